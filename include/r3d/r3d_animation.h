@@ -19,6 +19,18 @@
  * @{
  */
 
+// ========================================
+// ENUM TYPES
+// ========================================
+
+/**
+ * @brief Storage format of the keyframe values of an animation track.
+ */
+typedef enum {
+    R3D_ANIM_TRACK_FLOAT,       ///< Raw values (Vector3 or Quaternion).
+    R3D_ANIM_TRACK_QUANTIZED,   ///< Vector3 as 3x uint16 within the track range, Quaternion as smallest-three in 3x uint16.
+} R3D_AnimationTrackFormat;
+
 // ========================================
 // STRUCTS TYPES
 // ========================================
@@ -28,11 +40,15 @@
  *
  * Represents a single animated property (translation, rotation or scale).
  * Keys are sampled by time and interpolated at runtime.
+ * Quantized tracks are decoded on the fly while sampling.
  */
 typedef struct R3D_AnimationTrack {
-    const float* times;     ///< Keyframe times (sorted, in animation ticks).
-    const void* values;     ///< Keyframe values (Vector3 or Quaternion).
-    int count;              ///< Number of keyframes.
+    const float* times;                 ///< Keyframe times (sorted, in animation ticks).
+    const void* values;                 ///< Keyframe values, layout given by the format.
+    int count;                          ///< Number of keyframes.
+    R3D_AnimationTrackFormat format;    ///< Storage format of the keyframe values.
+    Vector3 rangeMin;                   ///< Quantized Vector3 tracks only; value of the code zero on each axis.
+    Vector3 rangeStep;                  ///< Quantized Vector3 tracks only; value step between two codes on each axis.
 } R3D_AnimationTrack;
 
 /**
@@ -58,6 +74,7 @@ typedef struct R3D_AnimationChannel {
 typedef struct R3D_Animation {
     R3D_AnimationChannel* channels;     ///< Array of animation channels, one per animated bone.
     int channelCount;                   ///< Total number of channels in this animation.
+    int* boneChannels;                  ///< Channel index for each bone, -1 if not animated (internal lookup, may be NULL).
     float ticksPerSecond;               ///< Playback rate; number of animation ticks per second.
     float duration;                     ///< Total length of the animation, in ticks.
     int boneCount;                      ///< Number of bones in the target skeleton.
@@ -92,6 +92,8 @@ typedef struct R3D_AnimationPlayer {
     Matrix* modelPose;          ///< Array of bone transforms in model space, obtained by hierarchical accumulation.
     Matrix* skinBuffer;         ///< Array of final skinning matrices (invBind * modelPose), sent to the GPU.
     uint32_t skinTexture;       ///< GPU texture ID storing the skinning matrices as a 1D RGBA16F texture.
+    uint32_t* keyCursors;       ///< Last sampled keyframe of each track of the active animation (internal, don't touch).
+    float* poseStreams;         ///< Sampled local pose, one float stream per transform component (internal, don't touch).
 
     R3D_AnimationEventCallback eventCallback;   ///< Callback function to receive animation events.
     void* eventUserData;                        ///< Optional user data pointer passed to the callback.
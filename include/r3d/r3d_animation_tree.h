@@ -156,6 +156,8 @@ typedef struct {
     int nodePoolSize;                  ///< Current animation node pool size.
     int nodePoolMaxSize;               ///< Maximum number of animation nodes, defined during load.
     int rootBone;                      ///< Optional root bone index, -1 if not defined.
+    float** posePool;                  ///< Scratch poses used while evaluating nodes, allocated on demand (internal, don't touch).
+    int posePoolDepth;                 ///< Number of scratch poses currently in use (internal, don't touch).
 
     R3D_AnimationTreeCallback updateCallback;   ///< Callback function to receive and modify final animation transformation.
     void* updateUserData;                       ///< Optional user data pointer passed to the callback.
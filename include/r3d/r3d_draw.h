@@ -125,6 +125,24 @@ R3DAPI void R3D_BeginCluster(BoundingBox aabb);
  */
 R3DAPI void R3D_EndCluster(void);
 
+/**
+ * @brief Begins a block of static shadow casters.
+ *
+ * Meshes and models drawn until R3D_EndStaticShadows() are rendered once into a
+ * cached depth layer of each shadow map, which is reused as long as the light does
+ * not move and the static casters drawn each frame stay the same (transforms, meshes,
+ * instance ranges). Other casters are drawn over a copy of that layer on each update.
+ *
+ * Static casters must still be drawn on every frame. Changes to the content of
+ * instance buffers or to skinning are not detected for static casters.
+ */
+R3DAPI void R3D_BeginStaticShadows(void);
+
+/**
+ * @brief Ends the current block of static shadow casters.
+ */
+R3DAPI void R3D_EndStaticShadows(void);
+
 /**
  * @brief Queues a light to be rendered for the current frame, without shadows.
  *
@@ -145,7 +163,8 @@ R3DAPI void R3D_PushLight(R3D_Light light);
  * been rendered before (so static lights can safely pass false from the start and
  * still get valid shadows). This happens even if the light is currently off-screen,
  * so you can safely ignore visibility when driving updateShadow, or factor it in
- * yourself if you want to defer updates for off-screen lights.
+ * yourself if you want to defer updates for off-screen lights. Updates beyond the
+ * budget set with R3D_SetShadowUpdateBudget() are postponed to a following frame.
  *
  * @param light The light data to submit (see R3D_Light).
  * @param map The shadow map to associate with this light for this frame.
@@ -408,6 +427,32 @@ R3DAPI void R3D_DrawDecalInstancedEx(R3D_Decal decal, R3D_InstanceBuffer instanc
  */
 R3DAPI void R3D_DrawDecalInstancedPro(R3D_Decal decal, R3D_InstanceBuffer instances, int offset, int count, Matrix transform);
 
+/**
+ * @brief Queues an occluder for CPU occlusion culling.
+ *
+ * The triangles of the mesh data are rasterized on the CPU into a coarse depth
+ * buffer (see R3D_HINT_OCCLUSION_BUFFER_SIZE). Objects whose bounds are entirely
+ * hidden behind the occluders are then skipped by the scene passes. Nothing is drawn.
+ *
+ * Occluders should be large and simple, and must not be bigger than the geometry they
+ * stand for, typically a low-poly version of walls, floors or terrain. Uses the indices
+ * if present, the vertices in order otherwise, as a triangle list.
+ * Occlusion culling is skipped entirely on frames without occluders.
+ *
+ * The data is copied, the command is executed during R3D_End().
+ */
+R3DAPI void R3D_DrawOccluder(R3D_MeshData data, Matrix transform);
+
+/**
+ * @brief Queues a box occluder for CPU occlusion culling.
+ *
+ * Same as R3D_DrawOccluder() with the six faces of the box.
+ * The box should fit inside the object it stands for (e.g. the inside of a wall).
+ *
+ * The command is executed during R3D_End().
+ */
+R3DAPI void R3D_DrawOccluderBox(BoundingBox box, Matrix transform);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
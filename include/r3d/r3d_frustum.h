@@ -12,6 +12,7 @@
 #include "./r3d_platform.h"
 #include "./r3d_shape.h"
 #include <raylib.h>
+#include <stdint.h>
 
 /**
  * @defgroup Frustum Frustum
@@ -58,6 +59,21 @@ typedef struct {
     Vector4 planes[R3D_PLANE_COUNT];
 } R3D_Frustum;
 
+/**
+ * @brief Axis-aligned boxes in structure-of-arrays layout, for batch frustum tests.
+ *
+ * Each pointer addresses one float per box, boxes are given by their center and half extents.
+ * The arrays don't need any particular alignment.
+ */
+typedef struct {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* extentX;
+    const float* extentY;
+    const float* extentZ;
+} R3D_BoxArray;
+
 // ========================================
 // PUBLIC API
 // ========================================
@@ -128,6 +144,21 @@ R3DAPI bool R3D_FrustumIntersectsBoundingBox(const R3D_Frustum* frustum, Boundin
  */
 R3DAPI bool R3D_FrustumIntersectsOrientedBox(const R3D_Frustum* frustum, R3D_OrientedBox obb);
 
+/**
+ * @brief Check many axis-aligned boxes against the frustum at once.
+ *
+ * Boxes are tested 8 at a time with AVX, 4 at a time with SSE or NEON,
+ * and one at a time when none is available at compile time.
+ * Each box gives the same result as R3D_FrustumIntersectsBoundingBox().
+ *
+ * @param frustum Frustum to test against. Must not be NULL.
+ * @param boxes Boxes to test, see R3D_BoxArray. Must not be NULL.
+ * @param count Number of boxes.
+ * @param outMask Receives one bit per box, set if the box intersects the frustum.
+ *                Must hold at least (count + 63) / 64 words, all of them are overwritten.
+ */
+R3DAPI void R3D_FrustumCullBoxes(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -81,6 +81,18 @@ typedef uint32_t R3D_ImportFlags;
  */
 #define R3D_IMPORT_VALIDATE_DATA        (1 << 4)
 
+/**
+ * @brief Compress imported animation clips.
+ *
+ * When enabled, constant tracks are collapsed to a single key, keys that
+ * interpolation reproduces within a small error are removed, rotations are
+ * quantized to 48-bit smallest-three and translations/scales to 16 bits
+ * per axis within the range of their track. Clips take several times less
+ * memory and are decoded on the fly while sampling, at the cost of a
+ * slightly longer import and a tiny loss of precision.
+ */
+#define R3D_IMPORT_COMPRESS_ANIMATIONS  (1 << 5)
+
 /**
  * @brief Enable high-quality import processing.
  *
@@ -37,6 +37,12 @@
  * The memory format of each enabled attribute is defined by `R3D_InstanceLayout`.
  * In shaders, these attributes are exposed as floating-point vectors, including
  * normalized integer formats such as UNORM/SNORM.
+ *
+ * `R3D_INSTANCE_CULLING` is not an attribute. When set, a CPU copy of every
+ * enabled stream is kept alongside the GPU buffers, and each instance is tested
+ * against the frustum of every pass (camera, shadow maps, probes). Only the
+ * visible instances are then re-uploaded and drawn. It requires the position
+ * attribute, and costs one CPU copy of the instance data.
  */
 typedef uint32_t R3D_InstanceFlags;
 
@@ -45,6 +51,7 @@ typedef uint32_t R3D_InstanceFlags;
 #define R3D_INSTANCE_SCALE      (1u << 2)   /*< Scale attribute: 3 components */
 #define R3D_INSTANCE_COLOR      (1u << 3)   /*< Color attribute: 4 components */
 #define R3D_INSTANCE_CUSTOM     (1u << 4)   /*< Custom attribute: 4 components */
+#define R3D_INSTANCE_CULLING    (1u << 5)   /*< Keeps a CPU copy of each attribute stream to enable per-instance frustum culling */
 
 /**
  * @brief Storage format used by an instance attribute.
@@ -190,6 +197,9 @@ R3DAPI void R3D_UploadInstances(R3D_InstanceBuffer buffer, R3D_InstanceFlags fla
  *
  * Call R3D_UnmapInstances when done writing.
  *
+ * @note With `R3D_INSTANCE_CULLING`, the returned pointer addresses the CPU copy,
+ *       and only the mapped range is uploaded by R3D_UnmapInstances.
+ *
  * @param buffer  Instance buffer containing the target GPU buffer.
  * @param flag    Attribute to map (single bit).
  * @param discard If true, existing buffer contents are invalidated,
@@ -205,6 +215,9 @@ R3DAPI void* R3D_MapInstances(R3D_InstanceBuffer buffer, R3D_InstanceFlags flag,
  * Prefer this over R3D_MapInstances for partial updates to avoid
  * touching unrelated data. Call R3D_UnmapInstances when done writing.
  *
+ * @note With `R3D_INSTANCE_CULLING`, the returned pointer addresses the CPU copy,
+ *       and only the mapped range is uploaded by R3D_UnmapInstances.
+ *
  * @param buffer  Instance buffer containing the target GPU buffer.
  * @param flag    Attribute to map (single bit).
  * @param offset  First instance index of the mapped range.
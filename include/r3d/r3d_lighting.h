@@ -19,6 +19,12 @@
  * @{
  */
 
+// ========================================
+// CONSTANTS
+// ========================================
+
+#define R3D_SHADOW_CASCADE_MAX 4
+
 // ========================================
 // ENUMS TYPES
 // ========================================
@@ -67,8 +73,26 @@ typedef struct R3D_ShadowMap {
     float slopeBias;        ///< Slope-scaled depth bias
     R3D_Layer cullMask;     ///< Layers considered when culling shadow casters for this map
     R3D_LightType type;     ///< Light type this shadow map was allocated for
+    float cascadeSplit;     ///< Cascade split scheme, from 0 for uniform to 1 for logarithmic splits (dir)
+    int cascadeUpdateInterval[R3D_SHADOW_CASCADE_MAX];  ///< Number of shadow updates between two renders of each cascade, 1 renders it on every update (dir)
 } R3D_ShadowMap;
 
+/**
+ * @brief Shadow update scheduling and residency statistics of the last rendered frame.
+ *
+ * A face is one cascade of a directional map, a spot map, or the six faces of
+ * an omni map counted individually.
+ */
+typedef struct R3D_ShadowStats {
+    int requestedFaces;     ///< Faces due for an update (requested, never rendered or previously deferred), including those of lights dropped by the light budget
+    int renderedFaces;      ///< Faces rendered within the budget
+    int deferredFaces;      ///< Faces postponed to a later frame by either budget, they keep their previous content
+    int oldestDeferral;     ///< Number of frames the oldest postponed update has been waiting, 0 if none
+    int residentMaps;       ///< Shadow maps holding a layer of the shadow map arrays
+    int evictedMaps;        ///< Shadow maps whose layer was reclaimed for a more important visible light
+    int missingMaps;        ///< Visible shadowed lights drawn without shadow, no layer was available for their map
+} R3D_ShadowStats;
+
 // ========================================
 // PUBLIC API
 // ========================================
@@ -96,16 +120,38 @@ R3DAPI R3D_Light R3D_CreateSpotLight(Vector3 pos, Vector3 dir, float range, Colo
  */
 R3DAPI R3D_Light R3D_CreateOmniLight(Vector3 pos, float range, Color color, float energy);
 
+/**
+ * @brief Sets the maximum number of spot and omni lights shaded per frame.
+ *
+ * Visible lights are ranked by importance, from their energy, range, distance to the
+ * camera and screen coverage. Lights beyond the budget are neither shaded nor have their
+ * shadow maps updated. The last few kept ones are dimmed, by at most half, as they get
+ * close to the cutoff, so that lights crossing it do not pop. Directional lights are not counted.
+ *
+ * @param maxLights Maximum number of lights per frame, 0 or less for no limit (default).
+ */
+R3DAPI void R3D_SetLightBudget(int maxLights);
+
+/**
+ * @brief Returns the maximum number of spot and omni lights shaded per frame, 0 if unlimited.
+ */
+R3DAPI int R3D_GetLightBudget(void);
+
 // ----------------------------------------
 // LIGHTING: Shadow Functions
 // ----------------------------------------
 
 /**
- * @brief Allocates a shadow map layer for a given light type.
+ * @brief Allocates a shadow map for a given light type.
  *
  * The shadow map resolution is fixed per light type and configured via
  * R3D_HINT_SHADOW_DIR_SIZE, R3D_HINT_SHADOW_SPOT_SIZE and R3D_HINT_SHADOW_OMNI_SIZE
- * before R3D is initialized.
+ * before R3D is initialized. Directional shadow maps are split into
+ * R3D_HINT_SHADOW_DIR_CASCADES cascades of that resolution each.
+ *
+ * GPU memory is only taken once the light is first visible. Under
+ * R3D_HINT_SHADOW_MEMORY_BUDGET, the maps of the least recently visible lights
+ * give their memory back to the visible ones and are rendered again when needed.
  *
  * @param type The light type this shadow map will be used with (must match
  *             the type of the light it is later passed to via R3D_PushLight()).
@@ -122,6 +168,29 @@ R3DAPI void R3D_UnloadShadowMap(R3D_ShadowMap shadowMap);
  */
 R3DAPI bool R3D_IsShadowMapValid(R3D_ShadowMap shadowMap);
 
+/**
+ * @brief Sets the maximum number of shadow faces rendered per frame.
+ *
+ * When more faces are due than the budget allows, they are ranked by screen coverage,
+ * distance to the camera and time spent waiting; the others keep their previous
+ * content and are rendered on a following frame. The six faces of an omni map are
+ * always rendered together, the most urgent group is rendered even if it exceeds the budget.
+ * Maps that were never rendered are served first.
+ *
+ * @param maxFaces Maximum number of faces per frame, 0 or less for no limit (default).
+ */
+R3DAPI void R3D_SetShadowUpdateBudget(int maxFaces);
+
+/**
+ * @brief Returns the maximum number of shadow faces rendered per frame, 0 if unlimited.
+ */
+R3DAPI int R3D_GetShadowUpdateBudget(void);
+
+/**
+ * @brief Returns the shadow scheduling statistics of the last rendered frame.
+ */
+R3DAPI R3D_ShadowStats R3D_GetShadowStats(void);
+
 // ----------------------------------------
 // LIGHTING: Light Helper Functions
 // ----------------------------------------
@@ -267,7 +267,7 @@ typedef struct R3D_Material {
     R3D_CullMode cullMode;                  ///< Face culling mode (default: BACK)
     bool unlit;                             ///< If true, material does not participate in lighting (default: false)
 
-    int priority;                           ///< Render order priority; lower values are drawn first (default: 0)
+    int priority;                           ///< Render order priority; lower values are drawn first, clamped to [-32768, 32767] (default: 0)
     R3D_SurfaceShader* shader;              ///< Custom shader applied to the material (default: NULL)
 
 } R3D_Material;
@@ -66,6 +66,7 @@ typedef struct R3D_Mesh {
     R3D_PrimitiveType primitiveType;        ///< Type of primitive that constitutes the vertices.
     R3D_Layer layerMask;                    ///< Bitfield indicating the rendering layer(s) of this mesh.
     BoundingBox aabb;                       ///< Axis-Aligned Bounding Box in local space.
+    bool vertexAlpha;                       ///< True if some vertex colors are not fully opaque, such meshes keep the full vertex format in shadow passes.
 
 } R3D_Mesh;
 
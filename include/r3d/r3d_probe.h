@@ -28,6 +28,7 @@
 typedef enum R3D_ProbeType {
     R3D_PROBE_ILLUMINATION,     ///< Captures indirect diffuse lighting.
     R3D_PROBE_REFLECTION,       ///< Captures environment reflections.
+    R3D_PROBE_ILLUMINATION_SH,  ///< Captures indirect diffuse lighting as 9 spherical harmonics coefficients.
 } R3D_ProbeType;
 
 // ========================================
@@ -59,6 +60,8 @@ extern "C" {
  * @brief Allocates a probe of the given type.
  *
  * @param type Whether this probe contributes indirect lighting or reflections.
+ *             Spherical harmonics illumination probes cost 9 texels instead of a cubemap
+ *             and skip the irradiance convolution, at the cost of lower angular detail.
  * @param interior Whether the skybox is taken into account when capturing this probe.
  * @param shadow Whether shadow casters are taken into account when capturing this probe.
  */
@@ -50,6 +50,7 @@ uniform sampler2D uSsilTex;
 uniform sampler2D uOrmTex;
 
 uniform samplerCubeArray uIrradianceTex;
+uniform sampler2D uIrradianceSHTex;
 uniform samplerCubeArray uPrefilterTex;
 uniform sampler2D uBrdfLutTex;
 
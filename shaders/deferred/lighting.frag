@@ -47,6 +47,9 @@ uniform sampler2DArrayShadow uShadowDirTex;
 uniform sampler2DArrayShadow uShadowSpotTex;
 uniform samplerCubeArrayShadow uShadowOmniTex;
 
+uniform samplerBuffer uLightDataTex;
+uniform usamplerBuffer uLightGridTex;
+
 // ================================
 // Helper Includes
 // ================================
@@ -68,21 +71,6 @@ void main()
     vec3 N = V_GetWorldNormal(uNormalTex, pixCoord);
     vec3 P = V_GetWorldPosition(vTexCoord, depth);
 
-    /* Compute light direction and the dot product of the normal and light direction */
-
-    vec3 Ldelta = uLight.position - P;
-    float Ldist = length(Ldelta);
-
-    vec3 L = (uLight.type == LIGHT_DIR) ? -uLight.direction : Ldelta / max(Ldist, 1e-4);
-    float NoL = dot(N, L);
-
-    if (NoL <= 0.0)
-    {
-        FragRadiance = vec4(0.0);
-        FragSpecular = vec4(0.0);
-        return;
-    }
-
     /* Sample albedo and ORM buffers */
 
     vec3 albedo = texelFetch(uAlbedoTex, pixCoord, 0).rgb;
@@ -93,58 +81,94 @@ void main()
     vec3 V = normalize(uView.position - P);
     float NoV = max(dot(N, V), 1e-4);
 
-    /* Compute the halfway vector between the view and light directions */
+    vec3 F0 = PBR_F0(orm.b, orm.w, albedo);
+    mat2 diskRot = L_ShadowDebandingMatrix(gl_FragCoord.xy);
 
-    vec3 H = normalize(V + L);
+    /* Loop through the directional lights then the local lights of the cluster */
 
-    float LoH = max(dot(L, H), 0.0);
-    float NoH = max(dot(N, H), 0.0);
+    ivec2 cluster = L_GetClusterLights(vTexCoord, depth);
+    int lightCount = uNumDirLights + cluster.y;
 
-    /* Compute light color energy */
+    vec3 diff = vec3(0.0);
+    vec3 spec = vec3(0.0);
 
-    vec3 lightColE = uLight.color * uLight.energy;
+    for (int i = 0; i < lightCount; i++)
+    {
+        int index = (i < uNumDirLights) ? i : L_GetClusterLightIndex(cluster.x + i - uNumDirLights);
+        Light light = L_FetchLight(index);
 
-    /* Compute diffuse lighting */
+        /* Compute light direction and the dot product of the normal and light direction */
 
-    vec3 diff = L_Diffuse(orm.g, NoV, NoL, LoH);
-    diff *= albedo * lightColE * (1.0 - orm.b);
+        vec3 Ldelta = light.position - P;
+        float Ldist = length(Ldelta);
 
-    /* Compute specular lighting */
+        if (light.type != LIGHT_DIR && Ldist >= light.range) continue;
 
-    vec3 F0 = PBR_F0(orm.b, orm.w, albedo);
-    vec3 spec = L_Specular(F0, orm.g, NoV, NoL, NoH, LoH);
-    spec *= lightColE * uLight.specular;
+        vec3 L = (light.type == LIGHT_DIR) ? -light.direction : Ldelta / max(Ldist, 1e-4);
+        float NoL = dot(N, L);
 
-    /* Compute shadow factor */
+        if (NoL <= 0.0) continue;
 
-    float shadow = 1.0;
+        /* Compute the light volume falloff, skipping pixels outside of the cone or range */
 
-    if (uLight.type != LIGHT_DIR)
-    {
-        float atten = pow(1.0 - clamp(Ldist / uLight.range, 0.0, 1.0), uLight.falloff);
-        shadow *= atten;
-    }
+        float shadow = 1.0;
 
-    if (uLight.type == LIGHT_SPOT)
-    {
-        float theta = dot(L, -uLight.direction);
-        float epsilon = (uLight.innerCutOff - uLight.outerCutOff);
-        shadow *= smoothstep(0.0, 1.0, (theta - uLight.outerCutOff) / epsilon);
-    }
+        if (light.type != LIGHT_DIR)
+        {
+            float atten = pow(1.0 - clamp(Ldist / light.range, 0.0, 1.0), light.falloff);
+            shadow *= atten;
+        }
 
-    if (uLight.shadowLayer >= 0 && uLight.shadowOpacity != 0.0 && shadow > 1e-4)
-    {
-        mat2 diskRot = L_ShadowDebandingMatrix(gl_FragCoord.xy);
-        switch (uLight.type)
+        if (light.type == LIGHT_SPOT)
         {
-        case LIGHT_DIR:  shadow *= L_SampleShadowDir(uLight, P, depth, NoL, diskRot); break;
-        case LIGHT_SPOT: shadow *= L_SampleShadowSpot(uLight, P, NoL, diskRot); break;
-        case LIGHT_OMNI: shadow *= L_SampleShadowOmni(uLight, P, NoL, diskRot); break;
+            float theta = dot(L, -light.direction);
+            float epsilon = (light.innerCutOff - light.outerCutOff);
+            shadow *= smoothstep(0.0, 1.0, (theta - light.outerCutOff) / epsilon);
         }
+
+        if (shadow <= 1e-4) continue;
+
+        /* Compute the halfway vector between the view and light directions */
+
+        vec3 H = normalize(V + L);
+
+        float LoH = max(dot(L, H), 0.0);
+        float NoH = max(dot(N, H), 0.0);
+
+        /* Compute light color energy */
+
+        vec3 lightColE = light.color * light.energy;
+
+        /* Compute diffuse lighting */
+
+        vec3 diffLight = L_Diffuse(orm.g, NoV, NoL, LoH);
+        diffLight *= albedo * lightColE * (1.0 - orm.b);
+
+        /* Compute specular lighting */
+
+        vec3 specLight = L_Specular(F0, orm.g, NoV, NoL, NoH, LoH);
+        specLight *= lightColE * light.specular;
+
+        /* Compute shadow factor */
+
+        if (light.shadowLayer >= 0 && light.shadowOpacity != 0.0)
+        {
+            switch (light.type)
+            {
+            case LIGHT_DIR:  shadow *= L_SampleShadowDir(light, P, depth, NoL, diskRot); break;
+            case LIGHT_SPOT: shadow *= L_SampleShadowSpot(light, P, NoL, diskRot); break;
+            case LIGHT_OMNI: shadow *= L_SampleShadowOmni(light, P, NoL, diskRot); break;
+            }
+        }
+
+        /* Accumulate the diffuse and specular lighting contributions */
+
+        diff += diffLight * shadow;
+        spec += specLight * shadow;
     }
 
     /* Compute final lighting contribution */
 
-    FragRadiance = vec4(diff * shadow, 1.0);
-    FragSpecular = vec4(spec * shadow, 1.0);
+    FragRadiance = vec4(diff, 1.0);
+    FragSpecular = vec4(spec, 1.0);
 }
@@ -22,6 +22,32 @@ vec3 IBL_SampleIrradiance(samplerCubeArray irradiance, int index, vec3 N, vec4 r
     return texture(irradiance, vec4(M_Rotate3D(N, rotation), float(index))).rgb;
 }
 
+vec3 IBL_SampleIrradianceSH(sampler2D coeffs, int index, vec3 N)
+{
+    // Coefficients are stored with the cosine lobe already applied, one row per probe
+    vec3 c0 = texelFetch(coeffs, ivec2(0, index), 0).rgb;
+    vec3 c1 = texelFetch(coeffs, ivec2(1, index), 0).rgb;
+    vec3 c2 = texelFetch(coeffs, ivec2(2, index), 0).rgb;
+    vec3 c3 = texelFetch(coeffs, ivec2(3, index), 0).rgb;
+    vec3 c4 = texelFetch(coeffs, ivec2(4, index), 0).rgb;
+    vec3 c5 = texelFetch(coeffs, ivec2(5, index), 0).rgb;
+    vec3 c6 = texelFetch(coeffs, ivec2(6, index), 0).rgb;
+    vec3 c7 = texelFetch(coeffs, ivec2(7, index), 0).rgb;
+    vec3 c8 = texelFetch(coeffs, ivec2(8, index), 0).rgb;
+
+    vec3 irradiance = c0 * 0.282095
+        + c1 * (0.488603 * N.y)
+        + c2 * (0.488603 * N.z)
+        + c3 * (0.488603 * N.x)
+        + c4 * (1.092548 * N.x * N.y)
+        + c5 * (1.092548 * N.y * N.z)
+        + c6 * (0.315392 * (3.0 * N.z * N.z - 1.0))
+        + c7 * (1.092548 * N.x * N.z)
+        + c8 * (0.546274 * (N.x * N.x - N.y * N.y));
+
+    return max(irradiance, vec3(0.0)); //< L2 ringing can go negative behind strong sources
+}
+
 vec3 IBL_SamplePrefilter(samplerCubeArray prefilter, int index, vec3 V, vec3 N, float roughness, int numLevels)
 {
     float mipLevel = roughness * float(numLevels - 1);
@@ -11,6 +11,7 @@ struct E_Probe {
     float falloff;
     float range;
     int   layer;
+    int   harmonics;    //< Illumination only, layer indexes the SH coefficients instead of the irradiance array
 };
 
 struct E_Ambient {
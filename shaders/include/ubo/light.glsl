@@ -1,4 +1,4 @@
-/* light.glsl -- Light data structures and uniform block.
+/* light.glsl -- Light data structures and uniform blocks.
  *
  * Copyright (c) 2025-2026 Le Juez Victor
  *
@@ -10,11 +10,18 @@
 #define LIGHT_SPOT  1
 #define LIGHT_OMNI  2
 
+#define SHADOW_CASCADE_MAX 4    //< Same as 'R3D_SHADOW_CASCADE_MAX'
+
 struct Light {
-    mat4 viewProj;
+#ifndef LIGHT_GRID
+    mat4 viewProj[SHADOW_CASCADE_MAX];  //< One per cascade (dir), only the first is used (spot)
+#else
+    int dataOffset;         //< First texel of the light in the light data, matrices are fetched on demand
+#endif
     vec3 color;
     vec3 position;
     vec3 direction;
+    vec4 shadowTile;        //< Offset (xy) and size (z) of the shadow map tile in its layer, in texture coordinates
     float energy;
     float specular;
     float range;
@@ -27,14 +34,18 @@ struct Light {
     float shadowDepthBias;
     float shadowSlopeBias;
     float shadowFar;
-    int shadowLayer;        //< less than zero if no shadows
+    int shadowLayer;        //< less than zero if no shadows, first cascade layer (dir)
     int type;
+    int cascadeCount;       //< Number of cascades starting at 'shadowLayer' (dir)
 };
 
-#ifdef MAX_LIGHTS_FORWARD
-layout(std140) uniform LightArrayBlock {
-    Light uLights[MAX_LIGHTS_FORWARD];
+#ifdef LIGHT_GRID
+layout(std140) uniform LightGridBlock {
+    ivec3 uLightGridSize;   //< Number of clusters along X, Y and depth slices
+    vec2 uLightGridDepth;   //< Depth slice is 'log(z) * x + y'
+    int uNumDirLights;      //< Directional lights are stored first in the light data
     int uNumLights;
+    bool uLightShadows;
 };
 #else
 layout(std140) uniform LightBlock {
@@ -16,7 +16,9 @@ vec4 E_SampleIlluminationProbe(E_Probe probe, vec3 P, vec3 N)
 
     if (weight < 1e-4) return vec4(0.0);
 
-    vec3 irradiance = IBL_SampleIrradiance(uIrradianceTex, probe.layer, N);
+    vec3 irradiance = (probe.harmonics != 0)
+        ? IBL_SampleIrradianceSH(uIrradianceSHTex, probe.layer, N)
+        : IBL_SampleIrradiance(uIrradianceTex, probe.layer, N);
 
     return vec4(irradiance * weight, weight);
 }
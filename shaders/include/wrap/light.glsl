@@ -9,6 +9,71 @@
 #include "../ubo/light.glsl"
 #include "../lib/pbr.glsl"
 
+/* === Light grid === */
+
+#ifdef LIGHT_GRID
+
+#define LIGHT_TEXELS 23
+
+Light L_FetchLight(int index)
+{
+    int base = index * LIGHT_TEXELS;
+
+    vec4 t0 = texelFetch(uLightDataTex, base + 0);
+    vec4 t1 = texelFetch(uLightDataTex, base + 1);
+    vec4 t2 = texelFetch(uLightDataTex, base + 2);
+    vec4 t3 = texelFetch(uLightDataTex, base + 3);
+    vec4 t4 = texelFetch(uLightDataTex, base + 4);
+    vec4 t5 = texelFetch(uLightDataTex, base + 5);
+    vec4 t6 = texelFetch(uLightDataTex, base + 6);
+
+    Light light;
+    light.dataOffset = base;
+    light.color = t0.xyz;
+    light.energy = t0.w;
+    light.position = t1.xyz;
+    light.range = t1.w;
+    light.direction = t2.xyz;
+    light.specular = t2.w;
+    light.falloff = t3.x;
+    light.innerCutOff = t3.y;
+    light.outerCutOff = t3.z;
+    light.fogEnergy = t3.w;
+    light.shadowSoftness = t4.x;
+    light.shadowOpacity = t4.y;
+    light.shadowDepthBias = t4.z;
+    light.shadowSlopeBias = t4.w;
+    light.shadowFar = t5.x;
+    light.shadowLayer = uLightShadows ? int(t5.y) : -1;
+    light.type = int(t5.z);
+    light.cascadeCount = int(t5.w);
+    light.shadowTile = t6;
+
+    return light;
+}
+
+#ifndef PROBE
+
+/* Returns the offset and count of the cluster light indices, 'uv' is the screen position in [0, 1] */
+ivec2 L_GetClusterLights(vec2 uv, float linearDepth)
+{
+    ivec3 cell;
+    cell.xy = clamp(ivec2(uv * vec2(uLightGridSize.xy)), ivec2(0), uLightGridSize.xy - 1);
+    cell.z = clamp(int(floor(log(max(linearDepth, 1e-4)) * uLightGridDepth.x + uLightGridDepth.y)), 0, uLightGridSize.z - 1);
+
+    int cluster = (cell.z * uLightGridSize.y + cell.y) * uLightGridSize.x + cell.x;
+    return ivec2(texelFetch(uLightGridTex, 2 * cluster).r, texelFetch(uLightGridTex, 2 * cluster + 1).r);
+}
+
+int L_GetClusterLightIndex(int index)
+{
+    return int(texelFetch(uLightGridTex, index).r);
+}
+
+#endif // !PROBE
+
+#endif // LIGHT_GRID
+
 /* === Lighting === */
 
 vec3 L_Diffuse(float roughness, float NoV, float NoL, float LoH)
@@ -50,23 +115,102 @@ mat2 L_ShadowDebandingMatrix(vec2 fragCoord)
     return mat2(vec2(cr, -sr), vec2(sr, cr));
 }
 
+mat4 L_GetShadowMatrix(Light light, int cascade)
+{
+#ifdef LIGHT_GRID
+    int base = light.dataOffset + 7 + 4 * cascade;
+    return mat4(
+        texelFetch(uLightDataTex, base + 0),
+        texelFetch(uLightDataTex, base + 1),
+        texelFetch(uLightDataTex, base + 2),
+        texelFetch(uLightDataTex, base + 3)
+    );
+#else
+    return light.viewProj[cascade];
+#endif
+}
+
+/* Maps coordinates of a full shadow map to its tile, kept half a texel inside so filtering never reads the neighbors */
+vec2 L_ShadowTileUV(vec4 tile, vec2 uv, float texelSize)
+{
+    vec2 halfTexel = vec2(0.5 * texelSize);
+    return tile.xy + clamp(uv * tile.z, halfTexel, vec2(tile.z) - halfTexel);
+}
+
+/* Same as 'L_ShadowTileUV()' for a cube map direction, the face is kept and its coordinates remapped */
+vec3 L_ShadowTileDir(vec4 tile, vec3 dir, float texelSize)
+{
+    vec3 a = abs(dir);
+    vec3 major, sAxis, tAxis;
+
+    // Axes of the face coordinates, following the cube map face selection rules
+    if (a.x >= a.y && a.x >= a.z)
+    {
+        float s = sign(dir.x);
+        major = vec3(s, 0.0, 0.0);
+        sAxis = vec3(0.0, 0.0, -s);
+        tAxis = vec3(0.0, -1.0, 0.0);
+    }
+    else if (a.y >= a.z)
+    {
+        float s = sign(dir.y);
+        major = vec3(0.0, s, 0.0);
+        sAxis = vec3(1.0, 0.0, 0.0);
+        tAxis = vec3(0.0, 0.0, s);
+    }
+    else
+    {
+        float s = sign(dir.z);
+        major = vec3(0.0, 0.0, s);
+        sAxis = vec3(s, 0.0, 0.0);
+        tAxis = vec3(0.0, -1.0, 0.0);
+    }
+
+    vec2 st = vec2(dot(dir, sAxis), dot(dir, tAxis)) / dot(dir, major) * 0.5 + 0.5;
+    st = L_ShadowTileUV(tile, st, texelSize) * 2.0 - 1.0;
+
+    return major + st.x * sAxis + st.y * tAxis;
+}
+
 float L_SampleShadowDir(Light light, vec3 Pws, float Zvs, float NoL, mat2 diskRot)
 {
-    vec4 Pls = light.viewProj * vec4(Pws, 1.0);
-    vec3 projCoords = Pls.xyz / Pls.w * 0.5 + 0.5;
+    /* --- Select the first cascade containing the filter disk --- */
+
+    int last = light.cascadeCount - 1;
+    int cascade = last;
+    vec3 projCoords = vec3(0.0);
+
+    for (int i = 0; i <= last; ++i)
+    {
+        vec4 Pls = L_GetShadowMatrix(light, i) * vec4(Pws, 1.0);
+        projCoords = Pls.xyz / Pls.w * 0.5 + 0.5;
+
+        float margin = (i < last) ? 2.0 * light.shadowSoftness : 0.0;
+        if (all(greaterThan(projCoords.xy, vec2(margin))) && all(lessThan(projCoords.xy, vec2(1.0 - margin))))
+        {
+            cascade = i;
+            break;
+        }
+    }
+
+    /* --- Filter the selected cascade --- */
+
     float bias = light.shadowDepthBias + light.shadowSlopeBias * (1.0 - NoL);
     float compareDepth = projCoords.z - bias;
+    float layer = float(light.shadowLayer + cascade);
 
     float shadow = 0.0;
     for (int i = 0; i < SHADOW_SAMPLES; ++i)
     {
         vec2 offset = diskRot * VOGEL_DISK[i] * light.shadowSoftness;
-        shadow += texture(uShadowDirTex, vec4(projCoords.xy + offset, light.shadowLayer, compareDepth));
+        shadow += texture(uShadowDirTex, vec4(projCoords.xy + offset, layer, compareDepth));
     }
     shadow /= float(SHADOW_SAMPLES);
 
+    /* --- Fade out at the borders of the last cascade and toward the range --- */
+
     vec3 distToBorder = min(projCoords, 1.0 - projCoords);
-    float edgeFade = smoothstep(0.0, 0.05, min(distToBorder.x, min(distToBorder.y, distToBorder.z)));
+    float edgeFade = (cascade < last) ? 1.0 : smoothstep(0.0, 0.05, min(distToBorder.x, min(distToBorder.y, distToBorder.z)));
     float distFade = smoothstep(light.range, light.range * 0.75, Zvs);
 
     return mix(1.0, shadow, edgeFade * distFade * light.shadowOpacity);
@@ -74,16 +218,18 @@ float L_SampleShadowDir(Light light, vec3 Pws, float Zvs, float NoL, mat2 diskRo
 
 float L_SampleShadowSpot(Light light, vec3 Pws, float NoL, mat2 diskRot)
 {
-    vec4 Pls = light.viewProj * vec4(Pws, 1.0);
+    vec4 Pls = L_GetShadowMatrix(light, 0) * vec4(Pws, 1.0);
     vec3 projCoords = Pls.xyz / Pls.w * 0.5 + 0.5;
     float bias = light.shadowDepthBias + light.shadowSlopeBias * (1.0 - NoL);
     float compareDepth = projCoords.z - bias;
+    float texelSize = 1.0 / float(textureSize(uShadowSpotTex, 0).x);
 
     float shadow = 0.0;
     for (int i = 0; i < SHADOW_SAMPLES; ++i)
     {
         vec2 offset = diskRot * VOGEL_DISK[i] * light.shadowSoftness;
-        shadow += texture(uShadowSpotTex, vec4(projCoords.xy + offset, light.shadowLayer, compareDepth));
+        vec2 uv = L_ShadowTileUV(light.shadowTile, projCoords.xy + offset, texelSize);
+        shadow += texture(uShadowSpotTex, vec4(uv, light.shadowLayer, compareDepth));
     }
     shadow /= float(SHADOW_SAMPLES);
 
@@ -99,12 +245,14 @@ float L_SampleShadowOmni(Light light, vec3 Pws, float NoL, mat2 diskRot)
     float compareDepth = (currentDepth - bias) / light.shadowFar;
 
     mat3 OBN = M_OrthonormalBasis(lightToFrag / currentDepth);
+    float texelSize = 1.0 / float(textureSize(uShadowOmniTex, 0).x);
 
     float shadow = 0.0;
     for (int i = 0; i < SHADOW_SAMPLES; ++i)
     {
         vec2 diskOffset = diskRot * VOGEL_DISK[i] * light.shadowSoftness;
-        shadow += texture(uShadowOmniTex, vec4(OBN * vec3(diskOffset.xy, 1.0), light.shadowLayer), compareDepth);
+        vec3 dir = L_ShadowTileDir(light.shadowTile, OBN * vec3(diskOffset.xy, 1.0), texelSize);
+        shadow += texture(uShadowOmniTex, vec4(dir, light.shadowLayer), compareDepth);
     }
     shadow /= float(SHADOW_SAMPLES);
 
@@ -0,0 +1,107 @@
+/* cubemap_sh.frag -- Spherical harmonics projection of a cubemap fragment shader
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#version 330 core
+
+// ================================
+// Includes
+// ================================
+
+#include <lib/math.glsl>
+
+// ================================
+// Out - Fragments
+// ================================
+
+out vec4 FragColor;
+
+// ================================
+// Samplers & Uniforms
+// ================================
+
+uniform samplerCube uSourceTex;
+uniform int uSourceFaceSize;        //< Face size of the projected mip level
+uniform float uSourceLod;           //< Projected mip level, at most 16x16 texels per face
+
+// ================================
+// Functions
+// ================================
+
+vec3 FaceDirection(int face, vec2 uv)
+{
+    // Any bijection between faces and directions works here, the
+    // cubemap is sampled through the direction it produces
+    if (face == 0) return vec3( 1.0, -uv.y, -uv.x);
+    if (face == 1) return vec3(-1.0, -uv.y,  uv.x);
+    if (face == 2) return vec3( uv.x,  1.0,  uv.y);
+    if (face == 3) return vec3( uv.x, -1.0, -uv.y);
+    if (face == 4) return vec3( uv.x, -uv.y,  1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+float BasisSH(int index, vec3 d)
+{
+    if (index == 0) return 0.282095;
+    if (index == 1) return 0.488603 * d.y;
+    if (index == 2) return 0.488603 * d.z;
+    if (index == 3) return 0.488603 * d.x;
+    if (index == 4) return 1.092548 * d.x * d.y;
+    if (index == 5) return 1.092548 * d.y * d.z;
+    if (index == 6) return 0.315392 * (3.0 * d.z * d.z - 1.0);
+    if (index == 7) return 1.092548 * d.x * d.z;
+    return 0.546274 * (d.x * d.x - d.y * d.y);
+}
+
+float CosineLobeSH(int index)
+{
+    // Clamped cosine convolution divided by PI (Ramamoorthi & Hanrahan), so the
+    // evaluated sum matches the irradiance cubemaps convention (E / PI)
+    if (index == 0) return 1.0;
+    if (index < 4) return 2.0 / 3.0;
+    return 0.25;
+}
+
+// ================================
+// Main Function
+// ================================
+
+void main()
+{
+    // One fragment per coefficient, the viewport covers a single row
+    int index = int(gl_FragCoord.x);
+
+    float invSize = 1.0 / float(uSourceFaceSize);
+
+    vec3 coeff = vec3(0.0);
+    float weightSum = 0.0;
+
+    for (int face = 0; face < 6; face++)
+    {
+        for (int y = 0; y < uSourceFaceSize; y++)
+        {
+            for (int x = 0; x < uSourceFaceSize; x++)
+            {
+                vec2 uv = 2.0 * (vec2(x, y) + 0.5) * invSize - 1.0;
+                vec3 dir = FaceDirection(face, uv);
+
+                // Solid angle of the texel, up to a constant factor
+                float r2 = 1.0 + dot(uv, uv);
+                float weight = 1.0 / (r2 * sqrt(r2));
+
+                vec3 L = textureLod(uSourceTex, dir, uSourceLod).rgb;
+                coeff += L * BasisSH(index, normalize(dir)) * weight;
+                weightSum += weight;
+            }
+        }
+    }
+
+    // Normalize the weights so they integrate to the full sphere
+    coeff *= (4.0 * M_PI) / weightSum;
+
+    FragColor = vec4(coeff * CosineLobeSH(index), 1.0);
+}
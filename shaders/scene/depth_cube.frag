@@ -18,6 +18,13 @@
 // In - Varyings
 // ================================
 
+// The geometry shader of the layered path forwards the varyings under its own names
+#if defined(LAYERED)
+#   define vPosition gPosition
+#   define vTexCoord gTexCoord
+#   define vColor gColor
+#endif // LAYERED
+
 smooth in vec3 vPosition;
 smooth in vec2 vTexCoord;
 smooth in vec4 vColor;
@@ -53,7 +53,13 @@ uniform sampler2DArrayShadow uShadowDirTex;
 uniform sampler2DArrayShadow uShadowSpotTex;
 uniform samplerCubeArrayShadow uShadowOmniTex;
 
+uniform samplerBuffer uLightDataTex;
+#if !defined(PROBE)
+uniform usamplerBuffer uLightGridTex;
+#endif // !PROBE
+
 uniform samplerCubeArray uIrradianceTex;
+uniform sampler2D uIrradianceSHTex;
 uniform samplerCubeArray uPrefilterTex;
 uniform sampler2D uBrdfLutTex;
 
@@ -114,27 +120,61 @@ void main()
     vec3 V = normalize(uViewPosition - vPosition);
     float NoV = max(dot(N, V), 1e-4);
 
-    /* Loop through all light sources accumulating diffuse and specular light */
+    /* Loop through the light sources affecting this fragment accumulating diffuse and specular light */
 
     mat2 diskRot  = L_ShadowDebandingMatrix(gl_FragCoord.xy);
 
     vec3 diff = vec3(0.0);
     vec3 spec = vec3(0.0);
 
-    for (int i = 0; i < uNumLights; i++)
+#if defined(PROBE)
+    int lightCount = uNumLights;
+#else
+    ivec2 cluster = L_GetClusterLights(gl_FragCoord.xy * uFrame.texelSize, vLinearDepth);
+    int lightCount = uNumDirLights + cluster.y;
+#endif
+
+    for (int i = 0; i < lightCount; i++)
     {
-        Light light = uLights[i];
+#if defined(PROBE)
+        Light light = L_FetchLight(i);
+#else
+        // Directional lights first, then the local lights of the cluster
+        int index = (i < uNumDirLights) ? i : L_GetClusterLightIndex(cluster.x + i - uNumDirLights);
+        Light light = L_FetchLight(index);
+#endif
 
         /* Compute light direction and the dot product of the normal and light direction */
 
         vec3 Ldelta = light.position - vPosition;
         float Ldist = length(Ldelta);
 
+        if (light.type != LIGHT_DIR && Ldist >= light.range) continue;
+
         vec3 L = (light.type == LIGHT_DIR) ? -light.direction : Ldelta / max(Ldist, 1e-4);
         float NoL = dot(N, L);
 
         if (NoL <= 0.0) continue;
 
+        /* Compute the light volume falloff, skipping pixels outside of the cone or range */
+
+        float shadow = 1.0;
+
+        if (light.type != LIGHT_DIR)
+        {
+            float atten = pow(1.0 - clamp(Ldist / light.range, 0.0, 1.0), light.falloff);
+            shadow *= atten;
+        }
+
+        if (light.type == LIGHT_SPOT)
+        {
+            float theta = dot(L, -light.direction);
+            float epsilon = (light.innerCutOff - light.outerCutOff);
+            shadow *= smoothstep(0.0, 1.0, (theta - light.outerCutOff) / epsilon);
+        }
+
+        if (shadow <= 1e-4) continue;
+
         /* Compute the halfway vector between the view and light directions */
 
         vec3 H = normalize(V + L);
@@ -158,22 +198,7 @@ void main()
 
         /* Compute shadow factor */
 
-        float shadow = 1.0;
-
-        if (light.type != LIGHT_DIR)
-        {
-            float atten = pow(1.0 - clamp(Ldist / light.range, 0.0, 1.0), light.falloff);
-            shadow *= atten;
-        }
-
-        if (light.type == LIGHT_SPOT)
-        {
-            float theta = dot(L, -light.direction);
-            float epsilon = (light.innerCutOff - light.outerCutOff);
-            shadow *= smoothstep(0.0, 1.0, (theta - light.outerCutOff) / epsilon);
-        }
-
-        if (light.shadowLayer >= 0 && light.shadowOpacity != 0.0 && shadow > 1e-4)
+        if (light.shadowLayer >= 0 && light.shadowOpacity != 0.0)
         {
             switch (light.type)
             {
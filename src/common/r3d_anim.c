@@ -7,14 +7,23 @@
  */
 
 #include "./r3d_anim.h"
+#include "./r3d_helper.h"
+
+#include <stdint.h>
+#include <math.h>
 
 // ========================================
 // INTERNAL FUNCTION
 // ========================================
 
+static bool key_frame_contains(const float* times, uint32_t count, uint32_t idx, float time)
+{
+    return idx < count - 1 && times[idx] <= time && time < times[idx + 1];
+}
+
 static void find_key_frames(const float* times, uint32_t count, float time,
                             uint32_t* outIdx0, uint32_t* outIdx1,
-                            float* outT)
+                            float* outT, uint32_t* cursor)
 {
     // No keys
     if (count == 0)
@@ -40,16 +49,41 @@ static void find_key_frames(const float* times, uint32_t count, float time,
         return;
     }
 
-    // Binary search
     uint32_t left = 0;
     uint32_t right = count - 1;
-    while(right - left > 1)
+
+    // Playback moves by small steps, the key of the last sample or one of
+    // its neighbours is almost always the right one; search only on seeks
+    uint32_t hint = cursor ? *cursor : UINT32_MAX;
+
+    if (key_frame_contains(times, count, hint, time))
+    {
+        left = hint;
+        right = hint + 1;
+    }
+    else if (hint < count && key_frame_contains(times, count, hint + 1, time))
+    {
+        left = hint + 1;
+        right = hint + 2;
+    }
+    else if (hint > 0 && hint < count && key_frame_contains(times, count, hint - 1, time))
+    {
+        left = hint - 1;
+        right = hint;
+    }
+    else
     {
-        uint32_t mid = (left + right) >> 1;
-        if (times[mid] <= time) left  = mid;
-        else right = mid;
+        // Binary search
+        while(right - left > 1)
+        {
+            uint32_t mid = (left + right) >> 1;
+            if (times[mid] <= time) left  = mid;
+            else right = mid;
+        }
     }
 
+    if (cursor) *cursor = left;
+
     *outIdx0 = left;
     *outIdx1 = right;
 
@@ -60,6 +94,324 @@ static void find_key_frames(const float* times, uint32_t count, float time,
     *outT = (dt > 0.0f) ? (time - t0) / dt : 0.0f;
 }
 
+static Vector3 track_get_vec3(const R3D_AnimationTrack* track, uint32_t idx)
+{
+    if (track->format == R3D_ANIM_TRACK_QUANTIZED)
+    {
+        const uint16_t* code = (const uint16_t*)track->values + 3 * idx;
+        return (Vector3) {
+            track->rangeMin.x + code[0] * track->rangeStep.x,
+            track->rangeMin.y + code[1] * track->rangeStep.y,
+            track->rangeMin.z + code[2] * track->rangeStep.z
+        };
+    }
+
+    return ((const Vector3*)track->values)[idx];
+}
+
+static Quaternion track_get_quat(const R3D_AnimationTrack* track, uint32_t idx)
+{
+    if (track->format == R3D_ANIM_TRACK_QUANTIZED)
+    {
+        // Smallest-three: 2 bits for the index of the dropped (largest) component,
+        // then the three others on 15 bits each within [-1/sqrt(2), 1/sqrt(2)]
+        const uint16_t* code = (const uint16_t*)track->values + 3 * idx;
+        uint64_t bits = (uint64_t)code[0] | ((uint64_t)code[1] << 16) | ((uint64_t)code[2] << 32);
+
+        int largest = (int)(bits & 0x3);
+        float q[4];
+        float sumSq = 0.0f;
+
+        for (int i = 0, shift = 2; i < 4; i++)
+        {
+            if (i == largest) continue;
+            float unorm = (float)((bits >> shift) & 0x7FFF) / 32767.0f;
+            q[i] = (2.0f * unorm - 1.0f) * 0.70710678f;
+            sumSq += q[i] * q[i];
+            shift += 15;
+        }
+
+        q[largest] = sqrtf(R3D_MAX(1.0f - sumSq, 0.0f));
+
+        return (Quaternion) {q[0], q[1], q[2], q[3]};
+    }
+
+    return ((const Quaternion*)track->values)[idx];
+}
+
+// ========================================
+// TRACK COMPRESSION FUNCTIONS
+// ========================================
+
+typedef float (*key_error_fn)(const void* values, int first, int last, int idx, float t);
+
+static float vec3_key_error(const void* values, int first, int last, int idx, float t)
+{
+    const Vector3* v = values;
+    Vector3 lerp = Vector3Lerp(v[first], v[last], t);
+
+    float dx = fabsf(lerp.x - v[idx].x);
+    float dy = fabsf(lerp.y - v[idx].y);
+    float dz = fabsf(lerp.z - v[idx].z);
+
+    return R3D_MAX(dx, R3D_MAX(dy, dz));
+}
+
+static float quat_key_error(const void* values, int first, int last, int idx, float t)
+{
+    const Quaternion* q = values;
+    Quaternion slerp = QuaternionSlerp(q[first], q[last], t);
+
+    float dot = fabsf(slerp.x * q[idx].x + slerp.y * q[idx].y + slerp.z * q[idx].z + slerp.w * q[idx].w);
+    return 2.0f * acosf(R3D_MIN(dot, 1.0f));
+}
+
+static bool segment_fits(const float* times, const void* values, int first, int last, float tolerance, key_error_fn error)
+{
+    float dt = times[last] - times[first];
+
+    for (int i = first + 1; i < last; i++)
+    {
+        float t = (dt > 0.0f) ? (times[i] - times[first]) / dt : 0.0f;
+        if (error(values, first, last, i, t) > tolerance) return false;
+    }
+
+    return true;
+}
+
+static int reduce_keys(float* times, void* values, size_t stride, int count, float tolerance, key_error_fn error)
+{
+    uint8_t* bytes = values;
+
+    // Constant tracks collapse to their first key
+    bool constant = true;
+    for (int i = 1; i < count && constant; i++)
+    {
+        constant = (error(values, 0, 0, i, 0.0f) <= tolerance);
+    }
+    if (constant) return R3D_MIN(count, 1);
+
+    // Greedy pass: extend each segment until interpolating it misses a dropped key.
+    // Kept keys are compacted in place, never past the anchor still being read.
+    int kept = 1;
+    int anchor = 0;
+
+    for (int i = 2; i < count; i++)
+    {
+        if (segment_fits(times, values, anchor, i, tolerance, error)) continue;
+
+        anchor = i - 1;
+        times[kept] = times[anchor];
+        memmove(bytes + kept * stride, bytes + anchor * stride, stride);
+        kept++;
+    }
+
+    times[kept] = times[count - 1];
+    memmove(bytes + kept * stride, bytes + (count - 1) * stride, stride);
+
+    return kept + 1;
+}
+
+/*
+ * Round-trip checks of a compressed track: the track is decoded and sampled at the time of
+ * every source key like r3d_anim_channel_lerp() does, then compared with the source value.
+ * Kept key times are a subset of the source ones, so the error between keys can't be larger.
+ */
+static bool vec3_track_matches(const R3D_AnimationTrack* track, const float* times, const Vector3* values, int count, float tolerance)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t i0, i1;
+        float t;
+        find_key_frames(track->times, track->count, times[i], &i0, &i1, &t, NULL);
+
+        Vector3 v = Vector3Lerp(track_get_vec3(track, i0), track_get_vec3(track, i1), t);
+        float error = R3D_MAX(fabsf(v.x - values[i].x), R3D_MAX(fabsf(v.y - values[i].y), fabsf(v.z - values[i].z)));
+
+        if (error > tolerance) return false;
+    }
+
+    return true;
+}
+
+static bool quat_track_matches(const R3D_AnimationTrack* track, const float* times, const Quaternion* values, int count, float tolerance)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t i0, i1;
+        float t;
+        find_key_frames(track->times, track->count, times[i], &i0, &i1, &t, NULL);
+
+        Quaternion q = QuaternionSlerp(track_get_quat(track, i0), track_get_quat(track, i1), t);
+        float dot = fabsf(q.x * values[i].x + q.y * values[i].y + q.z * values[i].z + q.w * values[i].w);
+
+        if (2.0f * acosf(R3D_MIN(dot, 1.0f)) > tolerance) return false;
+    }
+
+    return true;
+}
+
+static void compress_vec3_track(R3D_AnimationTrack* track)
+{
+    if (track->count == 0 || track->format != R3D_ANIM_TRACK_FLOAT) return;
+
+    float* times = (float*)track->times;
+    Vector3* values = (Vector3*)track->values;
+
+    Vector3 vMin = values[0];
+    Vector3 vMax = values[0];
+    for (int i = 1; i < track->count; i++)
+    {
+        vMin = Vector3Min(vMin, values[i]);
+        vMax = Vector3Max(vMax, values[i]);
+    }
+
+    Vector3 extent = Vector3Subtract(vMax, vMin);
+    float tolerance = R3D_ANIM_COMPRESS_LINEAR_ERROR * R3D_MAX(extent.x, R3D_MAX(extent.y, extent.z));
+
+    // Floors for near-constant tracks, the magnitude one stays above the float precision of the values
+    Vector3 magnitude = Vector3Max(Vector3Negate(vMin), vMax);
+    tolerance = R3D_MAX(tolerance, R3D_ANIM_COMPRESS_ABSOLUTE_ERROR);
+    tolerance = R3D_MAX(tolerance, R3D_ANIM_COMPRESS_MAGNITUDE_ERROR * R3D_MAX(magnitude.x, R3D_MAX(magnitude.y, magnitude.z)));
+
+    // Source keys, kept for the round-trip check
+    float* srcTimes = r3d_malloc(track->count * sizeof(float));
+    Vector3* srcValues = r3d_malloc(track->count * sizeof(Vector3));
+    memcpy(srcTimes, times, track->count * sizeof(float));
+    memcpy(srcValues, values, track->count * sizeof(Vector3));
+
+    int count = reduce_keys(times, values, sizeof(Vector3), track->count, tolerance, vec3_key_error);
+
+    // 16 bits per axis within the range of the track, a flat axis keeps a null step
+    Vector3 step = Vector3Scale(extent, 1.0f / 65535.0f);
+    uint16_t* codes = r3d_malloc(3 * count * sizeof(uint16_t));
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector3 v = Vector3Subtract(values[i], vMin);
+        codes[3 * i + 0] = (step.x > 0.0f) ? (uint16_t)R3D_CLAMP(roundf(v.x / step.x), 0.0f, 65535.0f) : 0;
+        codes[3 * i + 1] = (step.y > 0.0f) ? (uint16_t)R3D_CLAMP(roundf(v.y / step.y), 0.0f, 65535.0f) : 0;
+        codes[3 * i + 2] = (step.z > 0.0f) ? (uint16_t)R3D_CLAMP(roundf(v.z / step.z), 0.0f, 65535.0f) : 0;
+    }
+
+    R3D_AnimationTrack packed = {
+        .times = times, .values = codes, .count = count,
+        .format = R3D_ANIM_TRACK_QUANTIZED,
+        .rangeMin = vMin, .rangeStep = step
+    };
+
+    bool matches = vec3_track_matches(&packed, srcTimes, srcValues, track->count, R3D_ANIM_COMPRESS_CHECK_FACTOR * tolerance);
+
+    // Keep the source keys when the precision of the values can't hold the tolerance
+    if (!matches)
+    {
+        memcpy(times, srcTimes, track->count * sizeof(float));
+        memcpy(values, srcValues, track->count * sizeof(Vector3));
+        R3D_TRACELOG(LOG_DEBUG, "Animation track kept uncompressed, round-trip error exceeds the tolerance");
+    }
+
+    r3d_free(srcTimes);
+    r3d_free(srcValues);
+
+    if (!matches)
+    {
+        r3d_free(codes);
+        return;
+    }
+
+    r3d_free(values);
+
+    track->times = r3d_realloc(times, count * sizeof(float));
+    track->values = codes;
+    track->count = count;
+    track->format = R3D_ANIM_TRACK_QUANTIZED;
+    track->rangeMin = vMin;
+    track->rangeStep = step;
+}
+
+static void compress_quat_track(R3D_AnimationTrack* track)
+{
+    if (track->count == 0 || track->format != R3D_ANIM_TRACK_FLOAT) return;
+
+    float* times = (float*)track->times;
+    Quaternion* values = (Quaternion*)track->values;
+
+    for (int i = 0; i < track->count; i++)
+    {
+        values[i] = QuaternionNormalize(values[i]);
+    }
+
+    // Source keys, kept for the round-trip check
+    float* srcTimes = r3d_malloc(track->count * sizeof(float));
+    Quaternion* srcValues = r3d_malloc(track->count * sizeof(Quaternion));
+    memcpy(srcTimes, times, track->count * sizeof(float));
+    memcpy(srcValues, values, track->count * sizeof(Quaternion));
+
+    int count = reduce_keys(times, values, sizeof(Quaternion), track->count, R3D_ANIM_COMPRESS_ANGULAR_ERROR, quat_key_error);
+
+    // Smallest-three, see track_get_quat() for the layout
+    uint16_t* codes = r3d_malloc(3 * count * sizeof(uint16_t));
+
+    for (int i = 0; i < count; i++)
+    {
+        float q[4] = {values[i].x, values[i].y, values[i].z, values[i].w};
+
+        int largest = 0;
+        for (int c = 1; c < 4; c++)
+        {
+            if (fabsf(q[c]) > fabsf(q[largest])) largest = c;
+        }
+
+        // q and -q are the same rotation, keep the dropped component positive
+        float sign = (q[largest] < 0.0f) ? -1.0f : 1.0f;
+
+        uint64_t bits = (uint64_t)largest;
+        for (int c = 0, shift = 2; c < 4; c++)
+        {
+            if (c == largest) continue;
+            float unorm = (sign * q[c] * 1.41421356f + 1.0f) * 0.5f;
+            uint64_t code = (uint64_t)R3D_CLAMP(roundf(unorm * 32767.0f), 0.0f, 32767.0f);
+            bits |= code << shift;
+            shift += 15;
+        }
+
+        codes[3 * i + 0] = (uint16_t)(bits & 0xFFFF);
+        codes[3 * i + 1] = (uint16_t)((bits >> 16) & 0xFFFF);
+        codes[3 * i + 2] = (uint16_t)((bits >> 32) & 0xFFFF);
+    }
+
+    R3D_AnimationTrack packed = {
+        .times = times, .values = codes, .count = count,
+        .format = R3D_ANIM_TRACK_QUANTIZED
+    };
+
+    bool matches = quat_track_matches(&packed, srcTimes, srcValues, track->count,
+                                      R3D_ANIM_COMPRESS_CHECK_FACTOR * R3D_ANIM_COMPRESS_ANGULAR_ERROR);
+
+    if (!matches)
+    {
+        memcpy(times, srcTimes, track->count * sizeof(float));
+        memcpy(values, srcValues, track->count * sizeof(Quaternion));
+        R3D_TRACELOG(LOG_DEBUG, "Animation track kept uncompressed, round-trip error exceeds the tolerance");
+    }
+
+    r3d_free(srcTimes);
+    r3d_free(srcValues);
+
+    if (!matches)
+    {
+        r3d_free(codes);
+        return;
+    }
+
+    r3d_free(values);
+
+    track->times = r3d_realloc(times, count * sizeof(float));
+    track->values = codes;
+    track->count = count;
+    track->format = R3D_ANIM_TRACK_QUANTIZED;
+}
+
 // ========================================
 // TRANSFORM/MATRIX FUNCTIONS
 // ========================================
@@ -138,8 +490,39 @@ void r3d_anim_matrices_compute(R3D_AnimationPlayer* player)
 // ANIMATION CHANNEL FUNCTIONS
 // ========================================
 
+void r3d_anim_channel_build_table(R3D_Animation* anim)
+{
+    if (anim->boneCount <= 0) return;
+
+    int* table = r3d_realloc(anim->boneChannels, anim->boneCount * sizeof(int));
+
+    for (int i = 0; i < anim->boneCount; i++)
+    {
+        table[i] = -1;
+    }
+
+    // Walk backwards so the first channel wins, like the linear search
+    for (int i = anim->channelCount - 1; i >= 0; i--)
+    {
+        int boneIdx = anim->channels[i].boneIndex;
+        if (boneIdx >= 0 && boneIdx < anim->boneCount)
+        {
+            table[boneIdx] = i;
+        }
+    }
+
+    anim->boneChannels = table;
+}
+
 const R3D_AnimationChannel* r3d_anim_channel_find(const R3D_Animation* anim, int boneIdx)
 {
+    if (anim->boneChannels != NULL)
+    {
+        if (boneIdx < 0 || boneIdx >= anim->boneCount) return NULL;
+        int channelIdx = anim->boneChannels[boneIdx];
+        return (channelIdx >= 0) ? &anim->channels[channelIdx] : NULL;
+    }
+
     for (int i = 0; i < anim->channelCount; i++)
     {
         if (anim->channels[i].boneIndex == boneIdx)
@@ -150,7 +533,25 @@ const R3D_AnimationChannel* r3d_anim_channel_find(const R3D_Animation* anim, int
     return NULL;
 }
 
-Transform r3d_anim_channel_lerp(const R3D_AnimationChannel* channel, float time, Transform* rest0, Transform* restN)
+int r3d_anim_max_channel_count(R3D_AnimationLib animLib)
+{
+    int maxCount = 0;
+    for (int i = 0; i < animLib.count; i++)
+    {
+        maxCount = R3D_MAX(maxCount, animLib.animations[i].channelCount);
+    }
+    return maxCount;
+}
+
+void r3d_anim_channel_compress(R3D_AnimationChannel* channel)
+{
+    compress_vec3_track(&channel->translation);
+    compress_quat_track(&channel->rotation);
+    compress_vec3_track(&channel->scale);
+}
+
+Transform r3d_anim_channel_lerp(const R3D_AnimationChannel* channel, float time, Transform* rest0, Transform* restN,
+                                uint32_t* cursors)
 {
     Transform result = {
         .translation = {0.0f, 0.0f, 0.0f},
@@ -160,47 +561,50 @@ Transform r3d_anim_channel_lerp(const R3D_AnimationChannel* channel, float time,
 
     if (channel->translation.count > 0)
     {
-        const Vector3* values = (const Vector3*)channel->translation.values;
+        const R3D_AnimationTrack* track = &channel->translation;
         uint32_t i0, i1;
         float t;
         find_key_frames(
-            channel->translation.times,
-            channel->translation.count,
-            time, &i0, &i1, &t
+            track->times,
+            track->count,
+            time, &i0, &i1, &t,
+            cursors ? &cursors[0] : NULL
         );
-        result.translation = Vector3Lerp(values[i0], values[i1], t);
-        if (rest0) rest0->translation = values[0];
-        if (restN) restN->translation = values[channel->translation.count-1];
+        result.translation = Vector3Lerp(track_get_vec3(track, i0), track_get_vec3(track, i1), t);
+        if (rest0) rest0->translation = track_get_vec3(track, 0);
+        if (restN) restN->translation = track_get_vec3(track, track->count - 1);
     }
 
     if (channel->rotation.count > 0)
     {
-        const Quaternion* values = (const Quaternion*)channel->rotation.values;
+        const R3D_AnimationTrack* track = &channel->rotation;
         uint32_t i0, i1;
         float t;
         find_key_frames(
-            channel->rotation.times,
-            channel->rotation.count,
-            time, &i0, &i1, &t
+            track->times,
+            track->count,
+            time, &i0, &i1, &t,
+            cursors ? &cursors[1] : NULL
         );
-        result.rotation = QuaternionSlerp(values[i0], values[i1], t);
-        if (rest0) rest0->rotation = values[0];
-        if (restN) restN->rotation = values[channel->rotation.count-1];
+        result.rotation = QuaternionSlerp(track_get_quat(track, i0), track_get_quat(track, i1), t);
+        if (rest0) rest0->rotation = track_get_quat(track, 0);
+        if (restN) restN->rotation = track_get_quat(track, track->count - 1);
     }
 
     if (channel->scale.count > 0)
     {
-        const Vector3* values = (const Vector3*)channel->scale.values;
+        const R3D_AnimationTrack* track = &channel->scale;
         uint32_t i0, i1;
         float t;
         find_key_frames(
-            channel->scale.times,
-            channel->scale.count,
-            time, &i0, &i1, &t
+            track->times,
+            track->count,
+            time, &i0, &i1, &t,
+            cursors ? &cursors[2] : NULL
         );
-        result.scale = Vector3Lerp(values[i0], values[i1], t);
-        if (rest0) rest0->scale = values[0];
-        if (restN) restN->scale = values[channel->scale.count-1];
+        result.scale = Vector3Lerp(track_get_vec3(track, i0), track_get_vec3(track, i1), t);
+        if (rest0) rest0->scale = track_get_vec3(track, 0);
+        if (restN) restN->scale = track_get_vec3(track, track->count - 1);
     }
 
     return result;
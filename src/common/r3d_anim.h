@@ -13,6 +13,24 @@
 
 #include "./r3d_math.h"
 
+// ========================================
+// CONSTANTS
+// ========================================
+
+/* Keyframe cursors per channel, one per track (translation, rotation, scale) */
+#define R3D_ANIM_CURSORS_PER_CHANNEL 3
+
+/* Compression tolerances, linear error is relative to the extent of the track.
+ * The linear tolerance never goes below the floors, so near-constant noisy tracks still reduce. */
+#define R3D_ANIM_COMPRESS_LINEAR_ERROR    1e-4f
+#define R3D_ANIM_COMPRESS_ANGULAR_ERROR   1e-3f   //< radians
+#define R3D_ANIM_COMPRESS_ABSOLUTE_ERROR  1e-5f   //< floor, in track units
+#define R3D_ANIM_COMPRESS_MAGNITUDE_ERROR 2.5e-7f //< floor, relative to the largest value (~2 float ulps)
+
+/* Error allowed by the round-trip check of a compressed track, relative to the tolerances above.
+ * Key removal stays within them, quantization adds at most half a step on top. */
+#define R3D_ANIM_COMPRESS_CHECK_FACTOR  2.0f
+
 // ========================================
 // TRANSFORM/MATRIX FUNCTIONS
 // ========================================
@@ -29,7 +47,11 @@ void r3d_anim_matrices_compute(R3D_AnimationPlayer* player);
 // ANIMATION CHANNEL FUNCTIONS
 // ========================================
 
+void r3d_anim_channel_build_table(R3D_Animation* anim);
 const R3D_AnimationChannel* r3d_anim_channel_find(const R3D_Animation* anim, int boneIdx);
-Transform r3d_anim_channel_lerp(const R3D_AnimationChannel* channel, float time, Transform* rest0, Transform* restN);
+int r3d_anim_max_channel_count(R3D_AnimationLib animLib);
+void r3d_anim_channel_compress(R3D_AnimationChannel* channel);
+Transform r3d_anim_channel_lerp(const R3D_AnimationChannel* channel, float time, Transform* rest0, Transform* restN,
+                                uint32_t* cursors);
 
 #endif // R3D_COMMON_ANIM_H
@@ -0,0 +1,460 @@
+/* r3d_anim_pose.c -- Structure-of-arrays local poses and their batch kernels.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#include "./r3d_anim_pose.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX__)
+#   include <immintrin.h>
+#   define R3D_POSE_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   include <xmmintrin.h>
+#   define R3D_POSE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define R3D_POSE_NEON
+#endif
+
+#include "./r3d_helper.h"
+#include "./r3d_math.h"
+
+// ========================================
+// CONSTANTS
+// ========================================
+
+/* Squared quaternion length below which a rotation is treated as degenerate */
+#define POSE_QUAT_EPSILON 1e-12f
+
+// ========================================
+// SIMD WRAPPERS
+// ========================================
+
+/* The kernels are written once against these wrappers, the masks returned
+ * by the comparisons are only meant to be consumed by vf_select(). */
+
+#if defined(R3D_POSE_AVX)
+
+#define R3D_POSE_SIMD_WIDTH 8
+
+typedef __m256 vfloat_t;
+typedef __m256 vmask_t;
+
+static inline vfloat_t vf_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void vf_store(float* p, vfloat_t v) { _mm256_storeu_ps(p, v); }
+static inline vfloat_t vf_set1(float x) { return _mm256_set1_ps(x); }
+static inline vfloat_t vf_add(vfloat_t a, vfloat_t b) { return _mm256_add_ps(a, b); }
+static inline vfloat_t vf_sub(vfloat_t a, vfloat_t b) { return _mm256_sub_ps(a, b); }
+static inline vfloat_t vf_mul(vfloat_t a, vfloat_t b) { return _mm256_mul_ps(a, b); }
+static inline vfloat_t vf_madd(vfloat_t a, vfloat_t b, vfloat_t c) { return _mm256_add_ps(a, _mm256_mul_ps(b, c)); }
+static inline vfloat_t vf_rsqrt(vfloat_t x) { return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(x)); }
+static inline vfloat_t vf_xorsign(vfloat_t v, vfloat_t s) { return _mm256_xor_ps(v, _mm256_and_ps(s, _mm256_set1_ps(-0.0f))); }
+static inline vmask_t vf_gt(vfloat_t a, vfloat_t b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vmask_t vf_eq(vfloat_t a, vfloat_t b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline vfloat_t vf_select(vmask_t m, vfloat_t a, vfloat_t b) { return _mm256_blendv_ps(b, a, m); }
+
+#elif defined(R3D_POSE_SSE)
+
+#define R3D_POSE_SIMD_WIDTH 4
+
+typedef __m128 vfloat_t;
+typedef __m128 vmask_t;
+
+static inline vfloat_t vf_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void vf_store(float* p, vfloat_t v) { _mm_storeu_ps(p, v); }
+static inline vfloat_t vf_set1(float x) { return _mm_set1_ps(x); }
+static inline vfloat_t vf_add(vfloat_t a, vfloat_t b) { return _mm_add_ps(a, b); }
+static inline vfloat_t vf_sub(vfloat_t a, vfloat_t b) { return _mm_sub_ps(a, b); }
+static inline vfloat_t vf_mul(vfloat_t a, vfloat_t b) { return _mm_mul_ps(a, b); }
+static inline vfloat_t vf_madd(vfloat_t a, vfloat_t b, vfloat_t c) { return _mm_add_ps(a, _mm_mul_ps(b, c)); }
+static inline vfloat_t vf_rsqrt(vfloat_t x) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x)); }
+static inline vfloat_t vf_xorsign(vfloat_t v, vfloat_t s) { return _mm_xor_ps(v, _mm_and_ps(s, _mm_set1_ps(-0.0f))); }
+static inline vmask_t vf_gt(vfloat_t a, vfloat_t b) { return _mm_cmpgt_ps(a, b); }
+static inline vmask_t vf_eq(vfloat_t a, vfloat_t b) { return _mm_cmpeq_ps(a, b); }
+static inline vfloat_t vf_select(vmask_t m, vfloat_t a, vfloat_t b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+#elif defined(R3D_POSE_NEON)
+
+#define R3D_POSE_SIMD_WIDTH 4
+
+typedef float32x4_t vfloat_t;
+typedef uint32x4_t vmask_t;
+
+static inline vfloat_t vf_load(const float* p) { return vld1q_f32(p); }
+static inline void vf_store(float* p, vfloat_t v) { vst1q_f32(p, v); }
+static inline vfloat_t vf_set1(float x) { return vdupq_n_f32(x); }
+static inline vfloat_t vf_add(vfloat_t a, vfloat_t b) { return vaddq_f32(a, b); }
+static inline vfloat_t vf_sub(vfloat_t a, vfloat_t b) { return vsubq_f32(a, b); }
+static inline vfloat_t vf_mul(vfloat_t a, vfloat_t b) { return vmulq_f32(a, b); }
+static inline vfloat_t vf_madd(vfloat_t a, vfloat_t b, vfloat_t c) { return vmlaq_f32(a, b, c); }
+static inline vmask_t vf_gt(vfloat_t a, vfloat_t b) { return vcgtq_f32(a, b); }
+static inline vmask_t vf_eq(vfloat_t a, vfloat_t b) { return vceqq_f32(a, b); }
+static inline vfloat_t vf_select(vmask_t m, vfloat_t a, vfloat_t b) { return vbslq_f32(m, a, b); }
+
+static inline vfloat_t vf_rsqrt(vfloat_t x)
+{
+    // No vector sqrt/div on ARMv7, refine the estimate with two Newton-Raphson steps
+    vfloat_t e = vrsqrteq_f32(x);
+    e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+    e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+    return e;
+}
+
+static inline vfloat_t vf_xorsign(vfloat_t v, vfloat_t s)
+{
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(s), vdupq_n_u32(0x80000000u));
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v), sign));
+}
+
+#endif
+
+// ========================================
+// INTERNAL FUNCTIONS
+// ========================================
+
+static inline float mask_weight(const int32_t* mask, int boneIdx, float w)
+{
+    if (!mask) return w;
+    return (((uint32_t)mask[boneIdx >> 5] >> (boneIdx & 31)) & 1u) ? w : 0.0f;
+}
+
+/* Translation and scale streams, the ones blended linearly */
+static inline void linear_streams(const r3d_anim_pose_t* pose, float* streams[6])
+{
+    streams[0] = pose->tx, streams[1] = pose->ty, streams[2] = pose->tz;
+    streams[3] = pose->sx, streams[4] = pose->sy, streams[5] = pose->sz;
+}
+
+static inline void nlerp_bone(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, int i, float w)
+{
+    float ax = a->rx[i], ay = a->ry[i], az = a->rz[i], aw = a->rw[i];
+    float bx = b->rx[i], by = b->ry[i], bz = b->rz[i], bw = b->rw[i];
+
+    if (w != 0.0f)
+    {
+        // Shortest arc, the sign is taken from the bit like the SIMD path does
+        float sign = copysignf(1.0f, ax*bx + ay*by + az*bz + aw*bw);
+
+        ax += (bx * sign - ax) * w;
+        ay += (by * sign - ay) * w;
+        az += (bz * sign - az) * w;
+        aw += (bw * sign - aw) * w;
+
+        float len2 = ax*ax + ay*ay + az*az + aw*aw;
+        float invLen = (len2 > POSE_QUAT_EPSILON) ? 1.0f / sqrtf(len2) : 1.0f;
+
+        ax *= invLen, ay *= invLen, az *= invLen, aw *= invLen;
+    }
+
+    dst->rx[i] = ax, dst->ry[i] = ay, dst->rz[i] = az, dst->rw[i] = aw;
+}
+
+// ========================================
+// BATCH FUNCTIONS
+// ========================================
+
+/* Each kernel processes as many bones as its vector width allows and
+ * returns how many it processed, the caller finishes the tail.
+ * Mask words hold 32 bones so a group never straddles two of them. */
+
+#if defined(R3D_POSE_SIMD_WIDTH)
+
+static inline vfloat_t lane_weights(const int32_t* mask, int i, float w)
+{
+    if (!mask) return vf_set1(w);
+
+    float lanes[R3D_POSE_SIMD_WIDTH];
+    for (int k = 0; k < R3D_POSE_SIMD_WIDTH; k++)
+    {
+        lanes[k] = mask_weight(mask, i + k, w);
+    }
+
+    return vf_load(lanes);
+}
+
+static inline void nlerp_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, int i, vfloat_t w)
+{
+    vfloat_t ax = vf_load(a->rx + i), ay = vf_load(a->ry + i), az = vf_load(a->rz + i), aw = vf_load(a->rw + i);
+    vfloat_t bx = vf_load(b->rx + i), by = vf_load(b->ry + i), bz = vf_load(b->rz + i), bw = vf_load(b->rw + i);
+
+    vfloat_t dot = vf_mul(ax, bx);
+    dot = vf_madd(dot, ay, by);
+    dot = vf_madd(dot, az, bz);
+    dot = vf_madd(dot, aw, bw);
+
+    bx = vf_xorsign(bx, dot), by = vf_xorsign(by, dot);
+    bz = vf_xorsign(bz, dot), bw = vf_xorsign(bw, dot);
+
+    vfloat_t qx = vf_madd(ax, vf_sub(bx, ax), w);
+    vfloat_t qy = vf_madd(ay, vf_sub(by, ay), w);
+    vfloat_t qz = vf_madd(az, vf_sub(bz, az), w);
+    vfloat_t qw = vf_madd(aw, vf_sub(bw, aw), w);
+
+    vfloat_t len2 = vf_mul(qx, qx);
+    len2 = vf_madd(len2, qy, qy);
+    len2 = vf_madd(len2, qz, qz);
+    len2 = vf_madd(len2, qw, qw);
+
+    vfloat_t one = vf_set1(1.0f);
+    vfloat_t invLen = vf_select(vf_gt(len2, vf_set1(POSE_QUAT_EPSILON)), vf_rsqrt(len2), one);
+
+    // Lanes with a null weight keep their input untouched
+    vmask_t keep = vf_eq(w, vf_set1(0.0f));
+
+    vf_store(dst->rx + i, vf_select(keep, ax, vf_mul(qx, invLen)));
+    vf_store(dst->ry + i, vf_select(keep, ay, vf_mul(qy, invLen)));
+    vf_store(dst->rz + i, vf_select(keep, az, vf_mul(qz, invLen)));
+    vf_store(dst->rw + i, vf_select(keep, aw, vf_mul(qw, invLen)));
+}
+
+static int pose_blend_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, float w, const int32_t* mask)
+{
+    float *ds[6], *as[6], *bs[6];
+    linear_streams(dst, ds);
+    linear_streams(a, as);
+    linear_streams(b, bs);
+
+    int i = 0;
+    for (; i + R3D_POSE_SIMD_WIDTH <= dst->count; i += R3D_POSE_SIMD_WIDTH)
+    {
+        vfloat_t wv = lane_weights(mask, i, w);
+
+        for (int s = 0; s < 6; s++)
+        {
+            vfloat_t va = vf_load(as[s] + i);
+            vfloat_t vb = vf_load(bs[s] + i);
+            vf_store(ds[s] + i, vf_madd(va, vf_sub(vb, va), wv));
+        }
+
+        nlerp_simd(dst, a, b, i, wv);
+    }
+
+    return i;
+}
+
+static int pose_add_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, float w, const int32_t* mask)
+{
+    const float* as[R3D_ANIM_POSE_STREAMS] = {a->tx, a->ty, a->tz, a->rx, a->ry, a->rz, a->rw, a->sx, a->sy, a->sz};
+    const float* bs[R3D_ANIM_POSE_STREAMS] = {b->tx, b->ty, b->tz, b->rx, b->ry, b->rz, b->rw, b->sx, b->sy, b->sz};
+    float* ds[R3D_ANIM_POSE_STREAMS] = {dst->tx, dst->ty, dst->tz, dst->rx, dst->ry, dst->rz, dst->rw, dst->sx, dst->sy, dst->sz};
+
+    int i = 0;
+    for (; i + R3D_POSE_SIMD_WIDTH <= dst->count; i += R3D_POSE_SIMD_WIDTH)
+    {
+        vfloat_t wv = lane_weights(mask, i, w);
+
+        for (int s = 0; s < R3D_ANIM_POSE_STREAMS; s++)
+        {
+            vf_store(ds[s] + i, vf_madd(vf_load(as[s] + i), vf_load(bs[s] + i), wv));
+        }
+    }
+
+    return i;
+}
+
+static int pose_accumulate_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* src, float w)
+{
+    float *ds[6], *ss[6];
+    linear_streams(dst, ds);
+    linear_streams(src, ss);
+
+    const vfloat_t wv = vf_set1(w);
+
+    int i = 0;
+    for (; i + R3D_POSE_SIMD_WIDTH <= dst->count; i += R3D_POSE_SIMD_WIDTH)
+    {
+        for (int s = 0; s < 6; s++)
+        {
+            vf_store(ds[s] + i, vf_madd(vf_load(ds[s] + i), vf_load(ss[s] + i), wv));
+        }
+
+        nlerp_simd(dst, dst, src, i, wv);
+    }
+
+    return i;
+}
+
+static int pose_to_matrices_simd(Matrix* out, const r3d_anim_pose_t* pose)
+{
+    const vfloat_t zero = vf_set1(0.0f);
+    const vfloat_t one = vf_set1(1.0f);
+    const vfloat_t two = vf_set1(2.0f);
+
+    int i = 0;
+    for (; i + R3D_POSE_SIMD_WIDTH <= pose->count; i += R3D_POSE_SIMD_WIDTH)
+    {
+        vfloat_t qx = vf_load(pose->rx + i), qy = vf_load(pose->ry + i);
+        vfloat_t qz = vf_load(pose->rz + i), qw = vf_load(pose->rw + i);
+
+        vfloat_t len2 = vf_mul(qx, qx);
+        len2 = vf_madd(len2, qy, qy);
+        len2 = vf_madd(len2, qz, qz);
+        len2 = vf_madd(len2, qw, qw);
+
+        // Degenerate rotations collapse to zero, which yields the identity below
+        vfloat_t invLen = vf_select(vf_gt(len2, vf_set1(POSE_QUAT_EPSILON)), vf_rsqrt(len2), zero);
+        qx = vf_mul(qx, invLen), qy = vf_mul(qy, invLen);
+        qz = vf_mul(qz, invLen), qw = vf_mul(qw, invLen);
+
+        vfloat_t qx2 = vf_mul(qx, qx), qy2 = vf_mul(qy, qy), qz2 = vf_mul(qz, qz);
+        vfloat_t qxqy = vf_mul(qx, qy), qxqz = vf_mul(qx, qz), qxqw = vf_mul(qx, qw);
+        vfloat_t qyqz = vf_mul(qy, qz), qyqw = vf_mul(qy, qw), qzqw = vf_mul(qz, qw);
+
+        vfloat_t sx = vf_load(pose->sx + i);
+        vfloat_t sy = vf_load(pose->sy + i);
+        vfloat_t sz = vf_load(pose->sz + i);
+
+        /* --- Matrix elements, in the memory order of the struct --- */
+
+        float m[12][R3D_POSE_SIMD_WIDTH];
+
+        vf_store(m[0],  vf_mul(vf_sub(one, vf_mul(two, vf_add(qy2, qz2))), sx));
+        vf_store(m[1],  vf_mul(vf_mul(two, vf_sub(qxqy, qzqw)), sy));
+        vf_store(m[2],  vf_mul(vf_mul(two, vf_add(qxqz, qyqw)), sz));
+        vf_store(m[3],  vf_load(pose->tx + i));
+
+        vf_store(m[4],  vf_mul(vf_mul(two, vf_add(qxqy, qzqw)), sx));
+        vf_store(m[5],  vf_mul(vf_sub(one, vf_mul(two, vf_add(qx2, qz2))), sy));
+        vf_store(m[6],  vf_mul(vf_mul(two, vf_sub(qyqz, qxqw)), sz));
+        vf_store(m[7],  vf_load(pose->ty + i));
+
+        vf_store(m[8],  vf_mul(vf_mul(two, vf_sub(qxqz, qyqw)), sx));
+        vf_store(m[9],  vf_mul(vf_mul(two, vf_add(qyqz, qxqw)), sy));
+        vf_store(m[10], vf_mul(vf_sub(one, vf_mul(two, vf_add(qx2, qy2))), sz));
+        vf_store(m[11], vf_load(pose->tz + i));
+
+        for (int k = 0; k < R3D_POSE_SIMD_WIDTH; k++)
+        {
+            out[i + k] = (Matrix) {
+                m[0][k], m[1][k], m[2][k],  m[3][k],
+                m[4][k], m[5][k], m[6][k],  m[7][k],
+                m[8][k], m[9][k], m[10][k], m[11][k],
+                0, 0, 0, 1
+            };
+        }
+    }
+
+    return i;
+}
+
+#else
+
+static int pose_blend_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, float w, const int32_t* mask)
+{
+    (void)dst, (void)a, (void)b, (void)w, (void)mask;
+    return 0;
+}
+
+static int pose_add_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b, float w, const int32_t* mask)
+{
+    (void)dst, (void)a, (void)b, (void)w, (void)mask;
+    return 0;
+}
+
+static int pose_accumulate_simd(r3d_anim_pose_t* dst, const r3d_anim_pose_t* src, float w)
+{
+    (void)dst, (void)src, (void)w;
+    return 0;
+}
+
+static int pose_to_matrices_simd(Matrix* out, const r3d_anim_pose_t* pose)
+{
+    (void)out, (void)pose;
+    return 0;
+}
+
+#endif
+
+// ========================================
+// POSE FUNCTIONS
+// ========================================
+
+int r3d_anim_pose_buffer_size(int count)
+{
+    int stride = (R3D_MAX(count, 1) + 7) & ~7;
+    return R3D_ANIM_POSE_STREAMS * stride;
+}
+
+r3d_anim_pose_t r3d_anim_pose_view(float* buffer, int count)
+{
+    int stride = r3d_anim_pose_buffer_size(count) / R3D_ANIM_POSE_STREAMS;
+
+    return (r3d_anim_pose_t) {
+        .tx = buffer + 0 * stride, .ty = buffer + 1 * stride, .tz = buffer + 2 * stride,
+        .rx = buffer + 3 * stride, .ry = buffer + 4 * stride, .rz = buffer + 5 * stride, .rw = buffer + 6 * stride,
+        .sx = buffer + 7 * stride, .sy = buffer + 8 * stride, .sz = buffer + 9 * stride,
+        .count = count,
+        .stride = stride
+    };
+}
+
+void r3d_anim_pose_zero(r3d_anim_pose_t* pose)
+{
+    memset(pose->tx, 0, R3D_ANIM_POSE_STREAMS * pose->stride * sizeof(float));
+}
+
+void r3d_anim_pose_blend(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b,
+                         float w, const int32_t* mask)
+{
+    float *ds[6], *as[6], *bs[6];
+    linear_streams(dst, ds);
+    linear_streams(a, as);
+    linear_streams(b, bs);
+
+    for (int i = pose_blend_simd(dst, a, b, w, mask); i < dst->count; i++)
+    {
+        float wi = mask_weight(mask, i, w);
+        for (int s = 0; s < 6; s++)
+        {
+            ds[s][i] = as[s][i] + (bs[s][i] - as[s][i]) * wi;
+        }
+        nlerp_bone(dst, a, b, i, wi);
+    }
+}
+
+void r3d_anim_pose_add(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b,
+                       float w, const int32_t* mask)
+{
+    for (int i = pose_add_simd(dst, a, b, w, mask); i < dst->count; i++)
+    {
+        Transform ta = r3d_anim_pose_get(a, i);
+        Transform tb = r3d_anim_pose_get(b, i);
+        float wi = mask_weight(mask, i, w);
+
+        r3d_anim_pose_set(dst, i, (Transform) {
+            .translation = Vector3Add(ta.translation, Vector3Scale(tb.translation, wi)),
+            .rotation = QuaternionAdd(ta.rotation, QuaternionScale(tb.rotation, wi)),
+            .scale = Vector3Add(ta.scale, Vector3Scale(tb.scale, wi))
+        });
+    }
+}
+
+void r3d_anim_pose_accumulate(r3d_anim_pose_t* dst, const r3d_anim_pose_t* src, float w)
+{
+    float *ds[6], *ss[6];
+    linear_streams(dst, ds);
+    linear_streams(src, ss);
+
+    for (int i = pose_accumulate_simd(dst, src, w); i < dst->count; i++)
+    {
+        for (int s = 0; s < 6; s++)
+        {
+            ds[s][i] += ss[s][i] * w;
+        }
+        nlerp_bone(dst, dst, src, i, w);
+    }
+}
+
+void r3d_anim_pose_to_matrices(Matrix* out, const r3d_anim_pose_t* pose)
+{
+    for (int i = pose_to_matrices_simd(out, pose); i < pose->count; i++)
+    {
+        Transform tf = r3d_anim_pose_get(pose, i);
+        out[i] = r3d_matrix_srt_quat(tf.scale, tf.rotation, tf.translation);
+    }
+}
@@ -0,0 +1,96 @@
+/* r3d_anim_pose.h -- Structure-of-arrays local poses and their batch kernels.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#ifndef R3D_ANIM_POSE_H
+#define R3D_ANIM_POSE_H
+
+#include <raylib.h>
+#include <stdint.h>
+
+// ========================================
+// CONSTANTS
+// ========================================
+
+/* Number of float streams of a pose: translation xyz, rotation xyzw, scale xyz */
+#define R3D_ANIM_POSE_STREAMS 10
+
+// ========================================
+// POSE STRUCT
+// ========================================
+
+/* View over a single buffer of R3D_ANIM_POSE_STREAMS consecutive streams,
+ * each holding one component for every bone. Streams are padded to a
+ * multiple of 8 floats so each of them starts on a 32 bytes boundary
+ * relative to the buffer.
+ */
+typedef struct {
+    float* tx; float* ty; float* tz;
+    float* rx; float* ry; float* rz; float* rw;
+    float* sx; float* sy; float* sz;
+    int count;      //< Number of bones
+    int stride;     //< Distance between two streams, in floats
+} r3d_anim_pose_t;
+
+// ========================================
+// POSE FUNCTIONS
+// ========================================
+
+/* Returns the number of floats a pose buffer of 'count' bones needs */
+int r3d_anim_pose_buffer_size(int count);
+
+/* Returns a pose view over 'buffer', sized with r3d_anim_pose_buffer_size() */
+r3d_anim_pose_t r3d_anim_pose_view(float* buffer, int count);
+
+/* Sets every component of every bone to zero */
+void r3d_anim_pose_zero(r3d_anim_pose_t* pose);
+
+/* dst = a + (b - a) * w, rotations are nlerped along the shortest arc.
+ * Bones whose bit is cleared in 'mask' keep 'a', a NULL mask selects all of them.
+ * 'dst' may alias 'a' or 'b'. */
+void r3d_anim_pose_blend(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b,
+                         float w, const int32_t* mask);
+
+/* dst = a + b * w on every component, same masking rules as r3d_anim_pose_blend() */
+void r3d_anim_pose_add(r3d_anim_pose_t* dst, const r3d_anim_pose_t* a, const r3d_anim_pose_t* b,
+                       float w, const int32_t* mask);
+
+/* Weighted accumulation into 'dst', translations and scales are summed,
+ * rotations are nlerped toward 'src'. Start from a zeroed pose. */
+void r3d_anim_pose_accumulate(r3d_anim_pose_t* dst, const r3d_anim_pose_t* src, float w);
+
+/* Builds the local SRT matrix of every bone, rotations are normalized */
+void r3d_anim_pose_to_matrices(Matrix* out, const r3d_anim_pose_t* pose);
+
+// ========================================
+// INLINE FUNCTIONS
+// ========================================
+
+static inline Transform r3d_anim_pose_get(const r3d_anim_pose_t* pose, int boneIdx)
+{
+    return (Transform) {
+        .translation = {pose->tx[boneIdx], pose->ty[boneIdx], pose->tz[boneIdx]},
+        .rotation = {pose->rx[boneIdx], pose->ry[boneIdx], pose->rz[boneIdx], pose->rw[boneIdx]},
+        .scale = {pose->sx[boneIdx], pose->sy[boneIdx], pose->sz[boneIdx]}
+    };
+}
+
+static inline void r3d_anim_pose_set(r3d_anim_pose_t* pose, int boneIdx, Transform tf)
+{
+    pose->tx[boneIdx] = tf.translation.x;
+    pose->ty[boneIdx] = tf.translation.y;
+    pose->tz[boneIdx] = tf.translation.z;
+    pose->rx[boneIdx] = tf.rotation.x;
+    pose->ry[boneIdx] = tf.rotation.y;
+    pose->rz[boneIdx] = tf.rotation.z;
+    pose->rw[boneIdx] = tf.rotation.w;
+    pose->sx[boneIdx] = tf.scale.x;
+    pose->sy[boneIdx] = tf.scale.y;
+    pose->sz[boneIdx] = tf.scale.z;
+}
+
+#endif // R3D_ANIM_POSE_H
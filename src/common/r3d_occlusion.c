@@ -0,0 +1,371 @@
+/* r3d_occlusion.c -- Coarse CPU depth buffer for occlusion culling.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#include "./r3d_occlusion.h"
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "./r3d_helper.h"
+
+// ========================================
+// INTERNAL TYPES
+// ========================================
+
+/* Clip space position */
+typedef struct {
+    float x, y, z, w;
+} occ_clip_t;
+
+/* Screen position in texels, with window depth */
+typedef struct {
+    float x, y, z;
+} occ_screen_t;
+
+// ========================================
+// INTERNAL FUNCTIONS
+// ========================================
+
+static inline occ_clip_t occ_to_clip(const Matrix* m, Vector3 p)
+{
+    return (occ_clip_t) {
+        .x = m->m0 * p.x + m->m4 * p.y + m->m8 * p.z + m->m12,
+        .y = m->m1 * p.x + m->m5 * p.y + m->m9 * p.z + m->m13,
+        .z = m->m2 * p.x + m->m6 * p.y + m->m10 * p.z + m->m14,
+        .w = m->m3 * p.x + m->m7 * p.y + m->m11 * p.z + m->m15
+    };
+}
+
+static inline occ_screen_t occ_to_screen(const r3d_occlusion_t* occ, occ_clip_t c)
+{
+    float invW = 1.0f / c.w;
+
+    return (occ_screen_t) {
+        .x = (c.x * invW * 0.5f + 0.5f) * occ->widths[0],
+        .y = (c.y * invW * 0.5f + 0.5f) * occ->heights[0],
+        .z = c.z * invW * 0.5f + 0.5f
+    };
+}
+
+static inline occ_clip_t occ_clip_lerp(occ_clip_t a, occ_clip_t b, float t)
+{
+    return (occ_clip_t) {
+        .x = a.x + (b.x - a.x) * t,
+        .y = a.y + (b.y - a.y) * t,
+        .z = a.z + (b.z - a.z) * t,
+        .w = a.w + (b.w - a.w) * t
+    };
+}
+
+/* Near plane distance of a clip position, z >= -w inside */
+static inline float occ_near_distance(occ_clip_t c)
+{
+    return c.z + c.w;
+}
+
+static void occ_raster_triangle(r3d_occlusion_t* occ, occ_screen_t v0, occ_screen_t v1, occ_screen_t v2)
+{
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (fabsf(area) < 1e-6f) return;
+
+    // Both windings occlude, make it counter clockwise
+    if (area < 0.0f)
+    {
+        R3D_SWAP(occ_screen_t, v1, v2);
+        area = -area;
+    }
+
+    int width = occ->widths[0];
+    int height = occ->heights[0];
+
+    int minX = R3D_MAX((int)floorf(R3D_MIN(v0.x, R3D_MIN(v1.x, v2.x))), 0);
+    int minY = R3D_MAX((int)floorf(R3D_MIN(v0.y, R3D_MIN(v1.y, v2.y))), 0);
+    int maxX = R3D_MIN((int)ceilf(R3D_MAX(v0.x, R3D_MAX(v1.x, v2.x))), width) - 1;
+    int maxY = R3D_MIN((int)ceilf(R3D_MAX(v0.y, R3D_MAX(v1.y, v2.y))), height) - 1;
+
+    if (minX > maxX || minY > maxY) return;
+
+    /* --- Edge functions, positive inside, coverage is sampled at texel centers --- */
+
+    float a[3] = { v1.y - v2.y, v2.y - v0.y, v0.y - v1.y };
+    float b[3] = { v2.x - v1.x, v0.x - v2.x, v1.x - v0.x };
+    float c[3] = {
+        v1.x * v2.y - v2.x * v1.y,
+        v2.x * v0.y - v0.x * v2.y,
+        v0.x * v1.y - v1.x * v0.y
+    };
+
+    /* --- Depth plane, evaluated at the farthest corner of each texel --- */
+
+    float invArea = 1.0f / area;
+    float dzdx = (a[0] * v0.z + a[1] * v1.z + a[2] * v2.z) * invArea;
+    float dzdy = (b[0] * v0.z + b[1] * v1.z + b[2] * v2.z) * invArea;
+    float zBias = 0.5f * (fabsf(dzdx) + fabsf(dzdy));
+    float zMax = R3D_MAX(v0.z, R3D_MAX(v1.z, v2.z));
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = (float)y + 0.5f;
+        float* row = occ->levels[0] + (size_t)y * width;
+
+        for (int x = minX; x <= maxX; x++)
+        {
+            float px = (float)x + 0.5f;
+
+            float e0 = a[0] * px + b[0] * py + c[0];
+            float e1 = a[1] * px + b[1] * py + c[1];
+            float e2 = a[2] * px + b[2] * py + c[2];
+            if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+
+            float z = v0.z + dzdx * (px - v0.x) + dzdy * (py - v0.y) + zBias;
+            z = R3D_MIN(z, zMax);
+
+            if (z < row[x]) row[x] = z;
+        }
+    }
+}
+
+// ========================================
+// OCCLUSION FUNCTIONS
+// ========================================
+
+void r3d_occlusion_begin(r3d_occlusion_t* occ, int width, int height, Matrix viewProj)
+{
+    width = R3D_MAX(width, 1);
+    height = R3D_MAX(height, 1);
+
+    /* --- Lay out the levels down to 1x1 --- */
+
+    size_t total = 0;
+    int levelCount = 0;
+    int w = width, h = height;
+
+    while (levelCount < R3D_OCCLUSION_MAX_LEVELS)
+    {
+        occ->widths[levelCount] = w;
+        occ->heights[levelCount] = h;
+        total += (size_t)w * h;
+        levelCount++;
+
+        if (w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    // The erosion pass needs a scratch copy of level 0
+    total += (size_t)width * height;
+
+    if (total > occ->capacity)
+    {
+        occ->memory = r3d_realloc(occ->memory, total * sizeof(float));
+        occ->capacity = total;
+    }
+
+    float* level = occ->memory;
+    for (int i = 0; i < levelCount; i++)
+    {
+        occ->levels[i] = level;
+        level += (size_t)occ->widths[i] * occ->heights[i];
+    }
+
+    occ->scratch = level;
+    occ->levelCount = levelCount;
+    occ->viewProj = viewProj;
+
+    /* --- Clear level 0 to the far plane, the others are rebuilt from it --- */
+
+    float* depth = occ->levels[0];
+    for (size_t i = 0, n = (size_t)width * height; i < n; i++)
+    {
+        depth[i] = 1.0f;
+    }
+}
+
+void r3d_occlusion_release(r3d_occlusion_t* occ)
+{
+    r3d_free(occ->memory);
+    memset(occ, 0, sizeof(*occ));
+}
+
+void r3d_occlusion_draw_triangles(r3d_occlusion_t* occ, const Vector3* positions, int vertexCount)
+{
+    for (int t = 0; t + 2 < vertexCount; t += 3)
+    {
+        occ_clip_t in[3] = {
+            occ_to_clip(&occ->viewProj, positions[t + 0]),
+            occ_to_clip(&occ->viewProj, positions[t + 1]),
+            occ_to_clip(&occ->viewProj, positions[t + 2])
+        };
+
+        /* --- Clip against the near plane, a triangle becomes at most a quad --- */
+
+        occ_clip_t poly[4];
+        int count = 0;
+
+        for (int i = 0; i < 3; i++)
+        {
+            occ_clip_t a = in[i];
+            occ_clip_t b = in[(i + 1) % 3];
+            float da = occ_near_distance(a);
+            float db = occ_near_distance(b);
+
+            if (da >= 0.0f) poly[count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                poly[count++] = occ_clip_lerp(a, b, da / (da - db));
+            }
+        }
+
+        if (count < 3) continue;
+
+        /* --- Project and fill as a fan --- */
+
+        occ_screen_t screen[4];
+        bool projectable = true;
+
+        for (int i = 0; i < count && projectable; i++)
+        {
+            // Degenerate projections may still leave w at zero past the near plane
+            projectable = (poly[i].w > 0.0f);
+            if (projectable) screen[i] = occ_to_screen(occ, poly[i]);
+        }
+
+        if (!projectable) continue;
+
+        for (int i = 1; i + 1 < count; i++)
+        {
+            occ_raster_triangle(occ, screen[0], screen[i], screen[i + 1]);
+        }
+    }
+}
+
+void r3d_occlusion_build_hierarchy(r3d_occlusion_t* occ)
+{
+    /* --- Erode the coverage by one texel, so partially covered edge texels are dropped --- */
+
+    // Texels beyond the borders count as uncovered, the coverage of border texels is unknown past them
+
+    int width = occ->widths[0];
+    int height = occ->heights[0];
+    float* depth = occ->levels[0];
+    float* scratch = occ->scratch;
+
+    for (int y = 0; y < height; y++)
+    {
+        const float* row = depth + (size_t)y * width;
+        float* dst = scratch + (size_t)y * width;
+
+        for (int x = 0; x < width; x++)
+        {
+            float left = (x > 0) ? row[x - 1] : 1.0f;
+            float right = (x + 1 < width) ? row[x + 1] : 1.0f;
+            dst[x] = R3D_MAX(R3D_MAX(left, row[x]), right);
+        }
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        const float* above = (y > 0) ? scratch + (size_t)(y - 1) * width : NULL;
+        const float* below = (y + 1 < height) ? scratch + (size_t)(y + 1) * width : NULL;
+        const float* row = scratch + (size_t)y * width;
+        float* dst = depth + (size_t)y * width;
+
+        for (int x = 0; x < width; x++)
+        {
+            float d = R3D_MAX(above ? above[x] : 1.0f, row[x]);
+            dst[x] = R3D_MAX(d, below ? below[x] : 1.0f);
+        }
+    }
+
+    /* --- Reduce each level from the previous one --- */
+
+    for (int l = 1; l < occ->levelCount; l++)
+    {
+        const float* src = occ->levels[l - 1];
+        float* dst = occ->levels[l];
+
+        int srcW = occ->widths[l - 1];
+        int srcH = occ->heights[l - 1];
+        int dstW = occ->widths[l];
+        int dstH = occ->heights[l];
+
+        for (int y = 0; y < dstH; y++)
+        {
+            int y0 = 2 * y;
+            int y1 = R3D_MIN(y0 + 1, srcH - 1);
+
+            for (int x = 0; x < dstW; x++)
+            {
+                int x0 = 2 * x;
+                int x1 = R3D_MIN(x0 + 1, srcW - 1);
+
+                float d0 = R3D_MAX(src[y0 * srcW + x0], src[y0 * srcW + x1]);
+                float d1 = R3D_MAX(src[y1 * srcW + x0], src[y1 * srcW + x1]);
+                dst[y * dstW + x] = R3D_MAX(d0, d1);
+            }
+        }
+    }
+}
+
+bool r3d_occlusion_is_box_visible(const r3d_occlusion_t* occ, Vector3 center, Vector3 extents)
+{
+    if (occ->levelCount == 0) return true;
+
+    /* --- Project the corners, keep the screen rectangle and the nearest depth --- */
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3 corner = {
+            center.x + ((i & 1) ? extents.x : -extents.x),
+            center.y + ((i & 2) ? extents.y : -extents.y),
+            center.z + ((i & 4) ? extents.z : -extents.z)
+        };
+
+        occ_clip_t clip = occ_to_clip(&occ->viewProj, corner);
+        if (occ_near_distance(clip) <= 0.0f || clip.w <= 0.0f) return true;
+
+        occ_screen_t s = occ_to_screen(occ, clip);
+        minX = R3D_MIN(minX, s.x);
+        minY = R3D_MIN(minY, s.y);
+        minZ = R3D_MIN(minZ, s.z);
+        maxX = R3D_MAX(maxX, s.x);
+        maxY = R3D_MAX(maxY, s.y);
+    }
+
+    // Only the part on screen can be hidden, the rest is outside the frustum
+    int x0 = R3D_MAX((int)floorf(minX), 0);
+    int y0 = R3D_MAX((int)floorf(minY), 0);
+    int x1 = R3D_MIN((int)floorf(maxX), occ->widths[0] - 1);
+    int y1 = R3D_MIN((int)floorf(maxY), occ->heights[0] - 1);
+
+    if (x0 > x1 || y0 > y1) return true;
+
+    /* --- Pick the level where the rectangle spans at most 2x2 texels --- */
+
+    int level = 0;
+    while (level + 1 < occ->levelCount && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+    {
+        level++;
+    }
+
+    const float* depth = occ->levels[level];
+    int width = occ->widths[level];
+
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+    {
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+        {
+            if (minZ <= depth[y * width + x]) return true;
+        }
+    }
+
+    return false;
+}
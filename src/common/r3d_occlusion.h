@@ -0,0 +1,66 @@
+/* r3d_occlusion.h -- Coarse CPU depth buffer for occlusion culling.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#ifndef R3D_OCCLUSION_H
+#define R3D_OCCLUSION_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ========================================
+// CONFIG
+// ========================================
+
+/* Number of levels the hierarchy can hold, enough for a 32768 texels wide buffer */
+#define R3D_OCCLUSION_MAX_LEVELS 16
+
+// ========================================
+// OCCLUSION TYPES
+// ========================================
+
+/* Depth buffer of the occluders and its max depth hierarchy.
+ * Level 0 holds the rasterized occluders, each following level keeps the farthest
+ * depth of the 2x2 texels below it. Depths are window depths in [0, 1], 1 being the far plane.
+ * Coverage is sampled at texel centers then eroded by one texel, so a convex occluder never
+ * hides more than its own area. No GPU state is involved, tests can run concurrently once built.
+ */
+typedef struct {
+    float* levels[R3D_OCCLUSION_MAX_LEVELS];    //< Start of each level in 'memory'
+    int widths[R3D_OCCLUSION_MAX_LEVELS];       //< Width of each level in texels
+    int heights[R3D_OCCLUSION_MAX_LEVELS];      //< Height of each level in texels
+    int levelCount;                             //< Number of levels down to 1x1
+    float* scratch;                             //< Level 0 sized work area, after the levels in 'memory'
+    float* memory;                              //< Single allocation holding every level
+    size_t capacity;                            //< Number of floats allocated in 'memory'
+    Matrix viewProj;                            //< View projection the occluders are rasterized with
+} r3d_occlusion_t;
+
+// ========================================
+// OCCLUSION FUNCTIONS
+// ========================================
+
+/* Resizes the buffer if needed and clears it to the far plane.
+ * Must be called before rasterizing the occluders of a view. */
+void r3d_occlusion_begin(r3d_occlusion_t* occ, int width, int height, Matrix viewProj);
+
+/* Releases the buffer memory, the struct can be reused with `r3d_occlusion_begin()`. */
+void r3d_occlusion_release(r3d_occlusion_t* occ);
+
+/* Rasterizes world space triangles, three positions per triangle, both windings are drawn.
+ * Triangles are clipped against the near plane. */
+void r3d_occlusion_draw_triangles(r3d_occlusion_t* occ, const Vector3* positions, int vertexCount);
+
+/* Erodes level 0 and builds the max depth levels, to call once every occluder has been rasterized. */
+void r3d_occlusion_build_hierarchy(r3d_occlusion_t* occ);
+
+/* Returns false if the world box is entirely behind the occluders.
+ * Boxes crossing the near plane are always reported visible. */
+bool r3d_occlusion_is_box_visible(const r3d_occlusion_t* occ, Vector3 center, Vector3 extents);
+
+#endif // R3D_OCCLUSION_H
@@ -46,6 +46,27 @@ void r3d_pass_prepare_irradiance(int layerMap, GLuint srcCubemap)
     r3d_driver_enable(GL_CULL_FACE);
 }
 
+void r3d_pass_prepare_irradiance_sh(int layerSH, GLuint srcCubemap, int srcSize)
+{
+    // Project from the first mip no larger than 16x16, each coefficient reads every texel of it
+    int srcLod = 0;
+    while ((srcSize >> srcLod) > 16) srcLod++;
+
+    R3D_SHADER_USE(prepare.cubemapSH);
+    r3d_driver_disable(GL_DEPTH_TEST);
+    r3d_driver_disable(GL_CULL_FACE);
+
+    R3D_SHADER_BIND_SAMPLER(prepare.cubemapSH, uSourceTex, srcCubemap);
+    R3D_SHADER_SET_INT(prepare.cubemapSH, uSourceFaceSize, srcSize >> srcLod);
+    R3D_SHADER_SET_FLOAT(prepare.cubemapSH, uSourceLod, (float)srcLod);
+
+    r3d_env_sh_bind_fbo(layerSH);
+    R3D_RENDER_SCREEN();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    r3d_driver_enable(GL_CULL_FACE);
+}
+
 void r3d_pass_prepare_prefilter(int layerMap, GLuint srcCubemap, int srcSize)
 {
     Matrix matProj = MatrixPerspective(90.0 * DEG2RAD, 1.0, 0.1, 10.0);
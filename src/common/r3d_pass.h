@@ -17,6 +17,7 @@
 // ========================================
 
 void r3d_pass_prepare_irradiance(int layerMap, GLuint srcCubemap);
+void r3d_pass_prepare_irradiance_sh(int layerSH, GLuint srcCubemap, int srcSize);
 void r3d_pass_prepare_prefilter(int layerMap, GLuint srcCubemap, int srcSize);
 
 #endif // R3D_COMMON_PASS_H
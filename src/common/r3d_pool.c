@@ -0,0 +1,206 @@
+/* r3d_pool.c -- Fixed worker pool for data-parallel tasks.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#include "./r3d_pool.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(R3D_NO_C11_THREADS)
+#   include <tinycthread.h>
+#else
+#   include <threads.h>
+#endif
+
+#include "./r3d_helper.h"
+
+// ========================================
+// POOL STRUCT
+// ========================================
+
+/* Workers sleep on 'wake' until 'generation' changes, each dispatch bumps it.
+ * 'busy' counts the workers that joined the current dispatch, the caller
+ * waits on 'idle' until it drops back to zero before returning, so no worker
+ * can still be reading the task state when the next dispatch rewrites it.
+ */
+struct r3d_pool {
+    mtx_t mutex;
+    cnd_t wake;
+    cnd_t idle;
+
+    r3d_pool_task_fn fn;
+    void* userData;
+    int taskCount;
+    atomic_int nextTask;
+
+    unsigned generation;
+    int busy;
+    bool quit;
+
+    int workerCount;
+    thrd_t workers[];
+};
+
+// ========================================
+// INTERNAL FUNCTIONS
+// ========================================
+
+static void pool_execute(r3d_pool_t* pool)
+{
+    while (true)
+    {
+        int taskIndex = atomic_fetch_add_explicit(&pool->nextTask, 1, memory_order_relaxed);
+        if (taskIndex >= pool->taskCount) break;
+        pool->fn(pool->userData, taskIndex);
+    }
+}
+
+static int pool_worker(void* arg)
+{
+    r3d_pool_t* pool = arg;
+
+    mtx_lock(&pool->mutex);
+    unsigned seenGeneration = pool->generation;
+
+    while (true)
+    {
+        while (!pool->quit && pool->generation == seenGeneration)
+        {
+            cnd_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->quit) break;
+
+        seenGeneration = pool->generation;
+        pool->busy++;
+        mtx_unlock(&pool->mutex);
+
+        pool_execute(pool);
+
+        mtx_lock(&pool->mutex);
+        if (--pool->busy == 0) cnd_signal(&pool->idle);
+    }
+
+    mtx_unlock(&pool->mutex);
+
+    return 0;
+}
+
+static void pool_wait_idle(r3d_pool_t* pool)
+{
+    while (pool->busy > 0)
+    {
+        cnd_wait(&pool->idle, &pool->mutex);
+    }
+}
+
+// ========================================
+// POOL FUNCTIONS
+// ========================================
+
+r3d_pool_t* r3d_pool_create(int workerCount)
+{
+    workerCount = R3D_CLAMP(workerCount, 0, R3D_POOL_MAX_WORKERS);
+
+    r3d_pool_t* pool = r3d_malloc(sizeof(r3d_pool_t) + workerCount * sizeof(thrd_t));
+    memset(pool, 0, sizeof(r3d_pool_t));
+
+    if (mtx_init(&pool->mutex, mtx_plain) != thrd_success)
+    {
+        r3d_free(pool);
+        return NULL;
+    }
+
+    if (cnd_init(&pool->wake) != thrd_success)
+    {
+        mtx_destroy(&pool->mutex);
+        r3d_free(pool);
+        return NULL;
+    }
+
+    if (cnd_init(&pool->idle) != thrd_success)
+    {
+        cnd_destroy(&pool->wake);
+        mtx_destroy(&pool->mutex);
+        r3d_free(pool);
+        return NULL;
+    }
+
+    atomic_init(&pool->nextTask, 0);
+
+    // Keep the workers that could be started, the pool stays usable with fewer threads
+    for (int i = 0; i < workerCount; i++)
+    {
+        if (thrd_create(&pool->workers[i], pool_worker, pool) != thrd_success)
+        {
+            R3D_TRACELOG(LOG_WARNING, "Failed to start worker thread %d/%d", i + 1, workerCount);
+            break;
+        }
+        pool->workerCount++;
+    }
+
+    return pool;
+}
+
+void r3d_pool_destroy(r3d_pool_t* pool)
+{
+    if (pool == NULL) return;
+
+    mtx_lock(&pool->mutex);
+    pool->quit = true;
+    cnd_broadcast(&pool->wake);
+    mtx_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->workerCount; i++)
+    {
+        thrd_join(pool->workers[i], NULL);
+    }
+
+    cnd_destroy(&pool->idle);
+    cnd_destroy(&pool->wake);
+    mtx_destroy(&pool->mutex);
+
+    r3d_free(pool);
+}
+
+void r3d_pool_run(r3d_pool_t* pool, r3d_pool_task_fn fn, void* userData, int taskCount)
+{
+    if (taskCount <= 0) return;
+
+    // Not worth waking anyone for a single task
+    if (pool == NULL || pool->workerCount == 0 || taskCount == 1)
+    {
+        for (int i = 0; i < taskCount; i++) fn(userData, i);
+        return;
+    }
+
+    mtx_lock(&pool->mutex);
+
+    // A late worker may still be draining the previous dispatch
+    pool_wait_idle(pool);
+
+    pool->fn = fn;
+    pool->userData = userData;
+    pool->taskCount = taskCount;
+    atomic_store_explicit(&pool->nextTask, 0, memory_order_relaxed);
+
+    pool->generation++;
+    cnd_broadcast(&pool->wake);
+
+    mtx_unlock(&pool->mutex);
+
+    pool_execute(pool);
+
+    // Every task was claimed, wait for the workers still running theirs
+    mtx_lock(&pool->mutex);
+    pool_wait_idle(pool);
+    mtx_unlock(&pool->mutex);
+}
+
+int r3d_pool_thread_count(const r3d_pool_t* pool)
+{
+    return (pool != NULL) ? pool->workerCount + 1 : 1;
+}
@@ -0,0 +1,54 @@
+/* r3d_pool.h -- Fixed worker pool for data-parallel tasks.
+ *
+ * Copyright (c) 2025-2026 Le Juez Victor
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * For conditions of distribution and use, see accompanying LICENSE file.
+ */
+
+#ifndef R3D_POOL_H
+#define R3D_POOL_H
+
+#include <stdbool.h>
+
+// ========================================
+// CONFIG
+// ========================================
+
+/* Upper bound on the number of worker threads a pool can spawn */
+#ifndef R3D_POOL_MAX_WORKERS
+#   define R3D_POOL_MAX_WORKERS 64
+#endif
+
+// ========================================
+// POOL TYPES
+// ========================================
+
+/* Task callback, called once for each index in [0, taskCount).
+ * Tasks of a same dispatch run concurrently and must not write to shared data.
+ */
+typedef void (*r3d_pool_task_fn)(void* userData, int taskIndex);
+
+/* Opaque pool, see r3d_pool.c */
+typedef struct r3d_pool r3d_pool_t;
+
+// ========================================
+// POOL FUNCTIONS
+// ========================================
+
+/* Creates a pool with 'workerCount' threads, the calling thread also takes tasks
+ * during a dispatch. A count of zero is valid and runs every dispatch inline.
+ * Returns NULL on failure. */
+r3d_pool_t* r3d_pool_create(int workerCount);
+
+/* Stops and joins the workers, then releases the pool. Accepts NULL. */
+void r3d_pool_destroy(r3d_pool_t* pool);
+
+/* Runs 'fn' for every task index and returns once all tasks are completed.
+ * Must only be called from the thread that created the pool. */
+void r3d_pool_run(r3d_pool_t* pool, r3d_pool_task_fn fn, void* userData, int taskCount);
+
+/* Returns the number of threads taking part in a dispatch (workers + caller). */
+int r3d_pool_thread_count(const r3d_pool_t* pool);
+
+#endif // R3D_POOL_H
@@ -14,6 +14,7 @@
 #include <string.h>
 
 #include "../common/r3d_helper.h"
+#include "../common/r3d_anim.h"
 
 // ========================================
 // CHANNEL LOADING (INTERNAL)
@@ -21,9 +22,9 @@
 
 static void load_vec3_track(R3D_AnimationTrack* track, unsigned int count, const struct aiVectorKey* keys)
 {
+    *track = (R3D_AnimationTrack) {0};
     track->count  = (int)count;
-    track->times  = NULL;
-    track->values = NULL;
+    track->format = R3D_ANIM_TRACK_FLOAT;
 
     if (track->count == 0) return;
 
@@ -42,9 +43,9 @@ static void load_vec3_track(R3D_AnimationTrack* track, unsigned int count, const
 
 static void load_quat_track(R3D_AnimationTrack* track, unsigned int count, const struct aiQuatKey* keys)
 {
+    *track = (R3D_AnimationTrack) {0};
     track->count  = (int)count;
-    track->times  = NULL;
-    track->values = NULL;
+    track->format = R3D_ANIM_TRACK_FLOAT;
 
     if (track->count == 0) return;
 
@@ -82,6 +83,11 @@ static bool load_channel(R3D_AnimationChannel* channel, const R3D_Importer* impo
     load_quat_track(&channel->rotation, aiChannel->mNumRotationKeys, aiChannel->mRotationKeys);
     load_vec3_track(&channel->scale, aiChannel->mNumScalingKeys, aiChannel->mScalingKeys);
 
+    if (R3D_BIT_ANY(importer->flags, R3D_IMPORT_COMPRESS_ANIMATIONS))
+    {
+        r3d_anim_channel_compress(channel);
+    }
+
     return true;
 }
 
@@ -154,6 +160,10 @@ static bool load_animation(R3D_Animation* animation, const R3D_Importer* importe
         animation->channels = r3d_realloc(animation->channels, successChannels * sizeof(R3D_AnimationChannel));
     }
 
+    // Bone indexed channel table, spares the samplers a search per bone
+    animation->boneChannels = NULL;
+    r3d_anim_channel_build_table(animation);
+
     R3D_TRACELOG(LOG_INFO, "Animation '%s' loaded: %.2f duration, %.2f ticks/sec, %d channels",
              animation->name, animation->duration, animation->ticksPerSecond, animation->channelCount);
 
@@ -24,6 +24,9 @@
 #define R3D_ENV_CUBEMAP_ARRAY_INIT_CAPACITY 16
 #define R3D_ENV_CUBEMAP_ARRAY_GROWTH        8
 
+#define R3D_ENV_SH_ARRAY_INIT_CAPACITY      16
+#define R3D_ENV_SH_ARRAY_GROWTH             16
+
 // ========================================
 // MODULE STATE
 // ========================================
@@ -78,7 +81,7 @@ static r3d_env_cubemap_array_t cubemap_array_create(int size, bool mipmapped)
     r3d_env_cubemap_array_t arr = {0};
 
     arr.freeList    = R3D_LIST_CREATE(int, R3D_ENV_CUBEMAP_ARRAY_INIT_CAPACITY);
-    arr.layerStates = R3D_LIST_CREATE(r3d_env_cubemap_layer_state_t, R3D_ENV_CUBEMAP_ARRAY_INIT_CAPACITY);
+    arr.layerStates = R3D_LIST_CREATE(r3d_env_layer_state_t, R3D_ENV_CUBEMAP_ARRAY_INIT_CAPACITY);
     arr.size        = size;
     arr.mipLevels   = mipmapped ? r3d_get_mip_levels_1d(size) : 1;
 
@@ -166,7 +169,7 @@ static int cubemap_array_acquire_layer(r3d_env_cubemap_array_t* arr)
     int layer = -1;
     R3D_LIST_POP(arr->freeList, &layer);
 
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     state->acquired = true;
     state->rendered = false;
 
@@ -175,7 +178,7 @@ static int cubemap_array_acquire_layer(r3d_env_cubemap_array_t* arr)
 
 static void cubemap_array_release_layer(r3d_env_cubemap_array_t* arr, int layer)
 {
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     state->acquired = false;
     state->rendered = false;
 
@@ -264,6 +267,127 @@ static void cubemap_gen_mipmaps(r3d_env_cubemap_t* cm)
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
+// ========================================
+// SH ARRAY FUNCTIONS
+// ========================================
+
+static void sh_array_allocate_texture(GLuint texture, uint32_t layers)
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA16F,
+        R3D_ENV_SH_COEFF_COUNT, (int)layers,
+        0, GL_RGBA, GL_FLOAT, NULL
+    );
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static r3d_env_sh_array_t sh_array_create(void)
+{
+    r3d_env_sh_array_t arr = {0};
+
+    arr.freeList    = R3D_LIST_CREATE(int, R3D_ENV_SH_ARRAY_INIT_CAPACITY);
+    arr.layerStates = R3D_LIST_CREATE(r3d_env_layer_state_t, R3D_ENV_SH_ARRAY_INIT_CAPACITY);
+
+    glGenFramebuffers(1, &arr.framebuffer);
+
+    return arr;
+}
+
+static void sh_array_destroy(r3d_env_sh_array_t* arr)
+{
+    if (arr->texture != 0)     glDeleteTextures(1, &arr->texture);
+    if (arr->framebuffer != 0) glDeleteFramebuffers(1, &arr->framebuffer);
+
+    R3D_LIST_DESTROY(arr->layerStates);
+    R3D_LIST_DESTROY(arr->freeList);
+
+    *arr = (r3d_env_sh_array_t){0};
+}
+
+static bool sh_array_expand(r3d_env_sh_array_t* arr, uint32_t growth)
+{
+    uint32_t newLayerCount = arr->layerCount + growth;
+
+    GLuint newTexture;
+    glGenTextures(1, &newTexture);
+    sh_array_allocate_texture(newTexture, newLayerCount);
+
+    // Copy existing coefficients into the new texture if any, all rows at once
+    if (arr->layerCount > 0 && arr->texture != 0)
+    {
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, arr->texture, 0);
+
+        glBindTexture(GL_TEXTURE_2D, newTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, R3D_ENV_SH_COEFF_COUNT, (int)arr->layerCount);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    if (arr->texture != 0)
+    {
+        glDeleteTextures(1, &arr->texture);
+    }
+    arr->texture = newTexture;
+
+    // Resize layer states cache (new entries are zeroed)
+    R3D_LIST_RESIZE(arr->layerStates, newLayerCount);
+
+    // Newly allocated layers become available
+    for (uint32_t layer = arr->layerCount; layer < newLayerCount; layer++)
+    {
+        int l = (int)layer;
+        R3D_LIST_PUSH(arr->freeList, l);
+    }
+
+    arr->layerCount = newLayerCount;
+
+    return true;
+}
+
+static int sh_array_acquire_layer(r3d_env_sh_array_t* arr)
+{
+    if (R3D_LIST_EMPTY(arr->freeList))
+    {
+        if (!sh_array_expand(arr, R3D_ENV_SH_ARRAY_GROWTH))
+        {
+            return -1;
+        }
+    }
+
+    int layer = -1;
+    R3D_LIST_POP(arr->freeList, &layer);
+
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
+    state->acquired = true;
+    state->rendered = false;
+
+    return layer;
+}
+
+static void sh_array_release_layer(r3d_env_sh_array_t* arr, int layer)
+{
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
+    state->acquired = false;
+    state->rendered = false;
+
+    R3D_LIST_PUSH(arr->freeList, layer);
+}
+
 // ========================================
 // PROBE FUNCTIONS
 // ========================================
@@ -295,18 +419,19 @@ static void probe_job_init(r3d_env_probe_job_t* job, const R3D_Probe* probe)
     }
 
     job->position  = probe->position;
+    job->range     = probe->range;
     job->probeType = probe->type;
     job->interior  = probe->interior;
     job->shadows   = probe->shadows;
     job->layer     = (int)probe->handle - 1;
 }
 
-static void probe_push(const R3D_Probe* probe, r3d_env_cubemap_array_t* cubemapArray, r3d_list_t** targetList, bool updateProbe)
+static void probe_push(const R3D_Probe* probe, r3d_list_t* layerStates, r3d_list_t** targetList, bool updateProbe)
 {
     if (probe->range <= 0.0f) return;
 
     int layer = (int)probe->handle - 1;
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(cubemapArray->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(layerStates, r3d_env_layer_state_t, layer);
 
     bool mustCapture = !state->rendered || updateProbe;
     bool visible = R3D_FrustumIntersectsSphere(&R3D.viewState.frustum, probe->position, probe->range);
@@ -342,12 +467,14 @@ bool r3d_env_init(void)
 {
     memset(&R3D_MOD_ENV, 0, sizeof(R3D_MOD_ENV));
 
-    R3D_MOD_ENV.irradianceCapture = cubemap_create(R3D_HINT(R3D_HINT_IBL_IRRADIANCE_SIZE), false);
+    R3D_MOD_ENV.irradianceCapture = cubemap_create(R3D_HINT(R3D_HINT_IBL_IRRADIANCE_SIZE), true);
     R3D_MOD_ENV.prefilterCapture  = cubemap_create(R3D_HINT(R3D_HINT_IBL_PREFILTER_SIZE), true);
 
     R3D_MOD_ENV.irradiance = cubemap_array_create(R3D_HINT(R3D_HINT_IBL_IRRADIANCE_SIZE), false);
     R3D_MOD_ENV.prefilter  = cubemap_array_create(R3D_HINT(R3D_HINT_IBL_PREFILTER_SIZE), true);
 
+    R3D_MOD_ENV.irradianceSH = sh_array_create();
+
     R3D_MOD_ENV.listProbeIllumination = R3D_LIST_CREATE(R3D_Probe, 16);
     R3D_MOD_ENV.listProbeReflection   = R3D_LIST_CREATE(R3D_Probe, 16);
     R3D_MOD_ENV.listProbeJobs         = R3D_LIST_CREATE(r3d_env_probe_job_t, 16);
@@ -363,6 +490,8 @@ void r3d_env_quit(void)
     cubemap_array_destroy(&R3D_MOD_ENV.irradiance);
     cubemap_array_destroy(&R3D_MOD_ENV.prefilter);
 
+    sh_array_destroy(&R3D_MOD_ENV.irradianceSH);
+
     R3D_LIST_DESTROY(R3D_MOD_ENV.listProbeIllumination);
     R3D_LIST_DESTROY(R3D_MOD_ENV.listProbeReflection);
     R3D_LIST_DESTROY(R3D_MOD_ENV.listProbeJobs);
@@ -381,10 +510,13 @@ void r3d_env_push_probe(const R3D_Probe* probe, bool updateProbe)
     switch (probe->type)
     {
     case R3D_PROBE_ILLUMINATION:
-        probe_push(probe, &R3D_MOD_ENV.irradiance, &R3D_MOD_ENV.listProbeIllumination, updateProbe);
+        probe_push(probe, R3D_MOD_ENV.irradiance.layerStates, &R3D_MOD_ENV.listProbeIllumination, updateProbe);
         break;
     case R3D_PROBE_REFLECTION:
-        probe_push(probe, &R3D_MOD_ENV.prefilter, &R3D_MOD_ENV.listProbeReflection, updateProbe);
+        probe_push(probe, R3D_MOD_ENV.prefilter.layerStates, &R3D_MOD_ENV.listProbeReflection, updateProbe);
+        break;
+    case R3D_PROBE_ILLUMINATION_SH:
+        probe_push(probe, R3D_MOD_ENV.irradianceSH.layerStates, &R3D_MOD_ENV.listProbeIllumination, updateProbe);
         break;
     default:
         R3D_ASSERT(false);
@@ -397,6 +529,7 @@ R3D_Probe* r3d_env_probe_get(R3D_ProbeType type, int probeIndex)
     switch (type)
     {
     case R3D_PROBE_ILLUMINATION:
+    case R3D_PROBE_ILLUMINATION_SH:
         return &R3D_LIST_GET(R3D_MOD_ENV.listProbeIllumination, R3D_Probe, probeIndex);
     case R3D_PROBE_REFLECTION:
         return &R3D_LIST_GET(R3D_MOD_ENV.listProbeReflection, R3D_Probe, probeIndex);
@@ -422,6 +555,8 @@ bool r3d_env_probe_layer_is_valid(R3D_ProbeType type, int layer)
         return r3d_env_irradiance_layer_is_valid(layer);
     case R3D_PROBE_REFLECTION:
         return r3d_env_prefilter_layer_is_valid(layer);
+    case R3D_PROBE_ILLUMINATION_SH:
+        return r3d_env_sh_layer_is_valid(layer);
     default:
         R3D_ASSERT(false);
         break;
@@ -435,6 +570,7 @@ void r3d_env_probe_capture_bind_fbo(R3D_ProbeType type, int face)
     switch (type)
     {
     case R3D_PROBE_ILLUMINATION:
+    case R3D_PROBE_ILLUMINATION_SH:
         cubemap_bind_fbo(&R3D_MOD_ENV.irradianceCapture, face);
         break;
     case R3D_PROBE_REFLECTION:
@@ -448,8 +584,19 @@ void r3d_env_probe_capture_bind_fbo(R3D_ProbeType type, int face)
 
 void r3d_env_probe_capture_gen_mipmaps(R3D_ProbeType type)
 {
-    R3D_ASSERT(type == R3D_PROBE_REFLECTION);
-    cubemap_gen_mipmaps(&R3D_MOD_ENV.prefilterCapture);
+    switch (type)
+    {
+    case R3D_PROBE_ILLUMINATION:
+    case R3D_PROBE_ILLUMINATION_SH:
+        cubemap_gen_mipmaps(&R3D_MOD_ENV.irradianceCapture);
+        break;
+    case R3D_PROBE_REFLECTION:
+        cubemap_gen_mipmaps(&R3D_MOD_ENV.prefilterCapture);
+        break;
+    default:
+        R3D_ASSERT(false);
+        break;
+    }
 }
 
 GLuint r3d_env_probe_capture_get(R3D_ProbeType type)
@@ -457,6 +604,7 @@ GLuint r3d_env_probe_capture_get(R3D_ProbeType type)
     switch (type)
     {
     case R3D_PROBE_ILLUMINATION:
+    case R3D_PROBE_ILLUMINATION_SH:
         return R3D_MOD_ENV.irradianceCapture.texture;
     case R3D_PROBE_REFLECTION:
         return R3D_MOD_ENV.prefilterCapture.texture;
@@ -472,6 +620,7 @@ int r3d_env_probe_capture_size(R3D_ProbeType type)
     switch (type)
     {
     case R3D_PROBE_ILLUMINATION:
+    case R3D_PROBE_ILLUMINATION_SH:
         return R3D_MOD_ENV.irradianceCapture.size;
     case R3D_PROBE_REFLECTION:
         return R3D_MOD_ENV.prefilterCapture.size;
@@ -486,8 +635,9 @@ const char* r3d_env_probe_type_name(R3D_ProbeType type)
 {
     switch (type)
     {
-    case R3D_PROBE_ILLUMINATION: return "Illumination";
-    case R3D_PROBE_REFLECTION:   return "Reflection";
+    case R3D_PROBE_ILLUMINATION:    return "Illumination";
+    case R3D_PROBE_REFLECTION:      return "Reflection";
+    case R3D_PROBE_ILLUMINATION_SH: return "Illumination SH";
     default: break;
     }
     return NULL;
@@ -510,7 +660,7 @@ void r3d_env_irradiance_bind_fbo(int layer, int face)
 {
     r3d_env_cubemap_array_t* arr = &R3D_MOD_ENV.irradiance;
 
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     state->rendered = true;
 
     glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
@@ -531,7 +681,7 @@ bool r3d_env_irradiance_layer_is_valid(int layer)
         return false;
     }
 
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     return state->acquired;
 }
 
@@ -559,7 +709,7 @@ void r3d_env_prefilter_bind_fbo(int layer, int face, int mipLevel)
 
     R3D_ASSERT(mipLevel < arr->mipLevels);
 
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     state->rendered = true;
 
     glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
@@ -581,7 +731,7 @@ bool r3d_env_prefilter_layer_is_valid(int layer)
         return false;
     }
 
-    r3d_env_cubemap_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_cubemap_layer_state_t, layer);
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
     return state->acquired;
 }
 
@@ -589,3 +739,50 @@ GLuint r3d_env_prefilter_get(void)
 {
     return R3D_MOD_ENV.prefilter.texture;
 }
+
+int r3d_env_sh_acquire_layer(void)
+{
+    return sh_array_acquire_layer(&R3D_MOD_ENV.irradianceSH);
+}
+
+void r3d_env_sh_release_layer(int layer)
+{
+    if (r3d_env_sh_layer_is_valid(layer))
+    {
+        sh_array_release_layer(&R3D_MOD_ENV.irradianceSH, layer);
+    }
+}
+
+void r3d_env_sh_bind_fbo(int layer)
+{
+    r3d_env_sh_array_t* arr = &R3D_MOD_ENV.irradianceSH;
+
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
+    state->rendered = true;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_TEXTURE_2D, arr->texture, 0
+    );
+
+    glViewport(0, layer, R3D_ENV_SH_COEFF_COUNT, 1);
+}
+
+bool r3d_env_sh_layer_is_valid(int layer)
+{
+    r3d_env_sh_array_t* arr = &R3D_MOD_ENV.irradianceSH;
+
+    if (layer < 0 || (uint32_t)layer >= arr->layerCount)
+    {
+        return false;
+    }
+
+    r3d_env_layer_state_t* state = &R3D_LIST_GET(arr->layerStates, r3d_env_layer_state_t, layer);
+    return state->acquired;
+}
+
+GLuint r3d_env_sh_get(void)
+{
+    return R3D_MOD_ENV.irradianceSH.texture;
+}
@@ -17,6 +17,12 @@
 
 #include "../common/r3d_list.h"
 
+// ========================================
+// CONSTANTS
+// ========================================
+
+#define R3D_ENV_SH_COEFF_COUNT 9    //< L2 spherical harmonics, one RGB coefficient per texel
+
 // ========================================
 // HELPER MACROS
 // ========================================
@@ -41,6 +47,7 @@ typedef struct {
     Matrix        invView[6];
     Matrix        invProj;
     Vector3       position;
+    float         range;
     R3D_ProbeType probeType;
     bool          interior;
     bool          shadows;
@@ -50,18 +57,26 @@ typedef struct {
 typedef struct {
     bool acquired;              // true from acquire until release; drives handle validity checks
     bool rendered;              // true once the layer's content has been captured at least once since (re)acquired
-} r3d_env_cubemap_layer_state_t;
+} r3d_env_layer_state_t;
 
 typedef struct {
     GLuint      framebuffer;
     GLuint      texture;        // GL_TEXTURE_CUBE_MAP_ARRAY handle, 0 until first expand
     r3d_list_t* freeList;       // list<int> of currently free layer indices
-    r3d_list_t* layerStates;    // list<r3d_env_cubemap_layer_state_t> indexed by layer
+    r3d_list_t* layerStates;    // list<r3d_env_layer_state_t> indexed by layer
     uint32_t    layerCount;     // total number of allocated layers (GL side)
     int         size;           // cubemap face resolution
     int         mipLevels;      // 1 if not mipmapped
 } r3d_env_cubemap_array_t;
 
+typedef struct {
+    GLuint      framebuffer;
+    GLuint      texture;        // GL_TEXTURE_2D handle, one row of R3D_ENV_SH_COEFF_COUNT texels per layer
+    r3d_list_t* freeList;       // list<int> of currently free layer indices
+    r3d_list_t* layerStates;    // list<r3d_env_layer_state_t> indexed by layer
+    uint32_t    layerCount;     // total number of allocated layers (GL side)
+} r3d_env_sh_array_t;
+
 typedef struct {
     GLuint      framebuffer;
     GLuint      texture;        // GL_TEXTURE_CUBE_MAP handle
@@ -79,6 +94,7 @@ extern struct r3d_env {
     r3d_env_cubemap_t prefilterCapture;
     r3d_env_cubemap_array_t irradiance;
     r3d_env_cubemap_array_t prefilter;
+    r3d_env_sh_array_t irradianceSH;
     r3d_list_t* listProbeIllumination;
     r3d_list_t* listProbeReflection;
     r3d_list_t* listProbeJobs;
@@ -151,6 +167,21 @@ bool r3d_env_prefilter_layer_is_valid(int layer);
 /* Get prefiltered cubemap array texture ID */
 GLuint r3d_env_prefilter_get(void);
 
+/* Reserve a new spherical harmonics layer (returns -1 on failure) */
+int r3d_env_sh_acquire_layer(void);
+
+/* Release a spherical harmonics layer */
+void r3d_env_sh_release_layer(int layer);
+
+/* Bind spherical harmonics framebuffer, restricted to the row of the given layer */
+void r3d_env_sh_bind_fbo(int layer);
+
+/**/
+bool r3d_env_sh_layer_is_valid(int layer);
+
+/* Get spherical harmonics coefficients texture ID */
+GLuint r3d_env_sh_get(void);
+
 // ========================================
 // INLINE QUERIES
 // ========================================
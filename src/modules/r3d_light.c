@@ -12,6 +12,7 @@
 #include <r3d_config.h>
 #include <raymath.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <float.h>
 
@@ -26,19 +27,130 @@
 #define SHADOW_SPOT_LAYER_GROWTH    4
 #define SHADOW_OMNI_LAYER_GROWTH    4
 
+#define SHADOW_TILE_RETRY_DELAY     30  // Frames before trying again to enlarge a tile that found no room
+
 // ========================================
 // MODULE STATE
 // ========================================
 
 struct r3d_light R3D_MOD_LIGHT;
 
+// ========================================
+// SHADOW ATLAS FUNCTIONS
+// ========================================
+
+/* Each layer is a quadtree of power of two tiles, level 0 being the whole layer */
+enum {
+    SHADOW_TILE_FREE = 0,
+    SHADOW_TILE_SPLIT,
+    SHADOW_TILE_USED,
+};
+
+static int shadow_atlas_first_node(int level)
+{
+    return ((1 << (2 * level)) - 1) / 3;
+}
+
+static int shadow_atlas_node_level(int node)
+{
+    int level = 0;
+    while (level + 1 < R3D_SHADOW_ATLAS_LEVELS && node >= shadow_atlas_first_node(level + 1))
+    {
+        level++;
+    }
+    return level;
+}
+
+static int shadow_atlas_alloc_node(uint8_t* nodes, int node, int level, int target)
+{
+    if (nodes[node] == SHADOW_TILE_USED) return -1;
+
+    int child = shadow_atlas_first_node(level + 1) + 4 * (node - shadow_atlas_first_node(level));
+
+    if (nodes[node] == SHADOW_TILE_FREE)
+    {
+        if (level == target)
+        {
+            nodes[node] = SHADOW_TILE_USED;
+            return node;
+        }
+
+        // Children of a free node are always free
+        nodes[node] = SHADOW_TILE_SPLIT;
+        return shadow_atlas_alloc_node(nodes, child, level + 1, target);
+    }
+
+    if (level == target) return -1;
+
+    // Fill the quadrants already split before splitting a free one
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            bool split = (nodes[child + i] == SHADOW_TILE_SPLIT);
+            if (split != (pass == 0)) continue;
+
+            int found = shadow_atlas_alloc_node(nodes, child + i, level + 1, target);
+            if (found >= 0) return found;
+        }
+    }
+
+    return -1;
+}
+
+static void shadow_atlas_free_node(uint8_t* nodes, int node)
+{
+    nodes[node] = SHADOW_TILE_FREE;
+
+    // Merge the quadrants back as long as all four are free
+    for (int level = shadow_atlas_node_level(node); level > 0; level--)
+    {
+        int first = shadow_atlas_first_node(level);
+        int siblings = first + ((node - first) & ~3);
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (nodes[siblings + i] != SHADOW_TILE_FREE) return;
+        }
+
+        node = shadow_atlas_first_node(level - 1) + (node - first) / 4;
+        nodes[node] = SHADOW_TILE_FREE;
+    }
+}
+
+static r3d_rect_t shadow_atlas_node_rect(int node, int size)
+{
+    int level = shadow_atlas_node_level(node);
+    int local = node - shadow_atlas_first_node(level);
+
+    // Each base 4 digit of the local index selects a quadrant, the first level first
+    int x = 0, y = 0;
+    for (int i = level - 1; i >= 0; i--)
+    {
+        int quadrant = (local >> (2 * i)) & 3;
+        x = (x << 1) | (quadrant & 1);
+        y = (y << 1) | (quadrant >> 1);
+    }
+
+    int tileSize = size >> level;
+    return (r3d_rect_t) {x * tileSize, y * tileSize, tileSize, tileSize};
+}
+
+static int shadow_atlas_level(Vector2 minNdc, Vector2 maxNdc)
+{
+    // The tile takes at least the fraction of its layer the light takes of the screen
+    float coverage = 0.5f * fmaxf(maxNdc.x - minNdc.x, maxNdc.y - minNdc.y);
+    int level = (int)floorf(-log2f(fmaxf(coverage, 1e-6f)));
+    return R3D_CLAMP(level, 0, R3D_SHADOW_ATLAS_LEVELS - 1);
+}
+
 // ========================================
 // SHADOW ARRAY FUNCTIONS
 // ========================================
 
-static void shadow_array_allocate_texture(GLuint texture, GLenum target, int size, uint32_t layers)
+static void shadow_array_allocate_texture(GLuint texture, GLenum target, int size, uint32_t layers, int facesPerLayer)
 {
-    int actualLayers = (target == GL_TEXTURE_CUBE_MAP_ARRAY) ? (int)layers * 6 : (int)layers;
+    int actualLayers = (int)layers * facesPerLayer;
 
     glBindTexture(target, texture);
     glTexImage3D(
@@ -62,15 +174,17 @@ static void shadow_array_allocate_texture(GLuint texture, GLenum target, int siz
     glBindTexture(target, 0);
 }
 
-static r3d_light_shadow_array_t shadow_array_create(GLenum target, int size, int growth)
+static r3d_light_shadow_array_t shadow_array_create(GLenum target, int size, int facesPerLayer, int growth)
 {
     r3d_light_shadow_array_t arr = {0};
 
-    arr.target   = target;
-    arr.size     = size;
-    arr.growth   = growth;
-    arr.freeList = R3D_LIST_CREATE(int, 16);
-    arr.cache    = R3D_LIST_CREATE(r3d_light_shadow_cache_t, 16);
+    arr.target        = target;
+    arr.facesPerLayer = facesPerLayer;
+    arr.size          = size;
+    arr.growth        = growth;
+    arr.freeList      = R3D_LIST_CREATE(int, 16);
+    arr.atlas         = R3D_LIST_CREATE(uint8_t, 16 * R3D_SHADOW_ATLAS_NODES);
+    arr.cache         = R3D_LIST_CREATE(r3d_light_shadow_cache_t, 16);
 
     glGenFramebuffers(1, &arr.framebuffer);
 
@@ -79,29 +193,59 @@ static r3d_light_shadow_array_t shadow_array_create(GLenum target, int size, int
 
 static void shadow_array_destroy(r3d_light_shadow_array_t* arr)
 {
-    if (arr->texture != 0)     glDeleteTextures(1, &arr->texture);
-    if (arr->framebuffer != 0) glDeleteFramebuffers(1, &arr->framebuffer);
+    if (arr->texture != 0)       glDeleteTextures(1, &arr->texture);
+    if (arr->staticTexture != 0) glDeleteTextures(1, &arr->staticTexture);
+    if (arr->framebuffer != 0)   glDeleteFramebuffers(1, &arr->framebuffer);
 
     R3D_LIST_DESTROY(arr->cache);
+    R3D_LIST_DESTROY(arr->atlas);
     R3D_LIST_DESTROY(arr->freeList);
 
     *arr = (r3d_light_shadow_array_t){0};
 }
 
+static size_t shadow_array_layer_bytes(const r3d_light_shadow_array_t* arr)
+{
+    size_t bytes = (size_t)arr->size * (size_t)arr->size * 2 * (size_t)arr->facesPerLayer; // GL_DEPTH_COMPONENT16
+    return (arr->staticTexture != 0) ? 2 * bytes : bytes;
+}
+
+static uint32_t shadow_array_affordable_layers(const r3d_light_shadow_array_t* arr)
+{
+    int budget = R3D_HINT(R3D_HINT_SHADOW_MEMORY_BUDGET);
+    if (budget <= 0) return UINT32_MAX;
+
+    size_t budgetBytes = (size_t)budget << 20;
+    size_t usedBytes = 0;
+
+    for (int type = 0; type < R3D_LIGHT_TYPE_COUNT; type++)
+    {
+        const r3d_light_shadow_array_t* other = &R3D_MOD_LIGHT.shadowArrays[type];
+        usedBytes += other->layerCount * shadow_array_layer_bytes(other);
+    }
+
+    if (usedBytes >= budgetBytes) return 0;
+
+    return (uint32_t)((budgetBytes - usedBytes) / shadow_array_layer_bytes(arr));
+}
+
 static bool shadow_array_expand(r3d_light_shadow_array_t* arr, uint32_t growth)
 {
+    growth = R3D_MIN(growth, shadow_array_affordable_layers(arr));
+    if (growth == 0) return false;
+
     uint32_t newLayerCount = arr->layerCount + growth;
 
     GLuint newTexture;
     glGenTextures(1, &newTexture);
-    shadow_array_allocate_texture(newTexture, arr->target, arr->size, newLayerCount);
+    shadow_array_allocate_texture(newTexture, arr->target, arr->size, newLayerCount, arr->facesPerLayer);
 
     // Copy existing content into the new texture if any
     if (arr->layerCount > 0 && arr->texture != 0)
     {
         glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
 
-        int facesPerLayer = (arr->target == GL_TEXTURE_CUBE_MAP_ARRAY) ? 6 : 1;
+        int facesPerLayer = arr->facesPerLayer;
         for (uint32_t layer = 0; layer < arr->layerCount; layer++)
         {
             for (int face = 0; face < facesPerLayer; face++)
@@ -123,58 +267,156 @@ static bool shadow_array_expand(r3d_light_shadow_array_t* arr, uint32_t growth)
     }
     arr->texture = newTexture;
 
-    // Resize the cache (new entries zero-initialized => valid = false)
-    R3D_LIST_RESIZE(arr->cache, newLayerCount);
-
-    // Newly allocated layers become available
-    for (uint32_t layer = arr->layerCount; layer < newLayerCount; layer++)
+    // The static layers are reallocated on demand, existing ones must be redrawn
+    if (arr->staticTexture != 0)
     {
-        int l = (int)layer;
-        R3D_LIST_PUSH(arr->freeList, l);
+        glDeleteTextures(1, &arr->staticTexture);
+        arr->staticTexture = 0;
+
+        R3D_LIST_FOR_EACH(arr->cache, r3d_light_shadow_cache_t, cache)
+        {
+            cache->staticValid = 0;
+        }
     }
 
+    // Newly allocated layers start as a single free tile
+    R3D_LIST_RESIZE(arr->atlas, newLayerCount * R3D_SHADOW_ATLAS_NODES);
+
     arr->layerCount = newLayerCount;
 
     return true;
 }
 
-static int shadow_array_acquire_layer(r3d_light_shadow_array_t* arr)
+static bool shadow_array_alloc_tile(r3d_light_shadow_array_t* arr, int level, int* outLayer, int* outNode)
 {
-    if (R3D_LIST_EMPTY(arr->freeList))
+    for (uint32_t layer = 0; layer < arr->layerCount; layer++)
     {
-        if (!shadow_array_expand(arr, (uint32_t)arr->growth))
-        {
-            return -1;
-        }
+        uint8_t* nodes = &R3D_LIST_GET(arr->atlas, uint8_t, layer * R3D_SHADOW_ATLAS_NODES);
+
+        int node = shadow_atlas_alloc_node(nodes, 0, 0, level);
+        if (node < 0) continue;
+
+        *outLayer = (int)layer;
+        *outNode = node;
+
+        return true;
     }
 
-    int layer = -1;
-    R3D_LIST_POP(arr->freeList, &layer);
+    return false;
+}
+
+static void shadow_array_free_tile(r3d_light_shadow_array_t* arr, r3d_light_shadow_cache_t* cache)
+{
+    if (cache->layer < 0) return;
+
+    uint8_t* nodes = &R3D_LIST_GET(arr->atlas, uint8_t, cache->layer * R3D_SHADOW_ATLAS_NODES);
+    shadow_atlas_free_node(nodes, cache->tileNode);
+
+    // The map is rendered again from scratch once it gets a tile back
+    cache->layer = -1;
+    cache->tileNode = -1;
+    cache->staticValid = 0;
+    cache->renderedFaces = 0;
+    cache->pendingFaces = 0;
+}
+
+static bool shadow_array_evict_map(r3d_light_shadow_array_t* arr, uint32_t frame)
+{
+    r3d_light_shadow_cache_t* oldest = NULL;
+    uint32_t oldestAge = 0;
+
+    // Maps of lights visible this frame (age of 0) are never reclaimed
+    R3D_LIST_FOR_EACH(arr->cache, r3d_light_shadow_cache_t, cache)
+    {
+        uint32_t age = frame - cache->lastVisible;
+        if (cache->layer < 0 || age <= oldestAge) continue;
+        oldestAge = age;
+        oldest = cache;
+    }
+
+    if (oldest == NULL) return false;
+
+    shadow_array_free_tile(arr, oldest);
+
+    return true;
+}
+
+static int shadow_array_acquire_map(r3d_light_shadow_array_t* arr)
+{
+    int index = -1;
+
+    if (!R3D_LIST_EMPTY(arr->freeList))
+    {
+        R3D_LIST_POP(arr->freeList, &index);
+    }
+    else
+    {
+        index = (int)R3D_LIST_LENGTH(arr->cache);
+        R3D_LIST_RESIZE(arr->cache, index + 1);
+    }
 
-    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, layer);
-    cache->acquired = true;
-    cache->rendered = false;
+    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, index);
+    *cache = (r3d_light_shadow_cache_t) {
+        .acquired = true,
+        .layer = -1,
+        .tileNode = -1,
+    };
 
-    return layer;
+    return index;
 }
 
-static void shadow_array_release_layer(r3d_light_shadow_array_t* arr, int layer)
+static void shadow_array_release_map(r3d_light_shadow_array_t* arr, int index)
 {
-    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, layer);
+    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, index);
+
+    shadow_array_free_tile(arr, cache);
     cache->acquired = false;
-    cache->rendered = false;
 
-    R3D_LIST_PUSH(arr->freeList, layer);
+    R3D_LIST_PUSH(arr->freeList, index);
+}
+
+static void shadow_array_attach(const r3d_light_shadow_array_t* arr, GLuint texture, int layer, int face)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
+
+    // Layered attachment of the whole array, 'gl_Layer' picks the face
+    if (face < 0)
+    {
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+        return;
+    }
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer * arr->facesPerLayer + face);
+}
+
+static void shadow_cache_set_view_proj(r3d_light_shadow_cache_t* cache, int face, Matrix viewProj)
+{
+    // Static casters must be redrawn once the projection changes
+    if (memcmp(&cache->viewProj[face], &viewProj, sizeof(Matrix)) != 0)
+    {
+        cache->staticValid &= ~(1u << face);
+    }
+
+    cache->viewProj[face] = viewProj;
+}
+
+static bool shadow_cache_resize_due(const r3d_light_shadow_cache_t* cache, int level)
+{
+    // Maps without a tile are fully rendered anyway
+    if (cache->layer < 0) return false;
+
+    // One level of slack keeps lights near a threshold from switching tiles every frame
+    if (level > cache->tileLevel + 1) return true;
+
+    return level < cache->tileLevel && (int32_t)(R3D_MOD_LIGHT.shadowFrame - cache->tileRetry) >= 0;
 }
 
 // ========================================
 // LIGHT FUNCTIONS
 // ========================================
 
-static Matrix light_dir_view_proj(Vector3 dir, float range, R3D_Camera camera, double aspect)
+static Matrix light_dir_view_proj(Vector3 dir, float camNear, float camFar, R3D_Camera camera, double aspect, float* outRadius)
 {
-    float camNear   = range / 1000.0f;
-    float camFar    = range;
     float camFovy   = (float)camera.fovy;
     float camAspect = (float)aspect;
 
@@ -215,9 +457,25 @@ static Matrix light_dir_view_proj(Vector3 dir, float range, R3D_Camera camera, d
 
     Matrix proj = MatrixOrtho(-radius, radius, -radius, radius, near, far);
 
+    *outRadius = radius;
+
     return MatrixMultiply(view, proj);
 }
 
+static void light_dir_cascade_splits(float near, float far, float lambda, int count, float* outSplits)
+{
+    /* --- Blend of the uniform and logarithmic split schemes --- */
+
+    outSplits[0] = near;
+    for (int i = 1; i <= count; i++)
+    {
+        float t = (float)i / (float)count;
+        float logSplit = near * powf(far / near, t);
+        float uniSplit = near + (far - near) * t;
+        outSplits[i] = lambda * logSplit + (1.0f - lambda) * uniSplit;
+    }
+}
+
 static Matrix light_spot_view_proj(Vector3 pos, Vector3 dir, float range)
 {
     float near = 0.05f;
@@ -377,36 +635,65 @@ static void light_dir_push(const R3D_Light* light, const R3D_ShadowMap* map, R3D
 
     if (map && light->range > 0.0f)
     {
-        int mapLayer = (int)map->handle - 1;
+        int mapIndex = (int)map->handle - 1;
+
+        int cascadeCount = R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_DIR].facesPerLayer;
+        float mapSize = (float)R3D_HINT(R3D_HINT_SHADOW_DIR_SIZE);
+
+        r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(map->type, mapIndex);
+
+        /* --- Split the camera depth range covered by the shadow --- */
 
-        r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(map->type, mapLayer);
+        float splits[R3D_SHADOW_CASCADE_MAX + 1];
+        float near = R3D_MIN((float)camera.nearPlane, data.range / 1000.0f);
+        float lambda = R3D_CLAMP(map->cascadeSplit, 0.0f, 1.0f);
+        light_dir_cascade_splits(near, data.range, lambda, cascadeCount, splits);
 
-        if (!cache->rendered || updateShadow)
+        /* --- Refit and queue the cascades that are due for an update --- */
+
+        for (int i = 0; i < cascadeCount; i++)
         {
-            cache->viewProj = light_dir_view_proj(data.direction, data.range, camera, aspect);
-            cache->rendered = true; // Assume it will be rendered in advance
+            uint32_t faceBit = 1u << i;
+            int interval = R3D_MAX(map->cascadeUpdateInterval[i], 1);
+            bool cascadeUpdate = updateShadow && (cache->updateCount % interval) == 0;
+            bool cascadeDue = !(cache->renderedFaces & faceBit) || (cache->pendingFaces & faceBit);
+
+            data.viewProj[i] = cache->viewProj[i];
+            if (!cascadeUpdate && !cascadeDue) continue;
+
+            float radius = 0.0f;
+            data.viewProj[i] = light_dir_view_proj(data.direction, splits[i], splits[i + 1], camera, aspect, &radius);
 
             r3d_light_shadow_job_t job = {
-                .frustum     = R3D_ComputeFrustum(cache->viewProj),
-                .viewProj    = cache->viewProj,
-                .cullMask    = map->cullMask,
-                .type        = light->type,
-                .shadowLayer = mapLayer,
+                .frustum         = R3D_ComputeFrustum(data.viewProj[i]),
+                .viewProj        = data.viewProj[i],
+                .cullMask        = map->cullMask,
+                .type            = light->type,
+                .shadowMap       = mapIndex,
+                .shadowLayer     = -1,
+                .layerFace       = i,
+                .lightIndex      = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listLightData),
+                .minCasterRadius = (i > 0) ? 2.0f * radius / mapSize : 0.0f,
             };
 
             R3D_LIST_PUSH(R3D_MOD_LIGHT.listShadowJobs, job);
         }
 
-        data.viewProj        = cache->viewProj;
+        if (updateShadow) cache->updateCount++;
+
+        data.cascadeCount    = cascadeCount;
         data.shadowSoftness  = map->softness / (float)R3D_HINT(R3D_HINT_SHADOW_DIR_SIZE);
         data.shadowOpacity   = map->opacity;
         data.shadowDepthBias = map->depthBias;
         data.shadowSlopeBias = map->slopeBias;
         data.shadowFar       = cache->far;
-        data.shadowLayer     = mapLayer;
+        data.shadowMap       = mapIndex;
+        data.shadowLevel     = 0;
+        data.shadowLayer     = -1;
     }
     else
     {
+        data.shadowMap   = -1;
         data.shadowLayer = -1;
     }
 
@@ -423,97 +710,117 @@ static void light_spot_push(const R3D_Light* light, const R3D_ShadowMap* map, co
     float outerCutOff = cosf(light->outerCutOff * DEG2RAD);
     r3d_light_volume_t volume = light_spot_volume(position, direction, range, outerCutOff);
 
+    Vector2 minNdc = {0}, maxNdc = {0};
+    bool visible = R3D_FrustumIntersectsSphere(frustum, volume.center, volume.radius)
+                && light_volume_screen_ndc(&volume, &minNdc, &maxNdc);
+
+    int shadowLevel = visible ? shadow_atlas_level(minNdc, maxNdc) : 0;
+
     r3d_light_shadow_cache_t* cache = NULL;
     bool mustRenderShadow = false;
-    int  mapLayer = -1;
+    int  mapIndex = -1;
 
     if (map)
     {
-        mapLayer = (int)map->handle - 1;
-        cache = r3d_light_shadow_cache(map->type, mapLayer);
-        mustRenderShadow = !cache->rendered || updateShadow;
+        mapIndex = (int)map->handle - 1;
+        cache = r3d_light_shadow_cache(map->type, mapIndex);
+        mustRenderShadow = !cache->renderedFaces || cache->pendingFaces || updateShadow;
+        mustRenderShadow = mustRenderShadow || (visible && shadow_cache_resize_due(cache, shadowLevel));
     }
 
+    Matrix viewProj = cache ? cache->viewProj[0] : R3D_MATRIX_IDENTITY;
+
     if (mustRenderShadow)
     {
-        cache->viewProj = light_spot_view_proj(position, direction, range);
-        cache->rendered = true; // Assume it will be rendered in advance
+        viewProj = light_spot_view_proj(position, direction, range);
 
         r3d_light_shadow_job_t job = {
-            .frustum     = R3D_ComputeFrustum(cache->viewProj),
-            .viewProj    = cache->viewProj,
+            .frustum     = R3D_ComputeFrustum(viewProj),
+            .viewProj    = viewProj,
+            .position    = position,
             .cullMask    = map->cullMask,
             .type        = light->type,
-            .shadowLayer = mapLayer,
+            .shadowMap   = mapIndex,
+            .shadowLayer = -1,
+            .lightIndex  = visible ? (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listLightData) : -1,
         };
 
         R3D_LIST_PUSH(R3D_MOD_LIGHT.listShadowJobs, job);
     }
 
-    if (R3D_FrustumIntersectsSphere(frustum, volume.center, volume.radius))
-    {
-        Vector2 minNdc, maxNdc;
-
-        if (light_volume_screen_ndc(&volume, &minNdc, &maxNdc))
-        {
-            r3d_light_data_t data = {
-                .volume      = volume,
-                .minNdc      = minNdc,
-                .maxNdc      = maxNdc,
-                .color       = r3d_color_srgb_to_linear_vec3(light->color),
-                .position    = position,
-                .direction   = direction,
-                .energy      = light->energy,
-                .specular    = light->specular,
-                .range       = range,
-                .falloff     = R3D_MAX(light->falloff, 1e-4f),
-                .innerCutOff = cosf(light->innerCutOff * DEG2RAD),
-                .outerCutOff = outerCutOff,
-                .fogEnergy   = light->fogEnergy,
-                .type        = light->type,
-            };
+    if (!visible) return;
 
-            if (map)
-            {
-                data.viewProj        = cache->viewProj;
-                data.shadowSoftness  = map->softness / (float)R3D_HINT(R3D_HINT_SHADOW_SPOT_SIZE);
-                data.shadowOpacity   = map->opacity;
-                data.shadowDepthBias = map->depthBias;
-                data.shadowSlopeBias = map->slopeBias;
-                data.shadowFar       = cache->far;
-                data.shadowLayer     = mapLayer;
-            }
-            else
-            {
-                data.shadowLayer = -1;
-            }
+    r3d_light_data_t data = {
+        .volume      = volume,
+        .minNdc      = minNdc,
+        .maxNdc      = maxNdc,
+        .color       = r3d_color_srgb_to_linear_vec3(light->color),
+        .position    = position,
+        .direction   = direction,
+        .energy      = light->energy,
+        .specular    = light->specular,
+        .range       = range,
+        .falloff     = R3D_MAX(light->falloff, 1e-4f),
+        .innerCutOff = cosf(light->innerCutOff * DEG2RAD),
+        .outerCutOff = outerCutOff,
+        .fogEnergy   = light->fogEnergy,
+        .type        = light->type,
+    };
 
-            R3D_LIST_PUSH(R3D_MOD_LIGHT.listLightData, data);
-        }
+    if (map)
+    {
+        data.viewProj[0]     = viewProj;
+        data.shadowSoftness  = map->softness / (float)R3D_HINT(R3D_HINT_SHADOW_SPOT_SIZE);
+        data.shadowOpacity   = map->opacity;
+        data.shadowDepthBias = map->depthBias;
+        data.shadowSlopeBias = map->slopeBias;
+        data.shadowFar       = cache->far;
+        data.shadowMap       = mapIndex;
+        data.shadowLevel     = shadowLevel;
+        data.shadowLayer     = -1;
+    }
+    else
+    {
+        data.shadowMap   = -1;
+        data.shadowLayer = -1;
     }
+
+    R3D_LIST_PUSH(R3D_MOD_LIGHT.listLightData, data);
 }
 
 static void light_omni_push(const R3D_Light* light, const R3D_ShadowMap* map, const R3D_Frustum* frustum, bool updateShadow)
 {
     if (light->range <= 0.0f) return;
 
+    r3d_light_volume_t volume = {
+        .center = light->position,
+        .radius = light->range,
+    };
+
+    Vector2 minNdc = {0}, maxNdc = {0};
+    bool visible = R3D_FrustumIntersectsSphere(frustum, light->position, light->range)
+                && light_volume_screen_ndc(&volume, &minNdc, &maxNdc);
+
+    int shadowLevel = visible ? shadow_atlas_level(minNdc, maxNdc) : 0;
+
     r3d_light_shadow_cache_t* cache = NULL;
     bool mustRenderShadow = false;
-    int  mapLayer = -1;
+    int  mapIndex = -1;
 
     if (map)
     {
-        mapLayer = (int)map->handle - 1;
-        cache = r3d_light_shadow_cache(map->type, mapLayer);
-        mustRenderShadow = !cache->rendered || updateShadow;
+        mapIndex = (int)map->handle - 1;
+        cache = r3d_light_shadow_cache(map->type, mapIndex);
+        mustRenderShadow = !cache->renderedFaces || cache->pendingFaces || updateShadow;
+        mustRenderShadow = mustRenderShadow || (visible && shadow_cache_resize_due(cache, shadowLevel));
     }
 
+    float shadowFar = cache ? cache->far : 0.0f;
+
     if (mustRenderShadow)
     {
-        cache->rendered = true; // Assume it will be rendered in advance
-
         Matrix viewProjs[6];
-        light_omni_view_proj(light->position, light->range, viewProjs, &cache->far);
+        light_omni_view_proj(light->position, light->range, viewProjs, &shadowFar);
 
         for (int i = 0; i < 6; i++)
         {
@@ -521,66 +828,60 @@ static void light_omni_push(const R3D_Light* light, const R3D_ShadowMap* map, co
                 .frustum     = R3D_ComputeFrustum(viewProjs[i]),
                 .viewProj    = viewProjs[i],
                 .position    = light->position,
-                .far         = cache->far,
+                .far         = shadowFar,
                 .cullMask    = map->cullMask,
                 .type        = light->type,
-                .shadowLayer = mapLayer,
+                .shadowMap   = mapIndex,
+                .shadowLayer = -1,
                 .layerFace   = i,
+                .lightIndex  = visible ? (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listLightData) : -1,
             };
 
             R3D_LIST_PUSH(R3D_MOD_LIGHT.listShadowJobs, job);
         }
     }
 
-    if (R3D_FrustumIntersectsSphere(frustum, light->position, light->range))
-    {
-        r3d_light_volume_t volume = {
-            .center = light->position,
-            .radius = light->range,
-        };
-
-        Vector2 minNdc, maxNdc;
-
-        if (light_volume_screen_ndc(&volume, &minNdc, &maxNdc))
-        {
-            r3d_light_data_t data = {
-                .volume      = volume,
-                .minNdc      = minNdc,
-                .maxNdc      = maxNdc,
-                .color       = r3d_color_srgb_to_linear_vec3(light->color),
-                .position    = light->position,
-                .energy      = light->energy,
-                .specular    = light->specular,
-                .range       = light->range,
-                .falloff     = R3D_MAX(light->falloff, 1e-4f),
-                .fogEnergy   = light->fogEnergy,
-                .type        = light->type,
-            };
+    if (!visible) return;
 
-            if (map)
-            {
-                data.shadowSoftness  = map->softness / (float)R3D_HINT(R3D_HINT_SHADOW_OMNI_SIZE);
-                data.shadowOpacity   = map->opacity;
-                data.shadowDepthBias = map->depthBias;
-                data.shadowSlopeBias = map->slopeBias;
-                data.shadowFar       = cache->far;
-                data.shadowLayer     = mapLayer;
-            }
-            else
-            {
-                data.shadowLayer = -1;
-            }
+    r3d_light_data_t data = {
+        .volume      = volume,
+        .minNdc      = minNdc,
+        .maxNdc      = maxNdc,
+        .color       = r3d_color_srgb_to_linear_vec3(light->color),
+        .position    = light->position,
+        .energy      = light->energy,
+        .specular    = light->specular,
+        .range       = light->range,
+        .falloff     = R3D_MAX(light->falloff, 1e-4f),
+        .fogEnergy   = light->fogEnergy,
+        .type        = light->type,
+    };
 
-            R3D_LIST_PUSH(R3D_MOD_LIGHT.listLightData, data);
-        }
+    if (map)
+    {
+        data.shadowSoftness  = map->softness / (float)R3D_HINT(R3D_HINT_SHADOW_OMNI_SIZE);
+        data.shadowOpacity   = map->opacity;
+        data.shadowDepthBias = map->depthBias;
+        data.shadowSlopeBias = map->slopeBias;
+        data.shadowFar       = shadowFar;
+        data.shadowMap       = mapIndex;
+        data.shadowLevel     = shadowLevel;
+        data.shadowLayer     = -1;
+    }
+    else
+    {
+        data.shadowMap   = -1;
+        data.shadowLayer = -1;
     }
+
+    R3D_LIST_PUSH(R3D_MOD_LIGHT.listLightData, data);
 }
 
 static bool light_check_shadow_validity(const R3D_Light* light, const R3D_ShadowMap* map)
 {
     bool valid = true;
 
-    if (!r3d_light_shadow_layer_is_valid(map->type, (int)map->handle - 1))
+    if (!r3d_light_shadow_map_is_valid(map->type, (int)map->handle - 1))
     {
         const char* mType = r3d_light_type_name(map->type);
         R3D_TRACELOG(LOG_WARNING, "Invalid pushed shadow map (type: %s | handle: %d)", mType, map->handle);
@@ -600,70 +901,864 @@ static bool light_check_shadow_validity(const R3D_Light* light, const R3D_Shadow
 }
 
 // ========================================
-// MODULE FUNCTIONS
+// SHADOW SCHEDULING FUNCTIONS
 // ========================================
 
-bool r3d_light_init(void)
-{
-    memset(&R3D_MOD_LIGHT, 0, sizeof(R3D_MOD_LIGHT));
-
-    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_DIR]  = shadow_array_create(GL_TEXTURE_2D_ARRAY, R3D_HINT(R3D_HINT_SHADOW_DIR_SIZE), SHADOW_DIR_LAYER_GROWTH);
-    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_SPOT] = shadow_array_create(GL_TEXTURE_2D_ARRAY, R3D_HINT(R3D_HINT_SHADOW_SPOT_SIZE), SHADOW_SPOT_LAYER_GROWTH);
-    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_OMNI] = shadow_array_create(GL_TEXTURE_CUBE_MAP_ARRAY, R3D_HINT(R3D_HINT_SHADOW_OMNI_SIZE), SHADOW_OMNI_LAYER_GROWTH);
-
-    R3D_MOD_LIGHT.listShadowJobs = R3D_LIST_CREATE(r3d_light_shadow_job_t, 32);
-    R3D_MOD_LIGHT.listLightData  = R3D_LIST_CREATE(r3d_light_data_t, 256);
+/* Faces always rendered together, the six faces of an omni light or a single face otherwise */
+typedef struct {
+    int firstJob;
+    int jobCount;
+    float score;
+} shadow_unit_t;
 
-    return true;
-}
+/* Visible light whose shadow map needs a layer */
+typedef struct {
+    int lightIndex;
+    float importance;
+} shadow_request_t;
 
-void r3d_light_quit(void)
+static float shadow_importance(R3D_LightType type, Vector3 position, const r3d_light_data_t* light)
 {
-    for (int i = 0; i < R3D_LIGHT_TYPE_COUNT; i++)
+    float coverage = 0.0f;
+    if (light != NULL)
     {
-        shadow_array_destroy(&R3D_MOD_LIGHT.shadowArrays[i]);
+        coverage = 0.25f * (light->maxNdc.x - light->minNdc.x) * (light->maxNdc.y - light->minNdc.y);
     }
 
-    R3D_LIST_DESTROY(R3D_MOD_LIGHT.listShadowJobs);
-    R3D_LIST_DESTROY(R3D_MOD_LIGHT.listLightData);
+    float distance = 0.0f;
+    if (type != R3D_LIGHT_DIR)
+    {
+        distance = Vector3Distance(position, R3D.viewState.camera.position);
+    }
+
+    // Off-screen lights keep a small weight
+    return (0.05f + coverage) / (1.0f + 0.1f * distance);
 }
 
-void r3d_light_push(const R3D_Light* light, const R3D_ShadowMap* map, bool updateShadow)
+static float shadow_unit_score(const r3d_light_shadow_job_t* job, const r3d_light_shadow_cache_t* cache, uint32_t faces, int faceCount)
 {
-    if (map && !light_check_shadow_validity(light, map))
+    // Faces never rendered come first, the light has no usable shadow without them
+    if ((cache->renderedFaces & faces) != faces) return FLT_MAX;
+
+    const r3d_light_data_t* light = NULL;
+    if (job->lightIndex >= 0)
     {
-        map = NULL;
+        light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, job->lightIndex);
     }
 
-    switch (light->type)
+    // Waiting time of the longest deferred face of the unit
+    float age = 0.0f;
+    for (int face = 0; face < 6; face++)
     {
-    case R3D_LIGHT_DIR:
-        light_dir_push(light, map, R3D.viewState.camera, R3D.viewState.aspect, updateShadow);
-        break;
-
-    case R3D_LIGHT_SPOT:
-        light_spot_push(light, map, &R3D.viewState.frustum, updateShadow);
-        break;
+        if ((cache->pendingFaces & faces & (1u << face)) == 0) continue;
+        age = fmaxf(age, (float)(R3D_MOD_LIGHT.shadowFrame - cache->pendingSince[face]));
+    }
 
-    case R3D_LIGHT_OMNI:
-        light_omni_push(light, map, &R3D.viewState.frustum, updateShadow);
-        break;
+    // Importance per rendered face, bounded so that waiting always ends up winning
+    float score = shadow_importance(job->type, job->position, light);
+    score /= (float)(1 + job->layerFace * (job->type == R3D_LIGHT_DIR));
+    score /= (float)faceCount;
+    score = R3D_CLAMP(score, 0.01f, 1.0f);
 
-    default:
-        break;
-    }
+    return score * (1.0f + age) * (1.0f + age);
 }
 
-r3d_light_data_t* r3d_light_get(int lightIndex)
+static void shadow_commit_job(const r3d_light_shadow_job_t* job, r3d_light_shadow_cache_t* cache)
 {
-    return &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, lightIndex);
-}
+    uint32_t faceBit = 1u << job->layerFace;
 
-void r3d_light_clear(void)
-{
-    R3D_LIST_CLEAR(R3D_MOD_LIGHT.listShadowJobs);
-    R3D_LIST_CLEAR(R3D_MOD_LIGHT.listLightData);
-}
+    if (job->type == R3D_LIGHT_OMNI)
+    {
+        // Static casters must be redrawn once the light moves
+        if (memcmp(&cache->position, &job->position, sizeof(Vector3)) != 0 || cache->far != job->far)
+        {
+            cache->staticValid = 0;
+        }
+
+        cache->position = job->position;
+        cache->far = job->far;
+    }
+    else
+    {
+        shadow_cache_set_view_proj(cache, job->layerFace, job->viewProj);
+    }
+
+    cache->renderedFaces |= faceBit;
+    cache->pendingFaces &= ~faceBit;
+}
+
+static void shadow_defer_job(const r3d_light_shadow_job_t* job, r3d_light_shadow_cache_t* cache)
+{
+    uint32_t faceBit = 1u << job->layerFace;
+
+    if ((cache->pendingFaces & faceBit) == 0)
+    {
+        cache->pendingSince[job->layerFace] = R3D_MOD_LIGHT.shadowFrame;
+    }
+    cache->pendingFaces |= faceBit;
+
+    if (job->lightIndex < 0) return;
+
+    // The light samples the previous content, with the projection it was rendered with
+    r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, job->lightIndex);
+
+    if ((cache->renderedFaces & faceBit) == 0)
+    {
+        light->shadowLayer = -1;
+    }
+    else if (job->type == R3D_LIGHT_OMNI)
+    {
+        light->shadowFar = cache->far;
+    }
+    else
+    {
+        light->viewProj[job->layerFace] = cache->viewProj[job->layerFace];
+    }
+}
+
+static bool shadow_cache_assign_tile(r3d_light_shadow_array_t* arr, r3d_light_shadow_cache_t* cache, int level, R3D_ShadowStats* stats)
+{
+    int layer = -1;
+    int node = -1;
+
+    // Only maps without a tile reclaim the others, an enlargement that doesn't fit keeps its tile
+    bool canEvict = (cache->layer < 0);
+
+    while (!shadow_array_alloc_tile(arr, level, &layer, &node))
+    {
+        if (shadow_array_expand(arr, (uint32_t)arr->growth)) continue;
+        if (!canEvict || !shadow_array_evict_map(arr, R3D_MOD_LIGHT.shadowFrame)) return false;
+        stats->evictedMaps++;
+    }
+
+    // Releasing the previous tile also marks every face as not rendered
+    shadow_array_free_tile(arr, cache);
+
+    cache->layer = layer;
+    cache->tileNode = node;
+    cache->tileLevel = level;
+
+    return true;
+}
+
+static void shadow_resolve_residency(R3D_ShadowStats* stats)
+{
+    uint32_t frame = R3D_MOD_LIGHT.shadowFrame;
+    int lightCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listLightData);
+
+    R3D_STACK_SCOPE(&R3D.stack, lightCount * sizeof(shadow_request_t))
+    {
+        shadow_request_t* requests = r3d_stack_alloc(&R3D.stack, lightCount * sizeof(shadow_request_t));
+
+        /* --- Refresh the visible maps, shrink the oversized tiles and rank the maps needing one --- */
+
+        int requestCount = 0;
+        for (int i = 0; i < lightCount; i++)
+        {
+            const r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, i);
+            if (light->shadowMap < 0) continue;
+
+            r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(light->type, light->shadowMap);
+            cache->lastVisible = frame;
+
+            if (!shadow_cache_resize_due(cache, light->shadowLevel))
+            {
+                if (cache->layer >= 0) continue;
+            }
+            else if (light->shadowLevel > cache->tileLevel)
+            {
+                shadow_array_free_tile(&R3D_MOD_LIGHT.shadowArrays[light->type], cache);
+            }
+
+            shadow_request_t request = {
+                .lightIndex = i,
+                .importance = shadow_importance(light->type, light->position, light),
+            };
+
+            int slot = requestCount++;
+            while (slot > 0 && requests[slot - 1].importance < request.importance)
+            {
+                requests[slot] = requests[slot - 1];
+                slot--;
+            }
+            requests[slot] = request;
+        }
+
+        /* --- Give tiles to the most important ones, reclaiming the least recently visible maps --- */
+
+        for (int i = 0; i < requestCount; i++)
+        {
+            const r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, requests[i].lightIndex);
+            r3d_light_shadow_array_t* arr = &R3D_MOD_LIGHT.shadowArrays[light->type];
+            r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(light->type, light->shadowMap);
+
+            // The same map may be pushed with several lights
+            if (cache->layer >= 0 && !shadow_cache_resize_due(cache, light->shadowLevel)) continue;
+
+            bool enlarge = (cache->layer >= 0);
+            if (shadow_cache_assign_tile(arr, cache, light->shadowLevel, stats)) continue;
+
+            // Enlargements keep their current tile, new maps fall back to smaller tiles
+            if (enlarge)
+            {
+                cache->tileRetry = frame + SHADOW_TILE_RETRY_DELAY;
+                continue;
+            }
+
+            bool assigned = false;
+            for (int level = light->shadowLevel + 1; !assigned && level < R3D_SHADOW_ATLAS_LEVELS; level++)
+            {
+                assigned = shadow_cache_assign_tile(arr, cache, level, stats);
+            }
+
+            if (!assigned) stats->missingMaps++;
+        }
+    }
+
+    /* --- Resolve the layers sampled by the lights --- */
+
+    R3D_LIGHT_FOR_EACH_VISIBLE(light)
+    {
+        if (light->shadowMap < 0) continue;
+
+        const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(light->type, light->shadowMap);
+        if (cache->layer < 0) continue;
+
+        int size = R3D_MOD_LIGHT.shadowArrays[light->type].size;
+        r3d_rect_t tile = shadow_atlas_node_rect(cache->tileNode, size);
+
+        int stride = (light->type == R3D_LIGHT_DIR) ? light->cascadeCount : 1;
+        light->shadowLayer = cache->layer * stride;
+        light->shadowTile = (Vector4) {
+            (float)tile.x / (float)size,
+            (float)tile.y / (float)size,
+            (float)tile.w / (float)size,
+            0.0f
+        };
+    }
+
+    /* --- Drop the jobs of the maps left without a layer --- */
+
+    int jobCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listShadowJobs);
+    int keptCount = 0;
+
+    for (int i = 0; i < jobCount; i++)
+    {
+        r3d_light_shadow_job_t job = R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, i);
+        const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(job.type, job.shadowMap);
+        if (cache->layer < 0) continue;
+
+        job.shadowLayer = cache->layer;
+        R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, keptCount++) = job;
+    }
+
+    R3D_LIST_RESIZE(R3D_MOD_LIGHT.listShadowJobs, keptCount);
+}
+
+// ========================================
+// LIGHT BUDGET FUNCTIONS
+// ========================================
+
+/* Number of kept ranks above the cutoff over which the last kept lights fade in */
+#define LIGHT_BUDGET_FADE_RANKS 4
+
+/* Energy factor of the last kept light, the fade never goes below it */
+#define LIGHT_BUDGET_FADE_MIN 0.5f
+
+/* Visible local light competing for the light budget */
+typedef struct {
+    int lightIndex;
+    float importance;
+} light_rank_t;
+
+static float light_importance(const r3d_light_data_t* light)
+{
+    float intensity = light->energy * fmaxf(light->color.x, fmaxf(light->color.y, light->color.z));
+
+    // Screen area of the light volume, its off-screen part excluded
+    float w = fminf(light->maxNdc.x, 1.0f) - fmaxf(light->minNdc.x, -1.0f);
+    float h = fminf(light->maxNdc.y, 1.0f) - fmaxf(light->minNdc.y, -1.0f);
+    float coverage = 0.25f * fmaxf(w, 0.0f) * fmaxf(h, 0.0f);
+
+    // Lights far away compared to their range barely reach what they cover
+    float distance = Vector3Distance(light->position, R3D.viewState.camera.position);
+    float reach = light->range / (light->range + distance);
+
+    return intensity * (0.01f + coverage) * reach;
+}
+
+static int light_rank_compare(const void* a, const void* b)
+{
+    float ia = ((const light_rank_t*)a)->importance;
+    float ib = ((const light_rank_t*)b)->importance;
+
+    return (ia < ib) - (ia > ib);
+}
+
+// ========================================
+// LIGHT GRID FUNCTIONS
+// ========================================
+
+typedef struct {
+    Vector3 center;         // Light volume center in view space
+    float radius;
+    int minX, maxX;
+    int minY, maxY;
+    int minZ, maxZ;
+} light_grid_bounds_t;
+
+static r3d_light_gpu_t light_grid_pack(const r3d_light_data_t* light)
+{
+    r3d_light_gpu_t gpu = {
+        .color           = light->color,
+        .energy          = light->energy,
+        .position        = light->position,
+        .range           = light->range,
+        .direction       = light->direction,
+        .specular        = light->specular,
+        .falloff         = light->falloff,
+        .innerCutOff     = light->innerCutOff,
+        .outerCutOff     = light->outerCutOff,
+        .fogEnergy       = light->fogEnergy,
+        .shadowSoftness  = light->shadowSoftness,
+        .shadowOpacity   = light->shadowOpacity,
+        .shadowDepthBias = light->shadowDepthBias,
+        .shadowSlopeBias = light->shadowSlopeBias,
+        .shadowFar       = light->shadowFar,
+        .shadowLayer     = (float)light->shadowLayer,
+        .type            = (float)light->type,
+        .cascadeCount    = (float)light->cascadeCount,
+        .shadowTile      = light->shadowTile,
+    };
+
+    for (int i = 0; i < R3D_SHADOW_CASCADE_MAX; i++)
+    {
+        gpu.viewProj[i] = MatrixTranspose(light->viewProj[i]);
+    }
+
+    return gpu;
+}
+
+static int light_grid_tile(float ndc, int count)
+{
+    int tile = (int)floorf((ndc * 0.5f + 0.5f) * (float)count);
+    return R3D_CLAMP(tile, 0, count - 1);
+}
+
+static int light_grid_slice(float depth, float nearPlane)
+{
+    float z = R3D_MAX(depth, nearPlane);
+    int slice = (int)floorf(logf(z) * R3D_MOD_LIGHT.gridDepthScale + R3D_MOD_LIGHT.gridDepthBias);
+    return R3D_CLAMP(slice, 0, R3D_LIGHT_GRID_Z - 1);
+}
+
+static bool light_grid_bounds(const r3d_light_data_t* light, float nearPlane, float farPlane, light_grid_bounds_t* bounds)
+{
+    const Matrix* proj = &R3D.viewState.proj;
+
+    Vector3 vsCenter = r3d_vector3_transform(light->volume.center, &R3D.viewState.view);
+    float radius = light->volume.radius;
+    float depth = -vsCenter.z;
+
+    if (depth + radius < nearPlane || depth - radius > farPlane)
+    {
+        return false;
+    }
+
+    Vector2 minNdc = light->minNdc;
+    Vector2 maxNdc = light->maxNdc;
+
+    // The screen rect computed on push assumes a perspective projection
+    if (R3D.viewState.camera.projection == R3D_PROJECTION_ORTHOGRAPHIC)
+    {
+        float cx = vsCenter.x * proj->m0 + proj->m12;
+        float cy = vsCenter.y * proj->m5 + proj->m13;
+        float rx = radius * fabsf(proj->m0);
+        float ry = radius * fabsf(proj->m5);
+
+        minNdc = (Vector2) {cx - rx, cy - ry};
+        maxNdc = (Vector2) {cx + rx, cy + ry};
+    }
+
+    if (minNdc.x > 1.0f || maxNdc.x < -1.0f || minNdc.y > 1.0f || maxNdc.y < -1.0f)
+    {
+        return false;
+    }
+
+    bounds->center = vsCenter;
+    bounds->radius = radius;
+    bounds->minX = light_grid_tile(minNdc.x, R3D_LIGHT_GRID_X);
+    bounds->maxX = light_grid_tile(maxNdc.x, R3D_LIGHT_GRID_X);
+    bounds->minY = light_grid_tile(minNdc.y, R3D_LIGHT_GRID_Y);
+    bounds->maxY = light_grid_tile(maxNdc.y, R3D_LIGHT_GRID_Y);
+    bounds->minZ = light_grid_slice(depth - radius, nearPlane);
+    bounds->maxZ = light_grid_slice(depth + radius, nearPlane);
+
+    return true;
+}
+
+static bool light_grid_cell_touches(const light_grid_bounds_t* bounds, const float* sliceDepths, int x, int y, int z)
+{
+    const Matrix* proj = &R3D.viewState.proj;
+
+    // Slightly widened to absorb the rounding of the slice lookup in the shaders
+    float z0 = sliceDepths[z] * 0.999f;
+    float z1 = sliceDepths[z + 1] * 1.001f;
+
+    float nx0 = -1.0f + 2.0f * (float)x / R3D_LIGHT_GRID_X;
+    float nx1 = -1.0f + 2.0f * (float)(x + 1) / R3D_LIGHT_GRID_X;
+    float ny0 = -1.0f + 2.0f * (float)y / R3D_LIGHT_GRID_Y;
+    float ny1 = -1.0f + 2.0f * (float)(y + 1) / R3D_LIGHT_GRID_Y;
+
+    float minX, maxX, minY, maxY;
+
+    if (R3D.viewState.camera.projection == R3D_PROJECTION_ORTHOGRAPHIC)
+    {
+        minX = (nx0 - proj->m12) / proj->m0;
+        maxX = (nx1 - proj->m12) / proj->m0;
+        minY = (ny0 - proj->m13) / proj->m5;
+        maxY = (ny1 - proj->m13) / proj->m5;
+    }
+    else
+    {
+        minX = R3D_MIN(nx0 * z0, nx0 * z1) / proj->m0;
+        maxX = R3D_MAX(nx1 * z0, nx1 * z1) / proj->m0;
+        minY = R3D_MIN(ny0 * z0, ny0 * z1) / proj->m5;
+        maxY = R3D_MAX(ny1 * z0, ny1 * z1) / proj->m5;
+    }
+
+    // Distance from the volume center to the view space box of the cluster
+    float depth = -bounds->center.z;
+    float dx = R3D_CLAMP(bounds->center.x, minX, maxX) - bounds->center.x;
+    float dy = R3D_CLAMP(bounds->center.y, minY, maxY) - bounds->center.y;
+    float dz = R3D_CLAMP(depth, z0, z1) - depth;
+
+    return dx * dx + dy * dy + dz * dz <= bounds->radius * bounds->radius;
+}
+
+static void light_grid_upload(GLuint buffer, const r3d_list_t* list)
+{
+    size_t size = list->elemCount * list->elemSize;
+
+    // Keep some storage behind the texture even when there is nothing to fetch
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)R3D_MAX(size, (size_t)16), (size > 0) ? list->elements : NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+static void light_grid_create_buffer(GLuint* buffer, GLuint* texture, GLenum format)
+{
+    glGenBuffers(1, buffer);
+    glGenTextures(1, texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, *texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+// ========================================
+// MODULE FUNCTIONS
+// ========================================
+
+bool r3d_light_init(void)
+{
+    memset(&R3D_MOD_LIGHT, 0, sizeof(R3D_MOD_LIGHT));
+
+    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_DIR]  = shadow_array_create(GL_TEXTURE_2D_ARRAY, R3D_HINT(R3D_HINT_SHADOW_DIR_SIZE), R3D_HINT(R3D_HINT_SHADOW_DIR_CASCADES), SHADOW_DIR_LAYER_GROWTH);
+    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_SPOT] = shadow_array_create(GL_TEXTURE_2D_ARRAY, R3D_HINT(R3D_HINT_SHADOW_SPOT_SIZE), 1, SHADOW_SPOT_LAYER_GROWTH);
+    R3D_MOD_LIGHT.shadowArrays[R3D_LIGHT_OMNI] = shadow_array_create(GL_TEXTURE_CUBE_MAP_ARRAY, R3D_HINT(R3D_HINT_SHADOW_OMNI_SIZE), 6, SHADOW_OMNI_LAYER_GROWTH);
+
+    R3D_MOD_LIGHT.listShadowJobs = R3D_LIST_CREATE(r3d_light_shadow_job_t, 32);
+    R3D_MOD_LIGHT.listLightData  = R3D_LIST_CREATE(r3d_light_data_t, 256);
+    R3D_MOD_LIGHT.gridLights     = R3D_LIST_CREATE(r3d_light_gpu_t, 256);
+    R3D_MOD_LIGHT.gridData       = R3D_LIST_CREATE(uint32_t, 2 * R3D_LIGHT_GRID_CELL_COUNT + 1024);
+
+    light_grid_create_buffer(&R3D_MOD_LIGHT.lightBuffer, &R3D_MOD_LIGHT.lightTexture, GL_RGBA32F);
+    light_grid_create_buffer(&R3D_MOD_LIGHT.gridBuffer, &R3D_MOD_LIGHT.gridTexture, GL_R32UI);
+
+    return true;
+}
+
+void r3d_light_quit(void)
+{
+    for (int i = 0; i < R3D_LIGHT_TYPE_COUNT; i++)
+    {
+        shadow_array_destroy(&R3D_MOD_LIGHT.shadowArrays[i]);
+    }
+
+    glDeleteTextures(1, &R3D_MOD_LIGHT.lightTexture);
+    glDeleteTextures(1, &R3D_MOD_LIGHT.gridTexture);
+    glDeleteBuffers(1, &R3D_MOD_LIGHT.lightBuffer);
+    glDeleteBuffers(1, &R3D_MOD_LIGHT.gridBuffer);
+
+    R3D_LIST_DESTROY(R3D_MOD_LIGHT.listShadowJobs);
+    R3D_LIST_DESTROY(R3D_MOD_LIGHT.listLightData);
+    R3D_LIST_DESTROY(R3D_MOD_LIGHT.gridLights);
+    R3D_LIST_DESTROY(R3D_MOD_LIGHT.gridData);
+}
+
+void r3d_light_push(const R3D_Light* light, const R3D_ShadowMap* map, bool updateShadow)
+{
+    if (map && !light_check_shadow_validity(light, map))
+    {
+        map = NULL;
+    }
+
+    switch (light->type)
+    {
+    case R3D_LIGHT_DIR:
+        light_dir_push(light, map, R3D.viewState.camera, R3D.viewState.aspect, updateShadow);
+        break;
+
+    case R3D_LIGHT_SPOT:
+        light_spot_push(light, map, &R3D.viewState.frustum, updateShadow);
+        break;
+
+    case R3D_LIGHT_OMNI:
+        light_omni_push(light, map, &R3D.viewState.frustum, updateShadow);
+        break;
+
+    default:
+        break;
+    }
+}
+
+r3d_light_data_t* r3d_light_get(int lightIndex)
+{
+    return &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, lightIndex);
+}
+
+void r3d_light_clear(void)
+{
+    R3D_LIST_CLEAR(R3D_MOD_LIGHT.listShadowJobs);
+    R3D_LIST_CLEAR(R3D_MOD_LIGHT.listLightData);
+}
+
+void r3d_light_apply_budget(void)
+{
+    int budget = R3D_MOD_LIGHT.lightBudget;
+    int lightCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listLightData);
+
+    R3D_MOD_LIGHT.budgetDeferredFaces = 0;
+
+    if (budget <= 0 || lightCount <= budget) return;
+
+    // Directional lights are never dropped, only the local ones count against the budget
+    int localCount = 0;
+    for (int i = 0; i < lightCount; i++)
+    {
+        const r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, i);
+        if (light->type != R3D_LIGHT_DIR) localCount++;
+    }
+
+    if (localCount <= budget) return;
+
+    R3D_STACK_SCOPE(&R3D.stack, lightCount * (sizeof(light_rank_t) + sizeof(int)))
+    {
+        light_rank_t* ranks = r3d_stack_alloc(&R3D.stack, lightCount * sizeof(light_rank_t));
+        int* remap = r3d_stack_alloc(&R3D.stack, lightCount * sizeof(int));
+
+        /* --- Rank the local lights by decreasing importance, directional lights always stay --- */
+
+        int rankCount = 0;
+        for (int i = 0; i < lightCount; i++)
+        {
+            const r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, i);
+            remap[i] = i;
+
+            if (light->type == R3D_LIGHT_DIR) continue;
+
+            ranks[rankCount++] = (light_rank_t) {
+                .lightIndex = i,
+                .importance = light_importance(light),
+            };
+        }
+
+        qsort(ranks, rankCount, sizeof(light_rank_t), light_rank_compare);
+
+        /* --- Fade the last kept lights toward the cutoff, lights crossing it then do not pop --- */
+
+        // The fade only spans the few ranks at the boundary, scaled by their importance gap
+        // to the first dropped light, so the lights never at risk of being dropped are left alone
+        int first = R3D_MAX(budget - LIGHT_BUDGET_FADE_RANKS, 0);
+        float cutoff = ranks[budget].importance;
+        float gap = ranks[first].importance - cutoff;
+
+        for (int i = first; i < budget; i++)
+        {
+            r3d_light_data_t* light = &R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, ranks[i].lightIndex);
+
+            float t = (gap > 0.0f) ? (ranks[i].importance - cutoff) / gap : 1.0f;
+            float fade = LIGHT_BUDGET_FADE_MIN + (1.0f - LIGHT_BUDGET_FADE_MIN) * R3D_CLAMP(t, 0.0f, 1.0f);
+
+            light->energy *= fade;
+            light->fogEnergy *= fade;
+        }
+
+        /* --- Drop the others, keeping the submission order of the kept lights --- */
+
+        for (int i = budget; i < rankCount; i++)
+        {
+            remap[ranks[i].lightIndex] = -1;
+        }
+
+        int keptCount = 0;
+        for (int i = 0; i < lightCount; i++)
+        {
+            if (remap[i] < 0) continue;
+            remap[i] = keptCount;
+            R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, keptCount++) =
+                R3D_LIST_GET(R3D_MOD_LIGHT.listLightData, r3d_light_data_t, i);
+        }
+
+        R3D_LIST_RESIZE(R3D_MOD_LIGHT.listLightData, keptCount);
+
+        /* --- Follow the lights in the shadow jobs, the updates of the dropped ones wait for their return --- */
+
+        int jobCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listShadowJobs);
+        int keptJobs = 0;
+
+        for (int i = 0; i < jobCount; i++)
+        {
+            r3d_light_shadow_job_t job = R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, i);
+
+            if (job.lightIndex >= 0 && remap[job.lightIndex] < 0)
+            {
+                job.lightIndex = -1;
+                shadow_defer_job(&job, r3d_light_shadow_cache(job.type, job.shadowMap));
+                R3D_MOD_LIGHT.budgetDeferredFaces++;
+                continue;
+            }
+
+            if (job.lightIndex >= 0) job.lightIndex = remap[job.lightIndex];
+            R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, keptJobs++) = job;
+        }
+
+        R3D_LIST_RESIZE(R3D_MOD_LIGHT.listShadowJobs, keptJobs);
+    }
+}
+
+void r3d_light_schedule_shadows(void)
+{
+    R3D_ShadowStats stats = {0};
+
+    shadow_resolve_residency(&stats);
+
+    int jobCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listShadowJobs);
+    int budget = R3D_MOD_LIGHT.shadowBudget;
+
+    // Faces of the lights dropped by the light budget were due too, they are already deferred
+    int budgetDeferred = R3D_MOD_LIGHT.budgetDeferredFaces;
+    R3D_MOD_LIGHT.budgetDeferredFaces = 0;
+
+    stats.requestedFaces = jobCount + budgetDeferred;
+
+    R3D_STACK_SCOPE(&R3D.stack, jobCount * (sizeof(shadow_unit_t) + sizeof(bool)))
+    {
+        shadow_unit_t* units = r3d_stack_alloc(&R3D.stack, jobCount * sizeof(shadow_unit_t));
+        bool* keep = r3d_stack_alloc(&R3D.stack, jobCount * sizeof(bool));
+
+        /* --- Group the faces rendered together and rank them --- */
+
+        int unitCount = 0;
+        for (int i = 0; i < jobCount;)
+        {
+            const r3d_light_shadow_job_t* job = &R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, i);
+            const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(job->type, job->shadowMap);
+
+            bool omni = (job->type == R3D_LIGHT_OMNI);
+            uint32_t faces = omni ? 0x3F : (1u << job->layerFace);
+            int faceCount = omni ? 6 : 1;
+
+            shadow_unit_t unit = {
+                .firstJob = i,
+                .jobCount = faceCount,
+                .score = shadow_unit_score(job, cache, faces, faceCount),
+            };
+
+            // Insertion sort by decreasing score, there are only a few units per frame
+            int slot = unitCount++;
+            while (slot > 0 && units[slot - 1].score < unit.score)
+            {
+                units[slot] = units[slot - 1];
+                slot--;
+            }
+            units[slot] = unit;
+
+            i += unit.jobCount;
+        }
+
+        /* --- Keep the best ranked units fitting in the budget --- */
+
+        int faceCount = 0;
+        for (int i = 0; i < unitCount; i++)
+        {
+            // The first unit always goes, an omni light must not starve under a budget below six faces
+            bool fits = (budget <= 0) || (faceCount == 0) || (faceCount + units[i].jobCount <= budget);
+            if (fits) faceCount += units[i].jobCount;
+
+            for (int j = 0; j < units[i].jobCount; j++)
+            {
+                keep[units[i].firstJob + j] = fits;
+            }
+        }
+
+        /* --- Commit the kept faces and compact the jobs in submission order --- */
+
+        int keptCount = 0;
+        for (int i = 0; i < jobCount; i++)
+        {
+            r3d_light_shadow_job_t job = R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, i);
+            r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(job.type, job.shadowMap);
+
+            if (keep[i])
+            {
+                shadow_commit_job(&job, cache);
+                R3D_LIST_GET(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, keptCount++) = job;
+            }
+            else
+            {
+                shadow_defer_job(&job, cache);
+            }
+        }
+
+        R3D_LIST_RESIZE(R3D_MOD_LIGHT.listShadowJobs, keptCount);
+
+        stats.renderedFaces = keptCount;
+        stats.deferredFaces = jobCount - keptCount + budgetDeferred;
+    }
+
+    /* --- Report the resident maps and the age of the oldest deferred update --- */
+
+    for (int type = 0; type < R3D_LIGHT_TYPE_COUNT; type++)
+    {
+        R3D_LIST_FOR_EACH(R3D_MOD_LIGHT.shadowArrays[type].cache, r3d_light_shadow_cache_t, cache)
+        {
+            if (!cache->acquired || cache->layer < 0) continue;
+            stats.residentMaps++;
+            for (int face = 0; face < 6; face++)
+            {
+                if ((cache->pendingFaces & (1u << face)) == 0) continue;
+                int age = (int)(R3D_MOD_LIGHT.shadowFrame - cache->pendingSince[face]);
+                stats.oldestDeferral = R3D_MAX(stats.oldestDeferral, age);
+            }
+        }
+    }
+
+    R3D_MOD_LIGHT.shadowStats = stats;
+    R3D_MOD_LIGHT.shadowFrame++;
+}
+
+void r3d_light_build_grid(void)
+{
+    float nearPlane = (float)R3D.viewState.camera.nearPlane;
+    float farPlane  = (float)R3D.viewState.camera.farPlane;
+
+    float logRatio = logf(farPlane / nearPlane);
+    R3D_MOD_LIGHT.gridDepthScale = (float)R3D_LIGHT_GRID_Z / logRatio;
+    R3D_MOD_LIGHT.gridDepthBias  = -(float)R3D_LIGHT_GRID_Z * logf(nearPlane) / logRatio;
+
+    float sliceDepths[R3D_LIGHT_GRID_Z + 1];
+    for (int z = 0; z <= R3D_LIGHT_GRID_Z; z++)
+    {
+        sliceDepths[z] = nearPlane * powf(farPlane / nearPlane, (float)z / R3D_LIGHT_GRID_Z);
+    }
+
+    /* --- Pack directional lights first, they affect every cluster --- */
+
+    R3D_LIST_CLEAR(R3D_MOD_LIGHT.gridLights);
+
+    R3D_LIGHT_FOR_EACH_VISIBLE(light)
+    {
+        if (light->type != R3D_LIGHT_DIR) continue;
+        r3d_light_gpu_t gpu = light_grid_pack(light);
+        R3D_LIST_PUSH(R3D_MOD_LIGHT.gridLights, gpu);
+    }
+
+    R3D_MOD_LIGHT.gridDirLightCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.gridLights);
+
+    /* --- Count the local lights touching each cluster --- */
+
+    // Only clusters whose view space box intersects the light volume are counted,
+    // pixels behind or in front of a light never shade it
+
+    R3D_LIST_RESIZE(R3D_MOD_LIGHT.gridData, 2 * R3D_LIGHT_GRID_CELL_COUNT);
+    uint32_t* cells = R3D_MOD_LIGHT.gridData->elements;
+    memset(cells, 0, 2 * R3D_LIGHT_GRID_CELL_COUNT * sizeof(uint32_t));
+
+    R3D_LIGHT_FOR_EACH_VISIBLE(light)
+    {
+        if (light->type == R3D_LIGHT_DIR) continue;
+
+        light_grid_bounds_t b;
+        if (!light_grid_bounds(light, nearPlane, farPlane, &b)) continue;
+
+        r3d_light_gpu_t gpu = light_grid_pack(light);
+        R3D_LIST_PUSH(R3D_MOD_LIGHT.gridLights, gpu);
+
+        for (int z = b.minZ; z <= b.maxZ; z++)
+        {
+            for (int y = b.minY; y <= b.maxY; y++)
+            {
+                for (int x = b.minX; x <= b.maxX; x++)
+                {
+                    if (!light_grid_cell_touches(&b, sliceDepths, x, y, z)) continue;
+                    cells[2 * ((z * R3D_LIGHT_GRID_Y + y) * R3D_LIGHT_GRID_X + x) + 1]++;
+                }
+            }
+        }
+    }
+
+    /* --- Turn the counts into offsets past the cluster headers --- */
+
+    uint32_t offset = 2 * R3D_LIGHT_GRID_CELL_COUNT;
+    for (int i = 0; i < R3D_LIGHT_GRID_CELL_COUNT; i++)
+    {
+        cells[2 * i] = offset;
+        offset += cells[2 * i + 1];
+        cells[2 * i + 1] = 0;
+    }
+
+    R3D_LIST_RESIZE(R3D_MOD_LIGHT.gridData, offset);
+    cells = R3D_MOD_LIGHT.gridData->elements;
+
+    /* --- Write the light indices of each cluster --- */
+
+    // Local lights were packed in visit order, walking them again gives back their index
+    uint32_t lightIndex = (uint32_t)R3D_MOD_LIGHT.gridDirLightCount;
+
+    R3D_LIGHT_FOR_EACH_VISIBLE(light)
+    {
+        if (light->type == R3D_LIGHT_DIR) continue;
+
+        light_grid_bounds_t b;
+        if (!light_grid_bounds(light, nearPlane, farPlane, &b)) continue;
+
+        for (int z = b.minZ; z <= b.maxZ; z++)
+        {
+            for (int y = b.minY; y <= b.maxY; y++)
+            {
+                for (int x = b.minX; x <= b.maxX; x++)
+                {
+                    if (!light_grid_cell_touches(&b, sliceDepths, x, y, z)) continue;
+                    uint32_t* cell = &cells[2 * ((z * R3D_LIGHT_GRID_Y + y) * R3D_LIGHT_GRID_X + x)];
+                    cells[cell[0] + cell[1]++] = lightIndex;
+                }
+            }
+        }
+
+        lightIndex++;
+    }
+
+    /* --- Upload both buffers for the whole frame --- */
+
+    light_grid_upload(R3D_MOD_LIGHT.lightBuffer, R3D_MOD_LIGHT.gridLights);
+    light_grid_upload(R3D_MOD_LIGHT.gridBuffer, R3D_MOD_LIGHT.gridData);
+}
 
 r3d_rect_t r3d_light_screen_rect(const r3d_light_data_t* light, int w, int h)
 {
@@ -687,41 +1782,100 @@ const char* r3d_light_type_name(R3D_LightType type)
     return NULL;
 }
 
-int r3d_light_acquire_shadow_layer(R3D_LightType type)
+int r3d_light_acquire_shadow_map(R3D_LightType type)
 {
-    return shadow_array_acquire_layer(&R3D_MOD_LIGHT.shadowArrays[type]);
+    return shadow_array_acquire_map(&R3D_MOD_LIGHT.shadowArrays[type]);
 }
 
-void r3d_light_release_shadow_layer(R3D_LightType type, int layer)
+void r3d_light_release_shadow_map(R3D_LightType type, int index)
 {
-    if (r3d_light_shadow_layer_is_valid(type, layer))
+    if (r3d_light_shadow_map_is_valid(type, index))
     {
-        shadow_array_release_layer(&R3D_MOD_LIGHT.shadowArrays[type], layer);
+        shadow_array_release_map(&R3D_MOD_LIGHT.shadowArrays[type], index);
     }
 }
 
-void r3d_light_bind_shadow_fbo(R3D_LightType type, int layer, int face)
+r3d_rect_t r3d_light_shadow_tile_rect(R3D_LightType type, int index)
 {
-    R3D_ASSERT((type == R3D_LIGHT_OMNI && face >= 0 && face < 6) || (type != R3D_LIGHT_OMNI && face == 0));
+    const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(type, index);
+    R3D_ASSERT(cache->layer >= 0);
+
+    return shadow_atlas_node_rect(cache->tileNode, R3D_MOD_LIGHT.shadowArrays[type].size);
+}
 
+void r3d_light_bind_shadow_fbo(R3D_LightType type, int index, int face)
+{
     r3d_light_shadow_array_t* arr = &R3D_MOD_LIGHT.shadowArrays[type];
-    int stride = (type == R3D_LIGHT_OMNI) ? 6 : 1;
+    R3D_ASSERT(face < arr->facesPerLayer);
+
+    const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(type, index);
+    r3d_rect_t tile = shadow_atlas_node_rect(cache->tileNode, arr->size);
+
+    shadow_array_attach(arr, arr->texture, cache->layer, face);
+    glViewport(tile.x, tile.y, tile.w, tile.h);
+}
+
+void r3d_light_bind_static_shadow_fbo(R3D_LightType type, int index, int face)
+{
+    r3d_light_shadow_array_t* arr = &R3D_MOD_LIGHT.shadowArrays[type];
+    R3D_ASSERT(face < arr->facesPerLayer);
+
+    if (arr->staticTexture == 0)
+    {
+        glGenTextures(1, &arr->staticTexture);
+        shadow_array_allocate_texture(arr->staticTexture, arr->target, arr->size, arr->layerCount, arr->facesPerLayer);
+    }
+
+    const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(type, index);
+    r3d_rect_t tile = shadow_atlas_node_rect(cache->tileNode, arr->size);
+
+    shadow_array_attach(arr, arr->staticTexture, cache->layer, face);
+    glViewport(tile.x, tile.y, tile.w, tile.h);
+}
+
+void r3d_light_copy_static_shadow(R3D_LightType type, int index, int face)
+{
+    r3d_light_shadow_array_t* arr = &R3D_MOD_LIGHT.shadowArrays[type];
+    R3D_ASSERT(arr->staticTexture != 0);
+
+    const r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(type, index);
+    r3d_rect_t tile = shadow_atlas_node_rect(cache->tileNode, arr->size);
+
+    int layerFace = cache->layer * arr->facesPerLayer + face;
 
     glBindFramebuffer(GL_FRAMEBUFFER, arr->framebuffer);
-    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, arr->texture, 0, layer * stride + face);
-    glViewport(0, 0, arr->size, arr->size);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, arr->staticTexture, 0, layerFace);
+    glBindTexture(arr->target, arr->texture);
+    glCopyTexSubImage3D(arr->target, 0, tile.x, tile.y, layerFace, tile.x, tile.y, tile.w, tile.h);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(arr->target, 0);
+}
+
+void r3d_light_update_static_shadows(uint64_t staticHash)
+{
+    if (staticHash == R3D_MOD_LIGHT.staticShadowHash) return;
+    R3D_MOD_LIGHT.staticShadowHash = staticHash;
+
+    for (int type = 0; type < R3D_LIGHT_TYPE_COUNT; type++)
+    {
+        R3D_LIST_FOR_EACH(R3D_MOD_LIGHT.shadowArrays[type].cache, r3d_light_shadow_cache_t, cache)
+        {
+            cache->staticValid = 0;
+        }
+    }
 }
 
-bool r3d_light_shadow_layer_is_valid(R3D_LightType type, int layer)
+bool r3d_light_shadow_map_is_valid(R3D_LightType type, int index)
 {
     r3d_light_shadow_array_t* arr = &R3D_MOD_LIGHT.shadowArrays[type];
 
-    if (layer < 0 || (uint32_t)layer >= arr->layerCount)
+    if (index < 0 || (size_t)index >= R3D_LIST_LENGTH(arr->cache))
     {
         return false;
     }
 
-    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, layer);
+    r3d_light_shadow_cache_t* cache = &R3D_LIST_GET(arr->cache, r3d_light_shadow_cache_t, index);
     return cache->acquired;
 }
 
@@ -735,8 +1889,8 @@ GLuint r3d_light_shadow_map(R3D_LightType type)
     return R3D_MOD_LIGHT.shadowArrays[type].texture;
 }
 
-r3d_light_shadow_cache_t* r3d_light_shadow_cache(R3D_LightType type, int layer)
+r3d_light_shadow_cache_t* r3d_light_shadow_cache(R3D_LightType type, int index)
 {
-    R3D_ASSERT(layer >= 0);
-    return &R3D_LIST_GET(R3D_MOD_LIGHT.shadowArrays[type].cache, r3d_light_shadow_cache_t, layer);
+    R3D_ASSERT(index >= 0);
+    return &R3D_LIST_GET(R3D_MOD_LIGHT.shadowArrays[type].cache, r3d_light_shadow_cache_t, index);
 }
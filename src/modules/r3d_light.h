@@ -29,6 +29,27 @@
 #define R3D_LIGHT_FOR_EACH_SHADOW_JOB(job) \
     R3D_LIST_FOR_EACH(R3D_MOD_LIGHT.listShadowJobs, r3d_light_shadow_job_t, job)
 
+// ========================================
+// LIGHT GRID CONFIG
+// ========================================
+
+/* Number of clusters of the light grid along each screen axis and along the view depth */
+#define R3D_LIGHT_GRID_X 16
+#define R3D_LIGHT_GRID_Y 9
+#define R3D_LIGHT_GRID_Z 24
+
+#define R3D_LIGHT_GRID_CELL_COUNT (R3D_LIGHT_GRID_X * R3D_LIGHT_GRID_Y * R3D_LIGHT_GRID_Z)
+
+// ========================================
+// SHADOW ATLAS CONFIG
+// ========================================
+
+/* Tile sizes of the shadow atlas, from the full layer down to 1/16 of its size */
+#define R3D_SHADOW_ATLAS_LEVELS 5
+
+/* Quadtree nodes per layer, (4^levels - 1) / 3 */
+#define R3D_SHADOW_ATLAS_NODES 341
+
 // ========================================
 // TYPES
 // ========================================
@@ -41,7 +62,7 @@ typedef struct {
 typedef struct {
     r3d_light_volume_t volume;  // Light volume (sphere) (spot/omni)
     Vector2 minNdc, maxNdc;     // Light area to the screen in NDC
-    Matrix viewProj;            // Used for shadow projection (dir/spot)
+    Matrix viewProj[R3D_SHADOW_CASCADE_MAX];    // Used for shadow projection, one per cascade (dir) or [0] (spot)
     Vector3 color;
     Vector3 position;           // Light position (spot/omni)
     Vector3 direction;          // Light direction (dir/spot)
@@ -57,7 +78,11 @@ typedef struct {
     float shadowDepthBias;      // Constant depth bias
     float shadowSlopeBias;      // Slope-scaled depth bias
     float shadowFar;            // Far plane for shadow projection
-    int shadowLayer;            // Shadow map layer index, -1 if no shadow
+    int shadowMap;              // Shadow map index in its array, -1 if no shadow
+    int shadowLevel;            // Atlas level wanted for the shadow map tile, from its screen coverage
+    int shadowLayer;            // Shadow map layer index, first cascade layer (dir), -1 if no shadow, resolved when scheduling
+    Vector4 shadowTile;         // Offset (xy) and size (z) of the shadow map tile in its layer, resolved when scheduling
+    int cascadeCount;           // Number of shadow cascades starting at 'shadowLayer' (dir)
     R3D_LightType type;
 } r3d_light_data_t;
 
@@ -68,24 +93,68 @@ typedef struct {
     float         far;
     R3D_Layer     cullMask;
     R3D_LightType type;
-    int           shadowLayer;
+    int           shadowMap;        // Shadow map index in its array
+    int           shadowLayer;      // Layer holding the shadow map, resolved when scheduling
     int           layerFace;
+    float         minCasterRadius;  // Casters with a smaller bounding radius are skipped (dir cascades)
+    int           lightIndex;       // Index of the light in 'listLightData', -1 if the light is not visible
 } r3d_light_shadow_job_t;
 
 typedef struct {
-    Matrix viewProj;            // stored for projection (dir/spot)
-    float  far;                 // stored for projection (omni)
-    bool   acquired;            // true from acquire until release; drives handle validity checks
-    bool   rendered;            // true once shadow content has been rendered at least once since (re)acquired
+    Matrix   viewProj[R3D_SHADOW_CASCADE_MAX];  // stored for projection, one per cascade (dir) or [0] (spot)
+    int      updateCount;       // number of shadow updates requested, paces the cascade update intervals (dir)
+    Vector3  position;          // stored to detect moves (omni)
+    float    far;               // stored for projection (omni)
+    uint32_t staticValid;       // one bit per face, set while the static layer matches the current projection
+    uint32_t renderedFaces;     // one bit per face rendered at least once since the map became resident
+    uint32_t pendingFaces;      // one bit per face whose requested update was deferred by the shadow budget
+    uint32_t pendingSince[6];   // scheduling frame each pending face was first deferred, up to six faces (omni)
+    uint32_t lastVisible;       // scheduling frame the light was last visible, the oldest resident maps are evicted first
+    uint32_t tileRetry;         // scheduling frame a failed tile enlargement may be tried again
+    int      layer;             // layer of the shadow array holding the map, -1 while not resident
+    int      tileNode;          // atlas node of the map tile within 'layer'
+    int      tileLevel;         // atlas level of the map tile, 0 for the full layer
+    bool     acquired;          // true from acquire until release; drives handle validity checks
 } r3d_light_shadow_cache_t;
 
+/*
+ * Light as read by the shaders from the light data buffer, 23 RGBA32F texels per light.
+ * The matrices come last and are only fetched when sampling the shadow map.
+ * Must stay in sync with 'L_FetchLight()' and 'L_GetShadowMatrix()' in 'wrap/light.glsl'.
+ */
+typedef struct {
+    Vector3 color;
+    float   energy;
+    Vector3 position;
+    float   range;
+    Vector3 direction;
+    float   specular;
+    float   falloff;
+    float   innerCutOff;
+    float   outerCutOff;
+    float   fogEnergy;
+    float   shadowSoftness;
+    float   shadowOpacity;
+    float   shadowDepthBias;
+    float   shadowSlopeBias;
+    float   shadowFar;
+    float   shadowLayer;
+    float   type;
+    float   cascadeCount;
+    Vector4 shadowTile;
+    Matrix  viewProj[R3D_SHADOW_CASCADE_MAX];   // Transposed, one column per texel
+} r3d_light_gpu_t;
+
 typedef struct {
     GLuint      framebuffer;
     GLuint      texture;        // GL_TEXTURE_2D_ARRAY or GL_TEXTURE_CUBE_MAP_ARRAY handle, 0 until first expand
+    GLuint      staticTexture;  // same layout as 'texture' holding the static casters only, 0 until first needed
     GLenum      target;         // GL_TEXTURE_2D_ARRAY (dir/spot) or GL_TEXTURE_CUBE_MAP_ARRAY (omni)
-    r3d_list_t* freeList;       // list<int> of currently free layer indices
-    r3d_list_t* cache;          // list<r3d_light_shadow_cache_t> indexed by layer
+    r3d_list_t* freeList;       // list<int> of currently free map indices
+    r3d_list_t* atlas;          // list<uint8_t> of R3D_SHADOW_ATLAS_NODES tile states per layer
+    r3d_list_t* cache;          // list<r3d_light_shadow_cache_t> indexed by map
     uint32_t    layerCount;     // total number of allocated layers (GL side)
+    int         facesPerLayer;  // texture layers per shadow map, 6 (omni), cascade count (dir) or 1 (spot)
     int         size;           // shadow map resolution
     int         growth;         // number of layers added per expand
 } r3d_light_shadow_array_t;
@@ -98,6 +167,21 @@ extern struct r3d_light {
     r3d_light_shadow_array_t shadowArrays[R3D_LIGHT_TYPE_COUNT];
     r3d_list_t* listShadowJobs;
     r3d_list_t* listLightData;
+    r3d_list_t* gridLights;     // list<r3d_light_gpu_t> directional lights first, then local lights
+    r3d_list_t* gridData;       // list<uint32_t> (offset, count) per cluster followed by the light indices
+    GLuint lightBuffer;         // Texture buffer storage of 'gridLights'
+    GLuint lightTexture;        // GL_RGBA32F view of 'lightBuffer'
+    GLuint gridBuffer;          // Texture buffer storage of 'gridData'
+    GLuint gridTexture;         // GL_R32UI view of 'gridBuffer'
+    float gridDepthScale;       // Depth slice is 'log(z) * scale + bias'
+    float gridDepthBias;
+    int gridDirLightCount;      // Number of directional lights at the start of 'gridLights'
+    uint64_t staticShadowHash;  // Hash of the static casters the static shadow layers were rendered with
+    int shadowBudget;           // Maximum number of shadow faces rendered per frame, 0 if unlimited
+    int lightBudget;            // Maximum number of local lights shaded per frame, 0 if unlimited
+    uint32_t shadowFrame;       // Scheduling counter, ages the deferred shadow updates
+    R3D_ShadowStats shadowStats;    // Decisions of the last shadow scheduling
+    int budgetDeferredFaces;        // Shadow faces deferred by the light budget, reported by the next scheduling
 } R3D_MOD_LIGHT;
 
 // ========================================
@@ -119,23 +203,50 @@ r3d_light_data_t* r3d_light_get(int lightIndex);
 /**/
 void r3d_light_clear(void);
 
+/* Keeps the most important visible local lights within the light budget, fading those near
+ * the cutoff and dropping the others along with their shadow jobs, to call before scheduling. */
+void r3d_light_apply_budget(void);
+
+/* Gives a layer to the shadow maps of the visible lights, within the shadow memory budget,
+ * then ranks the shadow jobs of the frame and keeps those fitting in the shadow budget.
+ * Deferred jobs keep their previous content, to call before building the light grid. */
+void r3d_light_schedule_shadows(void);
+
+/* Packs the visible lights, bins the local ones into the clusters of the current view
+ * and uploads both buffers, to call once all lights of the frame have been pushed. */
+void r3d_light_build_grid(void);
+
 /* Returns the screen-space rectangle covered by the light's influence */
 r3d_rect_t r3d_light_screen_rect(const r3d_light_data_t* light, int w, int h);
 
 /**/
 const char* r3d_light_type_name(R3D_LightType type);
 
-/**/
-int r3d_light_acquire_shadow_layer(R3D_LightType type);
+/* Reserves a shadow map, its layer is only assigned once its light is visible */
+int r3d_light_acquire_shadow_map(R3D_LightType type);
 
-/**/
-void r3d_light_release_shadow_layer(R3D_LightType type, int layer);
+/* Releases a shadow map and the layer it was holding */
+void r3d_light_release_shadow_map(R3D_LightType type, int index);
+
+/* Returns the texel rectangle of a resident shadow map tile within its layer */
+r3d_rect_t r3d_light_shadow_tile_rect(R3D_LightType type, int index);
 
-/* Bind shadow framebuffer for a light type */
-void r3d_light_bind_shadow_fbo(R3D_LightType type, int layer, int face);
+/* Bind the shadow framebuffer to the layer of a resident shadow map, the viewport is set to its tile.
+ * A negative face attaches every layer of the array at once, for layered rendering. */
+void r3d_light_bind_shadow_fbo(R3D_LightType type, int index, int face);
 
-/* Returns if the shadow map layer is valid */
-bool r3d_light_shadow_layer_is_valid(R3D_LightType type, int layer);
+/* Bind the shadow framebuffer to the static casters tile, the static layers are allocated on first use.
+ * A negative face attaches every static layer at once, for layered rendering. */
+void r3d_light_bind_static_shadow_fbo(R3D_LightType type, int index, int face);
+
+/* Copy the static casters tile into the shadow map tile, leaves the framebuffer unbound */
+void r3d_light_copy_static_shadow(R3D_LightType type, int index, int face);
+
+/* Invalidates every static shadow layer if the static casters differ from the last call */
+void r3d_light_update_static_shadows(uint64_t staticHash);
+
+/* Returns if the shadow map index is valid */
+bool r3d_light_shadow_map_is_valid(R3D_LightType type, int index);
 
 /* Get the shadow map dimensions */
 int r3d_light_shadow_map_size(R3D_LightType type);
@@ -144,7 +255,7 @@ int r3d_light_shadow_map_size(R3D_LightType type);
 GLuint r3d_light_shadow_map(R3D_LightType type);
 
 /**/
-r3d_light_shadow_cache_t* r3d_light_shadow_cache(R3D_LightType type, int layer);
+r3d_light_shadow_cache_t* r3d_light_shadow_cache(R3D_LightType type, int index);
 
 // ========================================
 // INLINE QUERIES
@@ -155,6 +266,11 @@ static inline bool r3d_light_has_visible(void)
     return !R3D_LIST_EMPTY(R3D_MOD_LIGHT.listLightData);
 }
 
+static inline int r3d_light_grid_light_count(void)
+{
+    return (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.gridLights);
+}
+
 static inline bool r3d_light_has_shadow_job(void)
 {
     return !R3D_LIST_EMPTY(R3D_MOD_LIGHT.listShadowJobs);
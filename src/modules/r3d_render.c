@@ -19,6 +19,7 @@
 #include "../common/r3d_helper.h"
 #include "../common/r3d_math.h"
 #include "../common/r3d_hash.h"
+#include "../common/r3d_half.h"
 #include "../r3d_core_state.h"
 
 // ========================================
@@ -60,6 +61,19 @@ static const int INSTANCE_FORMAT_SIZE[R3D_INSTANCE_FORMAT_COUNT] = {
     [R3D_INSTANCE_FORMAT_SNORM8]  = 1,
 };
 
+/* Layout of the instances written for the dynamic batches, a full precision transform per merged call */
+static const R3D_InstanceLayout BATCH_INSTANCE_LAYOUT = {
+    .formats = {
+        [0] = R3D_INSTANCE_FORMAT_FLOAT32,
+        [1] = R3D_INSTANCE_FORMAT_FLOAT32,
+        [2] = R3D_INSTANCE_FORMAT_FLOAT32,
+    },
+    .flags = R3D_INSTANCE_POSITION | R3D_INSTANCE_ROTATION | R3D_INSTANCE_SCALE
+};
+
+/* Relative error tolerated on the scale and axes of a transform to merge it into a batch */
+#define BATCH_TRANSFORM_EPSILON 1e-4f
+
 // ========================================
 // MODULE STATE
 // ========================================
@@ -119,10 +133,75 @@ static void vao_configure(bool rebindVbo, bool configInstances)
     }
 }
 
+/*
+ * Sets up the depth VAO (already bound) over the packed position stream.
+ * Only the position attribute is sourced, the others read the constant values
+ * set by depth_vao_set_defaults() each time the VAO is bound for drawing.
+ * Pass configInstances=true only at init to set the instance divisors.
+ */
+static void depth_vao_configure(bool configInstances)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, R3D_MOD_RENDER.positionVbo);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), (void*)0);
+
+    if (configInstances)
+    {
+        glVertexAttribDivisor(10, 1);
+        glVertexAttribDivisor(11, 1);
+        glVertexAttribDivisor(12, 1);
+        glVertexAttribDivisor(13, 1);
+        glVertexAttribDivisor(14, 1);
+    }
+}
+
+/*
+ * Sets the constant values read by the vertex attributes the depth VAO does not source.
+ * These values are context state rather than VAO state, so they are set on every bind.
+ */
+static void depth_vao_set_defaults(void)
+{
+    glVertexAttrib2f(1, 0.0f, 0.0f);
+    glVertexAttrib3f(2, 0.0f, 0.0f, 1.0f);
+    glVertexAttrib4f(3, 1.0f, 0.0f, 0.0f, 1.0f);
+    glVertexAttrib4f(4, 1.0f, 1.0f, 1.0f, 1.0f);
+    glVertexAttribI4i(5, 0, 0, 0, 0);
+    glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+/*
+ * Grows the position stream to 'newCapacity' vertices, keeping the
+ * first 'count' positions. Same strategy as vbo_grow, called by it.
+ */
+static void position_vbo_grow(int newCapacity, int count)
+{
+    GLuint newVbo;
+    glGenBuffers(1, &newVbo);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * sizeof(Vector3), NULL, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, R3D_MOD_RENDER.positionVbo);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        0, 0,
+        count * sizeof(Vector3)
+    );
+
+    glDeleteBuffers(1, &R3D_MOD_RENDER.positionVbo);
+    R3D_MOD_RENDER.positionVbo = newVbo;
+
+    glBindVertexArray(R3D_MOD_RENDER.depthVao);
+    depth_vao_configure(false);
+    glBindVertexArray(0);
+}
+
 /*
  * Grows the global VBO to at least 'minCapacity' vertices.
  * Creates a new buffer, copies the old content via glCopyBufferSubData,
  * deletes the old buffer, and reconfigures the VAO attrib pointers.
+ * The position stream, when enabled, grows along with it.
  */
 static bool vbo_grow(int minCapacity)
 {
@@ -154,6 +233,12 @@ static bool vbo_grow(int minCapacity)
     vao_configure(true, false);
     glBindVertexArray(0);
 
+    // Keep the position stream the same size
+    if (R3D_MOD_RENDER.positionVbo != 0)
+    {
+        position_vbo_grow(newCapacity, R3D_MOD_RENDER.globalVertexCount);
+    }
+
     return true;
 }
 
@@ -186,6 +271,14 @@ static bool ebo_grow(int minCapacity)
     // Rebind the EBO into the global VAO
     glBindVertexArray(R3D_MOD_RENDER.globalVao);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, R3D_MOD_RENDER.globalEbo);
+
+    // The depth VAO shares it
+    if (R3D_MOD_RENDER.depthVao != 0)
+    {
+        glBindVertexArray(R3D_MOD_RENDER.depthVao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, R3D_MOD_RENDER.globalEbo);
+    }
+
     glBindVertexArray(0);
 
     return true;
@@ -193,7 +286,7 @@ static bool ebo_grow(int minCapacity)
 
 /*
  * Copies 'count' vertex slots from 'srcOffset' to 'dstOffset' within
- * the global VBO. Ranges must not overlap.
+ * the global VBO, and the position stream if enabled. Ranges must not overlap.
  */
 static void vbo_relocate(int dstOffset, int srcOffset, int count)
 {
@@ -207,6 +300,18 @@ static void vbo_relocate(int dstOffset, int srcOffset, int count)
         dstOffset * sizeof(R3D_Vertex),
         size
     );
+
+    if (R3D_MOD_RENDER.positionVbo != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, R3D_MOD_RENDER.positionVbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, R3D_MOD_RENDER.positionVbo);
+        glCopyBufferSubData(
+            GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            srcOffset * sizeof(Vector3),
+            dstOffset * sizeof(Vector3),
+            count * sizeof(Vector3)
+        );
+    }
 }
 
 /*
@@ -545,6 +650,68 @@ static void instances_disable(R3D_InstanceFlags flags)
 }
 */
 
+/*
+ * Returns the slot holding the CPU copy of 'key', or the empty slot where it would be inserted.
+ * The table uses linear probing and is never full.
+ */
+static int cpu_copy_slot_find(GLuint key)
+{
+    uint32_t mask = (uint32_t)R3D_MOD_RENDER.instanceCpuCopySlotCount - 1;
+    uint32_t slot = r3d_hash_fnv1a_32(&key, sizeof(key)) & mask;
+
+    for (;;)
+    {
+        int index = R3D_MOD_RENDER.instanceCpuCopySlots[slot];
+        if (index < 0) return (int)slot;
+        if (R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, index).key == key) return (int)slot;
+        slot = (slot + 1) & mask;
+    }
+}
+
+/*
+ * Empties a slot and shifts back the following entries of the probe chain that can move into it.
+ */
+static void cpu_copy_slot_erase(int slot)
+{
+    int* slots = R3D_MOD_RENDER.instanceCpuCopySlots;
+    uint32_t mask = (uint32_t)R3D_MOD_RENDER.instanceCpuCopySlotCount - 1;
+    uint32_t hole = (uint32_t)slot;
+
+    for (uint32_t i = (hole + 1) & mask; slots[i] >= 0; i = (i + 1) & mask)
+    {
+        GLuint key = R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, slots[i]).key;
+        uint32_t home = r3d_hash_fnv1a_32(&key, sizeof(key)) & mask;
+
+        // The entry can fill the hole if the hole lies on its probe path
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+
+    slots[hole] = -1;
+}
+
+/*
+ * Reallocates the slot table with 'slotCount' slots (a power of two) and reinserts every CPU copy.
+ */
+static void cpu_copy_slots_rebuild(int slotCount)
+{
+    r3d_free(R3D_MOD_RENDER.instanceCpuCopySlots);
+
+    R3D_MOD_RENDER.instanceCpuCopySlots = r3d_malloc(slotCount * sizeof(int));
+    R3D_MOD_RENDER.instanceCpuCopySlotCount = slotCount;
+    memset(R3D_MOD_RENDER.instanceCpuCopySlots, 0xFF, slotCount * sizeof(int));
+
+    int count = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.instanceCpuCopies);
+    for (int i = 0; i < count; i++)
+    {
+        GLuint key = R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, i).key;
+        R3D_MOD_RENDER.instanceCpuCopySlots[cpu_copy_slot_find(key)] = i;
+    }
+}
+
 // ========================================
 // INTERNAL ARRAY FUNCTIONS
 // ========================================
@@ -563,6 +730,40 @@ static inline int array_get_last_group_index(void)
     return groupIndex;
 }
 
+static inline uint64_t hash_combine(uint64_t hash, const void* data, size_t size)
+{
+    return (hash ^ r3d_hash_fnv1a_64(data, size)) * R3D_HASH_FNV_PRIME_64;
+}
+
+/*
+ * Hashes what a static caster writes in depth: the drawn range of the mesh and the material
+ * fields read by the depth shaders. Fields are hashed one by one, struct padding is not hashed.
+ */
+static uint64_t hash_static_caster(uint64_t hash, const R3D_Mesh* mesh, const R3D_Material* material)
+{
+    hash = hash_combine(hash, &mesh->vertexOffset, sizeof(mesh->vertexOffset));
+    hash = hash_combine(hash, &mesh->vertexCount, sizeof(mesh->vertexCount));
+    hash = hash_combine(hash, &mesh->indexOffset, sizeof(mesh->indexOffset));
+    hash = hash_combine(hash, &mesh->indexCount, sizeof(mesh->indexCount));
+    hash = hash_combine(hash, &mesh->primitiveType, sizeof(mesh->primitiveType));
+    hash = hash_combine(hash, &mesh->shadowCastMode, sizeof(mesh->shadowCastMode));
+    hash = hash_combine(hash, &mesh->layerMask, sizeof(mesh->layerMask));
+    hash = hash_combine(hash, &mesh->aabb, sizeof(mesh->aabb));
+    hash = hash_combine(hash, &mesh->vertexAlpha, sizeof(mesh->vertexAlpha));
+
+    hash = hash_combine(hash, &material->albedo.texture.id, sizeof(material->albedo.texture.id));
+    hash = hash_combine(hash, &material->albedo.color, sizeof(material->albedo.color));
+    hash = hash_combine(hash, &material->uvOffset, sizeof(material->uvOffset));
+    hash = hash_combine(hash, &material->uvScale, sizeof(material->uvScale));
+    hash = hash_combine(hash, &material->alphaCutoff, sizeof(material->alphaCutoff));
+    hash = hash_combine(hash, &material->transparencyMode, sizeof(material->transparencyMode));
+    hash = hash_combine(hash, &material->billboardMode, sizeof(material->billboardMode));
+    hash = hash_combine(hash, &material->cullMode, sizeof(material->cullMode));
+    hash = hash_combine(hash, &material->shader, sizeof(material->shader));
+
+    return hash;
+}
+
 //static inline r3d_render_group_t* array_get_last_group(void)
 //{
 //    int groupIndex = array_get_last_group_index();
@@ -691,220 +892,1375 @@ static inline bool is_draw_call_visible(const R3D_Frustum* frustum, const r3d_re
 }
 
 // ========================================
-// INTERNAL SORTING FUNCTIONS
+// INTERNAL INSTANCE CULLING FUNCTIONS
 // ========================================
 
-static Vector3 G_sortViewPosition = {0};
-
-static inline float calculate_center_distance_to_camera(const BoundingBox* aabb, const Matrix* transform)
+static inline float instance_read_component(const void* data, R3D_InstanceFormat format, size_t index)
 {
-    Vector3 center = {
-        (aabb->min.x + aabb->max.x) * 0.5f,
-        (aabb->min.y + aabb->max.y) * 0.5f,
-        (aabb->min.z + aabb->max.z) * 0.5f
-    };
-    center = Vector3Transform(center, *transform);
+    switch (format)
+    {
+    case R3D_INSTANCE_FORMAT_FLOAT32: return ((const float*)data)[index];
+    case R3D_INSTANCE_FORMAT_FLOAT16: return r3d_half_to_float(((const r3d_half_t*)data)[index]);
+    case R3D_INSTANCE_FORMAT_UNORM16: return ((const uint16_t*)data)[index] / 65535.0f;
+    case R3D_INSTANCE_FORMAT_SNORM16: return fmaxf(((const int16_t*)data)[index] / 32767.0f, -1.0f);
+    case R3D_INSTANCE_FORMAT_UNORM8:  return ((const uint8_t*)data)[index] / 255.0f;
+    case R3D_INSTANCE_FORMAT_SNORM8:  return fmaxf(((const int8_t*)data)[index] / 127.0f, -1.0f);
+    default: break;
+    }
 
-    return Vector3DistanceSqr(G_sortViewPosition, center);
+    return 0.0f;
 }
 
-static inline float calculate_max_distance_to_camera(const BoundingBox* aabb, const Matrix* transform)
+static inline Vector3 instance_read_vec3(const void* data, R3D_InstanceFormat format, int index)
 {
-    float maxDistSq = 0.0f;
-
-    for (int i = 0; i < 8; ++i)
+    if (format == R3D_INSTANCE_FORMAT_FLOAT32)
     {
-        Vector3 corner = {
-            (i & 1) ? aabb->max.x : aabb->min.x,
-            (i & 2) ? aabb->max.y : aabb->min.y,
-            (i & 4) ? aabb->max.z : aabb->min.z
-        };
+        return ((const Vector3*)data)[index];
+    }
 
-        corner = Vector3Transform(corner, *transform);
-        float distSq = Vector3DistanceSqr(G_sortViewPosition, corner);
-        maxDistSq = (distSq > maxDistSq) ? distSq : maxDistSq;
+    size_t base = 3 * (size_t)index;
+
+    return (Vector3) {
+        instance_read_component(data, format, base + 0),
+        instance_read_component(data, format, base + 1),
+        instance_read_component(data, format, base + 2)
+    };
+}
+
+static inline Quaternion instance_read_quat(const void* data, R3D_InstanceFormat format, int index)
+{
+    if (format == R3D_INSTANCE_FORMAT_FLOAT32)
+    {
+        return ((const Quaternion*)data)[index];
     }
 
-    return maxDistSq;
+    size_t base = 4 * (size_t)index;
+
+    return (Quaternion) {
+        instance_read_component(data, format, base + 0),
+        instance_read_component(data, format, base + 1),
+        instance_read_component(data, format, base + 2),
+        instance_read_component(data, format, base + 3)
+    };
 }
 
-static inline void sort_fill_state_data(r3d_render_sort_state_t* state, const r3d_render_call_t* call)
+/*
+ * Returns the CPU copy of the group instances if the group can be culled per instance, NULL otherwise.
+ * Requires the CPU copy of the positions and known local bounds.
+ */
+static inline const r3d_render_instance_cpu_copy_t* instances_can_cull(const r3d_render_group_t* group)
 {
-    memset(state, 0, sizeof(*state));
+    if (!R3D_BIT_ANY(group->instances.layout.flags, R3D_INSTANCE_CULLING)) return NULL;
+    if (memcmp(&group->instanceAabb, &(BoundingBox){0}, sizeof(BoundingBox)) == 0) return NULL;
 
-    switch (call->type)
+    const r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_get(group->instances.buffers[0]);
+    return (cpuCopy != NULL && cpuCopy->data[0] != NULL) ? cpuCopy : NULL;
+}
+
+/*
+ * Returns the first slot of the instance stream that is free in every attribute of the layout,
+ * and reserves room for 'count' instances from there in each staging. 'streamUsed' holds the bytes
+ * already written in each staging, the size of one instance is returned per attribute in 'attrSize'
+ * (0 for the attributes missing from the layout).
+ */
+static int instances_stream_reserve(const R3D_InstanceLayout* layout, const size_t streamUsed[R3D_INSTANCE_ATTRIBUTE_COUNT],
+                                    int count, size_t attrSize[R3D_INSTANCE_ATTRIBUTE_COUNT])
+{
+    int streamOffset = 0;
+
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
     {
-    case R3D_RENDER_CALL_MESH:
-        state->priority     = call->mesh.material.priority;
-        state->shader       = (uintptr_t)call->mesh.material.shader;
-        state->shading      = call->mesh.material.unlit;
-        state->albedo       = call->mesh.material.albedo.texture.id;
-        state->normal       = call->mesh.material.normal.texture.id;
-        state->orm          = call->mesh.material.orm.texture.id;
-        state->emission     = call->mesh.material.emission.texture.id;
-        state->stencil      = r3d_hash_fnv1a_32(&call->mesh.material.stencil, sizeof(call->mesh.material.stencil));
-        state->depth        = r3d_hash_fnv1a_32(&call->mesh.material.depth, sizeof(call->mesh.material.depth));
-        state->blend        = call->mesh.material.blendMode;
-        state->cull         = call->mesh.material.cullMode;
-        state->transparency = call->mesh.material.transparencyMode;
-        state->billboard    = call->mesh.material.billboardMode;
-        break;
+        attrSize[i] = 0;
+        if (!R3D_BIT_ANY(layout->flags, 1u << i)) continue;
+        attrSize[i] = INSTANCE_ATTRIBUTE_COMPONENTS[i] * INSTANCE_FORMAT_SIZE[layout->formats[i]];
+        int attrOffset = (int)((streamUsed[i] + attrSize[i] - 1) / attrSize[i]);
+        streamOffset = R3D_MAX(streamOffset, attrOffset);
+    }
 
-    case R3D_RENDER_CALL_DECAL:
-        state->shader   = (uintptr_t)call->decal.instance.shader;
-        state->albedo   = call->decal.instance.albedo.texture.id;
-        state->normal   = call->decal.instance.normal.texture.id;
-        state->orm      = call->decal.instance.orm.texture.id;
-        state->emission = call->decal.instance.emission.texture.id;
-        break;
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        if (attrSize[i] == 0) continue;
+        R3D_LIST_RESERVE(R3D_MOD_RENDER.instanceStaging[i], (streamOffset + count) * attrSize[i]);
     }
+
+    return streamOffset;
 }
 
-static void sort_fill_cache_front_to_back(r3d_render_list_enum_t list)
+/*
+ * Tests each instance of the group against the frustums and appends the instances
+ * inside any of them to the CPU staging of the instance stream. 'streamUsed' holds the bytes
+ * already written in each staging, the first written instance is returned in 'outOffset'.
+ * Returns the number of visible instances.
+ *
+ * Instances are bounded by a sphere: the group transform is applied first, then the
+ * instance scale, rotation and position, matching the order used in 'scene.vert'.
+ */
+static int instances_cull(const R3D_Frustum* frustums, int frustumCount, const r3d_render_group_t* group,
+                          const r3d_render_instance_cpu_copy_t* cpuCopy, size_t streamUsed[R3D_INSTANCE_ATTRIBUTE_COUNT], int* outOffset)
 {
-    R3D_ASSERT(list < R3D_RENDER_LIST_OPAQUE_INST && "Instantiated render lists should not be sorted by distance");
-    R3D_ASSERT(list != R3D_RENDER_LIST_DECAL && "Decal render list should not be sorted by distance");
+    const R3D_InstanceLayout* layout = &group->instances.layout;
 
-    r3d_list_t* drawList = R3D_MOD_RENDER.list[list];
-    size_t count = R3D_LIST_LENGTH(drawList);
+    /* --- Compute the local sphere of an instance, with the group transform applied --- */
 
-    for (size_t i = 0; i < count; i++)
+    BoundingBox aabb = group->instanceAabb;
+    const Matrix* transform = &group->transform;
+
+    Vector3 localCenter = r3d_vector3_transform(Vector3Scale(Vector3Add(aabb.min, aabb.max), 0.5f), transform);
+    Vector3 halfExtent = Vector3Scale(Vector3Subtract(aabb.max, aabb.min), 0.5f);
+
+    float axisScale = sqrtf(R3D_MAX(R3D_MAX(
+        transform->m0 * transform->m0 + transform->m1 * transform->m1 + transform->m2 * transform->m2,
+        transform->m4 * transform->m4 + transform->m5 * transform->m5 + transform->m6 * transform->m6),
+        transform->m8 * transform->m8 + transform->m9 * transform->m9 + transform->m10 * transform->m10));
+
+    float localRadius = Vector3Length(halfExtent) * axisScale;
+
+    /* --- Find the first stream slot usable by all attributes --- */
+
+    size_t attrSize[R3D_INSTANCE_ATTRIBUTE_COUNT];
+    int streamOffset = instances_stream_reserve(layout, streamUsed, group->instanceCount, attrSize);
+
+    /* --- Test each instance and compact the visible ones --- */
+
+    const void* positions = cpuCopy->data[0];
+    const void* rotations = R3D_BIT_ANY(layout->flags, R3D_INSTANCE_ROTATION) ? cpuCopy->data[1] : NULL;
+    const void* scales = R3D_BIT_ANY(layout->flags, R3D_INSTANCE_SCALE) ? cpuCopy->data[2] : NULL;
+
+    int visibleCount = 0;
+
+    for (int iInstance = group->instanceOffset; iInstance < group->instanceOffset + group->instanceCount; iInstance++)
     {
-        int callIndex = R3D_LIST_GET(drawList, int, i);
-        const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndex);
-        const r3d_render_group_t* group = r3d_render_get_call_group(call);
-        r3d_render_sort_t* sortData = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, callIndex);
+        Vector3 center = localCenter;
+        float radius = localRadius;
 
-        sortData->distance = calculate_center_distance_to_camera(
-            &call->mesh.instance.aabb, &group->transform
-        );
+        if (scales != NULL)
+        {
+            Vector3 scale = instance_read_vec3(scales, layout->formats[2], iInstance);
+            center = Vector3Multiply(center, scale);
+            radius *= R3D_MAX(R3D_MAX(fabsf(scale.x), fabsf(scale.y)), fabsf(scale.z));
+        }
+
+        if (rotations != NULL)
+        {
+            Quaternion rotation = instance_read_quat(rotations, layout->formats[1], iInstance);
+            center = Vector3RotateByQuaternion(center, rotation);
+        }
+
+        center = Vector3Add(center, instance_read_vec3(positions, layout->formats[0], iInstance));
+
+        bool inside = false;
+        for (int i = 0; i < frustumCount && !inside; i++)
+        {
+            inside = R3D_FrustumIntersectsSphere(&frustums[i], center, radius);
+        }
 
-        sort_fill_state_data(&sortData->state, call);
+        if (!inside) continue;
+
+        for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+        {
+            if (attrSize[i] == 0) continue;
+            uint8_t* dst = (uint8_t*)R3D_MOD_RENDER.instanceStaging[i]->elements + (streamOffset + visibleCount) * attrSize[i];
+            const uint8_t* src = cpuCopy->data[i] + (size_t)iInstance * attrSize[i];
+            memcpy(dst, src, attrSize[i]);
+        }
+
+        visibleCount++;
     }
-}
 
-static void sort_fill_cache_back_to_front(r3d_render_list_enum_t list)
-{
-    R3D_ASSERT(list < R3D_RENDER_LIST_OPAQUE_INST && "Instantiated render lists should not be sorted by distance");
-    R3D_ASSERT(list != R3D_RENDER_LIST_DECAL && "Decal render list should not be sorted by distance");
+    /* --- Commit the written range --- */
 
-    r3d_list_t* drawList = R3D_MOD_RENDER.list[list];
-    size_t count = R3D_LIST_LENGTH(drawList);
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        if (attrSize[i] == 0) continue;
+        streamUsed[i] = (streamOffset + visibleCount) * attrSize[i];
+        R3D_MOD_RENDER.instanceStaging[i]->elemCount = streamUsed[i];
+    }
 
-    for (size_t i = 0; i < count; i++)
+    *outOffset = streamOffset;
+
+    return visibleCount;
+}
+
+/*
+ * Uploads the CPU staging of the instance stream to the GPU.
+ * Buffers are orphaned to avoid stalling on draws from the previous pass.
+ */
+static void instances_upload_stream(void)
+{
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
     {
-        int callIndex = R3D_LIST_GET(drawList, int, i);
-        const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndex);
-        const r3d_render_group_t* group = r3d_render_get_call_group(call);
-        r3d_render_sort_t* sortData = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, callIndex);
+        size_t size = R3D_LIST_LENGTH(R3D_MOD_RENDER.instanceStaging[i]);
+        if (size == 0) continue;
 
-        sortData->distance = calculate_max_distance_to_camera(
-            &call->mesh.instance.aabb, &group->transform
-        );
+        if (R3D_MOD_RENDER.instanceStream[i] == 0)
+        {
+            glGenBuffers(1, &R3D_MOD_RENDER.instanceStream[i]);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, R3D_MOD_RENDER.instanceStream[i]);
 
-        // For back-to-front sorting we just need the priority for the meshes
-        memset(&sortData->state, 0, sizeof(sortData->state));
-        if (call->type == R3D_RENDER_CALL_MESH)
+        if (size > R3D_MOD_RENDER.instanceStreamSize[i])
         {
-            sortData->state.priority = call->mesh.material.priority;
+            size_t newSize = R3D_MAX(R3D_MOD_RENDER.instanceStreamSize[i], 1024);
+            while (newSize < size) newSize *= 2;
+            R3D_MOD_RENDER.instanceStreamSize[i] = newSize;
         }
+
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)R3D_MOD_RENDER.instanceStreamSize[i], NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)size, R3D_MOD_RENDER.instanceStaging[i]->elements);
     }
 }
 
-static void sort_fill_cache_by_material(r3d_render_list_enum_t list)
+// ========================================
+// INTERNAL PARALLEL CULLING FUNCTIONS
+// ========================================
+
+/* Number of groups tested by a single culling task, kept a multiple
+ * of 64 so that each task owns whole words of the visibility bitsets */
+#define CULL_GROUPS_PER_TASK 512
+
+/* Unit of work of a culling batch, a range of groups for one view or one whole cube map.
+ * The group range is only used by the linear path, tree traversals cover every group. */
+typedef struct {
+    Vector3 cubeCenter;
+    float cubeRange;
+    int view;
+    int first;
+    int last;
+    bool cube;
+} cull_task_t;
+
+typedef struct {
+    const R3D_Frustum* frustums;
+    const cull_task_t* tasks;
+    const r3d_render_group_visibility_t* groupVisibility;
+    const r3d_render_group_t* groups;
+    R3D_BoxArray clusterBoxes;
+    R3D_BoxArray groupBoxes;
+    R3D_BoxArray bvhBoxes;
+    const r3d_render_bvh_node_t* bvhNodes;
+    const int* bvhOrder;
+    const int* bvhUnbounded;
+    int bvhNodeCount;
+    int bvhUnboundedCount;
+    uint64_t* clusterBits;
+    uint64_t* groupBits;
+    int clusterWords;
+    int groupWords;
+    int clusterCount;
+    int groupCount;
+} cull_batch_t;
+
+typedef struct {
+    const r3d_occlusion_t* occlusion;
+    const r3d_render_group_t* groups;
+    r3d_render_group_visibility_t* groupVisibility;
+    R3D_BoxArray groupBoxes;
+    int groupCount;
+} cull_occlusion_batch_t;
+
+static inline bool cull_bit_test(const uint64_t* bits, int index)
 {
-    r3d_list_t* drawList = R3D_MOD_RENDER.list[list];
-    size_t count = R3D_LIST_LENGTH(drawList);
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
 
-    for (size_t i = 0; i < count; i++)
+static inline int cull_lsb64(uint64_t value)
+{
+    uint32_t low = (uint32_t)value;
+    return (low != 0) ? r3d_lsb_index(low) : 32 + r3d_lsb_index((uint32_t)(value >> 32));
+}
+
+/* Faces of a cube map overlapped by a box, bit N for face N in +X, -X, +Y, -Y, +Z, -Z order.
+ * Zero when the box lies outside the range sphere. A face is bounded by the four diagonal
+ * planes through the center, so each pair of axes is classified with sums and differences. */
+static inline uint8_t cull_cube_face_mask(Vector3 center, float range, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+    static const int PAIRS[3][2] = { {0, 1}, {0, 2}, {1, 2} };
+
+    float d[3] = { cx - center.x, cy - center.y, cz - center.z };
+    float e[3] = { ex, ey, ez };
+
+    float distSq = 0.0f;
+    for (int i = 0; i < 3; i++)
     {
-        int callIndex = R3D_LIST_GET(drawList, int, i);
-        const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndex);
-        r3d_render_sort_t* sortData = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, callIndex);
+        float q = fabsf(d[i]) - e[i];
+        if (q > 0.0f) distSq += q * q;
+    }
 
-        sortData->distance = 0.0f;
-        sort_fill_state_data(&sortData->state, call);
+    if (distSq > range * range) return 0;
+
+    uint8_t mask = 0x3F;
+
+    for (int p = 0; p < 3; p++)
+    {
+        int i = PAIRS[p][0], j = PAIRS[p][1];
+        float sum = d[i] + d[j];
+        float diff = d[i] - d[j];
+        float ext = e[i] + e[j] + EPSILON;
+
+        if (diff < -ext || sum < -ext) mask &= ~(1 << (2 * i));
+        if (diff > ext || sum > ext) mask &= ~(1 << (2 * i + 1));
+        if (diff > ext || sum < -ext) mask &= ~(1 << (2 * j));
+        if (diff < -ext || sum > ext) mask &= ~(1 << (2 * j + 1));
     }
+
+    return mask;
 }
 
-static inline int compare_i32(int32_t a, int32_t b)
+static inline bool cull_views_form_cube(const r3d_render_cull_view_t* views, int index, int count)
 {
-    return (a > b) - (a < b);
+    if (views[index].cubeFace != 0 || index + 6 > count) return false;
+
+    for (int f = 1; f < 6; f++)
+    {
+        const r3d_render_cull_view_t* face = &views[index + f];
+        if (face->cubeFace != f || face->cubeRange != views[index].cubeRange) return false;
+        if (!Vector3Equals(face->cubeCenter, views[index].cubeCenter)) return false;
+    }
+
+    return true;
 }
 
-static inline int compare_f32(float a, float b)
+static inline bool cull_obb_is_axis_aligned(const R3D_OrientedBox* obb)
 {
-    return (a > b) - (a < b);
+    return obb->axisX.y == 0.0f && obb->axisX.z == 0.0f
+        && obb->axisY.x == 0.0f && obb->axisY.z == 0.0f
+        && obb->axisZ.x == 0.0f && obb->axisZ.y == 0.0f;
 }
 
-static inline int compare_material(const r3d_render_sort_t* a, const r3d_render_sort_t* b)
+static void cull_bounds_push(r3d_list_t* bounds[6], Vector3 center, Vector3 extents)
 {
-    // User priority first (signed)
-    if (a->state.priority != b->state.priority)
+    const float values[6] = {
+        center.x, center.y, center.z,
+        extents.x, extents.y, extents.z
+    };
+
+    for (int i = 0; i < 6; i++)
     {
-        return compare_i32(a->state.priority, b->state.priority);
+        R3D_LIST_PUSH(bounds[i], values[i]);
     }
-
-    // Remaining fields via memcmp (must be all unsigned, zero-padded)
-    size_t n = sizeof(a->state) - offsetof(r3d_render_sort_state_t, shader);
-    return memcmp(&a->state.shader, &b->state.shader, n);
 }
 
-static int compare_front_to_back(const void* a, const void* b)
+static void cull_bounds_push_aabb(r3d_list_t* bounds[6], BoundingBox aabb)
 {
-    const r3d_render_sort_t* aEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(a));
-    const r3d_render_sort_t* bEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(b));
+    // Empty boxes are always visible, infinite extents keep them inside every plane
+    if (memcmp(&aabb, &(BoundingBox){0}, sizeof(BoundingBox)) == 0)
+    {
+        cull_bounds_push(bounds, (Vector3) {0}, (Vector3) {FLT_MAX, FLT_MAX, FLT_MAX});
+        return;
+    }
 
-    int cmp = compare_material(aEntry, bEntry);
-    if (cmp != 0) return cmp;
+    Vector3 center = Vector3Scale(Vector3Add(aabb.min, aabb.max), 0.5f);
+    Vector3 extents = Vector3Scale(Vector3Subtract(aabb.max, aabb.min), 0.5f);
 
-    return compare_f32(aEntry->distance, bEntry->distance);
+    cull_bounds_push(bounds, center, extents);
 }
 
-static int compare_back_to_front(const void* a, const void* b)
+static void cull_bounds_push_obb(r3d_list_t* bounds[6], R3D_OrientedBox obb)
 {
-    const r3d_render_sort_t* aEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(a));
-    const r3d_render_sort_t* bEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(b));
+    if (memcmp(&obb, &(R3D_OrientedBox){0}, sizeof(R3D_OrientedBox)) == 0)
+    {
+        cull_bounds_push(bounds, (Vector3) {0}, (Vector3) {FLT_MAX, FLT_MAX, FLT_MAX});
+        return;
+    }
 
-    int cmp = compare_i32(aEntry->state.priority, bEntry->state.priority);
-    if (cmp != 0) return cmp;
+    // World space extents of the box enclosing the OBB
+    Vector3 h = obb.halfExtents;
+    Vector3 extents = {
+        fabsf(obb.axisX.x) * h.x + fabsf(obb.axisY.x) * h.y + fabsf(obb.axisZ.x) * h.z,
+        fabsf(obb.axisX.y) * h.x + fabsf(obb.axisY.y) * h.y + fabsf(obb.axisZ.y) * h.z,
+        fabsf(obb.axisX.z) * h.x + fabsf(obb.axisY.z) * h.y + fabsf(obb.axisZ.z) * h.z
+    };
 
-    return compare_f32(bEntry->distance, aEntry->distance);
+    cull_bounds_push(bounds, obb.center, extents);
 }
 
-static int compare_materials_only(const void* a, const void* b)
+static inline R3D_BoxArray cull_bounds_array(r3d_list_t* const bounds[6])
 {
-    const r3d_render_sort_t* aEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(a));
-    const r3d_render_sort_t* bEntry = &R3D_LIST_GET(R3D_MOD_RENDER.sortCache, r3d_render_sort_t, *(const int*)(b));
-
-    return compare_material(aEntry, bEntry);
+    return (R3D_BoxArray) {
+        .centerX = (const float*)bounds[0]->elements,
+        .centerY = (const float*)bounds[1]->elements,
+        .centerZ = (const float*)bounds[2]->elements,
+        .extentX = (const float*)bounds[3]->elements,
+        .extentY = (const float*)bounds[4]->elements,
+        .extentZ = (const float*)bounds[5]->elements
+    };
 }
 
 // ========================================
-// MODULE FUNCTIONS
+// INTERNAL BVH FUNCTIONS
 // ========================================
 
-bool r3d_render_init(void)
-{
-    memset(&R3D_MOD_RENDER, 0, sizeof(R3D_MOD_RENDER));
+/* Max groups per leaf, leaves are tested with a single batch call */
+#define BVH_LEAF_SIZE 8
 
-    /* --- CPU array allocation (draw calls, groups, etc) --- */
+/* Below this number of groups the linear batch test wins over building the tree */
+#define BVH_MIN_GROUPS 256
 
-    int cap = R3D_HINT(R3D_HINT_DRAW_CALL_CAPACITY);
+/* Nodes at this depth become leaves whatever their size, median splits keep the depth
+ * around log2(groups / leaf size) so it is only reached with degenerate inputs */
+#define BVH_MAX_DEPTH 32
 
-    R3D_MOD_RENDER.clusters        = R3D_LIST_CREATE(r3d_render_cluster_t, cap);
-    R3D_MOD_RENDER.groupVisibility = R3D_LIST_CREATE(r3d_render_group_visibility_t, cap);
-    R3D_MOD_RENDER.callIndices     = R3D_LIST_CREATE(r3d_render_indices_t, cap);
+/* A depth first walk holds at most one pending sibling per level below the root, plus the node on top */
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH + 1)
+
+static void bvh_select(int* order, int count, int nth, const float* keys)
+{
+    // Quickselect: partially orders 'order' so that 'nth' holds the nth smallest key
+    int lo = 0, hi = count - 1;
+
+    while (lo < hi)
+    {
+        float pivot = keys[order[(lo + hi) / 2]];
+        int i = lo, j = hi;
+
+        while (i <= j)
+        {
+            while (keys[order[i]] < pivot) i++;
+            while (keys[order[j]] > pivot) j--;
+            if (i <= j)
+            {
+                R3D_SWAP(int, order[i], order[j]);
+                i++, j--;
+            }
+        }
+
+        if (nth <= j) hi = j;
+        else if (nth >= i) lo = i;
+        else break;
+    }
+}
+
+static void bvh_build_node(r3d_render_bvh_node_t* nodes, int* nodeCount, int nodeIndex, int depth,
+                           int* order, int first, int count, const R3D_BoxArray* boxes)
+{
+    Vector3 boxMin = {FLT_MAX, FLT_MAX, FLT_MAX};
+    Vector3 boxMax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    Vector3 centroidMin = boxMin;
+    Vector3 centroidMax = boxMax;
+
+    for (int i = first; i < first + count; i++)
+    {
+        int g = order[i];
+        Vector3 c = {boxes->centerX[g], boxes->centerY[g], boxes->centerZ[g]};
+        Vector3 e = {boxes->extentX[g], boxes->extentY[g], boxes->extentZ[g]};
+
+        boxMin = Vector3Min(boxMin, Vector3Subtract(c, e));
+        boxMax = Vector3Max(boxMax, Vector3Add(c, e));
+        centroidMin = Vector3Min(centroidMin, c);
+        centroidMax = Vector3Max(centroidMax, c);
+    }
+
+    r3d_render_bvh_node_t* node = &nodes[nodeIndex];
+    node->center = Vector3Scale(Vector3Add(boxMin, boxMax), 0.5f);
+    node->extents = Vector3Scale(Vector3Subtract(boxMax, boxMin), 0.5f);
+    node->first = first;
+    node->count = count;
+    node->left = -1;
+
+    if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH) return;
+
+    // Median split along the widest axis of the centroids
+    Vector3 spread = Vector3Subtract(centroidMax, centroidMin);
+    const float* keys = boxes->centerX;
+    if (spread.y > spread.x && spread.y >= spread.z) keys = boxes->centerY;
+    else if (spread.z > spread.x && spread.z > spread.y) keys = boxes->centerZ;
+
+    int half = count / 2;
+    bvh_select(order + first, count, half, keys);
+
+    int left = *nodeCount;
+    *nodeCount += 2;
+    node->left = left;
+
+    bvh_build_node(nodes, nodeCount, left, depth + 1, order, first, half, boxes);
+    bvh_build_node(nodes, nodeCount, left + 1, depth + 1, order, first + half, count - half, boxes);
+}
+
+static void bvh_build(void)
+{
+    int groupCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
+    R3D_BoxArray boxes = cull_bounds_array(R3D_MOD_RENDER.groupBounds);
+
+    /* --- Split bounded groups from the ones always tested apart --- */
+
+    R3D_LIST_CLEAR(R3D_MOD_RENDER.bvhOrder);
+    R3D_LIST_CLEAR(R3D_MOD_RENDER.bvhUnbounded);
+
+    for (int i = 0; i < groupCount; i++)
+    {
+        const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, i);
+        if (r3d_render_has_instances(group) || boxes.extentX[i] == FLT_MAX)
+        {
+            R3D_LIST_PUSH(R3D_MOD_RENDER.bvhUnbounded, i);
+        }
+        else
+        {
+            R3D_LIST_PUSH(R3D_MOD_RENDER.bvhOrder, i);
+        }
+    }
+
+    /* --- Build the tree, a binary tree has less than twice as many nodes as leaves --- */
+
+    int orderCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.bvhOrder);
+    int nodeCount = 0;
+
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.bvhNodes, R3D_MAX(2 * orderCount, 1));
+
+    if (orderCount > 0)
+    {
+        nodeCount = 1;
+        bvh_build_node(
+            R3D_MOD_RENDER.bvhNodes->elements, &nodeCount, 0, 0,
+            R3D_MOD_RENDER.bvhOrder->elements, 0, orderCount, &boxes
+        );
+    }
+
+    R3D_MOD_RENDER.bvhNodes->elemCount = nodeCount;
+
+    /* --- Gather the group boxes in leaf order for the leaf batch tests --- */
+
+    const int* order = R3D_MOD_RENDER.bvhOrder->elements;
+    const float* src[6] = {
+        boxes.centerX, boxes.centerY, boxes.centerZ,
+        boxes.extentX, boxes.extentY, boxes.extentZ
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        R3D_LIST_RESIZE(R3D_MOD_RENDER.bvhBounds[i], orderCount);
+        float* dst = R3D_MOD_RENDER.bvhBounds[i]->elements;
+        for (int j = 0; j < orderCount; j++) dst[j] = src[i][order[j]];
+    }
+
+    R3D_MOD_RENDER.bvhValid = true;
+}
+
+// ========================================
+// INTERNAL CULLING TASKS
+// ========================================
+
+static inline void cull_refine_group(const cull_batch_t* batch, const R3D_Frustum* frustum,
+                                     const uint64_t* clusterBits, uint64_t* groupBits, int groupIndex)
+{
+    const r3d_render_group_t* group = &batch->groups[groupIndex];
+    int clusterIndex = batch->groupVisibility[groupIndex].clusterIndex;
+    uint64_t bit = 1ull << (groupIndex & 63);
+    uint64_t* word = &groupBits[groupIndex >> 6];
+
+    // Groups of a culled cluster are culled, instanced groups trust their cluster
+    if (clusterIndex >= 0 && !cull_bit_test(clusterBits, clusterIndex)) *word &= ~bit;
+    else if (r3d_render_has_instances(group)) *word |= bit;
+    else if ((*word & bit) && !cull_obb_is_axis_aligned(&group->obb))
+    {
+        // The enclosing box is looser than a rotated OBB, test the OBB itself
+        if (!is_obb_visible(frustum, group->obb)) *word &= ~bit;
+    }
+}
+
+static void cull_task_clusters(void* userData, int taskIndex)
+{
+    const cull_batch_t* batch = userData;
+    const R3D_Frustum* frustum = &batch->frustums[taskIndex];
+    uint64_t* bits = batch->clusterBits + (size_t)taskIndex * batch->clusterWords;
+
+    R3D_FrustumCullBoxes(frustum, &batch->clusterBoxes, batch->clusterCount, bits);
+}
+
+static void cull_frustum_range(const cull_batch_t* batch, const cull_task_t* task)
+{
+    int first = task->first;
+    int last = task->last;
+
+    const R3D_Frustum* frustum = &batch->frustums[task->view];
+    const uint64_t* clusterBits = batch->clusterBits + (size_t)task->view * batch->clusterWords;
+    uint64_t* groupBits = batch->groupBits + (size_t)task->view * batch->groupWords;
+
+    /* --- Batch test of the enclosing boxes --- */
+
+    R3D_BoxArray boxes = {
+        .centerX = batch->groupBoxes.centerX + first,
+        .centerY = batch->groupBoxes.centerY + first,
+        .centerZ = batch->groupBoxes.centerZ + first,
+        .extentX = batch->groupBoxes.extentX + first,
+        .extentY = batch->groupBoxes.extentY + first,
+        .extentZ = batch->groupBoxes.extentZ + first
+    };
+
+    R3D_FrustumCullBoxes(frustum, &boxes, last - first, groupBits + (first >> 6));
+
+    /* --- Apply clusters and refine the survivors --- */
+
+    for (int i = first; i < last; i++)
+    {
+        cull_refine_group(batch, frustum, clusterBits, groupBits, i);
+    }
+}
+
+static void cull_cube_range(const cull_batch_t* batch, const cull_task_t* task)
+{
+    int first = task->first;
+    int last = task->last;
+
+    uint64_t* groupBits[6];
+    for (int f = 0; f < 6; f++)
+    {
+        groupBits[f] = batch->groupBits + (size_t)(task->view + f) * batch->groupWords;
+        memset(groupBits[f] + (first >> 6), 0, (size_t)((last + 63) / 64 - (first >> 6)) * sizeof(uint64_t));
+    }
+
+    /* --- Classify each box into the faces it overlaps --- */
+
+    const R3D_BoxArray* boxes = &batch->groupBoxes;
+
+    for (int i = first; i < last; i++)
+    {
+        uint8_t mask = cull_cube_face_mask(
+            task->cubeCenter, task->cubeRange,
+            boxes->centerX[i], boxes->centerY[i], boxes->centerZ[i],
+            boxes->extentX[i], boxes->extentY[i], boxes->extentZ[i]
+        );
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            int f = r3d_lsb_index(mask);
+            groupBits[f][i >> 6] |= 1ull << (i & 63);
+        }
+    }
+
+    /* --- Apply clusters and refine the survivors of each face --- */
+
+    for (int f = 0; f < 6; f++)
+    {
+        const R3D_Frustum* frustum = &batch->frustums[task->view + f];
+        const uint64_t* clusterBits = batch->clusterBits + (size_t)(task->view + f) * batch->clusterWords;
+
+        for (int i = first; i < last; i++)
+        {
+            cull_refine_group(batch, frustum, clusterBits, groupBits[f], i);
+        }
+    }
+}
+
+static void cull_frustum_bvh(const cull_batch_t* batch, const cull_task_t* task)
+{
+    const R3D_Frustum* frustum = &batch->frustums[task->view];
+    const uint64_t* clusterBits = batch->clusterBits + (size_t)task->view * batch->clusterWords;
+    uint64_t* groupBits = batch->groupBits + (size_t)task->view * batch->groupWords;
+
+    memset(groupBits, 0, batch->groupWords * sizeof(uint64_t));
+
+    /* --- Walk the tree, planes a node lies fully in front of are skipped for its subtree --- */
+
+    int stackNodes[BVH_STACK_SIZE];
+    uint8_t stackPlanes[BVH_STACK_SIZE];
+    int top = 0;
+
+    if (batch->bvhNodeCount > 0)
+    {
+        stackNodes[top] = 0;
+        stackPlanes[top] = (1 << R3D_PLANE_COUNT) - 1;
+        top++;
+    }
+
+    while (top > 0)
+    {
+        top--;
+        const r3d_render_bvh_node_t* node = &batch->bvhNodes[stackNodes[top]];
+        uint8_t planes = stackPlanes[top];
+        bool outside = false;
+
+        for (int p = 0; p < R3D_PLANE_COUNT && !outside; p++)
+        {
+            if (!(planes & (1 << p))) continue;
+
+            const Vector4* plane = &frustum->planes[p];
+            float distance = plane->x * node->center.x + plane->y * node->center.y + plane->z * node->center.z + plane->w;
+            float radius = fabsf(plane->x) * node->extents.x + fabsf(plane->y) * node->extents.y + fabsf(plane->z) * node->extents.z;
+
+            if (distance + radius < -EPSILON) outside = true;
+            else if (distance - radius >= -EPSILON) planes &= ~(1 << p);
+        }
+
+        if (outside) continue;
+
+        // Fully inside, every group of the subtree passes
+        if (planes == 0)
+        {
+            for (int i = node->first; i < node->first + node->count; i++)
+            {
+                int g = batch->bvhOrder[i];
+                groupBits[g >> 6] |= 1ull << (g & 63);
+            }
+        }
+        // Leaf crossing a plane, test its groups in batches of 64
+        else if (node->left < 0)
+        {
+            for (int first = node->first; first < node->first + node->count; first += 64)
+            {
+                R3D_BoxArray leaf = {
+                    .centerX = batch->bvhBoxes.centerX + first,
+                    .centerY = batch->bvhBoxes.centerY + first,
+                    .centerZ = batch->bvhBoxes.centerZ + first,
+                    .extentX = batch->bvhBoxes.extentX + first,
+                    .extentY = batch->bvhBoxes.extentY + first,
+                    .extentZ = batch->bvhBoxes.extentZ + first
+                };
+
+                uint64_t mask = 0;
+                R3D_FrustumCullBoxes(frustum, &leaf, R3D_MIN(node->first + node->count - first, 64), &mask);
+
+                for (; mask != 0; mask &= mask - 1)
+                {
+                    int g = batch->bvhOrder[first + cull_lsb64(mask)];
+                    groupBits[g >> 6] |= 1ull << (g & 63);
+                }
+            }
+        }
+        else
+        {
+            stackNodes[top] = node->left + 1, stackPlanes[top] = planes, top++;
+            stackNodes[top] = node->left, stackPlanes[top] = planes, top++;
+        }
+    }
+
+    /* --- Refine the candidates, then add the groups kept out of the tree --- */
+
+    for (int w = 0; w < batch->groupWords; w++)
+    {
+        for (uint64_t bits = groupBits[w]; bits != 0; bits &= bits - 1)
+        {
+            cull_refine_group(batch, frustum, clusterBits, groupBits, w * 64 + cull_lsb64(bits));
+        }
+    }
+
+    for (int i = 0; i < batch->bvhUnboundedCount; i++)
+    {
+        int g = batch->bvhUnbounded[i];
+        groupBits[g >> 6] |= 1ull << (g & 63);
+        cull_refine_group(batch, frustum, clusterBits, groupBits, g);
+    }
+}
+
+static void cull_cube_bvh(const cull_batch_t* batch, const cull_task_t* task)
+{
+    uint64_t* groupBits[6];
+    for (int f = 0; f < 6; f++)
+    {
+        groupBits[f] = batch->groupBits + (size_t)(task->view + f) * batch->groupWords;
+        memset(groupBits[f], 0, batch->groupWords * sizeof(uint64_t));
+    }
+
+    /* --- Walk the tree against the range sphere, classify the groups of the leaves reached --- */
+
+    int stackNodes[BVH_STACK_SIZE];
+    int top = 0;
+
+    if (batch->bvhNodeCount > 0)
+    {
+        stackNodes[top++] = 0;
+    }
+
+    while (top > 0)
+    {
+        const r3d_render_bvh_node_t* node = &batch->bvhNodes[stackNodes[--top]];
+
+        uint8_t nodeMask = cull_cube_face_mask(
+            task->cubeCenter, task->cubeRange,
+            node->center.x, node->center.y, node->center.z,
+            node->extents.x, node->extents.y, node->extents.z
+        );
+
+        if (nodeMask == 0) continue;
+
+        if (node->left >= 0)
+        {
+            stackNodes[top++] = node->left + 1;
+            stackNodes[top++] = node->left;
+            continue;
+        }
+
+        for (int i = node->first; i < node->first + node->count; i++)
+        {
+            uint8_t mask = cull_cube_face_mask(
+                task->cubeCenter, task->cubeRange,
+                batch->bvhBoxes.centerX[i], batch->bvhBoxes.centerY[i], batch->bvhBoxes.centerZ[i],
+                batch->bvhBoxes.extentX[i], batch->bvhBoxes.extentY[i], batch->bvhBoxes.extentZ[i]
+            );
+
+            int g = batch->bvhOrder[i];
+            for (; mask != 0; mask &= mask - 1)
+            {
+                groupBits[r3d_lsb_index(mask)][g >> 6] |= 1ull << (g & 63);
+            }
+        }
+    }
+
+    /* --- Refine the candidates of each face, then add the groups kept out of the tree --- */
+
+    for (int f = 0; f < 6; f++)
+    {
+        const R3D_Frustum* frustum = &batch->frustums[task->view + f];
+        const uint64_t* clusterBits = batch->clusterBits + (size_t)(task->view + f) * batch->clusterWords;
+
+        for (int w = 0; w < batch->groupWords; w++)
+        {
+            for (uint64_t bits = groupBits[f][w]; bits != 0; bits &= bits - 1)
+            {
+                cull_refine_group(batch, frustum, clusterBits, groupBits[f], w * 64 + cull_lsb64(bits));
+            }
+        }
+
+        for (int i = 0; i < batch->bvhUnboundedCount; i++)
+        {
+            int g = batch->bvhUnbounded[i];
+            groupBits[f][g >> 6] |= 1ull << (g & 63);
+            cull_refine_group(batch, frustum, clusterBits, groupBits[f], g);
+        }
+    }
+}
+
+static void cull_task_occlusion(void* userData, int taskIndex)
+{
+    const cull_occlusion_batch_t* batch = userData;
+
+    int first = taskIndex * CULL_GROUPS_PER_TASK;
+    int last = R3D_MIN(first + CULL_GROUPS_PER_TASK, batch->groupCount);
+
+    for (int i = first; i < last; i++)
+    {
+        r3d_render_group_visibility_t* visibility = &batch->groupVisibility[i];
+        if (visibility->visible != R3D_RENDER_VISBILITY_TRUE) continue;
+
+        // The bounds of instanced groups do not enclose their instances
+        if (r3d_render_has_instances(&batch->groups[i])) continue;
+
+        Vector3 extents = { batch->groupBoxes.extentX[i], batch->groupBoxes.extentY[i], batch->groupBoxes.extentZ[i] };
+        if (extents.x == FLT_MAX) continue;
+
+        Vector3 center = { batch->groupBoxes.centerX[i], batch->groupBoxes.centerY[i], batch->groupBoxes.centerZ[i] };
+
+        if (!r3d_occlusion_is_box_visible(batch->occlusion, center, extents))
+        {
+            visibility->visible = R3D_RENDER_VISBILITY_FALSE;
+        }
+    }
+}
+
+static void cull_task_groups(void* userData, int taskIndex)
+{
+    const cull_batch_t* batch = userData;
+    const cull_task_t* task = &batch->tasks[taskIndex];
+
+    if (task->cube) cull_cube_range(batch, task);
+    else cull_frustum_range(batch, task);
+}
+
+static void cull_task_bvh(void* userData, int taskIndex)
+{
+    const cull_batch_t* batch = userData;
+    const cull_task_t* task = &batch->tasks[taskIndex];
+
+    if (task->cube) cull_cube_bvh(batch, task);
+    else cull_frustum_bvh(batch, task);
+}
+
+/*
+ * Makes the groups visible from any of the 'count' views starting at 'index' in the last
+ * batch the current group visibility, per instance culling keeps the instances inside any of them.
+ */
+static void cull_select_views(int index, int count)
+{
+    const R3D_Frustum* frustums = &R3D_LIST_GET(R3D_MOD_RENDER.cullFrustums, R3D_Frustum, index);
+    const uint64_t* groupBits = (const uint64_t*)R3D_MOD_RENDER.cullGroupBits->elements + (size_t)index * R3D_MOD_RENDER.cullGroupWords;
+    size_t numGroups = R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
+
+    // Reset the instance stream, rewritten for each culled frustum
+    size_t streamUsed[R3D_INSTANCE_ATTRIBUTE_COUNT] = {0};
+    bool streamWritten = false;
+
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        R3D_LIST_CLEAR(R3D_MOD_RENDER.instanceStaging[i]);
+    }
+
+    // Expand the group bits, instances are culled here since they share the stream
+    for (size_t i = 0; i < numGroups; i++)
+    {
+        r3d_render_group_visibility_t* visibility = &R3D_LIST_GET(R3D_MOD_RENDER.groupVisibility, r3d_render_group_visibility_t, i);
+        const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, i);
+
+        bool visible = false;
+        for (int v = 0; v < count && !visible; v++)
+        {
+            visible = cull_bit_test(groupBits + (size_t)v * R3D_MOD_RENDER.cullGroupWords, (int)i);
+        }
+
+        visibility->visible = visible ? R3D_RENDER_VISBILITY_TRUE : R3D_RENDER_VISBILITY_FALSE;
+        visibility->streamCount = -1;
+
+        // Instanced groups with CPU data: keep only the visible instances
+        const r3d_render_instance_cpu_copy_t* cpuCopy = NULL;
+        if (visible && r3d_render_has_instances(group) && (cpuCopy = instances_can_cull(group)) != NULL)
+        {
+            visibility->streamCount = instances_cull(frustums, count, group, cpuCopy, streamUsed, &visibility->streamOffset);
+            if (visibility->streamCount == 0) visibility->visible = R3D_RENDER_VISBILITY_FALSE;
+            streamWritten = true;
+        }
+    }
+
+    if (streamWritten)
+    {
+        instances_upload_stream();
+    }
+}
+
+// ========================================
+// INTERNAL SORTING FUNCTIONS
+// ========================================
+
+/*
+ * Sort key layout, from the most significant bits:
+ *   FRONT_TO_BACK: priority (16) | shader ID (S) | state ID (T) | depth (48 - S - T, at most 32)
+ *   BACK_TO_FRONT: priority (16) | unused (16) | inverted depth (32)
+ *   MATERIAL_ONLY: priority (16) | shader ID (S) | state ID (T) | unused (48 - S - T)
+ *
+ * Shader and state IDs are dense and assigned in order of first appearance. S and T are
+ * the number of bits needed by the highest ID of the sort, so IDs never alias, and the
+ * depth keeps its most significant bits in the remaining space.
+ * Since the radix sort is stable, calls with equal keys keep their submission order.
+ */
+
+#define SORT_KEY_PRIORITY_SHIFT 48
+#define SORT_KEY_MATERIAL_BITS  48
+#define SORT_KEY_DEPTH_BITS     32
+
+static inline float calculate_center_distance_to_camera(Vector3 viewPosition, const BoundingBox* aabb, const Matrix* transform)
+{
+    Vector3 center = {
+        (aabb->min.x + aabb->max.x) * 0.5f,
+        (aabb->min.y + aabb->max.y) * 0.5f,
+        (aabb->min.z + aabb->max.z) * 0.5f
+    };
+    center = Vector3Transform(center, *transform);
+
+    return Vector3DistanceSqr(viewPosition, center);
+}
+
+static inline float calculate_max_distance_to_camera(Vector3 viewPosition, const BoundingBox* aabb, const Matrix* transform)
+{
+    float maxDistSq = 0.0f;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        Vector3 corner = {
+            (i & 1) ? aabb->max.x : aabb->min.x,
+            (i & 2) ? aabb->max.y : aabb->min.y,
+            (i & 4) ? aabb->max.z : aabb->min.z
+        };
+
+        corner = Vector3Transform(corner, *transform);
+        float distSq = Vector3DistanceSqr(viewPosition, corner);
+        maxDistSq = (distSq > maxDistSq) ? distSq : maxDistSq;
+    }
+
+    return maxDistSq;
+}
+
+static inline void sort_fill_state_data(r3d_render_sort_state_t* state, const r3d_render_call_t* call)
+{
+    memset(state, 0, sizeof(*state));
+
+    switch (call->type)
+    {
+    case R3D_RENDER_CALL_MESH:
+        state->priority     = call->mesh.material.priority;
+        state->shader       = (uintptr_t)call->mesh.material.shader;
+        state->shading      = call->mesh.material.unlit;
+        state->albedo       = call->mesh.material.albedo.texture.id;
+        state->normal       = call->mesh.material.normal.texture.id;
+        state->orm          = call->mesh.material.orm.texture.id;
+        state->emission     = call->mesh.material.emission.texture.id;
+        state->stencil      = r3d_hash_fnv1a_32(&call->mesh.material.stencil, sizeof(call->mesh.material.stencil));
+        state->depth        = r3d_hash_fnv1a_32(&call->mesh.material.depth, sizeof(call->mesh.material.depth));
+        state->blend        = call->mesh.material.blendMode;
+        state->cull         = call->mesh.material.cullMode;
+        state->transparency = call->mesh.material.transparencyMode;
+        state->billboard    = call->mesh.material.billboardMode;
+        break;
+
+    case R3D_RENDER_CALL_DECAL:
+        state->shader   = (uintptr_t)call->decal.instance.shader;
+        state->albedo   = call->decal.instance.albedo.texture.id;
+        state->normal   = call->decal.instance.normal.texture.id;
+        state->orm      = call->decal.instance.orm.texture.id;
+        state->emission = call->decal.instance.emission.texture.id;
+        break;
+    }
+}
+
+static void sort_intern_reset(size_t count)
+{
+    // Up to two entries per call (shader + state), kept at most half full
+    size_t capacity = 64;
+    while (capacity < 4 * count) capacity *= 2;
+
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.sortIntern, capacity);
+    memset(R3D_MOD_RENDER.sortIntern->elements, 0, capacity * sizeof(r3d_render_sort_intern_t));
+}
+
+static uint32_t sort_intern(uint64_t hash, uint32_t* counter)
+{
+    r3d_list_t* table = R3D_MOD_RENDER.sortIntern;
+    r3d_render_sort_intern_t* entries = table->elements;
+    size_t mask = table->elemCount - 1;
+
+    hash |= 1; // zero is reserved for empty slots
+
+    for (size_t i = (size_t)(hash ^ (hash >> 32)) & mask;; i = (i + 1) & mask)
+    {
+        if (entries[i].hash == hash) return entries[i].id;
+        if (entries[i].hash == 0)
+        {
+            entries[i].hash = hash;
+            entries[i].id = (*counter)++;
+            return entries[i].id;
+        }
+    }
+}
+
+static inline uint64_t sort_key_priority(int32_t priority)
+{
+    // The key holds 16 bits of priority, report the first out of range value
+    static bool clampReported = false;
+    if (!clampReported && (priority < INT16_MIN || priority > INT16_MAX))
+    {
+        R3D_TRACELOG(LOG_WARNING, "Material priority %d is outside [%d, %d] and will be clamped", priority, INT16_MIN, INT16_MAX);
+        clampReported = true;
+    }
+
+    // Bias the signed priority so that it orders correctly as unsigned
+    return (uint64_t)(R3D_CLAMP(priority, INT16_MIN, INT16_MAX) + 32768) << SORT_KEY_PRIORITY_SHIFT;
+}
+
+static inline int sort_id_bits(uint32_t idCount)
+{
+    // Number of bits needed to store every ID in [0, idCount)
+    int bits = 0;
+    while (bits < 32 && ((uint64_t)1 << bits) < idCount) bits++;
+    return bits;
+}
+
+/*
+ * Interns the shader and state of the call, returns (shader ID << 32 | state ID).
+ * The IDs are packed into the final key once their bit widths are known.
+ */
+static inline uint64_t sort_key_material_ids(const r3d_render_call_t* call, int32_t* priority, uint32_t* shaderCounter, uint32_t* stateCounter)
+{
+    r3d_render_sort_state_t state;
+    sort_fill_state_data(&state, call);
+    *priority = state.priority;
+
+    // The shader hash only covers the pointer while the state hash covers every field
+    // but the priority, the two can't collide in practice so they share the same table
+    uint64_t shaderHash = r3d_hash_fnv1a_64(&state.shader, sizeof(state.shader));
+    uint64_t stateHash = r3d_hash_fnv1a_64(&state.shader, sizeof(state) - offsetof(r3d_render_sort_state_t, shader));
+
+    uint64_t shaderId = sort_intern(shaderHash, shaderCounter);
+    uint64_t stateId = sort_intern(stateHash, stateCounter);
+
+    return (shaderId << 32) | stateId;
+}
+
+static inline uint32_t sort_depth_bits(float distSq)
+{
+    // Bit patterns of non-negative floats are ordered like the values they represent
+    uint32_t bits;
+    distSq = R3D_MAX(distSq, 0.0f);
+    memcpy(&bits, &distSq, sizeof(bits));
+    return bits;
+}
+
+static void sort_build_keys(r3d_render_list_enum_t list, Vector3 viewPosition, r3d_render_sort_enum_t mode)
+{
+    r3d_list_t* drawList = R3D_MOD_RENDER.visible[list];
+    size_t count = R3D_LIST_LENGTH(drawList);
+
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.sortKeys, count);
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.sortScratch, count);
+
+    r3d_render_sort_key_t* keys = R3D_MOD_RENDER.sortKeys->elements;
+    r3d_render_sort_key_t* scratch = R3D_MOD_RENDER.sortScratch->elements;
+
+    uint32_t shaderCounter = 0;
+    uint32_t stateCounter = 0;
+
+    if (mode != R3D_RENDER_SORT_BACK_TO_FRONT) sort_intern_reset(count);
+
+    /* --- Compute the priority, depth and material IDs of each call --- */
+
+    // Material modes keep the IDs in 'keys' and the priority and depth in 'scratch'
+    // until the width of the ID fields is known, the scratch is free until the radix sort
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int callIndex = R3D_LIST_GET(drawList, int, i);
+        const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndex);
+
+        int32_t priority = 0;
+        uint32_t depth = 0;
+        uint64_t key = 0;
+
+        switch (mode)
+        {
+        case R3D_RENDER_SORT_FRONT_TO_BACK:
+            {
+                R3D_ASSERT(list < R3D_RENDER_LIST_OPAQUE_INST && "Instantiated render lists should not be sorted by distance");
+                R3D_ASSERT(list != R3D_RENDER_LIST_DECAL && "Decal render list should not be sorted by distance");
+                const r3d_render_group_t* group = r3d_render_get_call_group(call);
+                float distSq = calculate_center_distance_to_camera(viewPosition, &call->mesh.instance.aabb, &group->transform);
+                key = sort_key_material_ids(call, &priority, &shaderCounter, &stateCounter);
+                depth = sort_depth_bits(distSq);
+            }
+            break;
+        case R3D_RENDER_SORT_BACK_TO_FRONT:
+            {
+                R3D_ASSERT(list < R3D_RENDER_LIST_OPAQUE_INST && "Instantiated render lists should not be sorted by distance");
+                R3D_ASSERT(list != R3D_RENDER_LIST_DECAL && "Decal render list should not be sorted by distance");
+                const r3d_render_group_t* group = r3d_render_get_call_group(call);
+                float distSq = calculate_max_distance_to_camera(viewPosition, &call->mesh.instance.aabb, &group->transform);
+                priority = (call->type == R3D_RENDER_CALL_MESH) ? call->mesh.material.priority : 0;
+                key = sort_key_priority(priority) | (uint64_t)(~sort_depth_bits(distSq));
+            }
+            break;
+        case R3D_RENDER_SORT_MATERIAL_ONLY:
+            key = sort_key_material_ids(call, &priority, &shaderCounter, &stateCounter);
+            break;
+        }
+
+        keys[i] = (r3d_render_sort_key_t) {
+            .key = key,
+            .callIndex = callIndex
+        };
+
+        scratch[i].key = sort_key_priority(priority) | depth;
+    }
+
+    if (mode == R3D_RENDER_SORT_BACK_TO_FRONT) return;
+
+    /* --- Pack the IDs with the smallest widths able to hold them --- */
+
+    int shaderBits = sort_id_bits(shaderCounter);
+    int stateBits = sort_id_bits(stateCounter);
+
+    if (shaderBits + stateBits > SORT_KEY_MATERIAL_BITS)
+    {
+        // States are distinct for distinct shaders, dropping the shader field only loses the shader grouping
+        R3D_TRACELOG(LOG_WARNING, "Too many shaders and states to sort (%u shaders, %u states), calls are no longer grouped by shader", shaderCounter, stateCounter);
+        shaderBits = 0;
+    }
+
+    int stateShift = SORT_KEY_MATERIAL_BITS - shaderBits - stateBits;
+    int depthBits = R3D_MIN(stateShift, SORT_KEY_DEPTH_BITS);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t shaderId = (shaderBits > 0) ? (keys[i].key >> 32) : 0;
+        uint64_t stateId = keys[i].key & 0xFFFFFFFFu;
+        uint64_t depth = (depthBits > 0) ? (scratch[i].key & 0xFFFFFFFFu) >> (SORT_KEY_DEPTH_BITS - depthBits) : 0;
+
+        keys[i].key = (scratch[i].key & ~(uint64_t)0xFFFFFFFFu)
+                    | (shaderId << (stateShift + stateBits))
+                    | (stateId << stateShift)
+                    | depth;
+    }
+}
+
+static void sort_radix(r3d_render_sort_key_t* keys, r3d_render_sort_key_t* scratch, size_t count)
+{
+    size_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    /* --- Build the histograms of all digits in a single pass --- */
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = keys[i].key;
+        for (int pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][(key >> (8 * pass)) & 0xFF]++;
+        }
+    }
+
+    /* --- Scatter one byte at a time, from least to most significant --- */
+
+    r3d_render_sort_key_t* src = keys;
+    r3d_render_sort_key_t* dst = scratch;
+
+    for (int pass = 0; pass < 8; pass++)
+    {
+        size_t* histogram = histograms[pass];
+        int shift = 8 * pass;
+
+        // Skip digits shared by every key, they don't change the order
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            size_t n = histogram[digit];
+            histogram[digit] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        R3D_SWAP(r3d_render_sort_key_t*, src, dst);
+    }
+
+    if (src != keys) memcpy(keys, src, count * sizeof(*keys));
+}
+
+// ========================================
+// INTERNAL BATCHING FUNCTIONS
+// ========================================
+
+/*
+ * Splits a transform into the position, rotation and uniform scale applied by the instanced path.
+ * The instanced shader rotates normals without rescaling them, so transforms with a shear,
+ * a non uniform scale or a mirror are rejected, they could not be reproduced exactly.
+ */
+static bool batch_decompose(const Matrix* transform, Vector3* position, Quaternion* rotation, float* scale)
+{
+    if (transform->m3 != 0.0f || transform->m7 != 0.0f || transform->m11 != 0.0f || transform->m15 != 1.0f)
+    {
+        return false;
+    }
+
+    Vector3 x = {transform->m0, transform->m1, transform->m2};
+    Vector3 y = {transform->m4, transform->m5, transform->m6};
+    Vector3 z = {transform->m8, transform->m9, transform->m10};
+
+    float sx = Vector3Length(x);
+    if (sx < 1e-6f) return false;
+
+    float tolerance = BATCH_TRANSFORM_EPSILON * sx;
+    if (fabsf(Vector3Length(y) - sx) > tolerance) return false;
+    if (fabsf(Vector3Length(z) - sx) > tolerance) return false;
+
+    tolerance *= sx;
+    if (fabsf(Vector3DotProduct(x, y)) > tolerance) return false;
+    if (fabsf(Vector3DotProduct(y, z)) > tolerance) return false;
+    if (fabsf(Vector3DotProduct(z, x)) > tolerance) return false;
+    if (Vector3DotProduct(Vector3CrossProduct(x, y), z) <= 0.0f) return false;
+
+    float invScale = 1.0f / sx;
+
+    Matrix basis = R3D_MATRIX_IDENTITY;
+    basis.m0 = x.x * invScale; basis.m1 = x.y * invScale; basis.m2 = x.z * invScale;
+    basis.m4 = y.x * invScale; basis.m5 = y.y * invScale; basis.m6 = y.z * invScale;
+    basis.m8 = z.x * invScale; basis.m9 = z.y * invScale; basis.m10 = z.z * invScale;
+
+    *position = (Vector3) {transform->m12, transform->m13, transform->m14};
+    *rotation = QuaternionFromMatrix(basis);
+    *scale = sx;
+
+    return true;
+}
+
+/*
+ * Returns true if the call can be drawn as an instance of a batch.
+ * Instanced and skinned groups already have their own path, billboards are left alone.
+ * Hybrid calls are refused: they sit in both the opaque and blend lists while batches
+ * are stored per call, so a batch built for one list would also be drawn by the other.
+ */
+static inline bool batch_is_mergeable(const r3d_render_call_t* call, const r3d_render_group_t* group)
+{
+    Vector3 position;
+    Quaternion rotation;
+    float scale;
+
+    return call->type == R3D_RENDER_CALL_MESH
+        && call->mesh.material.billboardMode == R3D_BILLBOARD_DISABLED
+        && call->mesh.material.transparencyMode != R3D_TRANSPARENCY_HYBRID
+        && !r3d_render_has_instances(group)
+        && group->skinTexture == 0
+        && batch_decompose(&group->transform, &position, &rotation, &scale);
+}
+
+/*
+ * Returns true if the two mesh calls issue the same draw with the same material.
+ */
+static inline bool batch_is_same_draw(const r3d_render_call_t* a, const r3d_render_call_t* b)
+{
+    const R3D_Mesh* meshA = &a->mesh.instance;
+    const R3D_Mesh* meshB = &b->mesh.instance;
+
+    return meshA->vertexOffset == meshB->vertexOffset
+        && meshA->vertexCount == meshB->vertexCount
+        && meshA->indexOffset == meshB->indexOffset
+        && meshA->indexCount == meshB->indexCount
+        && meshA->primitiveType == meshB->primitiveType
+        && memcmp(&a->mesh.material, &b->mesh.material, sizeof(R3D_Material)) == 0;
+}
+
+// ========================================
+// MODULE FUNCTIONS
+// ========================================
+
+bool r3d_render_init(void)
+{
+    memset(&R3D_MOD_RENDER, 0, sizeof(R3D_MOD_RENDER));
+    R3D_MOD_RENDER.cullCubeIndex = -1;
+
+    /* --- CPU array allocation (draw calls, groups, etc) --- */
+
+    int cap = R3D_HINT(R3D_HINT_DRAW_CALL_CAPACITY);
+
+    R3D_MOD_RENDER.clusters        = R3D_LIST_CREATE(r3d_render_cluster_t, cap);
+    R3D_MOD_RENDER.groupVisibility = R3D_LIST_CREATE(r3d_render_group_visibility_t, cap);
+    R3D_MOD_RENDER.callIndices     = R3D_LIST_CREATE(r3d_render_indices_t, cap);
     R3D_MOD_RENDER.groups          = R3D_LIST_CREATE(r3d_render_group_t, cap);
 
     for (int i = 0; i < R3D_RENDER_LIST_COUNT; i++)
     {
         R3D_MOD_RENDER.list[i] = R3D_LIST_CREATE(int, cap);
+        R3D_MOD_RENDER.visible[i] = R3D_LIST_CREATE(int, cap);
     }
 
     R3D_MOD_RENDER.calls        = R3D_LIST_CREATE(r3d_render_call_t, cap);
+    R3D_MOD_RENDER.callBatches  = R3D_LIST_CREATE(r3d_render_batch_t, cap);
     R3D_MOD_RENDER.groupIndices = R3D_LIST_CREATE(int, cap);
-    R3D_MOD_RENDER.sortCache    = R3D_LIST_CREATE(r3d_render_sort_t, cap);
+    R3D_MOD_RENDER.sortKeys     = R3D_LIST_CREATE(r3d_render_sort_key_t, cap);
+    R3D_MOD_RENDER.sortScratch  = R3D_LIST_CREATE(r3d_render_sort_key_t, cap);
+    R3D_MOD_RENDER.sortIntern   = R3D_LIST_CREATE(r3d_render_sort_intern_t, 64);
+
+    R3D_MOD_RENDER.occluders       = R3D_LIST_CREATE(Vector3, 64);
+    R3D_MOD_RENDER.cullFrustums    = R3D_LIST_CREATE(R3D_Frustum, 64);
+    R3D_MOD_RENDER.cullTasks       = R3D_LIST_CREATE(cull_task_t, 64);
+    R3D_MOD_RENDER.cullGroupBits   = R3D_LIST_CREATE(uint64_t, cap);
+    R3D_MOD_RENDER.cullClusterBits = R3D_LIST_CREATE(uint64_t, 64);
+
+    for (int i = 0; i < 6; i++)
+    {
+        R3D_MOD_RENDER.groupBounds[i]   = R3D_LIST_CREATE(float, cap);
+        R3D_MOD_RENDER.clusterBounds[i] = R3D_LIST_CREATE(float, 64);
+        R3D_MOD_RENDER.bvhBounds[i]     = R3D_LIST_CREATE(float, cap);
+    }
+
+    R3D_MOD_RENDER.bvhNodes     = R3D_LIST_CREATE(r3d_render_bvh_node_t, 2 * cap);
+    R3D_MOD_RENDER.bvhOrder     = R3D_LIST_CREATE(int, cap);
+    R3D_MOD_RENDER.bvhUnbounded = R3D_LIST_CREATE(int, 64);
+
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        R3D_MOD_RENDER.instanceStaging[i] = R3D_LIST_CREATE(uint8_t, 0);
+    }
+
+    R3D_MOD_RENDER.instanceCpuCopies = R3D_LIST_CREATE(r3d_render_instance_cpu_copy_t, 4);
 
     R3D_MOD_RENDER.activeCluster = -1;
 
@@ -938,6 +2294,25 @@ bool r3d_render_init(void)
     vao_configure(false, true);
     glBindVertexArray(0);
 
+    /* --- Creation of the position stream and its depth VAO --- */
+
+    if (R3D_HINT(R3D_HINT_MESH_POSITION_STREAM))
+    {
+        glGenVertexArrays(1, &R3D_MOD_RENDER.depthVao);
+        glBindVertexArray(R3D_MOD_RENDER.depthVao);
+
+        glGenBuffers(1, &R3D_MOD_RENDER.positionVbo);
+        glBindBuffer(GL_ARRAY_BUFFER, R3D_MOD_RENDER.positionVbo);
+        glBufferData(GL_ARRAY_BUFFER,
+            R3D_HINT(R3D_HINT_MESH_VERTEX_BUFFER_CAPACITY) * sizeof(Vector3),
+            NULL, GL_DYNAMIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, R3D_MOD_RENDER.globalEbo);
+
+        depth_vao_configure(true);
+        glBindVertexArray(0);
+    }
+
     return true;
 }
 
@@ -948,22 +2323,60 @@ void r3d_render_quit(void)
     if (R3D_MOD_RENDER.globalVao) glDeleteVertexArrays(1, &R3D_MOD_RENDER.globalVao);
     if (R3D_MOD_RENDER.globalVbo) glDeleteBuffers(1, &R3D_MOD_RENDER.globalVbo);
     if (R3D_MOD_RENDER.globalEbo) glDeleteBuffers(1, &R3D_MOD_RENDER.globalEbo);
+    if (R3D_MOD_RENDER.depthVao) glDeleteVertexArrays(1, &R3D_MOD_RENDER.depthVao);
+    if (R3D_MOD_RENDER.positionVbo) glDeleteBuffers(1, &R3D_MOD_RENDER.positionVbo);
+
+    glDeleteBuffers(R3D_INSTANCE_ATTRIBUTE_COUNT, R3D_MOD_RENDER.instanceStream);
 
     /* --- Release CPU arrays --- */
 
     for (int i = 0; i < R3D_RENDER_LIST_COUNT; i++)
     {
         R3D_LIST_DESTROY(R3D_MOD_RENDER.list[i]);
+        R3D_LIST_DESTROY(R3D_MOD_RENDER.visible[i]);
     }
 
     R3D_LIST_DESTROY(R3D_MOD_RENDER.groupVisibility);
     R3D_LIST_DESTROY(R3D_MOD_RENDER.groupIndices);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.callBatches);
     R3D_LIST_DESTROY(R3D_MOD_RENDER.callIndices);
-    R3D_LIST_DESTROY(R3D_MOD_RENDER.sortCache);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.sortScratch);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.sortIntern);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.sortKeys);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.occluders);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.cullFrustums);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.cullTasks);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.cullGroupBits);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.cullClusterBits);
+
+    for (int i = 0; i < 6; i++)
+    {
+        R3D_LIST_DESTROY(R3D_MOD_RENDER.groupBounds[i]);
+        R3D_LIST_DESTROY(R3D_MOD_RENDER.clusterBounds[i]);
+        R3D_LIST_DESTROY(R3D_MOD_RENDER.bvhBounds[i]);
+    }
+
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.bvhNodes);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.bvhOrder);
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.bvhUnbounded);
     R3D_LIST_DESTROY(R3D_MOD_RENDER.clusters);
+
+    r3d_occlusion_release(&R3D_MOD_RENDER.occlusion);
     R3D_LIST_DESTROY(R3D_MOD_RENDER.groups);
     R3D_LIST_DESTROY(R3D_MOD_RENDER.calls);
 
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        R3D_LIST_DESTROY(R3D_MOD_RENDER.instanceStaging[i]);
+    }
+
+    R3D_LIST_FOR_EACH(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, cpuCopy)
+    {
+        for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++) r3d_free(cpuCopy->data[i]);
+    }
+    R3D_LIST_DESTROY(R3D_MOD_RENDER.instanceCpuCopies);
+    r3d_free(R3D_MOD_RENDER.instanceCpuCopySlots);
+
     /* --- Realease free lists --- */
 
     R3D_LIST_DESTROY(R3D_MOD_RENDER.freeVertices);
@@ -1194,6 +2607,22 @@ void r3d_render_upload_vertices(int offset, const R3D_Vertex* verts, int count)
         count * sizeof(R3D_Vertex),
         verts
     );
+
+    if (R3D_MOD_RENDER.positionVbo == 0) return;
+
+    R3D_STACK_SCOPE(&R3D.stack, count * sizeof(Vector3))
+    {
+        Vector3* positions = r3d_stack_alloc(&R3D.stack, count * sizeof(Vector3));
+        for (int i = 0; i < count; i++) positions[i] = verts[i].position;
+
+        glBindBuffer(GL_ARRAY_BUFFER, R3D_MOD_RENDER.positionVbo);
+        glBufferSubData(
+            GL_ARRAY_BUFFER,
+            offset * sizeof(Vector3),
+            count * sizeof(Vector3),
+            positions
+        );
+    }
 }
 
 void r3d_render_upload_elements(int offset, const GLuint* indices, int count)
@@ -1211,11 +2640,86 @@ void r3d_render_upload_elements(int offset, const GLuint* indices, int count)
     );
 }
 
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_add(GLuint key)
+{
+    R3D_ASSERT(key != 0 && r3d_render_instance_cpu_copy_get(key) == NULL);
+
+    r3d_render_instance_cpu_copy_t cpuCopy = {.key = key};
+    R3D_LIST_PUSH(R3D_MOD_RENDER.instanceCpuCopies, cpuCopy);
+
+    int index = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.instanceCpuCopies) - 1;
+
+    // Keep the table at most half full, growing rebuilds it with the new entry
+    if (2 * (index + 1) > R3D_MOD_RENDER.instanceCpuCopySlotCount)
+    {
+        cpu_copy_slots_rebuild(R3D_MAX(16, 2 * R3D_MOD_RENDER.instanceCpuCopySlotCount));
+    }
+    else
+    {
+        R3D_MOD_RENDER.instanceCpuCopySlots[cpu_copy_slot_find(key)] = index;
+    }
+
+    return &R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, index);
+}
+
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_get(GLuint key)
+{
+    if (key == 0 || R3D_MOD_RENDER.instanceCpuCopySlotCount == 0) return NULL;
+
+    int index = R3D_MOD_RENDER.instanceCpuCopySlots[cpu_copy_slot_find(key)];
+    if (index < 0) return NULL;
+
+    return &R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, index);
+}
+
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_rekey(GLuint oldKey, GLuint newKey)
+{
+    if (r3d_render_instance_cpu_copy_get(oldKey) == NULL) return NULL;
+    R3D_ASSERT(newKey != 0 && r3d_render_instance_cpu_copy_get(newKey) == NULL);
+
+    int slot = cpu_copy_slot_find(oldKey);
+    int index = R3D_MOD_RENDER.instanceCpuCopySlots[slot];
+    cpu_copy_slot_erase(slot);
+
+    r3d_render_instance_cpu_copy_t* cpuCopy = &R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, index);
+    cpuCopy->key = newKey;
+
+    R3D_MOD_RENDER.instanceCpuCopySlots[cpu_copy_slot_find(newKey)] = index;
+
+    return cpuCopy;
+}
+
+void r3d_render_instance_cpu_copy_remove(GLuint key)
+{
+    r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_get(key);
+    if (cpuCopy == NULL) return;
+
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        r3d_free(cpuCopy->data[i]);
+    }
+
+    int index = (int)R3D_LIST_GET_INDEX(R3D_MOD_RENDER.instanceCpuCopies, cpuCopy);
+    int last = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.instanceCpuCopies) - 1;
+
+    cpu_copy_slot_erase(cpu_copy_slot_find(key));
+
+    // The last entry takes the removed place in the list, point its slot there
+    if (index != last)
+    {
+        GLuint lastKey = R3D_LIST_GET(R3D_MOD_RENDER.instanceCpuCopies, r3d_render_instance_cpu_copy_t, last).key;
+        R3D_MOD_RENDER.instanceCpuCopySlots[cpu_copy_slot_find(lastKey)] = index;
+    }
+
+    R3D_LIST_UNORDERED_REMOVE(R3D_MOD_RENDER.instanceCpuCopies, index);
+}
+
 void r3d_render_clear(void)
 {
     for (int i = 0; i < R3D_RENDER_LIST_COUNT; i++)
     {
         R3D_LIST_CLEAR(R3D_MOD_RENDER.list[i]);
+        R3D_LIST_CLEAR(R3D_MOD_RENDER.visible[i]);
     }
 
     R3D_LIST_CLEAR(R3D_MOD_RENDER.clusters);
@@ -1223,10 +2727,17 @@ void r3d_render_clear(void)
     R3D_LIST_CLEAR(R3D_MOD_RENDER.callIndices);
     R3D_LIST_CLEAR(R3D_MOD_RENDER.groups);
     R3D_LIST_CLEAR(R3D_MOD_RENDER.calls);
+    R3D_LIST_CLEAR(R3D_MOD_RENDER.callBatches);
     R3D_LIST_CLEAR(R3D_MOD_RENDER.groupIndices);
-    R3D_LIST_CLEAR(R3D_MOD_RENDER.sortCache);
+    R3D_LIST_CLEAR(R3D_MOD_RENDER.occluders);
+
+    for (int i = 0; i < 6; i++)
+    {
+        R3D_LIST_CLEAR(R3D_MOD_RENDER.groupBounds[i]);
+        R3D_LIST_CLEAR(R3D_MOD_RENDER.clusterBounds[i]);
+    }
 
-    R3D_MOD_RENDER.groupCulled = false;
+    R3D_MOD_RENDER.bvhValid = false;
 }
 
 bool r3d_render_cluster_begin(BoundingBox aabb)
@@ -1237,12 +2748,12 @@ bool r3d_render_cluster_begin(BoundingBox aabb)
     }
 
     r3d_render_cluster_t cluster = {
-        .aabb = aabb,
-        .visible = R3D_RENDER_VISBILITY_UNKNOWN
+        .aabb = aabb
     };
 
     R3D_MOD_RENDER.activeCluster = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.clusters);
     R3D_LIST_PUSH(R3D_MOD_RENDER.clusters, cluster);
+    cull_bounds_push_aabb(R3D_MOD_RENDER.clusterBounds, aabb);
 
     return true;
 }
@@ -1254,18 +2765,70 @@ bool r3d_render_cluster_end(void)
     return true;
 }
 
+bool r3d_render_static_shadows_begin(void)
+{
+    if (R3D_MOD_RENDER.staticShadows) return false;
+    R3D_MOD_RENDER.staticShadows = true;
+    return true;
+}
+
+bool r3d_render_static_shadows_end(void)
+{
+    if (!R3D_MOD_RENDER.staticShadows) return false;
+    R3D_MOD_RENDER.staticShadows = false;
+    return true;
+}
+
+uint64_t r3d_render_static_shadows_hash(void)
+{
+    uint64_t hash = 0;
+
+    int groupCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
+    for (int groupIndex = 0; groupIndex < groupCount; groupIndex++)
+    {
+        const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, groupIndex);
+        if (!group->staticShadow) continue;
+
+        hash = hash_combine(hash, &group->transform, sizeof(group->transform));
+        hash = hash_combine(hash, group->instances.buffers, sizeof(group->instances.buffers));
+        hash = hash_combine(hash, &group->instanceOffset, sizeof(group->instanceOffset));
+        hash = hash_combine(hash, &group->instanceCount, sizeof(group->instanceCount));
+
+        const r3d_render_indices_t* indices = &R3D_LIST_GET(R3D_MOD_RENDER.callIndices, r3d_render_indices_t, groupIndex);
+        for (int i = 0; i < indices->numCall; i++)
+        {
+            const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, indices->firstCall + i);
+            if (call->type == R3D_RENDER_CALL_DECAL) continue;
+
+            hash = hash_static_caster(hash, &call->mesh.instance, &call->mesh.material);
+        }
+
+        hash |= 1; // zero is reserved for no static casters
+    }
+
+    return hash;
+}
+
 void r3d_render_group_push(const r3d_render_group_t* group)
 {
     r3d_render_group_visibility_t visibility = {
         .clusterIndex = R3D_MOD_RENDER.activeCluster,
-        .visible = R3D_RENDER_VISBILITY_UNKNOWN
+        .visible = R3D_RENDER_VISBILITY_UNKNOWN,
+        .streamOffset = 0,
+        .streamCount = -1
     };
 
     r3d_render_indices_t indices = {0};
 
+    r3d_render_group_t entry = *group;
+    entry.staticShadow = R3D_MOD_RENDER.staticShadows;
+
     R3D_LIST_PUSH(R3D_MOD_RENDER.groupVisibility, visibility);
     R3D_LIST_PUSH(R3D_MOD_RENDER.callIndices, indices);
-    R3D_LIST_PUSH(R3D_MOD_RENDER.groups, *group);
+    R3D_LIST_PUSH(R3D_MOD_RENDER.groups, entry);
+    cull_bounds_push_obb(R3D_MOD_RENDER.groupBounds, group->obb);
+
+    R3D_MOD_RENDER.bvhValid = false;
 }
 
 void r3d_render_call_push(const r3d_render_call_t* call)
@@ -1311,9 +2874,6 @@ void r3d_render_call_push(const r3d_render_call_t* call)
             break;
         }
     }
-
-    // Reserve a matching slot in the sort cache (filled in later by r3d_render_sort_list)
-    R3D_LIST_PUSH(R3D_MOD_RENDER.sortCache, (r3d_render_sort_t) {0});
 }
 
 r3d_render_group_t* r3d_render_get_call_group(const r3d_render_call_t* call)
@@ -1327,62 +2887,195 @@ r3d_render_group_t* r3d_render_get_call_group(const r3d_render_call_t* call)
 
 void r3d_render_cull_groups(const R3D_Frustum* frustum)
 {
-    size_t numGroups = R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
-    size_t numClusters = R3D_LIST_LENGTH(R3D_MOD_RENDER.clusters);
+    r3d_render_cull_view_t view = {
+        .frustum = frustum,
+        .cubeFace = -1
+    };
 
-    // Reset visibility states if groups were already culled in a previous pass
-    if (R3D_MOD_RENDER.groupCulled)
+    r3d_render_cull_groups_batch(&view, 1);
+    r3d_render_cull_groups_select(0);
+}
+
+void r3d_render_cull_groups_batch(const r3d_render_cull_view_t* views, int count)
+{
+    int groupCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
+    int clusterCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.clusters);
+
+    /* --- Copy the frustums and size the visibility bitsets --- */
+
+    R3D_LIST_CLEAR(R3D_MOD_RENDER.cullFrustums);
+    for (int i = 0; i < count; i++)
     {
-        for (size_t i = 0; i < numGroups; i++)
-        {
-            R3D_LIST_GET(R3D_MOD_RENDER.groupVisibility, r3d_render_group_visibility_t, i).visible = R3D_RENDER_VISBILITY_UNKNOWN;
-        }
-        for (size_t i = 0; i < numClusters; i++)
+        R3D_LIST_PUSH(R3D_MOD_RENDER.cullFrustums, *views[i].frustum);
+    }
+
+    int groupWords = (groupCount + 63) / 64;
+    int clusterWords = (clusterCount + 63) / 64;
+
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.cullGroupBits, (size_t)count * groupWords);
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.cullClusterBits, (size_t)count * clusterWords);
+
+    R3D_MOD_RENDER.cullGroupWords = groupWords;
+
+    if (count == 0 || groupCount == 0) return;
+
+    // The tree is built once per frame, on the first batch that needs it
+    bool useBvh = (groupCount >= BVH_MIN_GROUPS);
+    if (useBvh && !R3D_MOD_RENDER.bvhValid) bvh_build();
+
+    /* --- Split the views into tasks, a complete cube map is culled by a single task --- */
+
+    int chunkCount = useBvh ? 1 : (groupCount + CULL_GROUPS_PER_TASK - 1) / CULL_GROUPS_PER_TASK;
+
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.cullTasks, (size_t)count * chunkCount);
+    cull_task_t* tasks = R3D_MOD_RENDER.cullTasks->elements;
+    int taskCount = 0;
+
+    for (int i = 0; i < count; )
+    {
+        bool cube = cull_views_form_cube(views, i, count);
+
+        for (int c = 0; c < chunkCount; c++)
         {
-            R3D_LIST_GET(R3D_MOD_RENDER.clusters, r3d_render_cluster_t, i).visible = R3D_RENDER_VISBILITY_UNKNOWN;
+            tasks[taskCount++] = (cull_task_t) {
+                .cubeCenter = views[i].cubeCenter,
+                .cubeRange = views[i].cubeRange,
+                .view = i,
+                .first = c * CULL_GROUPS_PER_TASK,
+                .last = useBvh ? groupCount : R3D_MIN((c + 1) * CULL_GROUPS_PER_TASK, groupCount),
+                .cube = cube
+            };
         }
+
+        i += cube ? 6 : 1;
     }
-    R3D_MOD_RENDER.groupCulled = true;
 
-    // Perform frustum culling for each group
-    for (size_t i = 0; i < numGroups; i++)
+    /* --- Test clusters, then groups, each task writing its own words --- */
+
+    cull_batch_t batch = {
+        .frustums = R3D_MOD_RENDER.cullFrustums->elements,
+        .tasks = tasks,
+        .groupVisibility = R3D_MOD_RENDER.groupVisibility->elements,
+        .groups = R3D_MOD_RENDER.groups->elements,
+        .clusterBoxes = cull_bounds_array(R3D_MOD_RENDER.clusterBounds),
+        .groupBoxes = cull_bounds_array(R3D_MOD_RENDER.groupBounds),
+        .clusterBits = R3D_MOD_RENDER.cullClusterBits->elements,
+        .groupBits = R3D_MOD_RENDER.cullGroupBits->elements,
+        .clusterWords = clusterWords,
+        .groupWords = groupWords,
+        .clusterCount = clusterCount,
+        .groupCount = groupCount
+    };
+
+    if (clusterCount > 0)
     {
-        r3d_render_group_visibility_t* visibility = &R3D_LIST_GET(R3D_MOD_RENDER.groupVisibility, r3d_render_group_visibility_t, i);
-        const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, i);
+        r3d_pool_run(R3D.pool, cull_task_clusters, &batch, count);
+    }
 
-        // Branch 1: Group belongs to a cluster
-        if (visibility->clusterIndex >= 0)
-        {
-            r3d_render_cluster_t* cluster = &R3D_LIST_GET(R3D_MOD_RENDER.clusters, r3d_render_cluster_t, visibility->clusterIndex);
+    if (useBvh)
+    {
+        batch.bvhBoxes = cull_bounds_array(R3D_MOD_RENDER.bvhBounds);
+        batch.bvhNodes = R3D_MOD_RENDER.bvhNodes->elements;
+        batch.bvhOrder = R3D_MOD_RENDER.bvhOrder->elements;
+        batch.bvhUnbounded = R3D_MOD_RENDER.bvhUnbounded->elements;
+        batch.bvhNodeCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.bvhNodes);
+        batch.bvhUnboundedCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.bvhUnbounded);
+
+        r3d_pool_run(R3D.pool, cull_task_bvh, &batch, taskCount);
+    }
+    else
+    {
+        r3d_pool_run(R3D.pool, cull_task_groups, &batch, taskCount);
+    }
+}
 
-            // Test cluster once (shared by multiple groups)
-            if (cluster->visible == R3D_RENDER_VISBILITY_UNKNOWN)
-            {
-                cluster->visible = is_aabb_visible(frustum, cluster->aabb);
-            }
+void r3d_render_cull_groups_select(int index)
+{
+    R3D_ASSERT(index >= 0 && (size_t)index < R3D_LIST_LENGTH(R3D_MOD_RENDER.cullFrustums));
 
-            // If cluster is visible, test the group
-            if (cluster->visible == R3D_RENDER_VISBILITY_TRUE)
-            {
-                // For instanced: trust cluster visibility
-                // For others: test group AABB individually
-                if (r3d_render_has_instances(group)) visibility->visible = R3D_RENDER_VISBILITY_TRUE;
-                else visibility->visible = is_obb_visible(frustum, group->obb);
-            }
-            else
-            {
-                visibility->visible = R3D_RENDER_VISBILITY_FALSE;
-            }
-        }
-        // Branch 2: Group without cluster
-        else
-        {
-            // For instanced: always visible
-            // For others: test group AABB
-            if (r3d_render_has_instances(group)) visibility->visible = R3D_RENDER_VISBILITY_TRUE;
-            else visibility->visible = is_obb_visible(frustum, group->obb);
-        }
+    cull_select_views(index, 1);
+    R3D_MOD_RENDER.cullCubeIndex = -1;
+}
+
+void r3d_render_cull_groups_select_cube(int index)
+{
+    R3D_ASSERT(index >= 0 && (size_t)index + 6 <= R3D_LIST_LENGTH(R3D_MOD_RENDER.cullFrustums));
+
+    cull_select_views(index, 6);
+    R3D_MOD_RENDER.cullCubeIndex = index;
+}
+
+uint32_t r3d_render_call_cube_faces(const r3d_render_call_t* call)
+{
+    int index = R3D_MOD_RENDER.cullCubeIndex;
+    R3D_ASSERT(index >= 0);
+
+    int callIndex = array_get_call_index(call);
+    int groupIndex = R3D_LIST_GET(R3D_MOD_RENDER.groupIndices, int, callIndex);
+    const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, groupIndex);
+
+    if (R3D_LIST_GET(R3D_MOD_RENDER.groupVisibility, r3d_render_group_visibility_t, groupIndex).visible == R3D_RENDER_VISBILITY_FALSE)
+    {
+        return 0;
+    }
+
+    // Same shortcuts as 'r3d_render_call_is_visible()', only the calls of regular multi-call groups are tested
+    bool testCall = (R3D_LIST_GET(R3D_MOD_RENDER.callIndices, r3d_render_indices_t, groupIndex).numCall > 1) &&
+                    !r3d_render_has_instances(group) && group->skinTexture == 0;
+
+    uint32_t faces = 0;
+
+    for (int face = 0; face < 6; face++)
+    {
+        const uint64_t* groupBits = (const uint64_t*)R3D_MOD_RENDER.cullGroupBits->elements + (size_t)(index + face) * R3D_MOD_RENDER.cullGroupWords;
+        if (!cull_bit_test(groupBits, groupIndex)) continue;
+
+        const R3D_Frustum* frustum = &R3D_LIST_GET(R3D_MOD_RENDER.cullFrustums, R3D_Frustum, index + face);
+        if (testCall && !is_draw_call_visible(frustum, call, group->transform)) continue;
+
+        faces |= 1u << face;
     }
+
+    return faces;
+}
+
+Vector3* r3d_render_occluder_alloc(int vertexCount)
+{
+    size_t offset = R3D_LIST_LENGTH(R3D_MOD_RENDER.occluders);
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.occluders, offset + vertexCount);
+
+    return (Vector3*)R3D_MOD_RENDER.occluders->elements + offset;
+}
+
+void r3d_render_cull_occlusion(Matrix viewProj, float aspect)
+{
+    int vertexCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.occluders);
+    int groupCount = (int)R3D_LIST_LENGTH(R3D_MOD_RENDER.groups);
+
+    if (vertexCount == 0 || groupCount == 0) return;
+
+    /* --- Rasterize the occluders and build the hierarchy --- */
+
+    int width = R3D_HINT(R3D_HINT_OCCLUSION_BUFFER_SIZE);
+    int height = (aspect > 0.0f) ? (int)((float)width / aspect + 0.5f) : width;
+
+    r3d_occlusion_t* occlusion = &R3D_MOD_RENDER.occlusion;
+    r3d_occlusion_begin(occlusion, width, height, viewProj);
+    r3d_occlusion_draw_triangles(occlusion, R3D_MOD_RENDER.occluders->elements, vertexCount);
+    r3d_occlusion_build_hierarchy(occlusion);
+
+    /* --- Test the bounds of the groups still visible --- */
+
+    cull_occlusion_batch_t batch = {
+        .occlusion = occlusion,
+        .groups = R3D_MOD_RENDER.groups->elements,
+        .groupVisibility = R3D_MOD_RENDER.groupVisibility->elements,
+        .groupBoxes = cull_bounds_array(R3D_MOD_RENDER.groupBounds),
+        .groupCount = groupCount
+    };
+
+    int taskCount = (groupCount + CULL_GROUPS_PER_TASK - 1) / CULL_GROUPS_PER_TASK;
+    r3d_pool_run(R3D.pool, cull_task_occlusion, &batch, taskCount);
 }
 
 bool r3d_render_call_is_visible(const r3d_render_call_t* call, const R3D_Frustum* frustum)
@@ -1428,40 +3121,182 @@ bool r3d_render_call_is_visible(const r3d_render_call_t* call, const R3D_Frustum
     return is_draw_call_visible(frustum, call, group->transform);
 }
 
+void r3d_render_compact_lists(const R3D_Frustum* frustum, R3D_Layer cullMask)
+{
+    // Batches are rebuilt after the lists are sorted, each call starts drawn on its own
+    size_t callCount = R3D_LIST_LENGTH(R3D_MOD_RENDER.calls);
+    R3D_LIST_RESIZE(R3D_MOD_RENDER.callBatches, callCount);
+    memset(R3D_MOD_RENDER.callBatches->elements, 0, callCount * sizeof(r3d_render_batch_t));
+
+    for (int list = 0; list < R3D_RENDER_LIST_COUNT; list++)
+    {
+        r3d_list_t* drawList = R3D_MOD_RENDER.list[list];
+        size_t count = R3D_LIST_LENGTH(drawList);
+
+        R3D_LIST_CLEAR(R3D_MOD_RENDER.visible[list]);
+        R3D_LIST_RESERVE(R3D_MOD_RENDER.visible[list], count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            int callIndex = R3D_LIST_GET(drawList, int, i);
+            const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndex);
+
+            // Decals have no layer mask, only meshes are filtered by the camera layers
+            if (call->type == R3D_RENDER_CALL_MESH && !R3D_BIT_ANY(cullMask, call->mesh.instance.layerMask))
+            {
+                continue;
+            }
+
+            if (r3d_render_call_is_visible(call, frustum))
+            {
+                R3D_LIST_PUSH(R3D_MOD_RENDER.visible[list], callIndex);
+            }
+        }
+    }
+}
+
 void r3d_render_sort_list(r3d_render_list_enum_t list, Vector3 viewPosition, r3d_render_sort_enum_t mode)
 {
-    G_sortViewPosition = viewPosition;
+    r3d_list_t* drawListCalls = R3D_MOD_RENDER.visible[list];
+    size_t count = R3D_LIST_LENGTH(drawListCalls);
+    if (count < 2) return;
 
-    int (*compareFunc)(const void *a, const void *b) = NULL;
-    r3d_list_t* drawListCalls = R3D_MOD_RENDER.list[list];
+    sort_build_keys(list, viewPosition, mode);
 
-    switch (mode)
+    r3d_render_sort_key_t* keys = R3D_MOD_RENDER.sortKeys->elements;
+    sort_radix(keys, R3D_MOD_RENDER.sortScratch->elements, count);
+
+    for (size_t i = 0; i < count; i++)
     {
-    case R3D_RENDER_SORT_FRONT_TO_BACK:
-        compareFunc = compare_front_to_back;
-        sort_fill_cache_front_to_back(list);
-        break;
-    case R3D_RENDER_SORT_BACK_TO_FRONT:
-        compareFunc = compare_back_to_front;
-        sort_fill_cache_back_to_front(list);
-        break;
-    case R3D_RENDER_SORT_MATERIAL_ONLY:
-        compareFunc = compare_materials_only;
-        sort_fill_cache_by_material(list);
-        break;
+        R3D_LIST_SET(drawListCalls, int, i, keys[i].callIndex);
     }
+}
 
-    qsort(
-        drawListCalls->elements,
-        drawListCalls->elemCount,
-        drawListCalls->elemSize,
-        compareFunc
-    );
+void r3d_render_batch_list(r3d_render_list_enum_t list)
+{
+    R3D_ASSERT(list < R3D_RENDER_LIST_OPAQUE_INST && "Instantiated render lists should not be batched");
+
+    r3d_list_t* drawList = R3D_MOD_RENDER.visible[list];
+    size_t count = R3D_LIST_LENGTH(drawList);
+    if (count < 2) return;
+
+    int* callIndices = drawList->elements;
+    r3d_render_batch_t* batches = R3D_MOD_RENDER.callBatches->elements;
+
+    // Batches are appended after the instances written by the current culling selection
+    size_t streamUsed[R3D_INSTANCE_ATTRIBUTE_COUNT];
+    bool streamWritten = false;
+
+    for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+    {
+        streamUsed[i] = R3D_LIST_LENGTH(R3D_MOD_RENDER.instanceStaging[i]);
+    }
+
+    size_t keptCount = 0;
+
+    for (size_t first = 0; first < count;)
+    {
+        const r3d_render_call_t* leader = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndices[first]);
+        callIndices[keptCount++] = callIndices[first];
+
+        /* --- Extend the run while the next calls draw the same thing --- */
+
+        size_t last = first + 1;
+
+        if (batch_is_mergeable(leader, r3d_render_get_call_group(leader)))
+        {
+            while (last < count)
+            {
+                const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndices[last]);
+                if (!batch_is_same_draw(leader, call) || !batch_is_mergeable(call, r3d_render_get_call_group(call))) break;
+                last++;
+            }
+        }
+
+        int runLength = (int)(last - first);
+
+        if (runLength < 2)
+        {
+            first = last;
+            continue;
+        }
+
+        /* --- Write one instance per merged call --- */
+
+        size_t attrSize[R3D_INSTANCE_ATTRIBUTE_COUNT];
+        int streamOffset = instances_stream_reserve(&BATCH_INSTANCE_LAYOUT, streamUsed, runLength, attrSize);
+
+        Vector3* positions = (Vector3*)((uint8_t*)R3D_MOD_RENDER.instanceStaging[0]->elements + streamOffset * attrSize[0]);
+        Quaternion* rotations = (Quaternion*)((uint8_t*)R3D_MOD_RENDER.instanceStaging[1]->elements + streamOffset * attrSize[1]);
+        Vector3* scales = (Vector3*)((uint8_t*)R3D_MOD_RENDER.instanceStaging[2]->elements + streamOffset * attrSize[2]);
+
+        for (int i = 0; i < runLength; i++)
+        {
+            const r3d_render_call_t* call = &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t, callIndices[first + i]);
+            float scale = 1.0f;
+            batch_decompose(&r3d_render_get_call_group(call)->transform, &positions[i], &rotations[i], &scale);
+            scales[i] = (Vector3) {scale, scale, scale};
+        }
+
+        for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+        {
+            if (attrSize[i] == 0) continue;
+            streamUsed[i] = (streamOffset + runLength) * attrSize[i];
+            R3D_MOD_RENDER.instanceStaging[i]->elemCount = streamUsed[i];
+        }
+
+        batches[callIndices[keptCount - 1]] = (r3d_render_batch_t) {
+            .streamOffset = streamOffset,
+            .instanceCount = runLength
+        };
+
+        streamWritten = true;
+        first = last;
+    }
+
+    drawList->elemCount = keptCount;
+
+    if (streamWritten)
+    {
+        instances_upload_stream();
+    }
+}
+
+const r3d_render_batch_t* r3d_render_get_call_batch(const r3d_render_call_t* call)
+{
+    int callIndex = array_get_call_index(call);
+    if ((size_t)callIndex >= R3D_LIST_LENGTH(R3D_MOD_RENDER.callBatches)) return NULL;
+
+    const r3d_render_batch_t* batch = &R3D_LIST_GET(R3D_MOD_RENDER.callBatches, r3d_render_batch_t, callIndex);
+
+    return (batch->instanceCount > 0) ? batch : NULL;
 }
 
 void r3d_render_prepare_drawing(void)
 {
+    if (R3D_MOD_RENDER.boundVao != R3D_MOD_RENDER.globalVao)
+    {
+        memset(&R3D_MOD_RENDER.instanceState, 0, sizeof(R3D_MOD_RENDER.instanceState));
+    }
+
     glBindVertexArray(R3D_MOD_RENDER.globalVao);
+    R3D_MOD_RENDER.boundVao = R3D_MOD_RENDER.globalVao;
+}
+
+void r3d_render_prepare_depth_drawing(bool positionOnly)
+{
+    GLuint vao = (positionOnly && R3D_MOD_RENDER.depthVao != 0)
+        ? R3D_MOD_RENDER.depthVao : R3D_MOD_RENDER.globalVao;
+
+    if (vao == R3D_MOD_RENDER.boundVao) return;
+
+    // The instance bindings are part of the VAO state, the cache no longer applies
+    memset(&R3D_MOD_RENDER.instanceState, 0, sizeof(R3D_MOD_RENDER.instanceState));
+
+    glBindVertexArray(vao);
+    R3D_MOD_RENDER.boundVao = vao;
+
+    if (vao == R3D_MOD_RENDER.depthVao) depth_vao_set_defaults();
 }
 
 void r3d_render_draw(const r3d_render_call_t* call)
@@ -1496,13 +3331,36 @@ void r3d_render_draw_instanced(const r3d_render_call_t* call)
 
     get_draw_call_info(call, &primitive, &vertexRange, &indexRange);
 
-    const r3d_render_group_t* group = r3d_render_get_call_group(call);
+    int callIndex = array_get_call_index(call);
+    int groupIndex = R3D_LIST_GET(R3D_MOD_RENDER.groupIndices, int, callIndex);
+    const r3d_render_group_t* group = &R3D_LIST_GET(R3D_MOD_RENDER.groups, r3d_render_group_t, groupIndex);
+    const r3d_render_group_visibility_t* visibility = &R3D_LIST_GET(R3D_MOD_RENDER.groupVisibility, r3d_render_group_visibility_t, groupIndex);
+
+    const r3d_render_batch_t* batch = r3d_render_get_call_batch(call);
+    int instanceCount = group->instanceCount;
+
+    // Draw the merged calls of a dynamic batch, written to the instance stream
+    if (batch != NULL)
+    {
+        instances_enable(R3D_MOD_RENDER.instanceStream, BATCH_INSTANCE_LAYOUT, batch->streamOffset);
+        instanceCount = batch->instanceCount;
+    }
+    // Draw the instances that survived culling if the group was culled per instance
+    else if (visibility->streamCount >= 0)
+    {
+        instances_enable(R3D_MOD_RENDER.instanceStream, group->instances.layout, visibility->streamOffset);
+        instanceCount = visibility->streamCount;
+    }
+    else
+    {
+        instances_enable(group->instances.buffers, group->instances.layout, group->instanceOffset);
+    }
 
-    instances_enable(group->instances.buffers, group->instances.layout, group->instanceOffset);
+    if (instanceCount == 0) return;
 
     if (indexRange.count == 0)
     {
-        glDrawArraysInstanced(primitive, vertexRange.offset, vertexRange.count, group->instanceCount);
+        glDrawArraysInstanced(primitive, vertexRange.offset, vertexRange.count, instanceCount);
     }
     else
     {
@@ -1511,7 +3369,7 @@ void r3d_render_draw_instanced(const r3d_render_call_t* call)
             indexRange.count,
             GL_UNSIGNED_INT,
             (void*)(indexRange.offset * sizeof(GLuint)),
-            group->instanceCount,
+            instanceCount,
             vertexRange.offset
         );
     }
@@ -18,6 +18,7 @@
 #include <r3d/r3d_mesh.h>
 #include <glad.h>
 
+#include "../common/r3d_occlusion.h"
 #include "../common/r3d_list.h"
 
 // ========================================
@@ -34,16 +35,29 @@
  * Intended for internal rendering passes only.
  */
 #define R3D_RENDER_FOR_EACH(call, cond, frustum, ...)                                               \
+    R3D_RENDER_FOR_EACH_IN(R3D_MOD_RENDER.list, call, cond, frustum, __VA_ARGS__)
+
+/*
+ * Same as `R3D_RENDER_FOR_EACH` but iterates the visible calls compacted by the
+ * last `r3d_render_compact_lists()`, in their sorted order, without culling again.
+ */
+#define R3D_RENDER_FOR_EACH_VISIBLE(call, cond, ...)                                                \
+    R3D_RENDER_FOR_EACH_IN(R3D_MOD_RENDER.visible, call, cond, NULL, __VA_ARGS__)
+
+/*
+ * Shared implementation of the iteration macros above, 'lists' is an array of index lists.
+ */
+#define R3D_RENDER_FOR_EACH_IN(lists, call, cond, frustum, ...)                                     \
     for (int _lists[] = {__VA_ARGS__}, _list_idx = 0, _i = 0, _keep = 1;                            \
          _list_idx < (int)(sizeof(_lists)/sizeof(_lists[0]));                                       \
-         ((size_t)_i >= R3D_LIST_LENGTH(R3D_MOD_RENDER.list[_lists[_list_idx]]) ?                   \
+         ((size_t)_i >= R3D_LIST_LENGTH((lists)[_lists[_list_idx]]) ?                               \
           (_list_idx++, _i = 0) : 0))                                                               \
         for (; _list_idx < (int)(sizeof(_lists)/sizeof(_lists[0])) &&                               \
-               (size_t)_i < R3D_LIST_LENGTH(R3D_MOD_RENDER.list[_lists[_list_idx]]);                \
+               (size_t)_i < R3D_LIST_LENGTH((lists)[_lists[_list_idx]]);                            \
              _i++, _keep = 1)                                                                       \
             for (const r3d_render_call_t* call =                                                    \
                  &R3D_LIST_GET(R3D_MOD_RENDER.calls, r3d_render_call_t,                             \
-                     R3D_LIST_GET(R3D_MOD_RENDER.list[_lists[_list_idx]], int, _i));                \
+                     R3D_LIST_GET((lists)[_lists[_list_idx]], int, _i));                            \
                  _keep && (cond) && (!(frustum) || r3d_render_call_is_visible(call, (frustum)));    \
                  _keep = 0)
 
@@ -158,21 +172,24 @@ typedef struct {
 
 /*
  * Cluster that may contain multiple render groups.
- * Stores bounds and the evaluated visibility state.
+ * Its visibility is evaluated per frustum during group culling.
  */
 typedef struct {
     BoundingBox aabb;
-    r3d_render_visibility_enum_t visible;
 } r3d_render_cluster_t;
 
 /*
  * Visibility metadata for a render group.
  * Holds its cluster index (if assigned) and its own visibility state.
  * Note: a group is effectively visible only when its cluster is visible.
+ * For instanced groups culled per instance, also holds the range of
+ * surviving instances written in the instance stream.
  */
 typedef struct {
     int clusterIndex;
     r3d_render_visibility_enum_t visible;
+    int streamOffset;       //< Offset of the first visible instance in the instance stream
+    int streamCount;        //< Number of visible instances in the stream (-1 if drawn from the group buffer)
 } r3d_render_group_visibility_t;
 
 /*
@@ -192,10 +209,12 @@ typedef struct {
 typedef struct {
     Matrix transform;               //< Model transformation matrix
     R3D_OrientedBox obb;            //< Oriented bounding box of all drawables contained in the group
+    BoundingBox instanceAabb;       //< Local bounding box of a single instance (instanced groups only)
     GLuint skinTexture;             //< Texture that contains the bone matrices (can be 0 for non-skinned)
     R3D_InstanceBuffer instances;   //< Instance buffer to use
     int instanceOffset;             //< Offset to the first instance
     int instanceCount;              //< Number of instances
+    bool staticShadow;              //< Drawn into the cached static shadow layers (set on push)
 } r3d_render_group_t;
 
 /*
@@ -227,9 +246,9 @@ typedef struct {
 } r3d_render_call_t;
 
 /*
- * Sort key derived from a rendering state.
- * Fields are declared in priority order: the first differing field
- * encountered during comparison determines the sort result.
+ * Material state of a draw call used to derive its sort key.
+ * The struct is zeroed before being filled so it can be hashed as raw bytes,
+ * calls sharing every field below are batched together by the sort.
  */
 typedef struct {
     int32_t priority;       ///< User-defined render order (signed, lower = first)
@@ -248,12 +267,69 @@ typedef struct {
 } r3d_render_sort_state_t;
 
 /*
- * Data stored per draw call in the sort cache.
+ * Packed sort key of a draw call, built once per sort.
+ * Keys are compared as plain unsigned integers, see `r3d_render_sort_list()` for the layout.
+ */
+typedef struct {
+    uint64_t key;           ///< Packed priority, state and depth bits
+    int callIndex;          ///< Index of the draw call in the calls array
+} r3d_render_sort_key_t;
+
+/*
+ * Entry of the table mapping hashed shader/material states to dense per-sort IDs.
+ * A zero hash marks an empty slot.
  */
 typedef struct {
-    r3d_render_sort_state_t state;
-    float distance;
-} r3d_render_sort_t;
+    uint64_t hash;          ///< Hash of the interned state (never zero once used)
+    uint32_t id;            ///< Dense ID assigned on first insertion
+} r3d_render_sort_intern_t;
+
+/*
+ * CPU copy of the attribute streams of an instance buffer created with R3D_INSTANCE_CULLING.
+ * Identified by the GPU buffer of the position attribute, which culling buffers always have.
+ * Also records the range of each attribute mapped by R3D_MapInstancesEx(), uploaded on unmap.
+ */
+typedef struct {
+    GLuint key;                                     //< GPU buffer of the position attribute
+    uint8_t* data[R3D_INSTANCE_ATTRIBUTE_COUNT];    //< CPU copy of each enabled attribute (NULL otherwise)
+    size_t mapOffset[R3D_INSTANCE_ATTRIBUTE_COUNT]; //< First mapped byte of each attribute
+    size_t mapSize[R3D_INSTANCE_ATTRIBUTE_COUNT];   //< Mapped bytes of each attribute (0 if not mapped)
+    bool mapDiscard[R3D_INSTANCE_ATTRIBUTE_COUNT];  //< Whether the mapped range is invalidated on upload
+} r3d_render_instance_cpu_copy_t;
+
+/*
+ * Node of the bounding volume hierarchy built over the group bounds.
+ * Each node covers a contiguous range of 'bvhOrder', the two children of a node are stored side by side.
+ */
+typedef struct {
+    Vector3 center;         //< Center of the node box
+    Vector3 extents;        //< Half extents of the node box
+    int first;              //< First entry covered in 'bvhOrder'
+    int count;              //< Number of entries covered
+    int left;               //< Index of the left child, the right one follows it (-1 for leaves)
+} r3d_render_bvh_node_t;
+
+/*
+ * View submitted to a culling batch, see `r3d_render_cull_groups_batch()`.
+ * The faces of a cube map (omni shadows, probes) are submitted as six consecutive
+ * views in +X, -X, +Y, -Y, +Z, -Z order, they are then culled together in one pass.
+ */
+typedef struct {
+    const R3D_Frustum* frustum;     //< Frustum of the view
+    Vector3 cubeCenter;             //< Eye position of the cube map (faces only)
+    float cubeRange;                //< Far distance of the cube faces (faces only)
+    int cubeFace;                   //< Face of the view in the cube map, -1 for a plain frustum
+} r3d_render_cull_view_t;
+
+/*
+ * Run of visible calls sharing the same mesh and material, drawn as one instanced draw.
+ * Stored per draw call, only the first call of the run is kept in its visible list.
+ * The transform of each merged call is written to the instance stream, see `r3d_render_batch_list()`.
+ */
+typedef struct {
+    int streamOffset;       //< Offset of the first merged call in the instance stream
+    int instanceCount;      //< Number of merged calls (0 if the call is drawn on its own)
+} r3d_render_batch_t;
 
 // ========================================
 // MODULE STATE
@@ -268,6 +344,9 @@ extern struct r3d_mod_render {
     GLuint globalVao;                                   //< Single VAO shared by all mesh and shape draw calls
     GLuint globalVbo;                                   //< Global vertex buffer holding all mesh and shape vertices
     GLuint globalEbo;                                   //< Global index buffer holding all mesh and shape indices
+    GLuint positionVbo;                                 //< Packed vertex positions mirroring the global VBO, zero if the position stream is disabled
+    GLuint depthVao;                                    //< VAO reading only the position stream, for depth-only draws needing no other attribute
+    GLuint boundVao;                                    //< VAO currently bound for drawing, the instance binding cache belongs to it
     int globalVertexCapacity;                           //< Number of vertex slots allocated in the VBO
     int globalElementCapacity;                          //< Number of index slots allocated in the EBO
     int globalVertexCount;                              //< High-water mark: first never-allocated vertex offset
@@ -277,21 +356,49 @@ extern struct r3d_mod_render {
     r3d_list_t* freeElements;                           //< Free list of released index ranges available for reuse (list<r3d_render_range_t>)
 
     r3d_render_instance_state_t instanceState;          //< Cached instance binding configuration
+
+    GLuint instanceStream[R3D_INSTANCE_ATTRIBUTE_COUNT];            //< Transient buffers receiving the culled instances of the current pass
+    size_t instanceStreamSize[R3D_INSTANCE_ATTRIBUTE_COUNT];        //< Allocated size in bytes of each instance stream buffer
+    r3d_list_t* instanceStaging[R3D_INSTANCE_ATTRIBUTE_COUNT];      //< CPU staging of each instance stream (list<uint8_t>)
+    r3d_list_t* instanceCpuCopies;                                  //< CPU copies of the culling instance buffers (list<r3d_render_instance_cpu_copy_t>)
+    int* instanceCpuCopySlots;                                      //< Open addressing table of 'instanceCpuCopies' indices by key (-1 if empty)
+    int instanceCpuCopySlotCount;                                   //< Size of the slot table, a power of two (0 until the first add)
     r3d_render_shape_t shapes[R3D_RENDER_SHAPE_COUNT];  //< Array of built-in shapes buffers
 
     r3d_list_t* clusters;                               //< Array of render clusters (list<r3d_render_cluster_t>)
     int activeCluster;                                  //< Index of the active cluster for new render groups (-1 if no active clusters)
+    bool staticShadows;                                 //< True while new render groups are static shadow casters
 
     r3d_list_t* groupVisibility;                        //< Array containing visibility info for each render group (list<r3d_render_group_visibility_t>, generated during group culling)
     r3d_list_t* callIndices;                            //< Array of draw call index ranges for each render group (list<r3d_render_indices_t>, automatically managed)
     r3d_list_t* groups;                                 //< Array of render groups (list<r3d_render_group_t>, shared data across draw calls)
 
     r3d_list_t* list[R3D_RENDER_LIST_COUNT];            //< List of draw call indices per render pass (list<int>)
-    r3d_list_t* sortCache;                              //< Draw call sorting data cache array (list<r3d_render_sort_t>)
+    r3d_list_t* visible[R3D_RENDER_LIST_COUNT];         //< Calls of each list visible to the camera, sorted in draw order (list<int>)
+    r3d_list_t* callBatches;                            //< Dynamic batch led by each draw call, reset with the visible lists (list<r3d_render_batch_t>)
+    r3d_list_t* sortKeys;                               //< Packed sort keys of the list being sorted (list<r3d_render_sort_key_t>)
+    r3d_list_t* sortScratch;                            //< Radix sort ping-pong buffer (list<r3d_render_sort_key_t>)
+    r3d_list_t* sortIntern;                             //< Open addressing table of dense state IDs (list<r3d_render_sort_intern_t>)
     r3d_list_t* calls;                                  //< Array of draw calls (list<r3d_render_call_t>)
     r3d_list_t* groupIndices;                           //< Array of group indices for each draw call (list<int>, automatically managed)
 
-    bool groupCulled;                                   //< Indicates if groups already culled (controls visibility reset)
+    r3d_list_t* cullFrustums;                           //< Frustums of the last culling batch (list<R3D_Frustum>)
+    r3d_list_t* cullTasks;                              //< Work items of the last culling batch (list<cull_task_t>, see r3d_render.c)
+    r3d_list_t* cullGroupBits;                          //< Group visibility bitsets, one per batch frustum (list<uint64_t>)
+    r3d_list_t* cullClusterBits;                        //< Cluster visibility bitsets, one per batch frustum (list<uint64_t>)
+    int cullGroupWords;                                 //< Number of 64-bit words in each group bitset
+    int cullCubeIndex;                                  //< First view of the cube map selected as a whole, -1 otherwise
+    r3d_list_t* groupBounds[6];                         //< World box enclosing each group, SoA center xyz then extents xyz (list<float>)
+    r3d_list_t* clusterBounds[6];                       //< Box of each cluster, same layout as 'groupBounds' (list<float>)
+
+    r3d_list_t* bvhNodes;                               //< Hierarchy over the bounded groups, root first (list<r3d_render_bvh_node_t>)
+    r3d_list_t* bvhOrder;                               //< Group indices in leaf order (list<int>)
+    r3d_list_t* bvhBounds[6];                           //< Group boxes in leaf order, same layout as 'groupBounds' (list<float>)
+    r3d_list_t* bvhUnbounded;                           //< Instanced or unbounded groups kept out of the tree (list<int>)
+    bool bvhValid;                                      //< False once groups were pushed since the last build
+
+    r3d_list_t* occluders;                              //< World positions of the occluder triangles of the frame (list<Vector3>)
+    r3d_occlusion_t occlusion;                          //< CPU depth buffer the occluders are rasterized into
 
 } R3D_MOD_RENDER;
 
@@ -361,6 +468,29 @@ void r3d_render_upload_vertices(int offset, const R3D_Vertex* verts, int count);
  */
 void r3d_render_upload_elements(int offset, const GLuint* indices, int count);
 
+/*
+ * Registers an empty CPU copy for the instance buffer identified by 'key'.
+ * The returned pointer stays valid until the next add or remove.
+ */
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_add(GLuint key);
+
+/*
+ * Returns the CPU copy registered for 'key', or NULL if the buffer has none.
+ * The returned pointer stays valid until the next add or remove.
+ */
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_get(GLuint key);
+
+/*
+ * Moves the CPU copy registered for 'oldKey' to 'newKey', returns it or NULL if the buffer has none.
+ * The returned pointer stays valid until the next add or remove.
+ */
+r3d_render_instance_cpu_copy_t* r3d_render_instance_cpu_copy_rekey(GLuint oldKey, GLuint newKey);
+
+/*
+ * Releases the CPU copy registered for 'key', if any.
+ */
+void r3d_render_instance_cpu_copy_remove(GLuint key);
+
 /*
  * Clear all render lists and reset the draw call buffer for the next frame.
  */
@@ -379,6 +509,27 @@ bool r3d_render_cluster_begin(BoundingBox aabb);
  */
 bool r3d_render_cluster_end(void);
 
+/*
+ * Begins a block of static shadow casters.
+ * All subsequent render group pushes are flagged as static casters.
+ * Returns false if a block is already active.
+ */
+bool r3d_render_static_shadows_begin(void);
+
+/*
+ * Ends the current block of static shadow casters.
+ * Returns false if no block is currently active.
+ */
+bool r3d_render_static_shadows_end(void);
+
+/*
+ * Returns a hash of the static shadow casters pushed this frame, their
+ * transforms, mesh ranges, depth-relevant material fields and instance
+ * ranges, or zero if there are none.
+ * Instance buffer contents and skinning are not part of the hash.
+ */
+uint64_t r3d_render_static_shadows_hash(void);
+
 /*
  * Push a new render group. All subsequent draw calls will belong to this group
  * until a new group is pushed.
@@ -400,10 +551,54 @@ r3d_render_group_t* r3d_render_get_call_group(const r3d_render_call_t* call);
 
 /*
  * Builds the list of groups that are visible inside the given frustum.
+ * Instanced groups with CPU data (R3D_INSTANCE_CULLING) are culled per instance,
+ * their surviving instances are compacted and uploaded to the instance stream.
  * Must be called before issuing visibility tests with the same frustum.
+ * Shorthand for a batch of one frustum followed by its selection.
  */
 void r3d_render_cull_groups(const R3D_Frustum* frustum);
 
+/*
+ * Culls all groups against several views at once, spread over the worker pool.
+ * Each view gets its own visibility bitset, tasks write disjoint words so no locking is needed.
+ * Complete cube maps are rejected once against their range sphere, then each survivor is
+ * sorted into the faces it overlaps, instead of being tested against six frustums.
+ * Results stay valid until the next batch, frustums are copied.
+ */
+void r3d_render_cull_groups_batch(const r3d_render_cull_view_t* views, int count);
+
+/*
+ * Makes the results of the view at 'index' in the last batch the current group visibility.
+ * Per instance culling and the instance stream upload happen here, on the calling thread.
+ */
+void r3d_render_cull_groups_select(int index);
+
+/*
+ * Same as `r3d_render_cull_groups_select()` for the six face views of a cube map starting at 'index',
+ * a group is visible if any face sees it. Used to draw every face at once (layered rendering).
+ */
+void r3d_render_cull_groups_select_cube(int index);
+
+/*
+ * Returns the faces of the selected cube map the call is visible from, bit N for face N.
+ * Only valid after `r3d_render_cull_groups_select_cube()`.
+ */
+uint32_t r3d_render_call_cube_faces(const r3d_render_call_t* call);
+
+/*
+ * Reserves room for 'vertexCount' world positions of occluder triangles, three per triangle,
+ * and returns where to write them. They are used by the next `r3d_render_cull_occlusion()`.
+ */
+Vector3* r3d_render_occluder_alloc(int vertexCount);
+
+/*
+ * Rasterizes the occluders of the frame into the CPU depth buffer with the given view,
+ * then marks as culled the visible groups whose bounds are entirely hidden behind them.
+ * Instanced groups are left untouched. Does nothing if no occluder was submitted.
+ * Must follow `r3d_render_cull_groups()` and precede the visibility tests of the same view.
+ */
+void r3d_render_cull_occlusion(Matrix viewProj, float aspect);
+
 /*
  * Returns true if the draw call is visible within the given frustum.
  * Uses both per-call culling and the results produced by `r3d_render_cull_groups()`
@@ -412,16 +607,49 @@ void r3d_render_cull_groups(const R3D_Frustum* frustum);
 bool r3d_render_call_is_visible(const r3d_render_call_t* call, const R3D_Frustum* frustum);
 
 /*
- * Sort a render list according to the given mode and camera position.
+ * Compacts the calls of every render list that are visible in the frustum and whose
+ * mesh layers intersect 'cullMask' into the dense 'visible' lists, preserving submission order.
+ * Groups must have been culled with the same frustum beforehand.
+ */
+void r3d_render_compact_lists(const R3D_Frustum* frustum, R3D_Layer cullMask);
+
+/*
+ * Sort the visible calls of a render list according to the given mode and camera position.
+ * Each call is reduced to a single 64-bit key which is then sorted with a stable LSD radix sort.
+ * Only the subset compacted by `r3d_render_compact_lists()` is sorted.
  */
 void r3d_render_sort_list(r3d_render_list_enum_t list, Vector3 viewPosition, r3d_render_sort_enum_t mode);
 
+/*
+ * Merges the runs of consecutive visible calls sharing the same mesh and material into batches.
+ * The transforms of a run are appended to the instance stream as position, rotation and scale,
+ * its first call then draws the whole run through the instanced path and the others are removed.
+ * Only non-instanced, non-skinned, non-billboard, non-hybrid calls with a uniformly scaled rigid transform are merged.
+ * Must follow `r3d_render_sort_list()`, the stream written by the current culling selection is kept.
+ */
+void r3d_render_batch_list(r3d_render_list_enum_t list);
+
+/*
+ * Returns the batch led by the draw call, or NULL if the call is drawn on its own.
+ * Valid after `r3d_render_batch_list()` until the next `r3d_render_compact_lists()`.
+ */
+const r3d_render_batch_t* r3d_render_get_call_batch(const r3d_render_call_t* call);
+
 /*
  * Binds the global VAO, making it active for all subsequent draw calls.
  * Must be called once before any r3d_render_draw* calls in a rendering pass.
  */
 void r3d_render_prepare_drawing(void);
 
+/*
+ * Selects the VAO used by the following depth-only draw calls.
+ * With 'positionOnly', vertices are fetched from the packed position stream,
+ * the other vertex attributes then read constant defaults (white color, zero texcoord).
+ * Falls back to the global VAO when the position stream is disabled.
+ * Call r3d_render_prepare_drawing() to return to the global VAO afterwards.
+ */
+void r3d_render_prepare_depth_drawing(bool positionOnly);
+
 /*
  * Issue a non-instanced draw call.
  */
@@ -429,7 +657,9 @@ void r3d_render_draw(const r3d_render_call_t* call);
 
 /*
  * Issue an instanced draw call.
- * Instance data is bound internally.
+ * Instance data is bound internally, from the instance stream when the
+ * group was culled per instance by the last `r3d_render_cull_groups()`
+ * or when the call leads a batch built by `r3d_render_batch_list()`.
  */
 void r3d_render_draw_instanced(const r3d_render_call_t* call);
 
@@ -453,36 +683,36 @@ static inline bool r3d_render_has_instances(const r3d_render_group_t* group)
 }
 
 /*
- * Check whether there are any opaque draw calls queued for the current frame.
- * Includes both instanced and non-instanced variants.
+ * Check whether there are any opaque draw calls visible for the current frame.
+ * Includes both instanced and non-instanced variants, valid after `r3d_render_compact_lists()`.
  */
 static inline bool r3d_render_has_opaque(void)
 {
     return
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_OPAQUE])) ||
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_OPAQUE_INST]));
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_OPAQUE])) ||
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_OPAQUE_INST]));
 }
 
 /*
- * Check whether there are any blended draw calls queued for the current frame.
- * Includes both instanced and non-instanced variants.
+ * Check whether there are any blended draw calls visible for the current frame.
+ * Includes both instanced and non-instanced variants, valid after `r3d_render_compact_lists()`.
  */
 static inline bool r3d_render_has_blended(void)
 {
     return
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_BLEND])) ||
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_BLEND_INST]));
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_BLEND])) ||
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_BLEND_INST]));
 }
 
 /*
- * Check whether there are any decal draw calls queued for the current frame.
- * Includes both instanced and non-instanced variants.
+ * Check whether there are any decal draw calls visible for the current frame.
+ * Includes both instanced and non-instanced variants, valid after `r3d_render_compact_lists()`.
  */
 static inline bool r3d_render_has_decals(void)
 {
     return
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_DECAL])) ||
-        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.list[R3D_RENDER_LIST_DECAL_INST]));
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_DECAL])) ||
+        (!R3D_LIST_EMPTY(R3D_MOD_RENDER.visible[R3D_RENDER_LIST_DECAL_INST]));
 }
 
 /*
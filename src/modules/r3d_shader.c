@@ -44,6 +44,7 @@
 #include <shaders/smaa_edge_detection.frag.h>
 #include <shaders/cubemap_from_equirectangular.frag.h>
 #include <shaders/cubemap_irradiance.frag.h>
+#include <shaders/cubemap_sh.frag.h>
 #include <shaders/cubemap_prefilter.frag.h>
 #include <shaders/cubemap_procedural_sky.frag.h>
 #include <shaders/cubemap_custom_sky.frag.h>
@@ -53,6 +54,7 @@
 #include <shaders/unlit.frag.h>
 #include <shaders/depth.frag.h>
 #include <shaders/depth_cube.frag.h>
+#include <shaders/depth_cube.geom.h>
 #include <shaders/decal.frag.h>
 #include <shaders/skybox.vert.h>
 #include <shaders/skybox.frag.h>
@@ -103,7 +105,7 @@ struct r3d_mod_shader R3D_MOD_SHADER;
 
 #define LOAD_SHADER(shader_name, vsCode, fsCode)                                \
 do {                                                                            \
-    shader_name->id = load_shader((vsCode), (fsCode));                          \
+    shader_name->id = load_shader((vsCode), NULL, (fsCode));                    \
     if (shader_name->id == 0) {                                                 \
         R3D_TRACELOG(LOG_ERROR, "Failed to load shader '" #shader_name "'");    \
         return false;                                                           \
@@ -120,7 +122,7 @@ do {
             R3D_TRACELOG(LOG_ERROR, "Failed to build '" #shader_name "' shader sources"); \
             R3D_STACK_SCOPE_EXIT(R3D.stack);                                    \
         }                                                                       \
-        shader_name->id = load_shader(vsCode, fsCode);                          \
+        shader_name->id = load_shader(vsCode, (desc).gsCode, fsCode);           \
         if (shader_name->id == 0)                                               \
         {                                                                       \
             R3D_TRACELOG(LOG_ERROR, "Failed to load shader '" #shader_name "'");\
@@ -186,6 +188,8 @@ typedef struct {
     const char** fsDefines; // Fragment shader defines (may be NULL)
     int fsDefineCount;      // Number of fragment defines (ignored if fsDefines is NULL)
 
+    const char* gsCode;     // Geometry shader source, used as is (may be NULL)
+
     const char* userCode;   // Optional user code to inject (NULL if none)
 } shader_source_desc_t;
 
@@ -231,7 +235,7 @@ static GLuint compile_shader(const char* source, GLenum shaderType)
     {
         char infoLog[512];
         glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        const char* type_str = (shaderType == GL_VERTEX_SHADER) ? "vertex" : "fragment";
+        const char* type_str = (shaderType == GL_VERTEX_SHADER) ? "vertex" : (shaderType == GL_GEOMETRY_SHADER) ? "geometry" : "fragment";
         R3D_TRACELOG(LOG_ERROR, "%s shader compilation failed: %s", type_str, infoLog);
         glDeleteShader(shader);
         return 0;
@@ -240,7 +244,7 @@ static GLuint compile_shader(const char* source, GLenum shaderType)
     return shader;
 }
 
-static GLuint link_shader(GLuint vertShader, GLuint fragShader)
+static GLuint link_shader(GLuint vertShader, GLuint geomShader, GLuint fragShader)
 {
     GLuint program = glCreateProgram();
     if (program == 0)
@@ -250,6 +254,7 @@ static GLuint link_shader(GLuint vertShader, GLuint fragShader)
     }
 
     glAttachShader(program, vertShader);
+    if (geomShader != 0) glAttachShader(program, geomShader);
     glAttachShader(program, fragShader);
     glLinkProgram(program);
 
@@ -265,26 +270,40 @@ static GLuint link_shader(GLuint vertShader, GLuint fragShader)
     }
 
     glDetachShader(program, vertShader);
+    if (geomShader != 0) glDetachShader(program, geomShader);
     glDetachShader(program, fragShader);
 
     return program;
 }
 
-static GLuint load_shader(const char* vsCode, const char* fsCode)
+static GLuint load_shader(const char* vsCode, const char* gsCode, const char* fsCode)
 {
     GLuint vs = compile_shader(vsCode, GL_VERTEX_SHADER);
     if (vs == 0) return 0;
 
+    GLuint gs = 0;
+    if (gsCode != NULL)
+    {
+        gs = compile_shader(gsCode, GL_GEOMETRY_SHADER);
+        if (gs == 0)
+        {
+            glDeleteShader(vs);
+            return 0;
+        }
+    }
+
     GLuint fs = compile_shader(fsCode, GL_FRAGMENT_SHADER);
     if (fs == 0)
     {
         glDeleteShader(vs);
+        if (gs != 0) glDeleteShader(gs);
         return 0;
     }
 
-    GLuint program = link_shader(vs, fs);
+    GLuint program = link_shader(vs, gs, fs);
 
     glDeleteShader(vs);
+    if (gs != 0) glDeleteShader(gs);
     glDeleteShader(fs);
 
     return program;
@@ -740,6 +759,22 @@ bool r3d_shader_load_prepare_cubemap_irradiance(r3d_shader_custom_t* custom)
     return true;
 }
 
+bool r3d_shader_load_prepare_cubemap_sh(r3d_shader_custom_t* custom)
+{
+    R3D_UNUSED(custom);
+
+    DECL_SHADER(r3d_shader_prepare_cubemap_sh_t, prepare, cubemapSH);
+    LOAD_SHADER(cubemapSH, SCREEN_VERT, CUBEMAP_SH_FRAG);
+
+    GET_LOCATION(cubemapSH, uSourceFaceSize);
+    GET_LOCATION(cubemapSH, uSourceLod);
+
+    USE_SHADER(cubemapSH);
+    SET_SAMPLER(cubemapSH, uSourceTex, R3D_SHADER_SAMPLER_SOURCE_CUBE_0);
+
+    return true;
+}
+
 bool r3d_shader_load_prepare_cubemap_prefilter(r3d_shader_custom_t* custom)
 {
     R3D_UNUSED(custom);
@@ -886,14 +921,12 @@ bool r3d_shader_load_scene_forward(r3d_shader_custom_t* custom)
 {
     char defNumIlluminationProbes[32] = {0};
     char defNumReflectionProbes[32]   = {0};
-    char defNumLights[32]             = {0};
 
     r3d_string_format(defNumIlluminationProbes, sizeof(defNumIlluminationProbes), "MAX_ILLUMINATION_PROBES %i", R3D_SHADER_PROBE_ILLUMINATION_UBO_CAP);
     r3d_string_format(defNumReflectionProbes, sizeof(defNumReflectionProbes), "MAX_REFLECTION_PROBES %i", R3D_SHADER_PROBE_REFLECTION_UBO_CAP);
-    r3d_string_format(defNumLights, sizeof(defNumLights), "MAX_LIGHTS_FORWARD %i", R3D_SHADER_LIGHT_FORWARD_UBO_CAP);
 
-    const char* VS_DEFINES[] = {"STAGE_VERT", "FORWARD", defNumLights};
-    const char* FS_DEFINES[] = {"STAGE_FRAG", "FORWARD", defNumLights, defNumIlluminationProbes, defNumReflectionProbes};
+    const char* VS_DEFINES[] = {"STAGE_VERT", "FORWARD"};
+    const char* FS_DEFINES[] = {"STAGE_FRAG", "FORWARD", "LIGHT_GRID", defNumIlluminationProbes, defNumReflectionProbes};
 
     const char* userCode = custom ? custom->program->userCode : NULL;
 
@@ -910,7 +943,7 @@ bool r3d_shader_load_scene_forward(r3d_shader_custom_t* custom)
     DECL_SHADER_SELECT(r3d_shader_scene_forward_t, scene, forward, custom);
     LOAD_SHADER_EX(forward, desc);
 
-    SET_UNIFORM_BUFFER(forward, LightArrayBlock, R3D_SHADER_BLOCK_SLOT_LIGHT_ARRAY);
+    SET_UNIFORM_BUFFER(forward, LightGridBlock, R3D_SHADER_BLOCK_SLOT_LIGHT_GRID);
     SET_UNIFORM_BUFFER(forward, FrameBlock, R3D_SHADER_BLOCK_SLOT_FRAME);
     SET_UNIFORM_BUFFER(forward, ViewBlock, R3D_SHADER_BLOCK_SLOT_VIEW);
     SET_UNIFORM_BUFFER(forward, EnvBlock, R3D_SHADER_BLOCK_SLOT_ENV);
@@ -950,7 +983,10 @@ bool r3d_shader_load_scene_forward(r3d_shader_custom_t* custom)
     SET_SAMPLER(forward, uShadowDirTex, R3D_SHADER_SAMPLER_SHADOW_DIR);
     SET_SAMPLER(forward, uShadowSpotTex, R3D_SHADER_SAMPLER_SHADOW_SPOT);
     SET_SAMPLER(forward, uShadowOmniTex, R3D_SHADER_SAMPLER_SHADOW_OMNI);
+    SET_SAMPLER(forward, uLightDataTex, R3D_SHADER_SAMPLER_LIGHT_DATA);
+    SET_SAMPLER(forward, uLightGridTex, R3D_SHADER_SAMPLER_LIGHT_GRID);
     SET_SAMPLER(forward, uIrradianceTex, R3D_SHADER_SAMPLER_IBL_IRRADIANCE);
+    SET_SAMPLER(forward, uIrradianceSHTex, R3D_SHADER_SAMPLER_IBL_SH);
     SET_SAMPLER(forward, uPrefilterTex, R3D_SHADER_SAMPLER_IBL_PREFILTER);
     SET_SAMPLER(forward, uBrdfLutTex, R3D_SHADER_SAMPLER_IBL_BRDF_LUT);
 
@@ -1150,18 +1186,62 @@ bool r3d_shader_load_scene_depth_cube(r3d_shader_custom_t* custom)
     return true;
 }
 
+bool r3d_shader_load_scene_depth_cube_layered(r3d_shader_custom_t* custom)
+{
+    R3D_UNUSED(custom);
+
+    const char* VS_DEFINES[] = {"STAGE_VERT", "DEPTH_CUBE"};
+    const char* FS_DEFINES[] = {"STAGE_FRAG", "DEPTH_CUBE", "LAYERED"};
+
+    shader_source_desc_t desc = {
+        .vsTemplate    = SCENE_VERT,
+        .vsDefines     = VS_DEFINES,
+        .vsDefineCount = R3D_ARRAY_SIZE(VS_DEFINES),
+        .fsTemplate    = DEPTH_CUBE_FRAG,
+        .fsDefines     = FS_DEFINES,
+        .fsDefineCount = R3D_ARRAY_SIZE(FS_DEFINES),
+        .gsCode        = DEPTH_CUBE_GEOM,
+        .userCode      = NULL,
+    };
+
+    DECL_SHADER(r3d_shader_scene_depth_cube_layered_t, scene, depthCubeLayered);
+    LOAD_SHADER_EX(depthCubeLayered, desc);
+
+    SET_UNIFORM_BUFFER(depthCubeLayered, FrameBlock, R3D_SHADER_BLOCK_SLOT_FRAME);
+
+    GET_LOCATION(depthCubeLayered, uMatModel);
+    GET_LOCATION(depthCubeLayered, uMatInvView);
+    GET_LOCATION(depthCubeLayered, uMatFaceViewProj);
+    GET_LOCATION(depthCubeLayered, uAlbedoColor);
+    GET_LOCATION(depthCubeLayered, uTexCoordOffset);
+    GET_LOCATION(depthCubeLayered, uTexCoordScale);
+    GET_LOCATION(depthCubeLayered, uInstancing);
+    GET_LOCATION(depthCubeLayered, uSkinning);
+    GET_LOCATION(depthCubeLayered, uBillboard);
+    GET_LOCATION(depthCubeLayered, uAlphaCutoff);
+    GET_LOCATION(depthCubeLayered, uViewPosition);
+    GET_LOCATION(depthCubeLayered, uFar);
+    GET_LOCATION(depthCubeLayered, uFaceMask);
+    GET_LOCATION(depthCubeLayered, uLayerBase);
+
+    USE_SHADER(depthCubeLayered);
+
+    SET_SAMPLER(depthCubeLayered, uBoneMatricesTex, R3D_SHADER_SAMPLER_BONE_MATRICES);
+    SET_SAMPLER(depthCubeLayered, uAlbedoMap, R3D_SHADER_SAMPLER_MAP_ALBEDO);
+
+    return true;
+}
+
 bool r3d_shader_load_scene_probe_forward(r3d_shader_custom_t* custom)
 {
     char defNumIlluminationProbes[32] = {0};
     char defNumReflectionProbes[32]   = {0};
-    char defNumLights[32]             = {0};
 
     r3d_string_format(defNumIlluminationProbes, sizeof(defNumIlluminationProbes), "MAX_ILLUMINATION_PROBES %i", R3D_SHADER_PROBE_ILLUMINATION_UBO_CAP);
     r3d_string_format(defNumReflectionProbes, sizeof(defNumReflectionProbes), "MAX_REFLECTION_PROBES %i", R3D_SHADER_PROBE_REFLECTION_UBO_CAP);
-    r3d_string_format(defNumLights, sizeof(defNumLights), "MAX_LIGHTS_FORWARD %i", R3D_SHADER_LIGHT_FORWARD_UBO_CAP);
 
-    const char* VS_DEFINES[] = {"STAGE_VERT", "PROBE", "PROBE_FORWARD", defNumLights};
-    const char* FS_DEFINES[] = {"STAGE_FRAG", "PROBE", "PROBE_FORWARD", defNumLights, defNumIlluminationProbes, defNumReflectionProbes};
+    const char* VS_DEFINES[] = {"STAGE_VERT", "PROBE", "PROBE_FORWARD"};
+    const char* FS_DEFINES[] = {"STAGE_FRAG", "PROBE", "PROBE_FORWARD", "LIGHT_GRID", defNumIlluminationProbes, defNumReflectionProbes};
 
     const char* userCode = custom ? custom->program->userCode : NULL;
 
@@ -1178,7 +1258,7 @@ bool r3d_shader_load_scene_probe_forward(r3d_shader_custom_t* custom)
     DECL_SHADER_SELECT(r3d_shader_scene_probe_forward_t, scene, probeForward, custom);
     LOAD_SHADER_EX(probeForward, desc);
 
-    SET_UNIFORM_BUFFER(probeForward, LightArrayBlock, R3D_SHADER_BLOCK_SLOT_LIGHT_ARRAY);
+    SET_UNIFORM_BUFFER(probeForward, LightGridBlock, R3D_SHADER_BLOCK_SLOT_LIGHT_GRID);
     SET_UNIFORM_BUFFER(probeForward, FrameBlock, R3D_SHADER_BLOCK_SLOT_FRAME);
     SET_UNIFORM_BUFFER(probeForward, ViewBlock, R3D_SHADER_BLOCK_SLOT_VIEW);
     SET_UNIFORM_BUFFER(probeForward, EnvBlock, R3D_SHADER_BLOCK_SLOT_ENV);
@@ -1222,7 +1302,9 @@ bool r3d_shader_load_scene_probe_forward(r3d_shader_custom_t* custom)
     SET_SAMPLER(probeForward, uShadowDirTex, R3D_SHADER_SAMPLER_SHADOW_DIR);
     SET_SAMPLER(probeForward, uShadowSpotTex, R3D_SHADER_SAMPLER_SHADOW_SPOT);
     SET_SAMPLER(probeForward, uShadowOmniTex, R3D_SHADER_SAMPLER_SHADOW_OMNI);
+    SET_SAMPLER(probeForward, uLightDataTex, R3D_SHADER_SAMPLER_LIGHT_DATA);
     SET_SAMPLER(probeForward, uIrradianceTex, R3D_SHADER_SAMPLER_IBL_IRRADIANCE);
+    SET_SAMPLER(probeForward, uIrradianceSHTex, R3D_SHADER_SAMPLER_IBL_SH);
     SET_SAMPLER(probeForward, uPrefilterTex, R3D_SHADER_SAMPLER_IBL_PREFILTER);
     SET_SAMPLER(probeForward, uBrdfLutTex, R3D_SHADER_SAMPLER_IBL_BRDF_LUT);
 
@@ -1389,6 +1471,7 @@ bool r3d_shader_load_deferred_ambient(r3d_shader_custom_t* custom)
     SET_SAMPLER(ambient, uOrmTex, R3D_SHADER_SAMPLER_BUFFER_ORM);
 
     SET_SAMPLER(ambient, uIrradianceTex, R3D_SHADER_SAMPLER_IBL_IRRADIANCE);
+    SET_SAMPLER(ambient, uIrradianceSHTex, R3D_SHADER_SAMPLER_IBL_SH);
     SET_SAMPLER(ambient, uPrefilterTex, R3D_SHADER_SAMPLER_IBL_PREFILTER);
     SET_SAMPLER(ambient, uBrdfLutTex, R3D_SHADER_SAMPLER_IBL_BRDF_LUT);
 
@@ -1399,10 +1482,19 @@ bool r3d_shader_load_deferred_lighting(r3d_shader_custom_t* custom)
 {
     R3D_UNUSED(custom);
 
+    const char* FS_DEFINES[] = {"LIGHT_GRID"};
+
+    shader_source_desc_t desc = {
+        .vsTemplate    = SCREEN_VERT,
+        .fsTemplate    = LIGHTING_FRAG,
+        .fsDefines     = FS_DEFINES,
+        .fsDefineCount = R3D_ARRAY_SIZE(FS_DEFINES),
+    };
+
     DECL_SHADER(r3d_shader_deferred_lighting_t, deferred, lighting);
-    LOAD_SHADER(lighting, SCREEN_VERT, LIGHTING_FRAG);
+    LOAD_SHADER_EX(lighting, desc);
 
-    SET_UNIFORM_BUFFER(lighting, LightBlock, R3D_SHADER_BLOCK_SLOT_LIGHT);
+    SET_UNIFORM_BUFFER(lighting, LightGridBlock, R3D_SHADER_BLOCK_SLOT_LIGHT_GRID);
     SET_UNIFORM_BUFFER(lighting, ViewBlock, R3D_SHADER_BLOCK_SLOT_VIEW);
 
     USE_SHADER(lighting);
@@ -1416,6 +1508,9 @@ bool r3d_shader_load_deferred_lighting(r3d_shader_custom_t* custom)
     SET_SAMPLER(lighting, uShadowSpotTex, R3D_SHADER_SAMPLER_SHADOW_SPOT);
     SET_SAMPLER(lighting, uShadowOmniTex, R3D_SHADER_SAMPLER_SHADOW_OMNI);
 
+    SET_SAMPLER(lighting, uLightDataTex, R3D_SHADER_SAMPLER_LIGHT_DATA);
+    SET_SAMPLER(lighting, uLightGridTex, R3D_SHADER_SAMPLER_LIGHT_GRID);
+
     return true;
 }
 
@@ -1866,6 +1961,7 @@ void r3d_shader_quit(void)
     UNLOAD_SHADERS(prepare.smaaBlendingWeights);
     UNLOAD_SHADER(prepare.cubemapFromEquirectangular);
     UNLOAD_SHADER(prepare.cubemapIrradiance);
+    UNLOAD_SHADER(prepare.cubemapSH);
     UNLOAD_SHADER(prepare.cubemapPrefilter);
     UNLOAD_SHADER(prepare.cubemapProceduralSky);
 
@@ -1876,6 +1972,7 @@ void r3d_shader_quit(void)
     UNLOAD_SHADER(scene.skybox);
     UNLOAD_SHADER(scene.depth);
     UNLOAD_SHADER(scene.depthCube);
+    UNLOAD_SHADER(scene.depthCubeLayered);
     UNLOAD_SHADER(scene.probeForward);
     UNLOAD_SHADER(scene.probeUnlit);
     UNLOAD_SHADER(scene.decal);
@@ -9,6 +9,7 @@
 #ifndef R3D_MODULE_SHADER_H
 #define R3D_MODULE_SHADER_H
 
+#include <r3d/r3d_lighting.h>
 #include <r3d/r3d_core.h>
 #include <r3d_config.h>
 #include <stdalign.h>
@@ -162,6 +163,11 @@ do {
     glUniformMatrix4fv((target)->uniform.loc, 1, GL_TRUE, (float*)&(value));    \
 } while (0)
 
+#define R3D_SHADER__SET_MAT4_V_IMPL(target, uniform, values, count)             \
+do {                                                                            \
+    glUniformMatrix4fv((target)->uniform.loc, (count), GL_TRUE, (float*)(values)); \
+} while (0)
+
 // ----------------------------------------
 // Shader uniform setter macros (INT)
 // ----------------------------------------
@@ -266,6 +272,9 @@ do {
 #define R3D_SHADER_SET_MAT4_SELECT(shader_name, custom, uniform, value) \
     R3D_SHADER__SET_MAT4_IMPL(R3D_SHADER_SELECT(shader_name, custom), uniform, value)
 
+#define R3D_SHADER_SET_MAT4_V(shader_name, uniform, values, count) \
+    R3D_SHADER__SET_MAT4_V_IMPL(R3D_SHADER_BASE(shader_name), uniform, values, count)
+
 // ========================================
 // SAMPLER ENUMS
 // ========================================
@@ -295,6 +304,9 @@ typedef enum {
 
     // Scene miscs
     R3D_SHADER_SAMPLER_BONE_MATRICES        = 16,
+    R3D_SHADER_SAMPLER_LIGHT_DATA           = 17,
+    R3D_SHADER_SAMPLER_LIGHT_GRID           = 18,
+    R3D_SHADER_SAMPLER_IBL_SH               = 19,
 
     // Buffers
     R3D_SHADER_SAMPLER_BUFFER_SCENE         = 20,
@@ -354,6 +366,9 @@ static const GLenum R3D_MOD_SHADER_SAMPLER_TYPES[R3D_SHADER_SAMPLER_COUNT] =
     [R3D_SHADER_SAMPLER_IBL_PREFILTER]          = GL_TEXTURE_CUBE_MAP_ARRAY,
     [R3D_SHADER_SAMPLER_IBL_BRDF_LUT]           = GL_TEXTURE_2D,
     [R3D_SHADER_SAMPLER_BONE_MATRICES]          = GL_TEXTURE_1D,
+    [R3D_SHADER_SAMPLER_LIGHT_DATA]             = GL_TEXTURE_BUFFER,
+    [R3D_SHADER_SAMPLER_LIGHT_GRID]             = GL_TEXTURE_BUFFER,
+    [R3D_SHADER_SAMPLER_IBL_SH]                 = GL_TEXTURE_2D,
     [R3D_SHADER_SAMPLER_BUFFER_SCENE]           = GL_TEXTURE_2D,
     [R3D_SHADER_SAMPLER_BUFFER_ALBEDO]          = GL_TEXTURE_2D,
     [R3D_SHADER_SAMPLER_BUFFER_NORMAL]          = GL_TEXTURE_2D,
@@ -417,7 +432,7 @@ typedef enum {
     R3D_SHADER_BLOCK_ENV,
     R3D_SHADER_BLOCK_FX,
     R3D_SHADER_BLOCK_LIGHT,
-    R3D_SHADER_BLOCK_LIGHT_ARRAY,
+    R3D_SHADER_BLOCK_LIGHT_GRID,
     R3D_SHADER_BLOCK_COUNT,
     R3D_SHADER_BLOCK_USER = R3D_SHADER_BLOCK_COUNT,
     R3D_SHADER_BLOCK_SLOT_COUNT,
@@ -428,7 +443,7 @@ typedef enum {
 #define R3D_SHADER_BLOCK_SLOT_ENV           2
 #define R3D_SHADER_BLOCK_SLOT_FX            3
 #define R3D_SHADER_BLOCK_SLOT_LIGHT         4
-#define R3D_SHADER_BLOCK_SLOT_LIGHT_ARRAY   5
+#define R3D_SHADER_BLOCK_SLOT_LIGHT_GRID    5
 #define R3D_SHADER_BLOCK_SLOT_USER          6
 
 // ========================================
@@ -461,6 +476,7 @@ typedef struct {
     alignas(4) float falloff;
     alignas(4) float range;
     alignas(4) int32_t layer;
+    alignas(4) int32_t harmonics;
 } r3d_shader_block_env_probe_t;
 
 typedef struct {
@@ -579,10 +595,11 @@ typedef struct {
 } r3d_shader_block_fx_t;
 
 typedef struct {
-    alignas(16) Matrix  viewProj;
+    alignas(16) Matrix  viewProj[R3D_SHADOW_CASCADE_MAX];
     alignas(16) Vector3 color;
     alignas(16) Vector3 position;
     alignas(16) Vector3 direction;
+    alignas(16) Vector4 shadowTile;
     alignas(4)  float   energy;
     alignas(4)  float   specular;
     alignas(4)  float   range;
@@ -597,12 +614,16 @@ typedef struct {
     alignas(4)  float   shadowFar;
     alignas(4)  int32_t shadowLayer;
     alignas(4)  int32_t type;
+    alignas(4)  int32_t cascadeCount;
 } r3d_shader_block_light_t;
 
 typedef struct {
-    alignas(16) r3d_shader_block_light_t uLights[R3D_SHADER_LIGHT_FORWARD_UBO_CAP];
-    alignas(4) int32_t uNumLights;
-} r3d_shader_block_light_array_t;
+    alignas(16) int32_t uLightGridSize[3];
+    alignas(8)  Vector2 uLightGridDepth;
+    alignas(4)  int32_t uNumDirLights;
+    alignas(4)  int32_t uNumLights;
+    alignas(4)  int32_t uLightShadows;
+} r3d_shader_block_light_grid_t;
 
 // ========================================
 // UNIFORM BLOCK SIZES AND SLOTS
@@ -614,7 +635,7 @@ static const int R3D_SHADER_BLOCK_SIZES[R3D_SHADER_BLOCK_COUNT] = {
     [R3D_SHADER_BLOCK_ENV]         = sizeof(r3d_shader_block_env_t),
     [R3D_SHADER_BLOCK_FX]          = sizeof(r3d_shader_block_fx_t),
     [R3D_SHADER_BLOCK_LIGHT]       = sizeof(r3d_shader_block_light_t),
-    [R3D_SHADER_BLOCK_LIGHT_ARRAY] = sizeof(r3d_shader_block_light_array_t),
+    [R3D_SHADER_BLOCK_LIGHT_GRID]  = sizeof(r3d_shader_block_light_grid_t),
 };
 
 static const int R3D_SHADER_BLOCK_SLOTS[R3D_SHADER_BLOCK_COUNT] = {
@@ -623,7 +644,7 @@ static const int R3D_SHADER_BLOCK_SLOTS[R3D_SHADER_BLOCK_COUNT] = {
     [R3D_SHADER_BLOCK_ENV]         = R3D_SHADER_BLOCK_SLOT_ENV,
     [R3D_SHADER_BLOCK_FX]          = R3D_SHADER_BLOCK_SLOT_FX,
     [R3D_SHADER_BLOCK_LIGHT]       = R3D_SHADER_BLOCK_SLOT_LIGHT,
-    [R3D_SHADER_BLOCK_LIGHT_ARRAY] = R3D_SHADER_BLOCK_SLOT_LIGHT_ARRAY,
+    [R3D_SHADER_BLOCK_LIGHT_GRID]  = R3D_SHADER_BLOCK_SLOT_LIGHT_GRID,
 };
 
 // ========================================
@@ -774,6 +795,13 @@ typedef struct {
     r3d_shader_uniform_sampler_t uSourceTex;
 } r3d_shader_prepare_cubemap_irradiance_t;
 
+typedef struct {
+    GLuint id;
+    r3d_shader_uniform_sampler_t uSourceTex;
+    r3d_shader_uniform_int_t uSourceFaceSize;
+    r3d_shader_uniform_float_t uSourceLod;
+} r3d_shader_prepare_cubemap_sh_t;
+
 typedef struct {
     GLuint id;
     r3d_shader_uniform_mat4_t uMatProj;
@@ -854,7 +882,10 @@ typedef struct {
     r3d_shader_uniform_sampler_t uShadowDirTex;
     r3d_shader_uniform_sampler_t uShadowSpotTex;
     r3d_shader_uniform_sampler_t uShadowOmniTex;
+    r3d_shader_uniform_sampler_t uLightDataTex;
+    r3d_shader_uniform_sampler_t uLightGridTex;
     r3d_shader_uniform_sampler_t uIrradianceTex;
+    r3d_shader_uniform_sampler_t uIrradianceSHTex;
     r3d_shader_uniform_sampler_t uPrefilterTex;
     r3d_shader_uniform_sampler_t uBrdfLutTex;
     r3d_shader_uniform_float_t uAlphaCutoff;
@@ -917,6 +948,26 @@ typedef struct {
     r3d_shader_uniform_float_t uFar;
 } r3d_shader_scene_depth_cube_t;
 
+typedef struct {
+    GLuint id;
+    r3d_shader_uniform_sampler_t uBoneMatricesTex;
+    r3d_shader_uniform_mat4_t uMatModel;
+    r3d_shader_uniform_mat4_t uMatInvView;
+    r3d_shader_uniform_mat4_t uMatFaceViewProj;     //< Array of six matrices, one per cube face
+    r3d_shader_uniform_col4_t uAlbedoColor;
+    r3d_shader_uniform_vec2_t uTexCoordOffset;
+    r3d_shader_uniform_vec2_t uTexCoordScale;
+    r3d_shader_uniform_int_t uInstancing;
+    r3d_shader_uniform_int_t uSkinning;
+    r3d_shader_uniform_int_t uBillboard;
+    r3d_shader_uniform_sampler_t uAlbedoMap;
+    r3d_shader_uniform_float_t uAlphaCutoff;
+    r3d_shader_uniform_vec3_t uViewPosition;
+    r3d_shader_uniform_float_t uFar;
+    r3d_shader_uniform_int_t uFaceMask;
+    r3d_shader_uniform_int_t uLayerBase;
+} r3d_shader_scene_depth_cube_layered_t;
+
 typedef struct {
     GLuint id;
     r3d_shader_uniform_sampler_t uBoneMatricesTex;
@@ -940,7 +991,9 @@ typedef struct {
     r3d_shader_uniform_sampler_t uShadowDirTex;
     r3d_shader_uniform_sampler_t uShadowSpotTex;
     r3d_shader_uniform_sampler_t uShadowOmniTex;
+    r3d_shader_uniform_sampler_t uLightDataTex;
     r3d_shader_uniform_sampler_t uIrradianceTex;
+    r3d_shader_uniform_sampler_t uIrradianceSHTex;
     r3d_shader_uniform_sampler_t uPrefilterTex;
     r3d_shader_uniform_sampler_t uBrdfLutTex;
     r3d_shader_uniform_float_t uAlphaCutoff;
@@ -1025,6 +1078,7 @@ typedef struct {
     r3d_shader_uniform_sampler_t uSsgiTex;
     r3d_shader_uniform_sampler_t uOrmTex;
     r3d_shader_uniform_sampler_t uIrradianceTex;
+    r3d_shader_uniform_sampler_t uIrradianceSHTex;
     r3d_shader_uniform_sampler_t uPrefilterTex;
     r3d_shader_uniform_sampler_t uBrdfLutTex;
 } r3d_shader_deferred_ambient_t;
@@ -1038,6 +1092,8 @@ typedef struct {
     r3d_shader_uniform_sampler_t uShadowDirTex;
     r3d_shader_uniform_sampler_t uShadowSpotTex;
     r3d_shader_uniform_sampler_t uShadowOmniTex;
+    r3d_shader_uniform_sampler_t uLightDataTex;
+    r3d_shader_uniform_sampler_t uLightGridTex;
 } r3d_shader_deferred_lighting_t;
 
 typedef struct {
@@ -1245,6 +1301,7 @@ extern struct r3d_mod_shader {
         r3d_shader_prepare_smaa_blending_weights_t smaaBlendingWeights[R3D_ANTI_ALIASING_PRESET_COUNT];
         r3d_shader_prepare_cubemap_from_equirectangular_t cubemapFromEquirectangular;
         r3d_shader_prepare_cubemap_irradiance_t cubemapIrradiance;
+        r3d_shader_prepare_cubemap_sh_t cubemapSH;
         r3d_shader_prepare_cubemap_prefilter_t cubemapPrefilter;
         r3d_shader_prepare_cubemap_procedural_sky_t cubemapProceduralSky;
     } prepare;
@@ -1258,6 +1315,7 @@ extern struct r3d_mod_shader {
         r3d_shader_scene_skybox_t skybox;
         r3d_shader_scene_depth_t depth;
         r3d_shader_scene_depth_cube_t depthCube;
+        r3d_shader_scene_depth_cube_layered_t depthCubeLayered;
         r3d_shader_scene_probe_forward_t probeForward;
         r3d_shader_scene_probe_unlit_t probeUnlit;
         r3d_shader_scene_decal_t decal;
@@ -1331,6 +1389,7 @@ bool r3d_shader_load_prepare_smaa_blending_weights_high(r3d_shader_custom_t* cus
 bool r3d_shader_load_prepare_smaa_blending_weights_ultra(r3d_shader_custom_t* custom);
 bool r3d_shader_load_prepare_cubemap_from_equirectangular(r3d_shader_custom_t* custom);
 bool r3d_shader_load_prepare_cubemap_irradiance(r3d_shader_custom_t* custom);
+bool r3d_shader_load_prepare_cubemap_sh(r3d_shader_custom_t* custom);
 bool r3d_shader_load_prepare_cubemap_prefilter(r3d_shader_custom_t* custom);
 bool r3d_shader_load_prepare_cubemap_procedural_sky(r3d_shader_custom_t* custom);
 bool r3d_shader_load_prepare_cubemap_custom_sky(r3d_shader_custom_t* custom);
@@ -1341,6 +1400,7 @@ bool r3d_shader_load_scene_background(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_skybox(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_depth(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_depth_cube(r3d_shader_custom_t* custom);
+bool r3d_shader_load_scene_depth_cube_layered(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_probe_forward(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_probe_unlit(r3d_shader_custom_t* custom);
 bool r3d_shader_load_scene_decal(r3d_shader_custom_t* custom);
@@ -1399,6 +1459,7 @@ static const struct r3d_shader_loader {
         r3d_shader_loader_func smaaBlendingWeights[R3D_ANTI_ALIASING_PRESET_COUNT];
         r3d_shader_loader_func cubemapFromEquirectangular;
         r3d_shader_loader_func cubemapIrradiance;
+        r3d_shader_loader_func cubemapSH;
         r3d_shader_loader_func cubemapPrefilter;
         r3d_shader_loader_func cubemapProceduralSky;
         r3d_shader_loader_func cubemapCustomSky;
@@ -1413,6 +1474,7 @@ static const struct r3d_shader_loader {
         r3d_shader_loader_func skybox;
         r3d_shader_loader_func depth;
         r3d_shader_loader_func depthCube;
+        r3d_shader_loader_func depthCubeLayered;
         r3d_shader_loader_func probeForward;
         r3d_shader_loader_func probeUnlit;
         r3d_shader_loader_func decal;
@@ -1482,6 +1544,7 @@ static const struct r3d_shader_loader {
         .smaaBlendingWeights[3] = r3d_shader_load_prepare_smaa_blending_weights_ultra,
         .cubemapFromEquirectangular = r3d_shader_load_prepare_cubemap_from_equirectangular,
         .cubemapIrradiance = r3d_shader_load_prepare_cubemap_irradiance,
+        .cubemapSH = r3d_shader_load_prepare_cubemap_sh,
         .cubemapPrefilter = r3d_shader_load_prepare_cubemap_prefilter,
         .cubemapProceduralSky = r3d_shader_load_prepare_cubemap_procedural_sky,
         .cubemapCustomSky = r3d_shader_load_prepare_cubemap_custom_sky,
@@ -1495,6 +1558,7 @@ static const struct r3d_shader_loader {
         .skybox = r3d_shader_load_scene_skybox,
         .depth = r3d_shader_load_scene_depth,
         .depthCube = r3d_shader_load_scene_depth_cube,
+        .depthCubeLayered = r3d_shader_load_scene_depth_cube_layered,
         .probeForward = r3d_shader_load_scene_probe_forward,
         .probeUnlit = r3d_shader_load_scene_probe_unlit,
         .decal = r3d_shader_load_scene_decal,
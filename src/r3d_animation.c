@@ -116,6 +116,7 @@ void R3D_UnloadAnimationLib(R3D_AnimationLib animLib)
         }
 
         r3d_free(anim->channels);
+        r3d_free(anim->boneChannels);
     }
 
     r3d_free(animLib.animations);
@@ -12,6 +12,7 @@
 #include <glad.h>
 
 #include "./common/r3d_helper.h"
+#include "./common/r3d_anim_pose.h"
 #include "./common/r3d_anim.h"
 
 // ========================================
@@ -40,6 +41,14 @@ R3D_AnimationPlayer R3D_LoadAnimationPlayer(R3D_Skeleton skeleton, R3D_Animation
     player.modelPose  = r3d_malloc(skeleton.boneCount * sizeof(*player.modelPose));
     player.skinBuffer = r3d_malloc(skeleton.boneCount * sizeof(*player.skinBuffer));
 
+    // Keyframe cursors, sized for the largest animation and shared by all of them:
+    // a cursor is only a hint and is validated against the keys before being used
+    int cursorCount = R3D_ANIM_CURSORS_PER_CHANNEL * r3d_anim_max_channel_count(animLib);
+    player.keyCursors = r3d_malloc(R3D_MAX(cursorCount, 1) * sizeof(*player.keyCursors));
+
+    // Sampled pose in structure-of-arrays form, converted to matrices in batches
+    player.poseStreams = r3d_malloc(r3d_anim_pose_buffer_size(skeleton.boneCount) * sizeof(*player.poseStreams));
+
     // Initialize animation states
     for (int i = 0; i < animLib.count; i++)
     {
@@ -79,6 +88,8 @@ void R3D_UnloadAnimationPlayer(R3D_AnimationPlayer player)
         glDeleteTextures(1, &player.skinTexture);
     }
 
+    r3d_free(player.poseStreams);
+    r3d_free(player.keyCursors);
     r3d_free(player.skinBuffer);
     r3d_free(player.modelPose);
     r3d_free(player.localPose);
@@ -308,15 +319,24 @@ void compute_local_matrices(R3D_AnimationPlayer* player)
     int boneCount = player->skeleton.boneCount;
     Matrix* localPose = player->localPose;
 
+    r3d_anim_pose_t pose = r3d_anim_pose_view(player->poseStreams, boneCount);
+
     for (int iBone = 0; iBone < boneCount; iBone++)
     {
         const R3D_AnimationChannel* channel = r3d_anim_channel_find(anim, iBone);
-        if (channel == NULL)
+        if (channel == NULL) continue;
+        uint32_t* cursors = &player->keyCursors[R3D_ANIM_CURSORS_PER_CHANNEL * (channel - anim->channels)];
+        r3d_anim_pose_set(&pose, iBone, r3d_anim_channel_lerp(channel, tick, NULL, NULL, cursors));
+    }
+
+    r3d_anim_pose_to_matrices(localPose, &pose);
+
+    // Bones without channel keep their bind pose, the streams are left as is for them
+    for (int iBone = 0; iBone < boneCount; iBone++)
+    {
+        if (r3d_anim_channel_find(anim, iBone) == NULL)
         {
             localPose[iBone] = player->skeleton.localBind[iBone];
-            continue;
         }
-        Transform local = r3d_anim_channel_lerp(channel, tick, NULL, NULL);
-        localPose[iBone] = r3d_matrix_srt_quat(local.scale, QuaternionNormalize(local.rotation), local.translation);
     }
 }
@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "./common/r3d_helper.h"
+#include "./common/r3d_anim_pose.h"
 #include "./common/r3d_anim.h"
 
 // ========================================
@@ -80,6 +81,7 @@ struct r3d_animtree_anim {
     r3d_animtree_type_t type;
     const R3D_Animation* animation;
     R3D_AnimationNodeParams params;
+    uint32_t* keyCursors;
     struct {
         Transform last;
         Transform rest0;
@@ -160,8 +162,8 @@ typedef struct {
 static bool anode_update(const R3D_AnimationTree* atree, R3D_AnimationTreeNode anode,
                          float elapsedTime, upinfo_t* info);
 
-static bool anode_eval(const R3D_AnimationTree* atree, R3D_AnimationTreeNode anode,
-                       int boneIdx, Transform* out, rminfo_t* info);
+static bool anode_eval(R3D_AnimationTree* atree, R3D_AnimationTreeNode anode,
+                       r3d_anim_pose_t* out, rminfo_t* info);
 
 static void anode_reset(R3D_AnimationTreeNode anode);
 
@@ -169,14 +171,14 @@ static void anode_reset(R3D_AnimationTreeNode anode);
 // BONE FUNCTIONS
 // ========================================
 
-static bool is_root_bone(const R3D_AnimationTree* atree, int boneIdx)
+static bool valid_root_bone(int boneIdx)
 {
-    return atree->rootBone == boneIdx;
+    return boneIdx >= 0;
 }
 
-static bool valid_root_bone(int boneIdx)
+static bool has_root_bone(const R3D_AnimationTree* atree)
 {
-    return boneIdx >= 0;
+    return valid_root_bone(atree->rootBone) && atree->rootBone < atree->player.skeleton.boneCount;
 }
 
 static bool masked_bone(const R3D_BoneMask* bMask, int boneIdx)
@@ -188,6 +190,38 @@ static bool masked_bone(const R3D_BoneMask* bMask, int boneIdx)
     return (bMask->mask[part] & (1 << bit)) != 0;
 }
 
+// ========================================
+// POSE POOL FUNCTIONS
+// ========================================
+
+static bool pose_acquire(R3D_AnimationTree* atree, r3d_anim_pose_t* pose)
+{
+    // Each node holds at most one scratch pose while evaluating an input,
+    // so the depth never exceeds the node count plus the tree output
+    int depth = atree->posePoolDepth;
+    if (depth > atree->nodePoolMaxSize)
+    {
+        R3D_TRACELOG(LOG_WARNING, "Failed to acquire scratch pose: pool exhausted (%d)", depth);
+        return false;
+    }
+
+    int boneCount = atree->player.skeleton.boneCount;
+    if (!atree->posePool[depth])
+    {
+        atree->posePool[depth] = r3d_malloc(r3d_anim_pose_buffer_size(boneCount) * sizeof(float));
+    }
+
+    atree->posePoolDepth += 1;
+    *pose = r3d_anim_pose_view(atree->posePool[depth], boneCount);
+
+    return true;
+}
+
+static void pose_release(R3D_AnimationTree* atree)
+{
+    atree->posePoolDepth -= 1;
+}
+
 // ========================================
 // ANIMATION STATE MACHINE
 // ========================================
@@ -732,101 +766,113 @@ static bool anode_update(const R3D_AnimationTree* atree, R3D_AnimationTreeNode a
 // TREE NODE EVAL FUNCTIONS
 // ========================================
 
-static bool anode_eval_anim(const R3D_AnimationTree* atree, r3d_animtree_anim_t* node,
-                            int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_anim(R3D_AnimationTree* atree, r3d_animtree_anim_t* node,
+                            r3d_anim_pose_t* out, rminfo_t* info)
 {
     const R3D_Animation* anim = node->animation;
     const R3D_AnimationState state = node->params.state;
-    const R3D_AnimationChannel* channel = r3d_anim_channel_find(anim, boneIdx);
+    const int boneCount = atree->player.skeleton.boneCount;
+    const float time = state.currentTime * anim->ticksPerSecond;
 
-    if (channel)
-    {
-        *out = r3d_anim_channel_lerp(channel, state.currentTime * anim->ticksPerSecond, NULL, NULL);
-    }
-    else
+    for (int boneIdx = 0; boneIdx < boneCount; boneIdx++)
     {
-        MatrixDecompose(atree->player.skeleton.localBind[boneIdx], &out->translation, &out->rotation, &out->scale);
+        const R3D_AnimationChannel* channel = r3d_anim_channel_find(anim, boneIdx);
+        Transform tf;
+
+        if (channel)
+        {
+            uint32_t* cursors = &node->keyCursors[R3D_ANIM_CURSORS_PER_CHANNEL * (channel - anim->channels)];
+            tf = r3d_anim_channel_lerp(channel, time, NULL, NULL, cursors);
+        }
+        else
+        {
+            MatrixDecompose(atree->player.skeleton.localBind[boneIdx], &tf.translation, &tf.rotation, &tf.scale);
+        }
+
+        if (node->params.evalCallback)
+        {
+            node->params.evalCallback(anim, state, boneIdx, &tf, node->params.evalUserData);
+        }
+
+        r3d_anim_pose_set(out, boneIdx, tf);
     }
 
-    if (node->params.evalCallback)
+    if (!has_root_bone(atree) || !r3d_anim_channel_find(anim, atree->rootBone))
     {
-        node->params.evalCallback(anim, state, boneIdx, out, node->params.evalUserData);
+        return true;
     }
 
-    if (channel && is_root_bone(atree, boneIdx))
-    {
-        if (info)
-        {
-            Transform motion = {0};
-            const int loops = node->root.loops;
+    const Transform root = r3d_anim_pose_get(out, atree->rootBone);
 
-            if (loops > 0)
-            {
-                motion = r3d_anim_transform_scale(
-                    r3d_anim_transform_subtr(node->root.restN, node->root.rest0),
-                    (float)loops
-                );
-            }
+    if (info)
+    {
+        Transform motion = {0};
+        const int loops = node->root.loops;
 
-            if (loops >= 0)
-            {
-                const bool forward = state.speed > 0.0f;
-                const Transform rest0 = forward ? node->root.rest0 : node->root.restN;
-                const Transform restN = forward ? node->root.restN : node->root.rest0;
-                const Transform split = r3d_anim_transform_add(
-                    r3d_anim_transform_subtr(restN, node->root.last),
-                    r3d_anim_transform_subtr(*out, rest0)
-                );
-                motion = r3d_anim_transform_add(motion, split);
-                motion.rotation = QuaternionNormalize(motion.rotation);
-                info->motion = motion;
-            }
-            else
-            {
-                info->motion = r3d_anim_transform_subtr(*out, node->root.last);
-            }
+        if (loops > 0)
+        {
+            motion = r3d_anim_transform_scale(
+                r3d_anim_transform_subtr(node->root.restN, node->root.rest0),
+                (float)loops
+            );
+        }
 
-            info->distance = r3d_anim_transform_subtr(*out, node->root.rest0);
+        if (loops >= 0)
+        {
+            const bool forward = state.speed > 0.0f;
+            const Transform rest0 = forward ? node->root.rest0 : node->root.restN;
+            const Transform restN = forward ? node->root.restN : node->root.rest0;
+            const Transform split = r3d_anim_transform_add(
+                r3d_anim_transform_subtr(restN, node->root.last),
+                r3d_anim_transform_subtr(root, rest0)
+            );
+            motion = r3d_anim_transform_add(motion, split);
+            motion.rotation = QuaternionNormalize(motion.rotation);
+            info->motion = motion;
+        }
+        else
+        {
+            info->motion = r3d_anim_transform_subtr(root, node->root.last);
         }
 
-        node->root.last = *out;
+        info->distance = r3d_anim_transform_subtr(root, node->root.rest0);
     }
 
+    node->root.last = root;
+
     return true;
 }
 
-static bool anode_eval_blend2(const R3D_AnimationTree* atree, r3d_animtree_blend2_t* node,
-                              int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_blend2(R3D_AnimationTree* atree, r3d_animtree_blend2_t* node,
+                              r3d_anim_pose_t* out, rminfo_t* info)
 {
     const R3D_BoneMask* bmask = node->params.boneMask;
-    const bool doBlend = !bmask || masked_bone(bmask, boneIdx);
-    const bool isRm = info && is_root_bone(atree, boneIdx);
 
     rminfo_t rm[2] = {0};
-    Transform in[2] = {0};
 
-    bool success = anode_eval(atree, node->inMain, boneIdx, &in[0], isRm ? &rm[0] : NULL);
+    bool success = anode_eval(atree, node->inMain, out, info ? &rm[0] : NULL);
     if (!success)
     {
         R3D_TRACELOG(LOG_WARNING, "Failed to eval blend2 node");
         return false;
     }
 
-    if (doBlend)
+    r3d_anim_pose_t in;
+    success = pose_acquire(atree, &in) && anode_eval(atree, node->inBlend, &in, info ? &rm[1] : NULL);
+    if (!success)
     {
-        success = anode_eval(atree, node->inBlend, boneIdx, &in[1], isRm ? &rm[1] : NULL);
-        if (!success)
-        {
-            R3D_TRACELOG(LOG_WARNING, "Failed to eval blend2 node");
-            return false;
-        }
+        R3D_TRACELOG(LOG_WARNING, "Failed to eval blend2 node");
+        return false;
     }
 
     const float w = R3D_CLAMP(node->params.blend, 0.0f, 1.0f);
-    *out = doBlend ? r3d_anim_transform_lerp(in[0], in[1], w) : in[0];
+    r3d_anim_pose_blend(out, out, &in, w, bmask ? bmask->mask : NULL);
+
+    pose_release(atree);
 
-    if (isRm)
+    if (info)
     {
+        const bool doBlend = !bmask || (has_root_bone(atree) && masked_bone(bmask, atree->rootBone));
         *info = doBlend ? (rminfo_t) {
             .motion = r3d_anim_transform_lerp(rm[0].motion, rm[1].motion, w),
             .distance = r3d_anim_transform_lerp(rm[0].distance, rm[1].distance, w)
@@ -836,38 +882,36 @@ static bool anode_eval_blend2(const R3D_AnimationTree* atree, r3d_animtree_blend
     return true;
 }
 
-static bool anode_eval_add2(const R3D_AnimationTree* atree, r3d_animtree_add2_t* node,
-                            int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_add2(R3D_AnimationTree* atree, r3d_animtree_add2_t* node,
+                            r3d_anim_pose_t* out, rminfo_t* info)
 {
     const R3D_BoneMask* bmask = node->params.boneMask;
-    const bool doAdd = !bmask || masked_bone(bmask, boneIdx);
-    const bool isRm = info && is_root_bone(atree, boneIdx);
 
     rminfo_t rm[2] = {0};
-    Transform in[2] = {0};
 
-    bool success = anode_eval(atree, node->inMain, boneIdx, &in[0], isRm ? &rm[0] : NULL);
+    bool success = anode_eval(atree, node->inMain, out, info ? &rm[0] : NULL);
     if (!success)
     {
         R3D_TRACELOG(LOG_WARNING, "Failed to eval add2 node");
         return false;
     }
 
-    if (doAdd)
+    r3d_anim_pose_t in;
+    success = pose_acquire(atree, &in) && anode_eval(atree, node->inAdd, &in, info ? &rm[1] : NULL);
+    if (!success)
     {
-        success = anode_eval(atree, node->inAdd, boneIdx, &in[1], isRm ? &rm[1] : NULL);
-        if (!success)
-        {
-            R3D_TRACELOG(LOG_WARNING, "Failed to eval add2 node");
-            return false;
-        }
+        R3D_TRACELOG(LOG_WARNING, "Failed to eval add2 node");
+        return false;
     }
 
     const float w = R3D_CLAMP(node->params.weight, 0.0f, 1.0f);
-    *out = doAdd ? r3d_anim_transform_add_v(in[0], in[1], w) : in[0];
+    r3d_anim_pose_add(out, out, &in, w, bmask ? bmask->mask : NULL);
+
+    pose_release(atree);
 
-    if (isRm)
+    if (info)
     {
+        const bool doAdd = !bmask || (has_root_bone(atree) && masked_bone(bmask, atree->rootBone));
         *info = doAdd ? (rminfo_t) {
             .motion = r3d_anim_transform_lerp(rm[0].motion, rm[1].motion, w),
             .distance = r3d_anim_transform_lerp(rm[0].distance, rm[1].distance, w)
@@ -877,14 +921,16 @@ static bool anode_eval_add2(const R3D_AnimationTree* atree, r3d_animtree_add2_t*
     return true;
 }
 
-static bool anode_eval_switch(const R3D_AnimationTree* atree, r3d_animtree_switch_t* node,
-                              int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_switch(R3D_AnimationTree* atree, r3d_animtree_switch_t* node,
+                              r3d_anim_pose_t* out, rminfo_t* info)
 {
-    const bool isRm = info && is_root_bone(atree, boneIdx);
     const float wInvSum = node->weightsInvSum;
 
     rminfo_t rm = {0};
-    Transform result = {0};
+    r3d_anim_pose_zero(out);
+
+    r3d_anim_pose_t in;
+    if (!pose_acquire(atree, &in)) return false;
 
     for (int i = 0; i < node->inCount; i++)
     {
@@ -892,40 +938,38 @@ static bool anode_eval_switch(const R3D_AnimationTree* atree, r3d_animtree_switc
         if (FloatEquals(w, 0.0f)) continue;
 
         rminfo_t inRm = {0};
-        Transform inTr = {0};
 
-        bool success = anode_eval(atree, node->inList[i], boneIdx, &inTr, isRm ? &inRm : NULL);
+        bool success = anode_eval(atree, node->inList[i], &in, info ? &inRm : NULL);
         if (!success)
         {
             R3D_TRACELOG(LOG_WARNING, "Failed to eval switch node: input %d failed", i);
             return false;
         }
 
-        result = r3d_anim_transform_addx_v(result, inTr, w);
+        r3d_anim_pose_accumulate(out, &in, w);
 
-        if (isRm)
+        if (info)
         {
             rm.motion = r3d_anim_transform_addx_v(rm.motion, inRm.motion, w);
             rm.distance = r3d_anim_transform_addx_v(rm.distance, inRm.distance, w);
         }
     }
 
-    *out = result;
-    if (isRm) *info = rm;
+    pose_release(atree);
+
+    if (info) *info = rm;
 
     return true;
 }
 
-static bool anode_eval_stm(const R3D_AnimationTree* atree, r3d_animtree_stm_t* node,
-                           int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_stm(R3D_AnimationTree* atree, r3d_animtree_stm_t* node,
+                           r3d_anim_pose_t* out, rminfo_t* info)
 {
     const R3D_AnimationStmIndex activeIdx = node->activeIdx;
-    const bool isRm = info && is_root_bone(atree, boneIdx);
 
     rminfo_t activeRm = {0};
-    Transform activeTr = {0};
 
-    bool success = anode_eval(atree, node->nodeList[activeIdx], boneIdx, &activeTr, isRm ? &activeRm : NULL);
+    bool success = anode_eval(atree, node->nodeList[activeIdx], out, info ? &activeRm : NULL);
     if (!success)
     {
         R3D_TRACELOG(LOG_WARNING, "Failed to eval stm state %d", activeIdx);
@@ -936,15 +980,14 @@ static bool anode_eval_stm(const R3D_AnimationTree* atree, r3d_animtree_stm_t* n
 
     if (!edge)
     {
-        *out = activeTr;
-        if (isRm) *info = activeRm;
+        if (info) *info = activeRm;
         return true;
     }
 
-    rminfo_t  edgeRm = {0};
-    Transform edgeTr = {0};
+    rminfo_t edgeRm = {0};
 
-    success = anode_eval(atree, node->nodeList[edge->beginIdx], boneIdx, &edgeTr, isRm ? &edgeRm : NULL);
+    r3d_anim_pose_t in;
+    success = pose_acquire(atree, &in) && anode_eval(atree, node->nodeList[edge->beginIdx], &in, info ? &edgeRm : NULL);
     if (!success)
     {
         R3D_TRACELOG(LOG_WARNING, "Failed to eval stm state %d", edge->beginIdx);
@@ -952,9 +995,11 @@ static bool anode_eval_stm(const R3D_AnimationTree* atree, r3d_animtree_stm_t* n
     }
 
     const float endWeight = R3D_CLAMP(edge->endWeight, 0.0f, 1.0f);
-    *out = r3d_anim_transform_lerp(edgeTr, activeTr, endWeight);
+    r3d_anim_pose_blend(out, &in, out, endWeight, NULL);
+
+    pose_release(atree);
 
-    if (isRm)
+    if (info)
     {
         *info = (rminfo_t) {
             .motion = r3d_anim_transform_lerp(edgeRm.motion, activeRm.motion, endWeight),
@@ -965,23 +1010,23 @@ static bool anode_eval_stm(const R3D_AnimationTree* atree, r3d_animtree_stm_t* n
     return true;
 }
 
-static bool anode_eval_stm_x(const R3D_AnimationTree* atree, r3d_animtree_stm_x_t* node,
-                             int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval_stm_x(R3D_AnimationTree* atree, r3d_animtree_stm_x_t* node,
+                             r3d_anim_pose_t* out, rminfo_t* info)
 {
-    return anode_eval(atree, node->nested, boneIdx, out, info);
+    return anode_eval(atree, node->nested, out, info);
 }
 
-static bool anode_eval(const R3D_AnimationTree* atree, R3D_AnimationTreeNode anode,
-                       int boneIdx, Transform* out, rminfo_t* info)
+static bool anode_eval(R3D_AnimationTree* atree, R3D_AnimationTreeNode anode,
+                       r3d_anim_pose_t* out, rminfo_t* info)
 {
     switch(anode.base->type)
     {
-    case R3D_ANIMTREE_ANIM:   return anode_eval_anim(atree, anode.anim, boneIdx, out, info);
-    case R3D_ANIMTREE_BLEND2: return anode_eval_blend2(atree, anode.bln2, boneIdx, out, info);
-    case R3D_ANIMTREE_ADD2:   return anode_eval_add2(atree, anode.add2, boneIdx, out, info);
-    case R3D_ANIMTREE_SWITCH: return anode_eval_switch(atree, anode.swch, boneIdx, out, info);
-    case R3D_ANIMTREE_STM:    return anode_eval_stm(atree, anode.stm, boneIdx, out, info);
-    case R3D_ANIMTREE_STM_X:  return anode_eval_stm_x(atree, anode.stmx, boneIdx, out, info);
+    case R3D_ANIMTREE_ANIM:   return anode_eval_anim(atree, anode.anim, out, info);
+    case R3D_ANIMTREE_BLEND2: return anode_eval_blend2(atree, anode.bln2, out, info);
+    case R3D_ANIMTREE_ADD2:   return anode_eval_add2(atree, anode.add2, out, info);
+    case R3D_ANIMTREE_SWITCH: return anode_eval_switch(atree, anode.swch, out, info);
+    case R3D_ANIMTREE_STM:    return anode_eval_stm(atree, anode.stm, out, info);
+    case R3D_ANIMTREE_STM_X:  return anode_eval_stm_x(atree, anode.stmx, out, info);
     default:
         R3D_TRACELOG(LOG_WARNING, "Failed to eval animation tree: invalid node type %d", anode.base->type);
         break;
@@ -1043,6 +1088,7 @@ static R3D_AnimationTreeNode* atree_anim_create(R3D_AnimationTree* atree, R3D_An
     r3d_animtree_anim_t* anim = anode->anim;
     anim->animation = a;
     anim->params = params;
+    anim->keyCursors = r3d_malloc(R3D_MAX(R3D_ANIM_CURSORS_PER_CHANNEL * a->channelCount, 1) * sizeof(uint32_t));
     if (reset) anode_reset_anim(anim);
 
     int boneIdx = atree->rootBone;
@@ -1054,7 +1100,7 @@ static R3D_AnimationTreeNode* atree_anim_create(R3D_AnimationTree* atree, R3D_An
         {
             anim->root.last = r3d_anim_channel_lerp(
                 c, s->currentTime * a->ticksPerSecond,
-                &anim->root.rest0, &anim->root.restN
+                &anim->root.rest0, &anim->root.restN, NULL
             );
         }
         else
@@ -1195,6 +1241,8 @@ static void atree_delete(R3D_AnimationTreeNode anode)
     switch(anode.base->type)
     {
     case R3D_ANIMTREE_ANIM:
+        r3d_free(anode.anim->keyCursors);
+        return;
     case R3D_ANIMTREE_BLEND2:
     case R3D_ANIMTREE_ADD2:
     case R3D_ANIMTREE_STM_X:
@@ -1237,30 +1285,42 @@ static void atree_update(R3D_AnimationTree* atree, float elapsedTime,
     bool success = anode_update(atree, *atree->rootNode, elapsedTime, NULL);
     if (!success) goto failure;
 
-    for (int boneIdx = 0; boneIdx < boneCount; boneIdx++)
-    {
-        const bool isRootBone = is_root_bone(atree, boneIdx);
-        rminfo_t rmInfo = {0};
-        Transform out = {0};
+    /* --- Evaluate the whole pose, node by node --- */
 
-        success = anode_eval(atree, *atree->rootNode, boneIdx, &out, isRootBone ? &rmInfo : NULL);
-        if (!success) goto failure;
+    // Reset the pool in case a previous evaluation bailed out mid-tree
+    atree->posePoolDepth = 0;
 
-        if (isRootBone)
-        {
-            if (rootMotion) *rootMotion = rmInfo.motion;
-            if (rootDistance) *rootDistance = rmInfo.distance;
-            out = r3d_anim_transform_subtr(out, rmInfo.distance);
-        }
+    const bool hasRootBone = has_root_bone(atree);
+    rminfo_t rmInfo = {0};
+
+    r3d_anim_pose_t pose;
+    success = pose_acquire(atree, &pose) && anode_eval(atree, *atree->rootNode, &pose, hasRootBone ? &rmInfo : NULL);
+    if (!success) goto failure;
+
+    pose_release(atree);
+
+    /* --- Extract root motion and output local matrices --- */
+
+    if (hasRootBone)
+    {
+        if (rootMotion) *rootMotion = rmInfo.motion;
+        if (rootDistance) *rootDistance = rmInfo.distance;
+        Transform root = r3d_anim_pose_get(&pose, atree->rootBone);
+        r3d_anim_pose_set(&pose, atree->rootBone, r3d_anim_transform_subtr(root, rmInfo.distance));
+    }
 
-        if (atree->updateCallback)
+    if (atree->updateCallback)
+    {
+        for (int boneIdx = 0; boneIdx < boneCount; boneIdx++)
         {
+            Transform out = r3d_anim_pose_get(&pose, boneIdx);
             atree->updateCallback(player, boneIdx, &out, atree->updateUserData);
+            r3d_anim_pose_set(&pose, boneIdx, out);
         }
-
-        player->localPose[boneIdx] = r3d_matrix_srt_quat(out.scale, out.rotation, out.translation);
     }
 
+    r3d_anim_pose_to_matrices(player->localPose, &pose);
+
     r3d_anim_matrices_compute(player);
     R3D_UploadAnimationPose(player);
     return;
@@ -1310,6 +1370,7 @@ R3D_AnimationTree R3D_LoadAnimationTreePro(R3D_AnimationPlayer player, int maxSi
     tree.player = player;
     tree.nodePool = r3d_malloc(maxSize * sizeof(*tree.nodePool));
     tree.nodePoolMaxSize = maxSize;
+    tree.posePool = r3d_malloc((maxSize + 1) * sizeof(*tree.posePool));
     tree.rootBone = rootBone;
     tree.updateCallback = updateCallback;
     tree.updateUserData = updateUserData;
@@ -1326,6 +1387,12 @@ void R3D_UnloadAnimationTree(R3D_AnimationTree tree)
         r3d_free(node.base);
     }
     r3d_free(tree.nodePool);
+
+    for (int i = 0; i <= tree.nodePoolMaxSize; i++)
+    {
+        if (tree.posePool[i]) r3d_free(tree.posePool[i]);
+    }
+    r3d_free(tree.posePool);
 }
 
 void R3D_UpdateAnimationTree(R3D_AnimationTree* tree, float dt)
@@ -28,15 +28,19 @@ static const int R3D_HINT_DEFAULTS[R3D_HINT_COUNT] = {
     [R3D_HINT_MESH_VERTEX_BUFFER_CAPACITY]   = 65536,
     [R3D_HINT_MESH_INDEX_BUFFER_CAPACITY]    = 131072,
     [R3D_HINT_MESH_STREAMING_CAPACITY]       = 128,
+    [R3D_HINT_MESH_POSITION_STREAM]          = 1,
     [R3D_HINT_DRAW_CALL_CAPACITY]            = 1024,
-    [R3D_HINT_FORWARD_LIGHT_PER_MESH]        = 16,
     [R3D_HINT_PROBE_ILLUMINATION_MAX_ACTIVE] = 32,
     [R3D_HINT_PROBE_REFLECTION_MAX_ACTIVE]   = 8,
-    [R3D_HINT_SHADOW_DIR_SIZE]               = 4096,
+    [R3D_HINT_SHADOW_DIR_SIZE]               = 2048,
+    [R3D_HINT_SHADOW_DIR_CASCADES]           = 4,
     [R3D_HINT_SHADOW_SPOT_SIZE]              = 2048,
     [R3D_HINT_SHADOW_OMNI_SIZE]              = 2048,
+    [R3D_HINT_SHADOW_MEMORY_BUDGET]          = 0,
     [R3D_HINT_IBL_IRRADIANCE_SIZE]           = 32,
     [R3D_HINT_IBL_PREFILTER_SIZE]            = 128,
+    [R3D_HINT_WORKER_THREAD_COUNT]           = -1,
+    [R3D_HINT_OCCLUSION_BUFFER_SIZE]         = 256,
 };
 
 // ========================================
@@ -78,12 +82,12 @@ void R3D_SetHint(R3D_Hint hint, int value)
     case R3D_HINT_MESH_STREAMING_CAPACITY:
         value = R3D_MAX(value, MIN_FREE_SLOTS);
         break;
+    case R3D_HINT_MESH_POSITION_STREAM:
+        value = R3D_CLAMP(value, 0, 1);
+        break;
     case R3D_HINT_DRAW_CALL_CAPACITY:
         value = R3D_MAX(value, MIN_DRAW_CALLS);
         break;
-    case R3D_HINT_FORWARD_LIGHT_PER_MESH:
-        value = R3D_CLAMP(value, 1, R3D_SHADER_LIGHT_FORWARD_UBO_CAP);
-        break;
     case R3D_HINT_PROBE_ILLUMINATION_MAX_ACTIVE:
         value = R3D_CLAMP(value, 1, R3D_SHADER_PROBE_ILLUMINATION_UBO_CAP);
         break;
@@ -93,18 +97,30 @@ void R3D_SetHint(R3D_Hint hint, int value)
     case R3D_HINT_SHADOW_DIR_SIZE:
         value = R3D_CLAMP(value, MIN_TEXMAP_SIZE, maxTexSize);
         break;
+    case R3D_HINT_SHADOW_DIR_CASCADES:
+        value = R3D_CLAMP(value, 1, R3D_SHADOW_CASCADE_MAX);
+        break;
     case R3D_HINT_SHADOW_SPOT_SIZE:
         value = R3D_CLAMP(value, MIN_TEXMAP_SIZE, maxTexSize);
         break;
     case R3D_HINT_SHADOW_OMNI_SIZE:
         value = R3D_CLAMP(value, MIN_TEXMAP_SIZE, maxTexSize);
         break;
+    case R3D_HINT_SHADOW_MEMORY_BUDGET:
+        value = R3D_MAX(value, 0);
+        break;
     case R3D_HINT_IBL_IRRADIANCE_SIZE:
         value = R3D_CLAMP(value, MIN_TEXMAP_SIZE, maxTexSize);
         break;
     case R3D_HINT_IBL_PREFILTER_SIZE:
         value = R3D_CLAMP(value, MIN_TEXMAP_SIZE, maxTexSize);
         break;
+    case R3D_HINT_WORKER_THREAD_COUNT:
+        value = R3D_CLAMP(value, -1, R3D_POOL_MAX_WORKERS);
+        break;
+    case R3D_HINT_OCCLUSION_BUFFER_SIZE:
+        value = R3D_CLAMP(value, 16, 4096);
+        break;
     case R3D_HINT_COUNT:
         break;
     }
@@ -171,6 +187,16 @@ bool R3D_Init(int resWidth, int resHeight)
         return false;
     }
 
+    int workerCount = R3D_HINT(R3D_HINT_WORKER_THREAD_COUNT);
+    if (workerCount < 0) workerCount = r3d_get_cpu_count() - 1;
+
+    R3D.pool = r3d_pool_create(workerCount);
+    if (R3D.pool == NULL)
+    {
+        R3D_TRACELOG(LOG_ERROR, "Failed to create internal worker pool");
+        return false;
+    }
+
     if (!r3d_texture_init())
     {
         R3D_TRACELOG(LOG_ERROR, "Failed to init texture module");
@@ -223,6 +249,7 @@ bool R3D_Init(int resWidth, int resHeight)
 void R3D_Close(void)
 {
     r3d_stack_destroy(R3D.stack);
+    r3d_pool_destroy(R3D.pool);
     r3d_texture_quit();
     r3d_target_quit();
     r3d_shader_quit();
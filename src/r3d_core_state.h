@@ -19,6 +19,7 @@
 #include <raylib.h>
 
 #include "./common/r3d_stack.h"
+#include "./common/r3d_pool.h"
 
 // ========================================
 // HELPER MACROS
@@ -73,6 +74,7 @@ extern struct r3d_core_state {
     Matrix matCubeViews[6];             //< Pre-computed view matrices for cubemap faces
     r3d_hint_t hints[R3D_HINT_COUNT];   //< User-configurable hints, resolved at R3D_Init()
     r3d_stack_t* stack;                 //< Main thread stack allocator
+    r3d_pool_t* pool;                   //< Worker pool for data-parallel tasks (culling)
     bool initialized;                   //< Indicates if R3D has been initialized successfully
 } R3D;
 
@@ -39,9 +39,6 @@
 #define IS_MESH_VISIBLE(mesh, cullMask) \
     (R3D_BIT_ANY((cullMask), (mesh).layerMask))
 
-#define IS_MESH_VISIBLE_CAMERA(mesh) \
-    (IS_MESH_VISIBLE((mesh), R3D.viewState.camera.cullMask))
-
 #define SHADOW_CAST_ONLY_MASK (                 \
     (1 << R3D_SHADOW_CAST_ONLY_AUTO) |          \
     (1 << R3D_SHADOW_CAST_ONLY_DOUBLE_SIDED) |  \
@@ -57,14 +54,19 @@
 // ========================================
 
 static void update_view_state(R3D_View view);
-static void upload_light_array_block_for_mesh(const r3d_render_call_t* call, bool shadow);
+static void upload_light_grid_block(bool shadows);
 static void upload_frame_block(void);
 static void upload_view_block(void);
 static void upload_env_block(void);
 static void upload_fx_block(void);
 
+static bool depth_position_only(const r3d_render_call_t* call, const r3d_render_group_t* group);
+
 static void raster_depth(const r3d_render_call_t* call, const Matrix* viewProj, const r3d_light_shadow_job_t* shadowJob);
 static void raster_depth_cube(const r3d_render_call_t* call, const Matrix* viewProj, const r3d_light_shadow_job_t* shadowJob);
+static void raster_depth_cube_layered(const r3d_render_call_t* call, uint32_t faces);
+static void raster_shadow_casters(const r3d_light_shadow_job_t* job, bool staticCasters, bool dynamicCasters);
+static void raster_shadow_casters_cube(const r3d_light_shadow_job_t* faces, uint32_t faceMask, bool staticCasters, bool dynamicCasters);
 static void raster_probe_forward(const r3d_render_call_t* call, const r3d_env_probe_job_t* job, int face, bool opaque);
 static void raster_probe_unlit(const r3d_render_call_t* call, const r3d_env_probe_job_t* job, int face, bool opaque);
 static void raster_geometry(const r3d_render_call_t* call);
@@ -73,6 +75,7 @@ static void raster_forward(const r3d_render_call_t* call);
 static void raster_unlit(const r3d_render_call_t* call, bool opaque);
 
 static void pass_scene_shadows(void);
+static void pass_scene_shadows_omni(const r3d_light_shadow_job_t* faces, int viewIndex, uint64_t staticHash);
 static void pass_scene_probes(void);
 static void pass_scene_geometry(void);
 static void pass_scene_decals(void);
@@ -153,6 +156,16 @@ void R3D_End(void)
     upload_env_block();
     upload_fx_block();
 
+    /* --- Keep the lights and their shadow updates within budget, then bin the visible lights --- */
+
+    r3d_light_apply_budget();
+    r3d_light_schedule_shadows();
+    r3d_light_build_grid();
+    upload_light_grid_block(true);
+
+    r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_LIGHT_DATA, R3D_MOD_LIGHT.lightTexture);
+    r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_LIGHT_GRID, R3D_MOD_LIGHT.gridTexture);
+
     /* --- Render all shadow maps and bind them --- */
 
     if (r3d_light_has_shadow_job())
@@ -169,18 +182,22 @@ void R3D_End(void)
     if (r3d_env_has_any_probes() || R3D.environment.ambient.map.flags != 0)
     {
         r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_IBL_IRRADIANCE, r3d_env_irradiance_get());
+        r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_IBL_SH, r3d_env_sh_get());
         r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_IBL_PREFILTER, r3d_env_prefilter_get());
         r3d_shader_bind_sampler(R3D_SHADER_SAMPLER_IBL_BRDF_LUT, r3d_texture_get(R3D_TEXTURE_BRDF_LUT));
 
         if (r3d_env_has_any_probe_jobs())
         {
             pass_scene_probes();
+            upload_light_grid_block(true);
         }
     }
 
-    /* --- Cull groups and sort all draw calls before rendering --- */
+    /* --- Cull groups, compact the visible calls and sort only those --- */
 
     r3d_render_cull_groups(&R3D.viewState.frustum);
+    r3d_render_cull_occlusion(R3D.viewState.viewProj, (float)R3D.viewState.aspect);
+    r3d_render_compact_lists(&R3D.viewState.frustum, R3D.viewState.camera.cullMask);
 
     r3d_render_sort_list(R3D_RENDER_LIST_OPAQUE, R3D.viewState.camera.position, R3D_RENDER_SORT_FRONT_TO_BACK);
     r3d_render_sort_list(R3D_RENDER_LIST_BLEND, R3D.viewState.camera.position, R3D_RENDER_SORT_BACK_TO_FRONT);
@@ -190,6 +207,11 @@ void R3D_End(void)
     r3d_render_sort_list(R3D_RENDER_LIST_BLEND_INST, R3D.viewState.camera.position, R3D_RENDER_SORT_MATERIAL_ONLY);
     r3d_render_sort_list(R3D_RENDER_LIST_DECAL_INST, R3D.viewState.camera.position, R3D_RENDER_SORT_MATERIAL_ONLY);
 
+    /* --- Merge repeated opaque draws into instanced batches --- */
+
+    // Blended calls are left alone to keep their back to front order
+    r3d_render_batch_list(R3D_RENDER_LIST_OPAQUE);
+
     /* --- Clear all G-Buffer before writing in it --- */
 
     r3d_driver_set_depth_mask(GL_TRUE);
@@ -339,6 +361,22 @@ void R3D_EndCluster(void)
     }
 }
 
+void R3D_BeginStaticShadows(void)
+{
+    if (!r3d_render_static_shadows_begin())
+    {
+        R3D_TRACELOG(LOG_WARNING, "Failed to begin static shadows");
+    }
+}
+
+void R3D_EndStaticShadows(void)
+{
+    if (!r3d_render_static_shadows_end())
+    {
+        R3D_TRACELOG(LOG_WARNING, "Failed to end static shadows");
+    }
+}
+
 void R3D_PushLight(R3D_Light light)
 {
     r3d_light_push(&light, NULL, false);
@@ -404,6 +442,7 @@ void R3D_DrawMeshInstancedPro(R3D_Mesh mesh, R3D_Material material, R3D_Instance
     drawGroup.instances = instances;
     drawGroup.instanceOffset = R3D_CLAMP(offset, 0, instances.capacity);
     drawGroup.instanceCount = R3D_CLAMP(count, 0, instances.capacity - offset);
+    drawGroup.instanceAabb = mesh.aabb;
 
     r3d_render_group_push(&drawGroup);
 
@@ -470,6 +509,7 @@ void R3D_DrawModelInstancedPro(R3D_Model model, R3D_InstanceBuffer instances, in
     drawGroup.instances = instances;
     drawGroup.instanceOffset = R3D_CLAMP(offset, 0, instances.capacity);
     drawGroup.instanceCount = R3D_CLAMP(count, 0, instances.capacity - offset);
+    drawGroup.instanceAabb = model.aabb;
 
     r3d_render_group_push(&drawGroup);
 
@@ -543,6 +583,7 @@ void R3D_DrawAnimatedModelInstancedPro(R3D_Model model, R3D_AnimationPlayer play
     drawGroup.instances = instances;
     drawGroup.instanceOffset = R3D_CLAMP(offset, 0, instances.capacity);
     drawGroup.instanceCount = R3D_CLAMP(count, 0, instances.capacity - offset);
+    drawGroup.instanceAabb = model.aabb;
 
     drawGroup.skinTexture = (player.skinTexture > 0)
         ? player.skinTexture : model.skeleton.skinTexture;
@@ -615,6 +656,7 @@ void R3D_DrawDecalInstancedPro(R3D_Decal decal, R3D_InstanceBuffer instances, in
     drawGroup.instances = instances;
     drawGroup.instanceOffset = R3D_CLAMP(offset, 0, instances.capacity);
     drawGroup.instanceCount = R3D_CLAMP(count, 0, instances.capacity - offset);
+    drawGroup.instanceAabb = R3D_AABB_UNIT;
 
     r3d_render_group_push(&drawGroup);
 
@@ -625,6 +667,69 @@ void R3D_DrawDecalInstancedPro(R3D_Decal decal, R3D_InstanceBuffer instances, in
     r3d_render_call_push(&drawCall);
 }
 
+void R3D_DrawOccluder(R3D_MeshData data, Matrix transform)
+{
+    int count = (data.indices != NULL) ? data.indexCount : data.vertexCount;
+    count -= count % 3;
+
+    if (data.vertices == NULL || count <= 0) return;
+
+    // Validated before allocating, a rejected mesh then leaves nothing behind
+    if (data.indices != NULL)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (data.indices[i] >= (uint32_t)data.vertexCount)
+            {
+                R3D_TRACELOG(LOG_WARNING, "Failed to draw occluder: index %u out of range (%d vertices)",
+                             data.indices[i], data.vertexCount);
+                return;
+            }
+        }
+    }
+
+    Vector3* positions = r3d_render_occluder_alloc(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t index = (data.indices != NULL) ? data.indices[i] : (uint32_t)i;
+        positions[i] = Vector3Transform(data.vertices[index].position, transform);
+    }
+}
+
+void R3D_DrawOccluderBox(BoundingBox box, Matrix transform)
+{
+    static const int FACES[6][4] = {
+        {0, 2, 6, 4}, {1, 5, 7, 3},  // -X, +X
+        {0, 4, 5, 1}, {2, 3, 7, 6},  // -Y, +Y
+        {0, 1, 3, 2}, {4, 6, 7, 5}   // -Z, +Z
+    };
+
+    Vector3 corners[8];
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3 corner = {
+            (i & 1) ? box.max.x : box.min.x,
+            (i & 2) ? box.max.y : box.min.y,
+            (i & 4) ? box.max.z : box.min.z
+        };
+        corners[i] = Vector3Transform(corner, transform);
+    }
+
+    Vector3* positions = r3d_render_occluder_alloc(6 * 6);
+
+    for (int f = 0; f < 6; f++)
+    {
+        const int* q = FACES[f];
+        *positions++ = corners[q[0]];
+        *positions++ = corners[q[1]];
+        *positions++ = corners[q[2]];
+        *positions++ = corners[q[0]];
+        *positions++ = corners[q[2]];
+        *positions++ = corners[q[3]];
+    }
+}
+
 // ========================================
 // INTERNAL FUNCTIONS
 // ========================================
@@ -671,6 +776,46 @@ static Rectangle view_resolve_viewport(R3D_View view)
     return view.viewport;
 }
 
+static bool texture_has_alpha(Texture2D texture)
+{
+    switch (texture.format)
+    {
+    case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE:
+    case PIXELFORMAT_UNCOMPRESSED_R5G6B5:
+    case PIXELFORMAT_UNCOMPRESSED_R8G8B8:
+    case PIXELFORMAT_UNCOMPRESSED_R32:
+    case PIXELFORMAT_UNCOMPRESSED_R32G32B32:
+    case PIXELFORMAT_UNCOMPRESSED_R16:
+    case PIXELFORMAT_UNCOMPRESSED_R16G16B16:
+    case PIXELFORMAT_COMPRESSED_DXT1_RGB:
+        return false;
+    default:
+        break;
+    }
+    return true;
+}
+
+/*
+ * Tells whether a depth draw can be fed from the packed position stream.
+ * Texcoords and colors are constants there, so the alpha test must not be able
+ * to discard anything, and skinning or custom vertex code keep the full format.
+ */
+bool depth_position_only(const r3d_render_call_t* call, const r3d_render_group_t* group)
+{
+    const R3D_Material* material = &call->mesh.material;
+    const R3D_Mesh* mesh = &call->mesh.instance;
+
+    if (material->shader != NULL || group->skinTexture > 0) return false;
+    if (material->alphaCutoff <= 0.0f) return true;
+
+    if (material->albedo.texture.id != 0 && texture_has_alpha(material->albedo.texture)) return false;
+    if (mesh->vertexAlpha) return false;
+
+    if (r3d_render_has_instances(group) && R3D_BIT_ANY(group->instances.layout.flags, R3D_INSTANCE_COLOR)) return false;
+
+    return (material->albedo.color.a / 255.0f) >= material->alphaCutoff;
+}
+
 static Rectangle view_fit_aspect(Rectangle rect, double aspect)
 {
     if (rect.width <= 0.0f || rect.height <= 0.0f || aspect <= 0.0)
@@ -745,50 +890,17 @@ void update_view_state(R3D_View view)
     R3D.viewState.aspect = aspect;
 }
 
-void upload_light_array_block_for_mesh(const r3d_render_call_t* call, bool shadow)
+void upload_light_grid_block(bool shadows)
 {
-    R3D_ASSERT(call->type == R3D_RENDER_CALL_MESH); //< Paranoid assert, should be fine
-
-    r3d_shader_block_light_array_t lights = {0};
-
-    R3D_LIGHT_FOR_EACH_VISIBLE(light)
-    {
-        // Check if the geometry touches the light volume
-        if (light->type != R3D_LIGHT_DIR)
-        {
-            if (!CheckCollisionBoxSphere(call->mesh.instance.aabb, light->volume.center, light->volume.radius))
-            {
-                continue;
-            }
-        }
-
-        r3d_shader_block_light_t* data = &lights.uLights[lights.uNumLights];
-        data->viewProj        = MatrixTranspose(light->viewProj);
-        data->color           = light->color;
-        data->position        = light->position;
-        data->direction       = light->direction;
-        data->energy          = light->energy;
-        data->specular        = light->specular;
-        data->range           = light->range;
-        data->falloff         = light->falloff;
-        data->innerCutOff     = light->innerCutOff;
-        data->outerCutOff     = light->outerCutOff;
-        data->fogEnergy       = light->fogEnergy;
-        data->shadowSoftness  = light->shadowSoftness;
-        data->shadowOpacity   = light->shadowOpacity;
-        data->shadowDepthBias = light->shadowDepthBias;
-        data->shadowSlopeBias = light->shadowSlopeBias;
-        data->shadowFar       = light->shadowFar;
-        data->shadowLayer     = shadow ? light->shadowLayer : -1;
-        data->type            = light->type;
-
-        if (++lights.uNumLights == R3D_HINT(R3D_HINT_FORWARD_LIGHT_PER_MESH))
-        {
-            break;
-        }
-    }
+    r3d_shader_block_light_grid_t grid = {
+        .uLightGridSize  = {R3D_LIGHT_GRID_X, R3D_LIGHT_GRID_Y, R3D_LIGHT_GRID_Z},
+        .uLightGridDepth = {R3D_MOD_LIGHT.gridDepthScale, R3D_MOD_LIGHT.gridDepthBias},
+        .uNumDirLights   = R3D_MOD_LIGHT.gridDirLightCount,
+        .uNumLights      = r3d_light_grid_light_count(),
+        .uLightShadows   = shadows,
+    };
 
-    r3d_shader_set_uniform_block(R3D_SHADER_BLOCK_LIGHT_ARRAY, &lights, true);
+    r3d_shader_set_uniform_block(R3D_SHADER_BLOCK_LIGHT_GRID, &grid, true);
 }
 
 void upload_frame_block(void)
@@ -836,10 +948,11 @@ void upload_env_block(void)
         R3D_ENV_FOR_EACH_ILLUMINATION_PROBE(probe)
         {
             env->uIlluminationProbes[iIlluminationProbe] = (r3d_shader_block_env_probe_t) {
-                .position = probe->position,
-                .falloff  = probe->falloff,
-                .range    = probe->range,
-                .layer    = (int)probe->handle - 1,
+                .position  = probe->position,
+                .falloff   = probe->falloff,
+                .range     = probe->range,
+                .layer     = (int)probe->handle - 1,
+                .harmonics = (probe->type == R3D_PROBE_ILLUMINATION_SH),
             };
             if (++iIlluminationProbe >= R3D_HINT(R3D_HINT_PROBE_ILLUMINATION_MAX_ACTIVE))
             {
@@ -1033,6 +1146,8 @@ void raster_depth(const r3d_render_call_t* call, const Matrix* viewProj, const r
 
     /* --- Rendering the object corresponding to the draw call --- */
 
+    r3d_render_prepare_depth_drawing(depth_position_only(call, group));
+
     if (r3d_render_has_instances(group))
     {
         R3D_SHADER_SET_INT_SELECT(scene.depth, shader, uInstancing, true);
@@ -1106,6 +1221,8 @@ void raster_depth_cube(const r3d_render_call_t* call, const Matrix* viewProj, co
 
     /* --- Rendering the object corresponding to the draw call --- */
 
+    r3d_render_prepare_depth_drawing(depth_position_only(call, group));
+
     if (r3d_render_has_instances(group))
     {
         R3D_SHADER_SET_INT_SELECT(scene.depthCube, shader, uInstancing, true);
@@ -1118,6 +1235,78 @@ void raster_depth_cube(const r3d_render_call_t* call, const Matrix* viewProj, co
     }
 }
 
+void raster_depth_cube_layered(const r3d_render_call_t* call, uint32_t faces)
+{
+    R3D_ASSERT(call->type == R3D_RENDER_CALL_MESH);   //< Paranoid assert, should be fine
+    R3D_ASSERT(call->mesh.material.shader == NULL);   //< Custom shaders have no layered variant
+
+    const r3d_render_group_t* group = r3d_render_get_call_group(call);
+    const R3D_Material* material = &call->mesh.material;
+    const R3D_Mesh* mesh = &call->mesh.instance;
+
+    /* --- Use shader, the light uniforms are set once per cube map --- */
+
+    R3D_SHADER_USE(scene.depthCubeLayered);
+
+    /* --- Route the caster to the faces it overlaps --- */
+
+    R3D_SHADER_SET_INT(scene.depthCubeLayered, uFaceMask, faces);
+
+    /* --- Send matrices --- */
+
+    R3D_SHADER_SET_MAT4(scene.depthCubeLayered, uMatModel, group->transform);
+
+    /* --- Send skinning related data --- */
+
+    if (group->skinTexture > 0)
+    {
+        R3D_SHADER_BIND_SAMPLER(scene.depthCubeLayered, uBoneMatricesTex, group->skinTexture);
+        R3D_SHADER_SET_INT(scene.depthCubeLayered, uSkinning, true);
+    }
+    else
+    {
+        R3D_SHADER_SET_INT(scene.depthCubeLayered, uSkinning, false);
+    }
+
+    /* --- Send billboard related data --- */
+
+    R3D_SHADER_SET_INT(scene.depthCubeLayered, uBillboard, material->billboardMode);
+    if (material->billboardMode != R3D_BILLBOARD_DISABLED)
+    {
+        R3D_SHADER_SET_MAT4(scene.depthCubeLayered, uMatInvView, R3D.viewState.invView);
+    }
+
+    /* --- Set texcoord offset/scale --- */
+
+    R3D_SHADER_SET_VEC2(scene.depthCubeLayered, uTexCoordOffset, material->uvOffset);
+    R3D_SHADER_SET_VEC2(scene.depthCubeLayered, uTexCoordScale, material->uvScale);
+
+    /* --- Set transparency material data --- */
+
+    R3D_SHADER_BIND_SAMPLER(scene.depthCubeLayered, uAlbedoMap, R3D_TEXTURE_SELECT(material->albedo.texture.id, WHITE));
+    R3D_SHADER_SET_COL4(scene.depthCubeLayered, uAlbedoColor, material->albedo.color);
+    R3D_SHADER_SET_FLOAT(scene.depthCubeLayered, uAlphaCutoff, material->alphaCutoff);
+
+    /* --- Applying material parameters that are independent of shaders --- */
+
+    r3d_driver_set_shadow_cast_mode(mesh->shadowCastMode, material->cullMode);
+
+    /* --- Rendering the object corresponding to the draw call --- */
+
+    r3d_render_prepare_depth_drawing(depth_position_only(call, group));
+
+    if (r3d_render_has_instances(group))
+    {
+        R3D_SHADER_SET_INT(scene.depthCubeLayered, uInstancing, true);
+        r3d_render_draw_instanced(call);
+    }
+    else
+    {
+        R3D_SHADER_SET_INT(scene.depthCubeLayered, uInstancing, false);
+        r3d_render_draw(call);
+    }
+}
+
 void raster_probe_forward(const r3d_render_call_t* call, const r3d_env_probe_job_t* job, int face, bool opaque)
 {
     R3D_ASSERT(call->type == R3D_RENDER_CALL_MESH); //< Paranoid assert, should be fine
@@ -1304,9 +1493,12 @@ void raster_geometry(const r3d_render_call_t* call)
 
     /* --- Send matrices --- */
 
-    Matrix matNormal = r3d_matrix_normal(&group->transform);
+    // The transforms of a batch are carried by its instances
+    const r3d_render_batch_t* batch = r3d_render_get_call_batch(call);
+    Matrix matModel = (batch != NULL) ? R3D_MATRIX_IDENTITY : group->transform;
+    Matrix matNormal = r3d_matrix_normal(&matModel);
 
-    R3D_SHADER_SET_MAT4_SELECT(scene.geometry, shader, uMatModel, group->transform);
+    R3D_SHADER_SET_MAT4_SELECT(scene.geometry, shader, uMatModel, matModel);
     R3D_SHADER_SET_MAT4_SELECT(scene.geometry, shader, uMatNormal, matNormal);
 
     /* --- Send skinning related data --- */
@@ -1360,7 +1552,7 @@ void raster_geometry(const r3d_render_call_t* call)
 
     /* --- Rendering the object corresponding to the draw call --- */
 
-    if (r3d_render_has_instances(group))
+    if (r3d_render_has_instances(group) || batch != NULL)
     {
         R3D_SHADER_SET_INT_SELECT(scene.geometry, shader, uInstancing, true);
         r3d_render_draw_instanced(call);
@@ -1546,9 +1738,12 @@ void raster_unlit(const r3d_render_call_t* call, bool opaque)
 
     /* --- Send matrices --- */
 
-    Matrix matNormal = r3d_matrix_normal(&group->transform);
+    // The transforms of a batch are carried by its instances
+    const r3d_render_batch_t* batch = r3d_render_get_call_batch(call);
+    Matrix matModel = (batch != NULL) ? R3D_MATRIX_IDENTITY : group->transform;
+    Matrix matNormal = r3d_matrix_normal(&matModel);
 
-    R3D_SHADER_SET_MAT4_SELECT(scene.unlit, shader, uMatModel, group->transform);
+    R3D_SHADER_SET_MAT4_SELECT(scene.unlit, shader, uMatModel, matModel);
     R3D_SHADER_SET_MAT4_SELECT(scene.unlit, shader, uMatNormal, matNormal);
 
     /* --- Send skinning related data --- */
@@ -1594,7 +1789,7 @@ void raster_unlit(const r3d_render_call_t* call, bool opaque)
 
     /* --- Rendering the object corresponding to the draw call --- */
 
-    if (r3d_render_has_instances(group))
+    if (r3d_render_has_instances(group) || batch != NULL)
     {
         R3D_SHADER_SET_INT_SELECT(scene.unlit, shader, uInstancing, true);
         r3d_render_draw_instanced(call);
@@ -1606,39 +1801,106 @@ void raster_unlit(const r3d_render_call_t* call, bool opaque)
     }
 }
 
-void pass_scene_shadows(void)
+void raster_shadow_casters(const r3d_light_shadow_job_t* job, bool staticCasters, bool dynamicCasters)
 {
-    r3d_driver_disable(GL_STENCIL_TEST);
-    r3d_driver_enable(GL_DEPTH_TEST);
+    #define COND (                                                          \
+        (call->mesh.instance.shadowCastMode != R3D_SHADOW_CAST_DISABLED) && \
+        IS_MESH_VISIBLE(call->mesh.instance, job->cullMask)                 \
+    )
 
-    r3d_driver_set_depth_func(GL_LEQUAL);
-    r3d_driver_set_depth_mask(GL_TRUE);
+    const R3D_Frustum* frustum = &job->frustum;
+
+    R3D_RENDER_FOR_EACH(call, COND, frustum, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+    {
+        const r3d_render_group_t* group = r3d_render_get_call_group(call);
+        if (group->staticShadow ? !staticCasters : !dynamicCasters) continue;
+
+        // Distant cascades skip the groups smaller than one of their texels
+        if (job->minCasterRadius > 0.0f)
+        {
+            if (!r3d_render_has_instances(group) && Vector3Length(group->obb.halfExtents) < job->minCasterRadius) continue;
+        }
+
+        if (r3d_render_should_cast_shadow(call))
+        {
+            raster_depth(call, &job->viewProj, job);
+        }
+    }
+
+    #undef COND
+}
 
+/*
+ * Returns true if the caster can't use the layered cube path and must be drawn face by face:
+ * custom surface shaders have no layered variant, and the geometry shader only takes triangles.
+ */
+static bool cube_caster_needs_faces(const r3d_render_call_t* call)
+{
+    return call->mesh.material.shader != NULL
+        || call->mesh.instance.primitiveType < R3D_PRIMITIVE_TRIANGLES;
+}
+
+void raster_shadow_casters_cube(const r3d_light_shadow_job_t* faces, uint32_t faceMask, bool staticCasters, bool dynamicCasters)
+{
     #define COND (                                                          \
         (call->mesh.instance.shadowCastMode != R3D_SHADOW_CAST_DISABLED) && \
         IS_MESH_VISIBLE(call->mesh.instance, job->cullMask)                 \
     )
 
-    R3D_LIGHT_FOR_EACH_SHADOW_JOB(job)
+    const r3d_light_shadow_job_t* job = &faces[0];
+
+    Matrix faceViewProj[6];
+    for (int face = 0; face < 6; face++)
     {
-        r3d_light_bind_shadow_fbo(job->type, job->shadowLayer, job->layerFace);
-        glClear(GL_DEPTH_BUFFER_BIT);
+        faceViewProj[face] = faces[face].viewProj;
+    }
+
+    R3D_SHADER_USE(scene.depthCubeLayered);
+    R3D_SHADER_SET_MAT4_V(scene.depthCubeLayered, uMatFaceViewProj, faceViewProj, 6);
+    R3D_SHADER_SET_INT(scene.depthCubeLayered, uLayerBase, job->shadowLayer * 6);
+    R3D_SHADER_SET_VEC3(scene.depthCubeLayered, uViewPosition, job->position);
+    R3D_SHADER_SET_FLOAT(scene.depthCubeLayered, uFar, job->far);
+
+    // Each caster is submitted once, the geometry shader emits it in every face it overlaps
+    bool faceCasters = false;
 
-        const R3D_Frustum* frustum = &job->frustum;
-        r3d_render_cull_groups(frustum);
+    R3D_RENDER_FOR_EACH(call, COND, NULL, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+    {
+        const r3d_render_group_t* group = r3d_render_get_call_group(call);
+        if (group->staticShadow ? !staticCasters : !dynamicCasters) continue;
+        if (!r3d_render_should_cast_shadow(call)) continue;
 
-        R3D_RENDER_FOR_EACH(call, COND, frustum, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+        if (cube_caster_needs_faces(call))
         {
-            if (r3d_render_should_cast_shadow(call))
+            faceCasters = true;
+            continue;
+        }
+
+        uint32_t callFaces = r3d_render_call_cube_faces(call) & faceMask;
+        if (callFaces != 0) raster_depth_cube_layered(call, callFaces);
+    }
+
+    if (!faceCasters) return;
+
+    // Casters the layered path can't take are drawn face by face
+    for (int face = 0; face < 6; face++)
+    {
+        uint32_t faceBit = 1u << face;
+        if ((faceMask & faceBit) == 0) continue;
+
+        // Static casters alone are only drawn into the static layers
+        if (staticCasters && !dynamicCasters) r3d_light_bind_static_shadow_fbo(job->type, job->shadowMap, face);
+        else r3d_light_bind_shadow_fbo(job->type, job->shadowMap, face);
+
+        R3D_RENDER_FOR_EACH(call, COND, NULL, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+        {
+            const r3d_render_group_t* group = r3d_render_get_call_group(call);
+            if (group->staticShadow ? !staticCasters : !dynamicCasters) continue;
+            if (!cube_caster_needs_faces(call) || !r3d_render_should_cast_shadow(call)) continue;
+
+            if (r3d_render_call_cube_faces(call) & faceBit)
             {
-                if (job->type == R3D_LIGHT_OMNI)
-                {
-                    raster_depth_cube(call, &job->viewProj, job);
-                }
-                else
-                {
-                    raster_depth(call, &job->viewProj, job);
-                }
+                raster_depth_cube(call, &faces[face].viewProj, &faces[face]);
             }
         }
     }
@@ -1646,13 +1908,148 @@ void pass_scene_shadows(void)
     #undef COND
 }
 
+void pass_scene_shadows(void)
+{
+    r3d_driver_disable(GL_STENCIL_TEST);
+    r3d_driver_enable(GL_DEPTH_TEST);
+
+    r3d_driver_set_depth_func(GL_LEQUAL);
+    r3d_driver_set_depth_mask(GL_TRUE);
+
+    // Cull the groups of every shadow job at once, jobs only select their results
+    int jobCount = (int)R3D_LIST_LENGTH(R3D_MOD_LIGHT.listShadowJobs);
+
+    R3D_STACK_SCOPE(&R3D.stack, jobCount * sizeof(r3d_render_cull_view_t))
+    {
+        r3d_render_cull_view_t* views = r3d_stack_alloc(&R3D.stack, jobCount * sizeof(r3d_render_cull_view_t));
+
+        int jobIndex = 0;
+        R3D_LIGHT_FOR_EACH_SHADOW_JOB(job)
+        {
+            // The six faces of an omni light share a single cube cull
+            bool omni = (job->type == R3D_LIGHT_OMNI);
+            views[jobIndex++] = (r3d_render_cull_view_t) {
+                .frustum = &job->frustum,
+                .cubeCenter = job->position,
+                .cubeRange = job->far,
+                .cubeFace = omni ? job->layerFace : -1
+            };
+        }
+
+        r3d_render_cull_groups_batch(views, jobCount);
+    }
+
+    // Static casters are kept in their own layers, redrawn only when the light or the static set changes
+    uint64_t staticHash = r3d_render_static_shadows_hash();
+    r3d_light_update_static_shadows(staticHash);
+
+    // Shadow maps are tiles of their layers, the scissor keeps the clears within them
+    r3d_driver_enable(GL_SCISSOR_TEST);
+
+    int jobIndex = 0;
+    R3D_LIGHT_FOR_EACH_SHADOW_JOB(job)
+    {
+        r3d_rect_t tile = r3d_light_shadow_tile_rect(job->type, job->shadowMap);
+        r3d_driver_set_scissor(tile.x, tile.y, tile.w, tile.h);
+
+        // The six faces of an omni light are scheduled together and follow each other, drawn in one pass
+        if (job->type == R3D_LIGHT_OMNI)
+        {
+            if (job->layerFace == 0) pass_scene_shadows_omni(job, jobIndex, staticHash);
+            jobIndex++;
+            continue;
+        }
+
+        r3d_render_cull_groups_select(jobIndex++);
+
+        if (staticHash == 0)
+        {
+            r3d_light_bind_shadow_fbo(job->type, job->shadowMap, job->layerFace);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            raster_shadow_casters(job, true, true);
+            continue;
+        }
+
+        r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(job->type, job->shadowMap);
+        uint32_t faceBit = 1u << job->layerFace;
+
+        if ((cache->staticValid & faceBit) == 0)
+        {
+            r3d_light_bind_static_shadow_fbo(job->type, job->shadowMap, job->layerFace);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            raster_shadow_casters(job, true, false);
+            cache->staticValid |= faceBit;
+        }
+
+        r3d_light_copy_static_shadow(job->type, job->shadowMap, job->layerFace);
+        r3d_light_bind_shadow_fbo(job->type, job->shadowMap, job->layerFace);
+        raster_shadow_casters(job, false, true);
+    }
+
+    r3d_driver_set_scissor(0, 0, R3D_TARGET_SIZE_W, R3D_TARGET_SIZE_H);
+    r3d_driver_disable(GL_SCISSOR_TEST);
+
+    // Casters may have been drawn from the position stream
+    r3d_render_prepare_drawing();
+}
+
+void pass_scene_shadows_omni(const r3d_light_shadow_job_t* faces, int viewIndex, uint64_t staticHash)
+{
+    const r3d_light_shadow_job_t* job = &faces[0];
+
+    for (int face = 0; face < 6; face++)
+    {
+        R3D_ASSERT(faces[face].layerFace == face && faces[face].shadowMap == job->shadowMap);
+    }
+
+    r3d_render_cull_groups_select_cube(viewIndex);
+
+    // Faces are cleared one by one, a layered clear would reach the other maps of the array
+    if (staticHash == 0)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            r3d_light_bind_shadow_fbo(job->type, job->shadowMap, face);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        r3d_light_bind_shadow_fbo(job->type, job->shadowMap, -1);
+        raster_shadow_casters_cube(faces, 0x3F, true, true);
+        return;
+    }
+
+    r3d_light_shadow_cache_t* cache = r3d_light_shadow_cache(job->type, job->shadowMap);
+    uint32_t staticStale = ~cache->staticValid & 0x3F;
+
+    if (staticStale != 0)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            if ((staticStale & (1u << face)) == 0) continue;
+            r3d_light_bind_static_shadow_fbo(job->type, job->shadowMap, face);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        r3d_light_bind_static_shadow_fbo(job->type, job->shadowMap, -1);
+        raster_shadow_casters_cube(faces, staticStale, true, false);
+        cache->staticValid |= staticStale;
+    }
+
+    for (int face = 0; face < 6; face++)
+    {
+        r3d_light_copy_static_shadow(job->type, job->shadowMap, face);
+    }
+
+    r3d_light_bind_shadow_fbo(job->type, job->shadowMap, -1);
+    raster_shadow_casters_cube(faces, 0x3F, false, true);
+}
+
 void pass_scene_probes(void)
 {
     #define RASTER_PROBE(opaque)                                    \
     do {                                                            \
         if (!call->mesh.material.unlit)                             \
         {                                                           \
-            upload_light_array_block_for_mesh(call, job->shadows);  \
             raster_probe_forward(call, job, iFace, (opaque));       \
         }                                                           \
         else                                                        \
@@ -1664,13 +2061,41 @@ void pass_scene_probes(void)
     const R3D_EnvBackground* bg = &R3D.environment.background;
     const R3D_EnvFog* fog = &R3D.environment.fog;
 
+    // Cull the groups of every probe at once, faces only select their results
+    int faceCount = 6 * (int)R3D_LIST_LENGTH(R3D_MOD_ENV.listProbeJobs);
+
+    R3D_STACK_SCOPE(&R3D.stack, faceCount * sizeof(r3d_render_cull_view_t))
+    {
+        r3d_render_cull_view_t* views = r3d_stack_alloc(&R3D.stack, faceCount * sizeof(r3d_render_cull_view_t));
+
+        int faceIndex = 0;
+        R3D_ENV_FOR_EACH_PROBE_JOB(job)
+        {
+            for (int iFace = 0; iFace < 6; iFace++)
+            {
+                views[faceIndex++] = (r3d_render_cull_view_t) {
+                    .frustum = &job->frustum[iFace],
+                    .cubeCenter = job->position,
+                    .cubeRange = job->range,
+                    .cubeFace = iFace
+                };
+            }
+        }
+
+        r3d_render_cull_groups_batch(views, faceCount);
+    }
+
+    int faceIndex = 0;
     R3D_ENV_FOR_EACH_PROBE_JOB(job)
     {
+        // Probes read every light, shadows are only sampled if the job asks for it
+        upload_light_grid_block(job->shadows);
+
         for (int iFace = 0; iFace < 6; iFace++)
         {
-            // Generates the list of visible groups for the current face of the capture
+            // Selects the list of visible groups for the current face of the capture
             const R3D_Frustum* frustum = &job->frustum[iFace];
-            r3d_render_cull_groups(frustum);
+            r3d_render_cull_groups_select(faceIndex++);
 
             // Render scene
             r3d_driver_enable(GL_STENCIL_TEST);
@@ -1736,11 +2161,21 @@ void pass_scene_probes(void)
         {
         case R3D_PROBE_ILLUMINATION:
             {
+                r3d_env_probe_capture_gen_mipmaps(job->probeType);
                 GLuint captureTex = r3d_env_probe_capture_get(job->probeType);
                 r3d_pass_prepare_irradiance(job->layer, captureTex);
             }
             break;
 
+        case R3D_PROBE_ILLUMINATION_SH:
+            {
+                r3d_env_probe_capture_gen_mipmaps(job->probeType);
+                GLuint captureTex = r3d_env_probe_capture_get(job->probeType);
+                int captureSize   = r3d_env_probe_capture_size(job->probeType);
+                r3d_pass_prepare_irradiance_sh(job->layer, captureTex, captureSize);
+            }
+            break;
+
         case R3D_PROBE_REFLECTION:
             {
                 r3d_env_probe_capture_gen_mipmaps(job->probeType);
@@ -1773,12 +2208,10 @@ void pass_scene_geometry(void)
 
     R3D_TARGET_BIND_LOAD(0, true, R3D_TARGET_GBUFFER);
 
-    #define COND (IS_MESH_VISIBLE_CAMERA(call->mesh.instance) && (!call->mesh.material.unlit))
-    R3D_RENDER_FOR_EACH(call, COND, &R3D.viewState.frustum, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+    R3D_RENDER_FOR_EACH_VISIBLE(call, !call->mesh.material.unlit, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
     {
         raster_geometry(call);
     }
-    #undef COND
 
     r3d_driver_set_depth_offset(0.0f, 0.0f);
     r3d_driver_set_depth_range(0.0f, 1.0f);
@@ -1801,7 +2234,7 @@ void pass_scene_decals(void)
     //        making orm.specular ineffective for decals.
     glColorMaski(2, GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
 
-    R3D_RENDER_FOR_EACH(call, true, &R3D.viewState.frustum, R3D_RENDER_LIST_DECAL_INST, R3D_RENDER_LIST_DECAL)
+    R3D_RENDER_FOR_EACH_VISIBLE(call, true, R3D_RENDER_LIST_DECAL_INST, R3D_RENDER_LIST_DECAL)
     {
         raster_decal(call);
     }
@@ -2109,7 +2542,6 @@ void pass_deferred_lights(void)
     r3d_driver_disable(GL_STENCIL_TEST);
     r3d_driver_disable(GL_CULL_FACE);
 
-    r3d_driver_enable(GL_SCISSOR_TEST);
     r3d_driver_enable(GL_DEPTH_TEST);
     r3d_driver_enable(GL_BLEND);
 
@@ -2127,45 +2559,9 @@ void pass_deferred_lights(void)
     R3D_SHADER_BIND_SAMPLER(deferred.lighting, uDepthTex, r3d_target_get_level(R3D_TARGET_DEPTH, 0));
     R3D_SHADER_BIND_SAMPLER(deferred.lighting, uOrmTex, r3d_target_get_level(R3D_TARGET_ORM, 0));
 
-    /* --- Calculate lighting contributions --- */
-
-    R3D_LIGHT_FOR_EACH_VISIBLE(light)
-    {
-        // Set scissors rect
-        r3d_rect_t dst = r3d_light_screen_rect(light, R3D_TARGET_SIZE_W, R3D_TARGET_SIZE_H);
-        r3d_driver_set_scissor(dst.x, dst.y, dst.w, dst.h);
-
-        // Send light data to the GPU
-        r3d_shader_block_light_t data = {
-            .viewProj        = MatrixTranspose(light->viewProj),
-            .color           = light->color,
-            .position        = light->position,
-            .direction       = light->direction,
-            .energy          = light->energy,
-            .specular        = light->specular,
-            .range           = light->range,
-            .falloff         = light->falloff,
-            .innerCutOff     = light->innerCutOff,
-            .outerCutOff     = light->outerCutOff,
-            .fogEnergy       = light->fogEnergy,
-            .shadowSoftness  = light->shadowSoftness,
-            .shadowOpacity   = light->shadowOpacity,
-            .shadowDepthBias = light->shadowDepthBias,
-            .shadowSlopeBias = light->shadowSlopeBias,
-            .shadowFar       = light->shadowFar,
-            .shadowLayer     = light->shadowLayer,
-            .type            = light->type,
-        };
-        r3d_shader_set_uniform_block(R3D_SHADER_BLOCK_LIGHT, &data, true);
-
-        // Accumulate this light!
-        R3D_RENDER_SCREEN();
-    }
-
-    /* --- Reset undesired states --- */
+    /* --- Accumulate every light in one pass, each pixel walks its own cluster --- */
 
-    r3d_driver_set_scissor(0, 0, R3D_TARGET_SIZE_W, R3D_TARGET_SIZE_H);
-    r3d_driver_disable(GL_SCISSOR_TEST);
+    R3D_RENDER_SCREEN();
 }
 
 void pass_deferred_ambient(r3d_target_t ssaoSource, r3d_target_t ssilSource, r3d_target_t ssgiSource)
@@ -2279,10 +2675,10 @@ void pass_deferred_volumetric_fog(r3d_target_t sceneTarget)
         r3d_driver_set_scissor(dst.x, dst.y, dst.w, dst.h);
 
         r3d_shader_block_light_t data = {
-            .viewProj        = MatrixTranspose(light->viewProj),
             .color           = light->color,
             .position        = light->position,
             .direction       = light->direction,
+            .shadowTile      = light->shadowTile,
             .energy          = light->energy,
             .specular        = light->specular,
             .range           = light->range,
@@ -2297,7 +2693,12 @@ void pass_deferred_volumetric_fog(r3d_target_t sceneTarget)
             .shadowFar       = light->shadowFar,
             .shadowLayer     = light->shadowLayer,
             .type            = light->type,
+            .cascadeCount    = light->cascadeCount,
         };
+        for (int i = 0; i < R3D_SHADOW_CASCADE_MAX; i++)
+        {
+            data.viewProj[i] = MatrixTranspose(light->viewProj[i]);
+        }
         r3d_shader_set_uniform_block(R3D_SHADER_BLOCK_LIGHT, &data, true);
 
         R3D_RENDER_SCREEN();
@@ -2332,23 +2733,20 @@ void pass_scene_forward(r3d_target_t sceneTarget)
     r3d_driver_disable(GL_BLEND);
     r3d_driver_set_depth_mask(GL_TRUE);
 
-    #define COND (IS_MESH_VISIBLE_CAMERA(call->mesh.instance) && (call->mesh.material.unlit))
-    R3D_RENDER_FOR_EACH(call, COND, &R3D.viewState.frustum, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
+    R3D_RENDER_FOR_EACH_VISIBLE(call, call->mesh.material.unlit, R3D_RENDER_LIST_OPAQUE_INST, R3D_RENDER_LIST_OPAQUE)
     {
         raster_unlit(call, true);
     }
-    #undef COND
 
     /* --- Render all lit/unlit blended --- */
 
     r3d_driver_enable(GL_BLEND);
     r3d_driver_set_depth_mask(GL_FALSE);
 
-    R3D_RENDER_FOR_EACH(call, IS_MESH_VISIBLE_CAMERA(call->mesh.instance), &R3D.viewState.frustum, R3D_RENDER_LIST_BLEND_INST, R3D_RENDER_LIST_BLEND)
+    R3D_RENDER_FOR_EACH_VISIBLE(call, true, R3D_RENDER_LIST_BLEND_INST, R3D_RENDER_LIST_BLEND)
     {
         if (!call->mesh.material.unlit)
         {
-            upload_light_array_block_for_mesh(call, true);
             raster_forward(call);
         }
         else
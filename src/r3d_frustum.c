@@ -8,8 +8,20 @@
 
 #include <r3d/r3d_frustum.h>
 #include <raymath.h>
+#include <string.h>
 #include <float.h>
 
+#if defined(__AVX__)
+#   include <immintrin.h>
+#   define R3D_FRUSTUM_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   include <xmmintrin.h>
+#   define R3D_FRUSTUM_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define R3D_FRUSTUM_NEON
+#endif
+
 #include "./common/r3d_math.h"
 #include "./r3d_core_state.h"
 
@@ -36,6 +48,182 @@ static inline float distance_to_plane(Vector4 plane, Vector3 position)
     return plane.x*position.x + plane.y*position.y + plane.z*position.z + plane.w;
 }
 
+static inline bool is_box_outside_plane(Vector4 plane, Vector3 absNormal, Vector3 center, Vector3 extents)
+{
+    float distance = distance_to_plane(plane, center);
+    float radius = absNormal.x * extents.x + absNormal.y * extents.y + absNormal.z * extents.z;
+    return distance + radius < -EPSILON;
+}
+
+// ========================================
+// BATCH FUNCTIONS
+// ========================================
+
+/* Each kernel tests as many boxes as its vector width allows and
+ * returns how many it processed, the caller finishes the tail.
+ * Groups never straddle two mask words since 64 is a multiple of the width. */
+
+#if defined(R3D_FRUSTUM_AVX)
+
+static int cull_boxes_simd(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask)
+{
+    __m256 nx[R3D_PLANE_COUNT], ny[R3D_PLANE_COUNT], nz[R3D_PLANE_COUNT], nw[R3D_PLANE_COUNT];
+    __m256 ax[R3D_PLANE_COUNT], ay[R3D_PLANE_COUNT], az[R3D_PLANE_COUNT];
+
+    for (int p = 0; p < R3D_PLANE_COUNT; p++)
+    {
+        const Vector4* plane = &frustum->planes[p];
+        nx[p] = _mm256_set1_ps(plane->x), ax[p] = _mm256_set1_ps(fabsf(plane->x));
+        ny[p] = _mm256_set1_ps(plane->y), ay[p] = _mm256_set1_ps(fabsf(plane->y));
+        nz[p] = _mm256_set1_ps(plane->z), az[p] = _mm256_set1_ps(fabsf(plane->z));
+        nw[p] = _mm256_set1_ps(plane->w);
+    }
+
+    const __m256 negEpsilon = _mm256_set1_ps(-EPSILON);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(boxes->centerX + i);
+        __m256 cy = _mm256_loadu_ps(boxes->centerY + i);
+        __m256 cz = _mm256_loadu_ps(boxes->centerZ + i);
+        __m256 ex = _mm256_loadu_ps(boxes->extentX + i);
+        __m256 ey = _mm256_loadu_ps(boxes->extentY + i);
+        __m256 ez = _mm256_loadu_ps(boxes->extentZ + i);
+
+        __m256 outside = _mm256_setzero_ps();
+
+        for (int p = 0; p < R3D_PLANE_COUNT; p++)
+        {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(nx[p], cx), nw[p]);
+            d = _mm256_add_ps(d, _mm256_mul_ps(ny[p], cy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(nz[p], cz));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ax[p], ex));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ay[p], ey));
+            d = _mm256_add_ps(d, _mm256_mul_ps(az[p], ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, negEpsilon, _CMP_LT_OQ));
+        }
+
+        uint64_t visible = ~(unsigned)_mm256_movemask_ps(outside) & 0xFFu;
+        outMask[i >> 6] |= visible << (i & 63);
+    }
+
+    return i;
+}
+
+#elif defined(R3D_FRUSTUM_SSE)
+
+static int cull_boxes_simd(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask)
+{
+    __m128 nx[R3D_PLANE_COUNT], ny[R3D_PLANE_COUNT], nz[R3D_PLANE_COUNT], nw[R3D_PLANE_COUNT];
+    __m128 ax[R3D_PLANE_COUNT], ay[R3D_PLANE_COUNT], az[R3D_PLANE_COUNT];
+
+    for (int p = 0; p < R3D_PLANE_COUNT; p++)
+    {
+        const Vector4* plane = &frustum->planes[p];
+        nx[p] = _mm_set1_ps(plane->x), ax[p] = _mm_set1_ps(fabsf(plane->x));
+        ny[p] = _mm_set1_ps(plane->y), ay[p] = _mm_set1_ps(fabsf(plane->y));
+        nz[p] = _mm_set1_ps(plane->z), az[p] = _mm_set1_ps(fabsf(plane->z));
+        nw[p] = _mm_set1_ps(plane->w);
+    }
+
+    const __m128 negEpsilon = _mm_set1_ps(-EPSILON);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(boxes->centerX + i);
+        __m128 cy = _mm_loadu_ps(boxes->centerY + i);
+        __m128 cz = _mm_loadu_ps(boxes->centerZ + i);
+        __m128 ex = _mm_loadu_ps(boxes->extentX + i);
+        __m128 ey = _mm_loadu_ps(boxes->extentY + i);
+        __m128 ez = _mm_loadu_ps(boxes->extentZ + i);
+
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < R3D_PLANE_COUNT; p++)
+        {
+            __m128 d = _mm_add_ps(_mm_mul_ps(nx[p], cx), nw[p]);
+            d = _mm_add_ps(d, _mm_mul_ps(ny[p], cy));
+            d = _mm_add_ps(d, _mm_mul_ps(nz[p], cz));
+            d = _mm_add_ps(d, _mm_mul_ps(ax[p], ex));
+            d = _mm_add_ps(d, _mm_mul_ps(ay[p], ey));
+            d = _mm_add_ps(d, _mm_mul_ps(az[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negEpsilon));
+        }
+
+        uint64_t visible = ~(unsigned)_mm_movemask_ps(outside) & 0xFu;
+        outMask[i >> 6] |= visible << (i & 63);
+    }
+
+    return i;
+}
+
+#elif defined(R3D_FRUSTUM_NEON)
+
+static int cull_boxes_simd(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask)
+{
+    float32x4_t nx[R3D_PLANE_COUNT], ny[R3D_PLANE_COUNT], nz[R3D_PLANE_COUNT], nw[R3D_PLANE_COUNT];
+    float32x4_t ax[R3D_PLANE_COUNT], ay[R3D_PLANE_COUNT], az[R3D_PLANE_COUNT];
+
+    for (int p = 0; p < R3D_PLANE_COUNT; p++)
+    {
+        const Vector4* plane = &frustum->planes[p];
+        nx[p] = vdupq_n_f32(plane->x), ax[p] = vdupq_n_f32(fabsf(plane->x));
+        ny[p] = vdupq_n_f32(plane->y), ay[p] = vdupq_n_f32(fabsf(plane->y));
+        nz[p] = vdupq_n_f32(plane->z), az[p] = vdupq_n_f32(fabsf(plane->z));
+        nw[p] = vdupq_n_f32(plane->w);
+    }
+
+    const float32x4_t negEpsilon = vdupq_n_f32(-EPSILON);
+    const uint32_t laneBits[4] = {1, 2, 4, 8};
+    const uint32x4_t laneMask = vld1q_u32(laneBits);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t cx = vld1q_f32(boxes->centerX + i);
+        float32x4_t cy = vld1q_f32(boxes->centerY + i);
+        float32x4_t cz = vld1q_f32(boxes->centerZ + i);
+        float32x4_t ex = vld1q_f32(boxes->extentX + i);
+        float32x4_t ey = vld1q_f32(boxes->extentY + i);
+        float32x4_t ez = vld1q_f32(boxes->extentZ + i);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+
+        for (int p = 0; p < R3D_PLANE_COUNT; p++)
+        {
+            float32x4_t d = vmlaq_f32(nw[p], nx[p], cx);
+            d = vmlaq_f32(d, ny[p], cy);
+            d = vmlaq_f32(d, nz[p], cz);
+            d = vmlaq_f32(d, ax[p], ex);
+            d = vmlaq_f32(d, ay[p], ey);
+            d = vmlaq_f32(d, az[p], ez);
+            outside = vorrq_u32(outside, vcltq_f32(d, negEpsilon));
+        }
+
+        // Horizontal add of the lane bits, works on both ARMv7 and AArch64
+        uint32x4_t bits = vandq_u32(outside, laneMask);
+        uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+        sum = vpadd_u32(sum, sum);
+
+        uint64_t visible = ~vget_lane_u32(sum, 0) & 0xFu;
+        outMask[i >> 6] |= visible << (i & 63);
+    }
+
+    return i;
+}
+
+#else
+
+static int cull_boxes_simd(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask)
+{
+    (void)frustum, (void)boxes, (void)count, (void)outMask;
+    return 0;
+}
+
+#endif
+
 // ========================================
 // PUBLIC API
 // ========================================
@@ -227,3 +415,33 @@ bool R3D_FrustumIntersectsOrientedBox(const R3D_Frustum* frustum, R3D_OrientedBo
 
     return true;
 }
+
+void R3D_FrustumCullBoxes(const R3D_Frustum* frustum, const R3D_BoxArray* boxes, int count, uint64_t* outMask)
+{
+    if (count <= 0) return;
+
+    memset(outMask, 0, ((size_t)count + 63) / 64 * sizeof(uint64_t));
+
+    int i = cull_boxes_simd(frustum, boxes, count, outMask);
+
+    Vector3 absNormals[R3D_PLANE_COUNT];
+    for (int p = 0; p < R3D_PLANE_COUNT; p++)
+    {
+        const Vector4* plane = &frustum->planes[p];
+        absNormals[p] = (Vector3) {fabsf(plane->x), fabsf(plane->y), fabsf(plane->z)};
+    }
+
+    for (; i < count; i++)
+    {
+        Vector3 center = {boxes->centerX[i], boxes->centerY[i], boxes->centerZ[i]};
+        Vector3 extents = {boxes->extentX[i], boxes->extentY[i], boxes->extentZ[i]};
+
+        bool visible = true;
+        for (int p = 0; p < R3D_PLANE_COUNT && visible; p++)
+        {
+            visible = !is_box_outside_plane(frustum->planes[p], absNormals[p], center, extents);
+        }
+
+        if (visible) outMask[i >> 6] |= 1ull << (i & 63);
+    }
+}
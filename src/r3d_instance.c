@@ -15,13 +15,15 @@
 #include <glad.h>
 
 #include "./modules/r3d_driver.h"
+#include "./modules/r3d_render.h"
 #include "./common/r3d_helper.h"
 
 // ========================================
 // INTERNAL CONSTANTS
 // ========================================
 
-#define R3D_INSTANCE_VALID_FLAGS ((1u << R3D_INSTANCE_ATTRIBUTE_COUNT) - 1u)
+#define R3D_INSTANCE_ATTRIBUTE_FLAGS ((1u << R3D_INSTANCE_ATTRIBUTE_COUNT) - 1u)
+#define R3D_INSTANCE_VALID_FLAGS (R3D_INSTANCE_ATTRIBUTE_FLAGS | R3D_INSTANCE_CULLING)
 
 static const size_t INSTANCE_ATTRIBUTE_COMPONENTS[R3D_INSTANCE_ATTRIBUTE_COUNT] = {
     /* POSITION */  3,
@@ -116,12 +118,18 @@ R3D_InstanceBuffer R3D_LoadInstanceBufferEx(int capacity, R3D_InstanceLayout lay
         return buffer;
     }
 
-    if (layout.flags == 0)
+    if ((layout.flags & R3D_INSTANCE_ATTRIBUTE_FLAGS) == 0)
     {
         R3D_TRACELOG(LOG_WARNING, "InstanceBuffer -> no attributes requested");
         return buffer;
     }
 
+    if (R3D_BIT_ANY(layout.flags, R3D_INSTANCE_CULLING) && !R3D_BIT_ANY(layout.flags, R3D_INSTANCE_POSITION))
+    {
+        R3D_TRACELOG(LOG_WARNING, "InstanceBuffer -> culling requires the position attribute, culling disabled");
+        R3D_BIT_CLEAR(layout.flags, R3D_INSTANCE_CULLING);
+    }
+
     glGenBuffers(R3D_INSTANCE_ATTRIBUTE_COUNT, buffer.buffers);
 
     for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
@@ -152,6 +160,18 @@ R3D_InstanceBuffer R3D_LoadInstanceBufferEx(int capacity, R3D_InstanceLayout lay
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+    // Allocate the CPU copies used for per-instance culling
+    if (R3D_BIT_ANY(layout.flags, R3D_INSTANCE_CULLING))
+    {
+        r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_add(buffer.buffers[0]);
+
+        for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+        {
+            if (!R3D_BIT_ANY(layout.flags, 1u << i)) continue;
+            cpuCopy->data[i] = r3d_malloc((size_t)capacity * get_attribute_size(i, layout.formats[i]));
+        }
+    }
+
     buffer.capacity = capacity;
     buffer.layout = layout;
 
@@ -162,6 +182,11 @@ R3D_InstanceBuffer R3D_LoadInstanceBufferEx(int capacity, R3D_InstanceLayout lay
 
 void R3D_UnloadInstanceBuffer(R3D_InstanceBuffer buffer)
 {
+    if (R3D_BIT_ANY(buffer.layout.flags, R3D_INSTANCE_CULLING))
+    {
+        r3d_render_instance_cpu_copy_remove(buffer.buffers[0]);
+    }
+
     glDeleteBuffers(R3D_INSTANCE_ATTRIBUTE_COUNT, buffer.buffers);
 }
 
@@ -181,6 +206,8 @@ void R3D_ResizeInstanceBuffer(R3D_InstanceBuffer* buffer, int newCapacity, bool
         return;
     }
 
+    GLuint oldKey = buffer->buffers[0];
+
     if (!keepData)
     {
         // Orphan path: reallocate existing buffers in-place, avoids GPU stall and new IDs
@@ -285,6 +312,25 @@ void R3D_ResizeInstanceBuffer(R3D_InstanceBuffer* buffer, int newCapacity, bool
         memcpy(buffer->buffers, newBuffers, sizeof(newBuffers));
     }
 
+    // Grow the CPU copies, their content follows the GPU buffers
+    r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_rekey(oldKey, buffer->buffers[0]);
+    if (cpuCopy != NULL)
+    {
+
+        for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
+        {
+            if (cpuCopy->data[i] == NULL) continue;
+
+            size_t attrSize = get_attribute_size(i, buffer->layout.formats[i]);
+            size_t oldSize = keepData ? (size_t)buffer->capacity * attrSize : 0;
+            size_t newSize = (size_t)newCapacity * attrSize;
+
+            cpuCopy->data[i] = r3d_realloc(cpuCopy->data[i], newSize);
+            memset(cpuCopy->data[i] + oldSize, 0, newSize - oldSize);
+            cpuCopy->mapSize[i] = 0;
+        }
+    }
+
     buffer->capacity = newCapacity;
     R3D_TRACELOG(LOG_INFO, "Instance buffer resized successfully (capacity=%d)", newCapacity);
 }
@@ -333,6 +379,12 @@ void R3D_UploadInstances(R3D_InstanceBuffer buffer, R3D_InstanceFlags flag,
     size_t uploadSize = (size_t)count * attrSize;
     size_t offsetBytes = (size_t)offset * attrSize;
 
+    r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_get(buffer.buffers[0]);
+    if (cpuCopy != NULL && cpuCopy->data[index] != NULL)
+    {
+        memcpy(cpuCopy->data[index] + offsetBytes, data, uploadSize);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, buffer.buffers[index]);
 
     // Orphan the buffer to avoid GPU sync; old data is discarded entirely
@@ -399,6 +451,16 @@ void* R3D_MapInstancesEx(R3D_InstanceBuffer buffer, R3D_InstanceFlags flag,
     GLintptr offsetBytes = (GLintptr)((size_t)offset * attrSize);
     GLsizeiptr rangeSize = (GLsizeiptr)((size_t)count * attrSize);
 
+    // Culling buffers are written through their CPU copy, the range is uploaded on unmap
+    r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_get(buffer.buffers[0]);
+    if (cpuCopy != NULL && cpuCopy->data[index] != NULL)
+    {
+        cpuCopy->mapOffset[index] = (size_t)offsetBytes;
+        cpuCopy->mapSize[index] = (size_t)rangeSize;
+        cpuCopy->mapDiscard[index] = discard;
+        return cpuCopy->data[index] + offsetBytes;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, buffer.buffers[index]);
 
     r3d_driver_clear_errors();
@@ -423,6 +485,8 @@ void R3D_UnmapInstances(R3D_InstanceBuffer buffer, R3D_InstanceFlags flags)
         flags &= R3D_INSTANCE_VALID_FLAGS;
     }
 
+    r3d_render_instance_cpu_copy_t* cpuCopy = r3d_render_instance_cpu_copy_get(buffer.buffers[0]);
+
     for (int i = 0; i < R3D_INSTANCE_ATTRIBUTE_COUNT; i++)
     {
         R3D_InstanceFlags flag = 1u << i;
@@ -440,6 +504,31 @@ void R3D_UnmapInstances(R3D_InstanceBuffer buffer, R3D_InstanceFlags flags)
 
         glBindBuffer(GL_ARRAY_BUFFER, buffer.buffers[i]);
 
+        // Culling buffers: upload the range written in the CPU copy
+        if (cpuCopy != NULL && cpuCopy->data[i] != NULL)
+        {
+            if (cpuCopy->mapSize[i] == 0) continue;
+
+            GLbitfield mapFlags = GL_MAP_WRITE_BIT;
+            if (cpuCopy->mapDiscard[i]) mapFlags |= GL_MAP_INVALIDATE_RANGE_BIT;
+
+            r3d_driver_clear_errors();
+            void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)cpuCopy->mapOffset[i], (GLsizeiptr)cpuCopy->mapSize[i], mapFlags);
+
+            if (ptr != NULL)
+            {
+                memcpy(ptr, cpuCopy->data[i] + cpuCopy->mapOffset[i], cpuCopy->mapSize[i]);
+                if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+                {
+                    R3D_TRACELOG(LOG_WARNING, "UnmapInstances -> GPU data may be corrupted (flag=0x%04x)", flag);
+                }
+            }
+
+            r3d_driver_check_error("UnmapInstances -> failed to upload the mapped range");
+            cpuCopy->mapSize[i] = 0;
+            continue;
+        }
+
         r3d_driver_clear_errors();
         if (!glUnmapBuffer(GL_ARRAY_BUFFER))
         {
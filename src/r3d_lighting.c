@@ -80,6 +80,16 @@ R3D_Light R3D_CreateOmniLight(Vector3 pos, float range, Color color, float energ
     return light;
 }
 
+void R3D_SetLightBudget(int maxLights)
+{
+    R3D_MOD_LIGHT.lightBudget = R3D_MAX(maxLights, 0);
+}
+
+int R3D_GetLightBudget(void)
+{
+    return R3D_MOD_LIGHT.lightBudget;
+}
+
 // ----------------------------------------
 // Shadow Config Functions
 // ----------------------------------------
@@ -88,14 +98,14 @@ R3D_ShadowMap R3D_LoadShadowMap(R3D_LightType type)
 {
     R3D_ShadowMap shadowMap = {0};
 
-    int layer = r3d_light_acquire_shadow_layer(type);
-    if (!r3d_light_shadow_layer_is_valid(type, layer))
+    int index = r3d_light_acquire_shadow_map(type);
+    if (!r3d_light_shadow_map_is_valid(type, index))
     {
         R3D_TRACELOG(LOG_WARNING, "Failed to load shadow map (type: %s)", r3d_light_type_name(type));
         return shadowMap;
     }
 
-    shadowMap.handle   = (uint32_t)(1 + layer);
+    shadowMap.handle   = (uint32_t)(1 + index);
     shadowMap.softness = 1.0f;
     shadowMap.opacity  = 1.0f;
     shadowMap.cullMask = R3D_LAYER_ALL;
@@ -106,6 +116,11 @@ R3D_ShadowMap R3D_LoadShadowMap(R3D_LightType type)
     case R3D_LIGHT_DIR:
         shadowMap.depthBias = 0.0001f;
         shadowMap.slopeBias = 0.0015f;
+        shadowMap.cascadeSplit = 0.75f;
+        shadowMap.cascadeUpdateInterval[0] = 1;
+        shadowMap.cascadeUpdateInterval[1] = 1;
+        shadowMap.cascadeUpdateInterval[2] = 2;
+        shadowMap.cascadeUpdateInterval[3] = 4;
         break;
 
     case R3D_LIGHT_SPOT:
@@ -129,14 +144,29 @@ R3D_ShadowMap R3D_LoadShadowMap(R3D_LightType type)
 
 void R3D_UnloadShadowMap(R3D_ShadowMap shadowMap)
 {
-    r3d_light_release_shadow_layer(shadowMap.type, (int)shadowMap.handle - 1);
+    r3d_light_release_shadow_map(shadowMap.type, (int)shadowMap.handle - 1);
 
     R3D_TRACELOG(LOG_INFO, "Shadow map unloaded successfully (type: %s)", r3d_light_type_name(shadowMap.type));
 }
 
 bool R3D_IsShadowMapValid(R3D_ShadowMap shadowMap)
 {
-    return r3d_light_shadow_layer_is_valid(shadowMap.type, (int)shadowMap.handle - 1);
+    return r3d_light_shadow_map_is_valid(shadowMap.type, (int)shadowMap.handle - 1);
+}
+
+void R3D_SetShadowUpdateBudget(int maxFaces)
+{
+    R3D_MOD_LIGHT.shadowBudget = R3D_MAX(maxFaces, 0);
+}
+
+int R3D_GetShadowUpdateBudget(void)
+{
+    return R3D_MOD_LIGHT.shadowBudget;
+}
+
+R3D_ShadowStats R3D_GetShadowStats(void)
+{
+    return R3D_MOD_LIGHT.shadowStats;
 }
 
 // ----------------------------------------
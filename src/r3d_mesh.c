@@ -16,6 +16,20 @@
 #include "./modules/r3d_render.h"
 #include "./common/r3d_helper.h"
 
+// ========================================
+// INTERNAL FUNCTIONS
+// ========================================
+
+static bool has_vertex_alpha(R3D_MeshData data)
+{
+    for (int i = 0; i < data.vertexCount; i++)
+    {
+        if (data.vertices[i].color.a < 255) return true;
+    }
+
+    return false;
+}
+
 // ========================================
 // PUBLIC API
 // ========================================
@@ -52,6 +66,7 @@ R3D_Mesh R3D_LoadMesh(R3D_PrimitiveType type, R3D_MeshData data, const BoundingB
     mesh.shadowCastMode = R3D_SHADOW_CAST_ON_AUTO;
     mesh.layerMask = R3D_LAYER_01;
     mesh.primitiveType = type;
+    mesh.vertexAlpha = has_vertex_alpha(data);
 
     // Compute the bounding box, if needed
     mesh.aabb = (aabb != NULL) ? *aabb
@@ -387,6 +402,7 @@ bool R3D_UpdateMesh(R3D_Mesh* mesh, R3D_MeshData data, const BoundingBox* aabb)
 
     mesh->vertexCount = data.vertexCount;
     mesh->indexCount = data.indexCount;
+    mesh->vertexAlpha = has_vertex_alpha(data);
 
     mesh->aabb = (aabb != NULL) ? *aabb
         : R3D_CalculateMeshDataBoundingBox(data);
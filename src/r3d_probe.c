@@ -31,6 +31,9 @@ R3D_Probe R3D_LoadProbe(R3D_ProbeType type, bool interior, bool shadow)
     case R3D_PROBE_REFLECTION:
         layer = r3d_env_prefilter_acquire_layer();
         break;
+    case R3D_PROBE_ILLUMINATION_SH:
+        layer = r3d_env_sh_acquire_layer();
+        break;
     }
 
     if (!r3d_env_probe_layer_is_valid(type, layer))
@@ -62,6 +65,9 @@ void R3D_UnloadProbe(R3D_Probe probe)
     case R3D_PROBE_REFLECTION:
         r3d_env_prefilter_release_layer((int)probe.handle - 1);
         break;
+    case R3D_PROBE_ILLUMINATION_SH:
+        r3d_env_sh_release_layer((int)probe.handle - 1);
+        break;
     }
 
     R3D_TRACELOG(LOG_INFO, "Probe unloaded successfully (type: %s)", r3d_env_probe_type_name(probe.type));